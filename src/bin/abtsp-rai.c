@@ -21,9 +21,11 @@ int solve_btsp = ARROW_FALSE;
 int lower_bound = -1;
 int upper_bound = INT_MAX;
 int basic_attempts = 1;
+int threads = 1;
+int restart_interval = 0;
 
 /* Program options */
-#define NUM_OPTS 9
+#define NUM_OPTS 11
 arrow_option options[NUM_OPTS] = 
 {
     {'i', "input", "TSPLIB input file", 
@@ -37,6 +39,10 @@ arrow_option options[NUM_OPTS] =
         ARROW_OPTION_INT, &iterations, ARROW_FALSE, ARROW_TRUE},
     {'b', "solve-btsp", "use BTSP formulation in RAI algorithm",
         ARROW_OPTION_INT, &solve_btsp, ARROW_FALSE, ARROW_FALSE},
+    {'p', "threads", "number of RAI worker threads",
+        ARROW_OPTION_INT, &threads, ARROW_FALSE, ARROW_TRUE},
+    {'R', "restart-interval", "iterations between restarts from best tour",
+        ARROW_OPTION_INT, &restart_interval, ARROW_FALSE, ARROW_TRUE},
         
     {'e', "supress-ebst", "supress binary search",
         ARROW_OPTION_INT, &supress_ebst, ARROW_FALSE, ARROW_FALSE},
@@ -101,9 +107,11 @@ main(int argc, char *argv[])
     }
     
     /* Set up RAI parameters */
-    if(iterations < 0) iterations = problem.size * problem.size;
-    rai_params.iterations = iterations;
+    arrow_tsp_rai_params_init(&problem, &rai_params);
+    if(iterations >= 0) rai_params.iterations = iterations;
     rai_params.solve_btsp = solve_btsp;
+    rai_params.threads = threads;
+    rai_params.restart_interval = restart_interval;
         
     /* Setup necessary function structures */
     if(arrow_btsp_fun_basic(ARROW_TRUE, &fun_basic) != ARROW_SUCCESS)
@@ -31,9 +31,11 @@ int shake_rand_min = 0;
 int shake_rand_max = -1;
 int random_seed = 0;
 int with_improvements = ARROW_FALSE;
+char *checkpoint_file = NULL;
+double checkpoint_interval = 300.0;
 
 /* Program options */
-#define NUM_OPTS 19
+#define NUM_OPTS 21
 arrow_option options[NUM_OPTS] = 
 {
     {'i', "input", "TSPLIB input file", 
@@ -77,7 +79,11 @@ arrow_option options[NUM_OPTS] =
     {'g', "random-seed", "random number generator seed",
         ARROW_OPTION_INT, &random_seed, ARROW_FALSE, ARROW_TRUE},
     {'W', "with-improvements", "use improvements (faster, poor quality solution)",
-        ARROW_OPTION_INT, &with_improvements, ARROW_FALSE, ARROW_FALSE}
+        ARROW_OPTION_INT, &with_improvements, ARROW_FALSE, ARROW_FALSE},
+    {'C', "checkpoint", "file to save the search to and resume it from",
+        ARROW_OPTION_STRING, &checkpoint_file, ARROW_FALSE, ARROW_TRUE},
+    {'K', "checkpoint-interval", "wall-clock seconds between checkpoints",
+        ARROW_OPTION_DOUBLE, &checkpoint_interval, ARROW_FALSE, ARROW_TRUE}
 };
 char *desc = "Balanced traveling salesman problem (BalTSP) solver";
 char *usage = "-i tsplib.tsp [options]";
@@ -98,8 +104,10 @@ main(int argc, char *argv[])
     arrow_btsp_fun fun_dt2;
     double lb_time;
     arrow_btsp_result tour_result;
+    arrow_btsp_checkpoint checkpoint;
     arrow_baltsp_params baltsp_params;
     arrow_btsp_params btsp_params;
+    arrow_btsp_memo memo;
     
     double start_time = arrow_util_zeit();
     double end_time;
@@ -223,10 +231,30 @@ main(int argc, char *argv[])
     btsp_params.steps               = btsp_steps;
     btsp_params.infinity            = edge_infinity;
     btsp_params.deep_copy           = deep_copy;
+    
+    /* Share feasibility verdicts between every solve in the search */
+    if(!arrow_btsp_memo_init(&memo))
+        return EXIT_FAILURE;
+    baltsp_params.memo              = &memo;
+    btsp_params.memo.memo           = &memo;
 
     
     /* Setup BalTSP results structure and solve BalTSP */
     arrow_btsp_result_init(&problem, &tour_result);
+    if(checkpoint_file != NULL)
+    {
+        arrow_btsp_checkpoint_init(checkpoint_file, "baltsp-db",
+                                   checkpoint_interval, &checkpoint);
+        if(!arrow_btsp_checkpoint_resume(&checkpoint, &problem, &info, 
+                                         &tour_result))
+        {
+            ret = EXIT_FAILURE;
+            goto CLEANUP;
+        }
+        if(checkpoint.resumed)
+            printf("Resuming search from %s\n", checkpoint_file);
+        baltsp_params.checkpoint = &checkpoint;
+    }
     if(!arrow_balanced_tsp_db(&problem, &mstsp_problem, &info, &baltsp_params, &btsp_params, &lb_time, &tour_result))
     {
         arrow_print_error("Could not solve BalTSP on given problem.\n");
@@ -289,6 +317,7 @@ main(int argc, char *argv[])
     }
     
     printf("Total Tour Solve Time: %.2f\n", tour_result.total_time);
+    printf("Memo Hits: %d of %d\n", memo.hits, memo.lookups);
     printf("Total Time: %.2f\n", end_time);
     
     
@@ -385,6 +414,7 @@ main(int argc, char *argv[])
     
     
 CLEANUP:
+    arrow_btsp_memo_destruct(&memo);
     arrow_btsp_result_destruct(&tour_result);
     arrow_btsp_fun_destruct(&fun_dt2);
     arrow_btsp_fun_destruct(&fun_shake);
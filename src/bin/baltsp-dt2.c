@@ -31,9 +31,11 @@ int shake_rand_min = 0;
 int shake_rand_max = -1;
 int random_seed = 0;
 int with_improvements = ARROW_FALSE;
+char *checkpoint_file = NULL;
+double checkpoint_interval = 300.0;
 
 /* Program options */
-#define NUM_OPTS 19
+#define NUM_OPTS 21
 arrow_option options[NUM_OPTS] = 
 {
     {'i', "input", "TSPLIB input file", 
@@ -77,7 +79,11 @@ arrow_option options[NUM_OPTS] =
     {'g', "random-seed", "random number generator seed",
         ARROW_OPTION_INT, &random_seed, ARROW_FALSE, ARROW_TRUE},
     {'W', "with-improvements", "use improvements (faster, poor quality solution)",
-        ARROW_OPTION_INT, &with_improvements, ARROW_FALSE, ARROW_FALSE}
+        ARROW_OPTION_INT, &with_improvements, ARROW_FALSE, ARROW_FALSE},
+    {'C', "checkpoint", "file to save the search to and resume it from",
+        ARROW_OPTION_STRING, &checkpoint_file, ARROW_FALSE, ARROW_TRUE},
+    {'K', "checkpoint-interval", "wall-clock seconds between checkpoints",
+        ARROW_OPTION_DOUBLE, &checkpoint_interval, ARROW_FALSE, ARROW_TRUE}
 };
 char *desc = "Balanced traveling salesman problem (BalTSP) solver";
 char *usage = "-i tsplib.tsp [options]";
@@ -96,6 +102,7 @@ main(int argc, char *argv[])
     arrow_btsp_fun fun_dt2;
     double lb_time;
     arrow_btsp_result tour_result;
+    arrow_btsp_checkpoint checkpoint;
     arrow_baltsp_params baltsp_params;
     
     double start_time = arrow_util_zeit();
@@ -200,6 +207,20 @@ main(int argc, char *argv[])
     
     /* Setup BalTSP results structure and solve BTSP */
     arrow_btsp_result_init(&problem, &tour_result);
+    if(checkpoint_file != NULL)
+    {
+        arrow_btsp_checkpoint_init(checkpoint_file, "baltsp-dt2",
+                                   checkpoint_interval, &checkpoint);
+        if(!arrow_btsp_checkpoint_resume(&checkpoint, &problem, &info, 
+                                         &tour_result))
+        {
+            ret = EXIT_FAILURE;
+            goto CLEANUP;
+        }
+        if(checkpoint.resumed)
+            printf("Resuming search from %s\n", checkpoint_file);
+        baltsp_params.checkpoint = &checkpoint;
+    }
     if(!arrow_balanced_tsp_dt2(&problem, &info, &baltsp_params, &lb_time, &tour_result))
     {
         arrow_print_error("Could not solve BalTSP on given problem.\n");
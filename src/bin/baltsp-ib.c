@@ -30,9 +30,11 @@ int shake_rand_max = -1;
 int random_seed = 0;
 int lb_only = ARROW_FALSE;
 int with_improvements = ARROW_FALSE;
+char *checkpoint_file = NULL;
+double checkpoint_interval = 300.0;
 
 /* Program options */
-#define NUM_OPTS 18
+#define NUM_OPTS 20
 arrow_option options[NUM_OPTS] = 
 {
     {'i', "input", "TSPLIB input file", 
@@ -75,7 +77,11 @@ arrow_option options[NUM_OPTS] =
     {'L', "lb-only", "only check lower bound gap",
         ARROW_OPTION_INT, &lb_only, ARROW_FALSE, ARROW_FALSE},
     {'W', "with-improvements", "use improvements (faster, poor quality solution)",
-        ARROW_OPTION_INT, &with_improvements, ARROW_FALSE, ARROW_FALSE}
+        ARROW_OPTION_INT, &with_improvements, ARROW_FALSE, ARROW_FALSE},
+    {'C', "checkpoint", "file to save the search to and resume it from",
+        ARROW_OPTION_STRING, &checkpoint_file, ARROW_FALSE, ARROW_TRUE},
+    {'K', "checkpoint-interval", "wall-clock seconds between checkpoints",
+        ARROW_OPTION_DOUBLE, &checkpoint_interval, ARROW_FALSE, ARROW_TRUE}
 };
 char *desc = "Balanced traveling salesman problem (BalTSP) solver";
 char *usage = "-i tsplib.tsp [options]";
@@ -94,6 +100,7 @@ main(int argc, char *argv[])
     arrow_btsp_fun fun_shake;
     arrow_bound_result lb_result;
     arrow_btsp_result tour_result;
+    arrow_btsp_checkpoint checkpoint;
     arrow_btsp_params btsp_params;
     
     double start_time = arrow_util_zeit();
@@ -190,6 +197,20 @@ main(int argc, char *argv[])
     
     /* Setup BTSP results structure and solve BTSP */
     arrow_btsp_result_init(&problem, &tour_result);
+    if(checkpoint_file != NULL)
+    {
+        arrow_btsp_checkpoint_init(checkpoint_file, "baltsp-ib",
+                                   checkpoint_interval, &checkpoint);
+        if(!arrow_btsp_checkpoint_resume(&checkpoint, &problem, &info, 
+                                         &tour_result))
+        {
+            ret = EXIT_FAILURE;
+            goto CLEANUP;
+        }
+        if(checkpoint.resumed)
+            printf("Resuming search from %s\n", checkpoint_file);
+        btsp_params.checkpoint = &checkpoint;
+    }
     if(!arrow_balanced_tsp_ib(&problem, &info, &btsp_params, lb_only,
                               with_improvements, &lb_result, &tour_result))
     {
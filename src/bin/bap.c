@@ -71,7 +71,7 @@ main(int argc, char *argv[])
         return EXIT_FAILURE;
     
     /* Solve BAP */
-    if(!arrow_bap_solve(problem, &info, &result))
+    if(!arrow_bap_solve(problem, &info, NULL, &result))
     {
         arrow_print_error("Could not solve BAP on file.");
         return EXIT_FAILURE;
@@ -89,7 +89,7 @@ main(int argc, char *argv[])
     }
     
     /* Solve BBSSP */
-    if(!arrow_bbssp_solve(problem, &info, &result))
+    if(!arrow_bbssp_solve(problem, &info, NULL, &result))
     {
         arrow_print_error("Could not solve BBSSP on file.");
         return EXIT_FAILURE;
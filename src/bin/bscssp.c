@@ -73,7 +73,7 @@ main(int argc, char *argv[])
         return EXIT_FAILURE;
     
     /* Solve BAP */
-    if(!arrow_bscssp_solve(problem, &info, &result))
+    if(!arrow_bscssp_solve(problem, &info, NULL, &result))
     {
         arrow_print_error("Could not solve BSCSSP on file.");
         return EXIT_FAILURE;
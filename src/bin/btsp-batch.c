@@ -0,0 +1,259 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Bottleneck traveling salesman problem batch solver.
+ *
+ * Solves the BTSP on every instance listed in a manifest file inside one
+ * process, writing each result out as soon as it is found.
+ *
+ * @author  John LaRusic
+ * @ingroup bin
+ ****************************************************************************/
+#include "common.h"
+#include "lb.h"
+#include "tsp.h"
+#include "btsp.h"
+
+/* Global variables */
+char *manifest_file = NULL;
+char *xml_file = NULL;
+int supress_hash = ARROW_FALSE;
+int deep_copy = ARROW_FALSE;
+int posa_attempts = 0;
+int basic_attempts = 3;
+int basic_restarts = 1;
+int shake_1_attempts = 1;
+int shake_1_restarts = 1;
+int random_seed = 0;
+int search_strategy = ARROW_BTSP_SEARCH_BISECT;
+int threads = 1;
+int quiet = ARROW_FALSE;
+double timebound = 0.0;
+double lb_timebound = 0.0;
+char *trace_file = NULL;
+int trace_format = ARROW_TRACE_JSONL;
+
+/* Program options */
+#define NUM_OPTS 17
+arrow_option options[NUM_OPTS] =
+{
+    {'i', "input", "manifest listing one TSPLIB file per line",
+        ARROW_OPTION_STRING, &manifest_file, ARROW_TRUE, ARROW_TRUE},
+    {'x', "xml", "file to write XML results to (default standard output)",
+        ARROW_OPTION_STRING, &xml_file, ARROW_FALSE, ARROW_TRUE},
+    {'q', "quiet", "discard solver output (always done without -x)",
+        ARROW_OPTION_INT, &quiet, ARROW_FALSE, ARROW_FALSE},
+
+    {'H', "supress-hash", "do not create hash table",
+        ARROW_OPTION_INT, &supress_hash, ARROW_FALSE, ARROW_FALSE},
+    {'d', "deep-copy", "stores data in full cost-matrix",
+        ARROW_OPTION_INT, &deep_copy, ARROW_FALSE, ARROW_FALSE},
+
+    {'p', "posa-attempts", "number of Posa heuristic attempts",
+        ARROW_OPTION_INT, &posa_attempts, ARROW_FALSE, ARROW_TRUE},
+    {'a', "basic-attempts", "number of basic attempts",
+        ARROW_OPTION_INT, &basic_attempts, ARROW_FALSE, ARROW_TRUE},
+    {'A', "basic-restarts", "number of random restarts for basic attempts",
+        ARROW_OPTION_INT, &basic_restarts, ARROW_FALSE, ARROW_TRUE},
+    {'b', "shake-1-attempts", "number of shake type I attempts",
+        ARROW_OPTION_INT, &shake_1_attempts, ARROW_FALSE, ARROW_TRUE},
+    {'B', "shake-1-restarts", "number of random restarts for shake attempts",
+        ARROW_OPTION_INT, &shake_1_restarts, ARROW_FALSE, ARROW_TRUE},
+
+    {'g', "random-seed", "random number generator seed",
+        ARROW_OPTION_INT, &random_seed, ARROW_FALSE, ARROW_TRUE},
+    {'y', "search", "threshold search: 0 bisect, 1 gallop, 2 interpolate, 3 quantile",
+        ARROW_OPTION_INT, &search_strategy, ARROW_FALSE, ARROW_TRUE},
+    {'j', "threads", "number of instances to solve at once",
+        ARROW_OPTION_INT, &threads, ARROW_FALSE, ARROW_TRUE},
+    {'t', "timebound", "wall-clock seconds allowed for each instance",
+        ARROW_OPTION_DOUBLE, &timebound, ARROW_FALSE, ARROW_TRUE},
+    {'L', "lb-timebound", "wall-clock seconds allowed for each lower bound",
+        ARROW_OPTION_DOUBLE, &lb_timebound, ARROW_FALSE, ARROW_TRUE},
+    {'E', "trace", "file to write solver trace events to",
+        ARROW_OPTION_STRING, &trace_file, ARROW_FALSE, ARROW_TRUE},
+    {'F', "trace-format", "trace format: 0 JSON Lines, 1 Chrome trace",
+        ARROW_OPTION_INT, &trace_format, ARROW_FALSE, ARROW_TRUE}
+};
+char *desc = "Bottleneck traveling salesman problem (BTSP) batch solver";
+char *usage = "-i manifest.txt [options]";
+
+/****************************************************************************
+ * Function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Reads the manifest: one file name per line, skipping blank lines
+ *          and lines starting with '#'.
+ *  @param  file_name [in] manifest file
+ *  @param  num_files [out] number of file names read
+ *  @param  file_names [out] array of file names
+ */
+int
+read_manifest(char *file_name, int *num_files, char ***file_names);
+
+/**
+ *  @brief  Writes one instance's result as XML to the file in
+ *          params->report_data.  See arrow_btsp_batch_params for the
+ *          arguments.
+ */
+void
+write_result(arrow_btsp_batch_params *params, int job, const char *file_name,
+             arrow_problem *problem, int ret, int lower_bound,
+             double total_time, arrow_btsp_result *result);
+
+/****************************************************************************
+ * Function implementations
+ ****************************************************************************/
+int
+main(int argc, char *argv[])
+{
+    int ret = EXIT_SUCCESS;
+    int i;
+    int num_files = 0;
+    int old_stdout = -1;
+    char **file_names = NULL;
+    FILE *xml = NULL;
+    arrow_btsp_batch_params params;
+    double start_time = arrow_util_real_zeit();
+
+    /* Read program arguments */
+    if(!arrow_options_parse(NUM_OPTS, options, desc, usage, argc, argv, NULL))
+        return EXIT_FAILURE;
+    if(!read_manifest(manifest_file, &num_files, &file_names))
+        return EXIT_FAILURE;
+
+    /* Solver chatter is only silenced once for the whole batch.  Results
+       written to standard output would interleave with it, so it always
+       goes when there is no xml file. */
+    if(quiet || (xml_file == NULL))
+        arrow_util_redirect_stdout_to_file(ARROW_DEV_NULL, &old_stdout);
+
+    if(xml_file != NULL)
+        xml = fopen(xml_file, "w");
+    else
+        xml = fdopen(dup(old_stdout), "w");
+    if(xml == NULL)
+    {
+        arrow_print_error("Could not open xml file for writing");
+        ret = EXIT_FAILURE;
+        goto CLEANUP;
+    }
+
+    arrow_util_random_seed(random_seed);
+    if((trace_file != NULL) && !arrow_trace_open(trace_file, trace_format))
+    {
+        ret = EXIT_FAILURE;
+        goto CLEANUP;
+    }
+
+    arrow_btsp_batch_params_init(&params);
+    params.threads          = threads;
+    params.deep_copy        = deep_copy;
+    params.supress_hash     = supress_hash;
+    params.posa_attempts    = posa_attempts;
+    params.basic_attempts   = basic_attempts;
+    params.basic_restarts   = basic_restarts;
+    params.shake_1_attempts = shake_1_attempts;
+    params.shake_1_restarts = shake_1_restarts;
+    params.search           = search_strategy;
+    params.timebound        = timebound;
+    params.lb_timebound     = lb_timebound;
+    params.report           = write_result;
+    params.report_data      = xml;
+
+    fprintf(xml, "<arrow_btsp_batch manifest_file=\"%s\" command_args=\"",
+            manifest_file);
+    arrow_util_print_program_args(argc, argv, xml);
+    fprintf(xml, "\">\n");
+    fflush(xml);
+
+    if(!arrow_btsp_solve_batch(num_files, file_names, &params))
+    {
+        arrow_print_error("Could not solve batch.\n");
+        ret = EXIT_FAILURE;
+    }
+
+    fprintf(xml, "    <total_time>%.2f</total_time>\n",
+            arrow_util_real_zeit() - start_time);
+    fprintf(xml, "</arrow_btsp_batch>\n");
+
+CLEANUP:
+    if((trace_file != NULL) && !arrow_trace_close())
+        ret = EXIT_FAILURE;
+    if(old_stdout >= 0)
+        arrow_util_restore_stdout(old_stdout);
+    if(xml != NULL)
+        fclose(xml);
+    for(i = 0; i < num_files; i++)
+        free(file_names[i]);
+    if(file_names != NULL)
+        free(file_names);
+    return ret;
+}
+
+int
+read_manifest(char *file_name, int *num_files, char ***file_names)
+{
+    int len;
+    int max_files = 0;
+    char line[1024];
+    char **names;
+    FILE *in;
+
+    *num_files = 0;
+    *file_names = NULL;
+    if((in = fopen(file_name, "r")) == NULL)
+    {
+        arrow_print_error("Could not open manifest file");
+        return ARROW_FAILURE;
+    }
+
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        len = strlen(line);
+        while((len > 0) && ((line[len - 1] == '\n') || (line[len - 1] == '\r') ||
+                            (line[len - 1] == ' ') || (line[len - 1] == '\t')))
+            line[--len] = '\0';
+        if((len == 0) || (line[0] == '#'))
+            continue;
+
+        if(*num_files == max_files)
+        {
+            max_files = (max_files == 0 ? 64 : max_files * 2);
+            if((names = realloc(*file_names, max_files * sizeof(char *))) == NULL)
+            {
+                arrow_print_error("Could not allocate memory for manifest");
+                fclose(in);
+                return ARROW_FAILURE;
+            }
+            *file_names = names;
+        }
+        if(((*file_names)[*num_files] = malloc(len + 1)) == NULL)
+        {
+            arrow_print_error("Could not allocate memory for manifest");
+            fclose(in);
+            return ARROW_FAILURE;
+        }
+        strcpy((*file_names)[*num_files], line);
+        (*num_files)++;
+    }
+    fclose(in);
+    return ARROW_SUCCESS;
+}
+
+void
+write_result(arrow_btsp_batch_params *params, int job, const char *file_name,
+             arrow_problem *problem, int ret, int lower_bound,
+             double total_time, arrow_btsp_result *result)
+{
+    FILE *xml = (FILE *)params->report_data;
+
+    fprintf(xml, "<arrow_btsp job=\"%d\" problem_file=\"%s\" solved=\"%d\">\n",
+            job, file_name, (ret ? 1 : 0));
+    if(ret && (result != NULL))
+    {
+        arrow_btsp_result_print_xml(result, xml);
+        arrow_xml_element_int("lower_bound", lower_bound, xml);
+    }
+    fprintf(xml, "    <total_time>%.2f</total_time>\n", total_time);
+    fprintf(xml, "</arrow_btsp>\n");
+    fflush(xml);
+}
@@ -26,6 +26,7 @@ int supress_hash = ARROW_FALSE;
 int deep_copy = ARROW_FALSE;
 int lower_bound = -1;
 int upper_bound = INT_MAX;
+int posa_attempts = 0;
 int basic_attempts = 3;
 int basic_restarts = 1;
 int shake_1_attempts = 1;
@@ -33,9 +34,19 @@ int shake_1_restarts = 1;
 int shake_1_rand_min = 0;
 int shake_1_rand_max = -1;
 int random_seed = 0;
+int search_strategy = ARROW_BTSP_SEARCH_BISECT;
+int threads = 1;
+double timebound = 0.0;
+double lb_timebound = 0.0;
+char *checkpoint_file = NULL;
+double checkpoint_interval = 300.0;
+char *trace_file = NULL;
+int trace_format = ARROW_TRACE_JSONL;
+int adaptive = ARROW_FALSE;
+double min_effort = -1.0;
 
 /* Program options */
-#define NUM_OPTS 21
+#define NUM_OPTS 32
 arrow_option options[NUM_OPTS] = 
 {
     {'i', "input", "TSPLIB input file", 
@@ -69,7 +80,11 @@ arrow_option options[NUM_OPTS] =
         ARROW_OPTION_INT, &lower_bound, ARROW_FALSE, ARROW_TRUE},
     {'u', "upper-bound", "initial upper bound",
         ARROW_OPTION_INT, &upper_bound, ARROW_FALSE, ARROW_TRUE},
+    {'L', "lb-timebound", "wall-clock seconds allowed for the lower bounds",
+        ARROW_OPTION_DOUBLE, &lb_timebound, ARROW_FALSE, ARROW_TRUE},
         
+    {'p', "posa-attempts", "number of Posa rotation-extension attempts",
+        ARROW_OPTION_INT, &posa_attempts, ARROW_FALSE, ARROW_TRUE},
     {'a', "basic-attempts", "number of basic attempts",
         ARROW_OPTION_INT, &basic_attempts, ARROW_FALSE, ARROW_TRUE},
     {'A', "basic-restarts", "number of basic restarts",
@@ -85,7 +100,25 @@ arrow_option options[NUM_OPTS] =
         ARROW_OPTION_INT, &shake_1_rand_max, ARROW_FALSE, ARROW_TRUE},
         
     {'g', "random-seed", "random number generator seed",
-        ARROW_OPTION_INT, &random_seed, ARROW_FALSE, ARROW_TRUE}
+        ARROW_OPTION_INT, &random_seed, ARROW_FALSE, ARROW_TRUE},
+    {'y', "search", "threshold search: 0 bisect, 1 gallop, 2 interpolate, 3 quantile",
+        ARROW_OPTION_INT, &search_strategy, ARROW_FALSE, ARROW_TRUE},
+    {'j', "threads", "number of thresholds to probe in parallel",
+        ARROW_OPTION_INT, &threads, ARROW_FALSE, ARROW_TRUE},
+    {'t', "timebound", "wall-clock seconds allowed (best tour is returned)",
+        ARROW_OPTION_DOUBLE, &timebound, ARROW_FALSE, ARROW_TRUE},
+    {'C', "checkpoint", "file to save the search to and resume it from",
+        ARROW_OPTION_STRING, &checkpoint_file, ARROW_FALSE, ARROW_TRUE},
+    {'K', "checkpoint-interval", "wall-clock seconds between checkpoints",
+        ARROW_OPTION_DOUBLE, &checkpoint_interval, ARROW_FALSE, ARROW_TRUE},
+    {'E', "trace", "file to write solver trace events to",
+        ARROW_OPTION_STRING, &trace_file, ARROW_FALSE, ARROW_TRUE},
+    {'F', "trace-format", "trace format: 0 JSON Lines, 1 Chrome trace",
+        ARROW_OPTION_INT, &trace_format, ARROW_FALSE, ARROW_TRUE},
+    {'R', "adaptive", "pick attempts by observed success (adaptive plan)",
+        ARROW_OPTION_INT, &adaptive, ARROW_FALSE, ARROW_FALSE},
+    {'M', "min-effort", "share of attempts for probes far above the bound",
+        ARROW_OPTION_DOUBLE, &min_effort, ARROW_FALSE, ARROW_TRUE}
 };
 char *desc = "Bottleneck traveling salesman problem (BTSP) solver";
 char *usage = "-i tsplib.tsp [options]";
@@ -95,21 +128,32 @@ int
 main(int argc, char *argv[])
 {   
     int ret = EXIT_SUCCESS;
-    int i, u, v, cost;
+    int i, j, u, v, cost;
 
     arrow_problem input_problem;
     arrow_problem asym_problem;
     arrow_problem mstsp_problem;
     arrow_problem *problem;
+    arrow_problem *bound_problem;
     arrow_problem_info info;
+    arrow_tsp_posa_params posa_params;
     arrow_tsp_cc_lk_params lk_basic_params;
     arrow_tsp_cc_lk_params lk_shake_1_params;
     arrow_btsp_fun fun_basic;
     arrow_btsp_fun fun_shake_1;
     arrow_btsp_fun fun_asym_shift;
     arrow_btsp_fun *fun_confirm;
+    arrow_btsp_fun *thread_shake_1 = NULL;
+    arrow_tsp_posa_params *thread_posa = NULL;
+    arrow_tsp_cc_lk_params *thread_lk = NULL;
+    arrow_btsp_solve_plan *thread_plans = NULL;
+    arrow_btsp_solve_plan **thread_steps = NULL;
+    int thread_funs = 0;
     arrow_btsp_result result;
     arrow_btsp_params btsp_params;
+    arrow_btsp_checkpoint checkpoint;
+    arrow_btsp_scheduler scheduler;
+    arrow_context context;
     
     int max_cost = INT_MIN;
     int mstsp_obj_value = -1;
@@ -123,6 +167,13 @@ main(int argc, char *argv[])
     /* Read program arguments */
     if(!arrow_options_parse(NUM_OPTS, options, desc, usage, argc, argv, NULL))
         return EXIT_FAILURE;
+    arrow_context_init(&context);
+    arrow_context_set_timebound(&context, timebound);
+    if((threads > 1) && (search_strategy != ARROW_BTSP_SEARCH_BISECT))
+    {
+        arrow_print_error("Parallel search (-j > 1) can only bisect (-y 0).");
+        return EXIT_FAILURE;
+    }
     
     
     /* Try and read the problem file.  We assume it's symmetric, but do some
@@ -178,7 +229,9 @@ main(int argc, char *argv[])
     printf("Infinity Value:       %d\n", edge_infinity);
 
     
-    /* If the problem's asymmetric, create symmetric from transformation. */
+    /* If the problem's asymmetric, create symmetric from transformation.
+       The lower bounds are found on the problem as given. */
+    bound_problem = problem;
     if(!problem->symmetric)
     {
         if(!arrow_problem_abtsp_to_sbtsp(deep_copy, problem, edge_infinity, &asym_problem))
@@ -191,30 +244,50 @@ main(int argc, char *argv[])
         
     /* Initialize random number generator */
     arrow_util_random_seed(random_seed);
+    
+    /* Start tracing if asked to */
+    if((trace_file != NULL) && !arrow_trace_open(trace_file, trace_format))
+        return EXIT_FAILURE;
+    
+    /* Pick up a saved search if there is one; it also knows the bound */
+    arrow_btsp_result_init(problem, &result);
+    if(checkpoint_file != NULL)
+    {
+        arrow_btsp_checkpoint_init(checkpoint_file, "btsp",
+                                   checkpoint_interval, &checkpoint);
+        if(!arrow_btsp_checkpoint_resume(&checkpoint, problem, &info, &result))
+            return EXIT_FAILURE;
+        if(checkpoint.resumed)
+        {
+            printf("Resuming search from %s\n", checkpoint_file);
+            if(lower_bound < 0)
+                lower_bound = checkpoint.values[2];
+        }
+    }
 
 
     if(lower_bound < 0)
     {
-        /* TODO: Add support for other lower bounds here */
-        /*
-        printf("Solving BBSSP to find a lower bound\n");
-        arrow_bound_result bbssp_result;
-        if(!arrow_bbssp_solve(problem, &info, &bbssp_result))
+        printf("Solving lower bound portfolio\n");
+        arrow_bound_result lb_result;
+        if(!arrow_lb_portfolio_solve(bound_problem, &info, lb_timebound,
+                                     &context, &lb_result))
         {
-            arrow_print_error("Could not solve BBSSP on file.\n");
+            arrow_print_error("Could not solve lower bounds on file.\n");
             return EXIT_FAILURE;
         }
-        lower_bound = bbssp_result.obj_value;
-        lower_bound_time = bbssp_result.total_time;
-        printf("BBSSP lower bound is %d\n.", lower_bound);
-        */
-        lower_bound = info.min_cost;
+        lower_bound = lb_result.obj_value;
+        lower_bound_time = lb_result.total_time;
+        printf("Portfolio lower bound is %d\n", lower_bound);
     }
     
     if(upper_bound < lower_bound)
         upper_bound = info.max_cost;
     
     
+    /* Setup Posa parameters structure */
+    arrow_tsp_posa_params_init(problem, &posa_params);
+    
     /* Setup LK parameters structure */
     arrow_tsp_cc_lk_params_init(problem, &lk_basic_params);
     arrow_tsp_cc_lk_params_init(problem, &lk_shake_1_params);
@@ -246,9 +319,15 @@ main(int argc, char *argv[])
     if(!arrow_btsp_fun_shake_1(deep_copy, edge_infinity, shake_1_rand_min, shake_1_rand_max, &info, &fun_shake_1))
         return EXIT_FAILURE;
         
-    #define SOLVE_STEPS 2
+    #define SOLVE_STEPS 3
     arrow_btsp_solve_plan steps[SOLVE_STEPS] = 
     {
+       {
+           ARROW_TSP_POSA,                  /* TSP solver */
+           (void *)&posa_params,            /* TSP solver parameters */
+           fun_basic,                       /* fun (cost matrix function) */
+           posa_attempts                    /* attempts */
+       },
        {
            ARROW_TSP_CC_LK,                 /* TSP solver */
            (void *)&lk_basic_params,              /* TSP solver parameters */
@@ -264,6 +343,44 @@ main(int argc, char *argv[])
     };
     
     
+    /* Each search thread gets its own copy of the plan, since the shake
+       function keeps its random numbers in its data, and of the solver
+       parameters, so no two threads touch the same structure */
+    if(threads > 1)
+    {
+        if(((thread_shake_1 = malloc(threads * sizeof(arrow_btsp_fun))) == NULL) ||
+           ((thread_posa = malloc(threads * 
+                                  sizeof(arrow_tsp_posa_params))) == NULL) ||
+           ((thread_lk = malloc(threads * 2 * 
+                                sizeof(arrow_tsp_cc_lk_params))) == NULL) ||
+           ((thread_plans = malloc(threads * SOLVE_STEPS * 
+                                   sizeof(arrow_btsp_solve_plan))) == NULL) ||
+           ((thread_steps = malloc(threads * 
+                                   sizeof(arrow_btsp_solve_plan *))) == NULL))
+        {
+            arrow_print_error("Could not allocate per-thread solve plans.");
+            return EXIT_FAILURE;
+        }
+        for(i = 0; i < threads; i++)
+        {
+            if(!arrow_btsp_fun_shake_1(deep_copy, edge_infinity, shake_1_rand_min, 
+                                       shake_1_rand_max, &info, &(thread_shake_1[i])))
+                return EXIT_FAILURE;
+            thread_funs++;
+            thread_posa[i] = posa_params;
+            thread_lk[i * 2] = lk_basic_params;
+            thread_lk[i * 2 + 1] = lk_shake_1_params;
+            
+            thread_steps[i] = &(thread_plans[i * SOLVE_STEPS]);
+            for(j = 0; j < SOLVE_STEPS; j++)
+                thread_steps[i][j] = steps[j];
+            thread_steps[i][0].tsp_params = (void *)&(thread_posa[i]);
+            thread_steps[i][1].tsp_params = (void *)&(thread_lk[i * 2]);
+            thread_steps[i][2].tsp_params = (void *)&(thread_lk[i * 2 + 1]);
+            thread_steps[i][2].fun = thread_shake_1[i];
+        }
+    }
+    
     if(input_problem.symmetric)
         fun_confirm = &fun_basic;
     else
@@ -290,10 +407,27 @@ main(int argc, char *argv[])
     btsp_params.num_steps           = SOLVE_STEPS;
     btsp_params.steps               = steps;
     btsp_params.confirm_plan        = confirm_plan;
+    btsp_params.context             = &context;
+    btsp_params.search              = search_strategy;
+    btsp_params.threads             = threads;
+    btsp_params.thread_steps        = thread_steps;
+    if(checkpoint_file != NULL)
+        btsp_params.checkpoint      = &checkpoint;
+    if(adaptive)
+    {
+        if(!arrow_btsp_scheduler_init(SOLVE_STEPS, &scheduler))
+        {
+            ret = EXIT_FAILURE;
+            adaptive = ARROW_FALSE;
+            goto CLEANUP;
+        }
+        if((min_effort > 0.0) && (min_effort <= 1.0))
+            scheduler.min_effort = min_effort;
+        btsp_params.scheduler       = &scheduler;
+    }
     
     
-    /* Setup BTSP results structure and solve BTSP */
-    arrow_btsp_result_init(problem, &result);
+    /* Solve BTSP */
     if(!arrow_btsp_solve(problem, &info, &btsp_params, &result))
     {
         arrow_print_error("Could not solve BTSP on given problem.\n");
@@ -410,6 +544,8 @@ main(int argc, char *argv[])
         }
         
         arrow_btsp_result_print_xml(&result, xml);
+        if(adaptive)
+            arrow_btsp_scheduler_print_xml(&scheduler, xml);
         
         fprintf(xml, "    <total_time>%.2f</total_time>\n", end_time);
         
@@ -451,9 +587,20 @@ main(int argc, char *argv[])
     }
     
 CLEANUP:
+    if((trace_file != NULL) && !arrow_trace_close())
+        ret = EXIT_FAILURE;
+    if(adaptive)
+        arrow_btsp_scheduler_destruct(&scheduler);
     arrow_btsp_result_destruct(&result);
     arrow_btsp_fun_destruct(&fun_basic);
     arrow_btsp_fun_destruct(&fun_shake_1);
+    for(i = 0; i < thread_funs; i++)
+        arrow_btsp_fun_destruct(&(thread_shake_1[i]));
+    if(thread_shake_1 != NULL) free(thread_shake_1);
+    if(thread_posa != NULL) free(thread_posa);
+    if(thread_lk != NULL) free(thread_lk);
+    if(thread_plans != NULL) free(thread_plans);
+    if(thread_steps != NULL) free(thread_steps);
     arrow_tsp_cc_lk_params_destruct(&lk_basic_params);
     arrow_tsp_cc_lk_params_destruct(&lk_shake_1_params);
     if(!input_problem.symmetric)
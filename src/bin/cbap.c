@@ -52,7 +52,7 @@ main(int argc, char *argv[])
     /* Note: algorithm does not need hash list */
     
     /* Solve CBAP */
-    if(!arrow_cbap_solve(&problem, &info, max_length, &result))
+    if(!arrow_cbap_solve(&problem, &info, max_length, NULL, &result))
     {
         arrow_print_error("Could not solve CBAP on file.");
         return EXIT_FAILURE;
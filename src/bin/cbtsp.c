@@ -32,10 +32,16 @@ int shake_attempts = 2;
 int shake_rand_min = 0;
 int shake_rand_max = -1;
 int random_seed = 0;
+int search_strategy = ARROW_BTSP_SEARCH_BISECT;
+double timebound = 0.0;
+char *checkpoint_file = NULL;
+double checkpoint_interval = 300.0;
+char *trace_file = NULL;
+int trace_format = ARROW_TRACE_JSONL;
 
 
 /* Program options */
-#define NUM_OPTS 20
+#define NUM_OPTS 26
 arrow_option options[NUM_OPTS] = 
 {
     {'i', "input", "TSPLIB input file", 
@@ -83,7 +89,19 @@ arrow_option options[NUM_OPTS] =
         ARROW_OPTION_INT, &shake_rand_max, ARROW_FALSE, ARROW_TRUE},
         
     {'g', "random-seed", "random number generator seed",
-        ARROW_OPTION_INT, &random_seed, ARROW_FALSE, ARROW_TRUE}
+        ARROW_OPTION_INT, &random_seed, ARROW_FALSE, ARROW_TRUE},
+    {'y', "search", "threshold search: 0 bisect, 1 gallop, 2 interpolate, 3 quantile",
+        ARROW_OPTION_INT, &search_strategy, ARROW_FALSE, ARROW_TRUE},
+    {'t', "timebound", "wall-clock seconds allowed (best tour is returned)",
+        ARROW_OPTION_DOUBLE, &timebound, ARROW_FALSE, ARROW_TRUE},
+    {'C', "checkpoint", "file to save the search to and resume it from",
+        ARROW_OPTION_STRING, &checkpoint_file, ARROW_FALSE, ARROW_TRUE},
+    {'K', "checkpoint-interval", "wall-clock seconds between checkpoints",
+        ARROW_OPTION_DOUBLE, &checkpoint_interval, ARROW_FALSE, ARROW_TRUE},
+    {'E', "trace", "file to write solver trace events to",
+        ARROW_OPTION_STRING, &trace_file, ARROW_FALSE, ARROW_TRUE},
+    {'F', "trace-format", "trace format: 0 JSON Lines, 1 Chrome trace",
+        ARROW_OPTION_INT, &trace_format, ARROW_FALSE, ARROW_TRUE}
 };
 char *desc = "Constarined bottleneck TSP solver";
 char *usage = "-i tsplib.tsp -L max_length [options]";
@@ -101,6 +119,8 @@ main(int argc, char *argv[])
     arrow_btsp_fun fun_shake;
     arrow_btsp_result result;
     arrow_btsp_params btsp_params;
+    arrow_btsp_checkpoint checkpoint;
+    arrow_context context;
     
     double start_time = arrow_util_zeit();
     double end_time;
@@ -109,6 +129,8 @@ main(int argc, char *argv[])
     /* Read program arguments */
     if(!arrow_options_parse(NUM_OPTS, options, desc, usage, argc, argv, NULL))
         return EXIT_FAILURE;
+    arrow_context_init(&context);
+    arrow_context_set_timebound(&context, timebound);
         
     /* Try and read the problem file and its info */
     if(!arrow_problem_read(input_file, &problem))
@@ -137,12 +159,33 @@ main(int argc, char *argv[])
     /* Initialize random number generator */
     arrow_util_random_seed(random_seed);
     
+    /* Start tracing if asked to */
+    if((trace_file != NULL) && !arrow_trace_open(trace_file, trace_format))
+        return EXIT_FAILURE;
+    
+    /* Pick up a saved search if there is one; it also knows the bound */
+    arrow_btsp_result_init(&problem, &result);
+    if(checkpoint_file != NULL)
+    {
+        arrow_btsp_checkpoint_init(checkpoint_file, "cbtsp",
+                                   checkpoint_interval, &checkpoint);
+        if(!arrow_btsp_checkpoint_resume(&checkpoint, &problem, &info, 
+                                         &result))
+            return EXIT_FAILURE;
+        if(checkpoint.resumed)
+        {
+            printf("Resuming search from %s\n", checkpoint_file);
+            if(lower_bound < 0)
+                lower_bound = checkpoint.values[2];
+        }
+    }
+    
     /* Determine if we need to call the BBSSP to find a lower bound */
     if(lower_bound < 0)
     {
         printf("Solving BBSSP to find a lower bound... ");
         arrow_bound_result bbssp_result;
-        if(!arrow_bbssp_solve(&problem, &info, &bbssp_result))
+        if(!arrow_bbssp_solve(&problem, &info, &context, &bbssp_result))
         {
             arrow_print_error("Could not solve BBSSP on file.\n");
             return EXIT_FAILURE;
@@ -201,9 +244,12 @@ main(int argc, char *argv[])
     btsp_params.num_steps           = SOLVE_STEPS;
     btsp_params.steps               = steps;
     btsp_params.confirm_plan        = confirm_plan;
+    btsp_params.context             = &context;
+    btsp_params.search              = search_strategy;
+    if(checkpoint_file != NULL)
+        btsp_params.checkpoint      = &checkpoint;
     
     /* Solve BTSP */
-    arrow_btsp_result_init(&problem, &result);
     if(!arrow_btsp_solve(&problem, &info, &btsp_params, &result))
     {
         arrow_print_error("Could not solve BTSP on file.\n");
@@ -289,6 +335,8 @@ main(int argc, char *argv[])
     }
     
 CLEANUP:
+    if((trace_file != NULL) && !arrow_trace_close())
+        ret = EXIT_FAILURE;
     arrow_btsp_result_destruct(&result);
     arrow_btsp_fun_destruct(&fun_basic);
     arrow_btsp_fun_destruct(&fun_shake);
@@ -67,7 +67,7 @@ main(int argc, char *argv[])
     }
     
     /* Solve BAP */
-    if(!arrow_dcbpb_solve(problem, &result))
+    if(!arrow_dcbpb_solve(problem, NULL, &result))
     {
         arrow_print_error("Could not solve DCBPB on file.");
         return EXIT_FAILURE;
@@ -44,12 +44,17 @@ main(int argc, char *argv[])
     /* Restore output */
     arrow_util_restore_stdout(stdout_id);
     
+    /* The analysis has already counted the edges with each cost */
+    arrow_problem_analysis *analysis;
+    if(!arrow_problem_analyze(&problem, &analysis))
+        return EXIT_FAILURE;
+    
     int i, j;
-    for(i = 0; i < problem.size; i++)
+    for(i = 0; i < analysis->cost_list_length; i++)
     {
-        for(j = i + 1; j < problem.size; j++)
+        for(j = 0; j < analysis->cost_count[i]; j++)
         {
-            printf("%d\n", problem.get_cost(&problem, i, j));
+            printf("%d\n", analysis->cost_list[i]);
         }
     }
     
@@ -33,9 +33,58 @@ typedef struct arrow_baltsp_params
     int infinity;                   /**< value to use for "infinity" */
     int deep_copy;
     double timebound;               /**< maximum time to spend on problem */
+    arrow_context *context;         /**< solve context (can be NULL) */
+    arrow_btsp_memo *memo;          /**< feasibility memo shared with the
+                                         BTSP solves (can be NULL) */
+    arrow_btsp_checkpoint *checkpoint; /**< saves the balanced search as it
+                                         goes (NULL for none); if it was
+                                         resumed, the search carries on from
+                                         it */
 } arrow_baltsp_params;
 
 
+/****************************************************************************
+ *  bounds.c
+ ****************************************************************************/
+/**
+ *  @brief  Calculates the best BTSP lower bound (the larger of the BBSSP and
+ *          BAP bounds).
+ *  @param  problem [in] problem structure
+ *  @param  info [in] problem info
+ *  @param  lower_bound [out] the best lower bound value (info->max_cost + 1
+ *              if there is no tour at all)
+ */
+int 
+arrow_baltsp_btsp_lower_bound(arrow_problem *problem, arrow_problem_info *info,
+                              int *lower_bound);
+
+
+/****************************************************************************
+ *  checkpoint.c
+ ****************************************************************************/
+/**
+ *  @brief  Saves the state of a balanced search, if there is a checkpoint.
+ *          The BalTSP searches that take BTSP parameters use their
+ *          checkpoint for the balanced search, not the BTSP solves in it.
+ *  @param  checkpoint [in/out] checkpoint structure (can be NULL)
+ *  @param  problem [in] problem being solved
+ *  @param  info [in] problem info
+ *  @param  low [in] cost index the search carries on from
+ *  @param  high [in] other cost index the search carries on from
+ *  @param  best_low [in] smallest cost in the best tour so far
+ *  @param  best_high [in] largest cost in the best tour so far
+ *  @param  extra [in] any other value the search needs to carry on
+ *  @param  force [in] if ARROW_TRUE, saves regardless of the interval
+ *  @param  tour_result [in] best tour, solver statistics and time so far
+ */
+int
+arrow_baltsp_checkpoint_save(arrow_btsp_checkpoint *checkpoint, 
+                             arrow_problem *problem, arrow_problem_info *info,
+                             int low, int high, int best_low, int best_high,
+                             int extra, int force, 
+                             arrow_btsp_result *tour_result);
+
+
 /****************************************************************************
  *  baltsp-db.c
  ****************************************************************************/
@@ -21,6 +21,16 @@
 #define ARROW_BTSP_SOLVE_PLAN_CONSTRAINED 2
 #define ARROW_BTSP_SOLVE_PLAN_CONSTRAINED_SHAKE 3
 
+#define ARROW_BTSP_SEARCH_COUNT 4
+#define ARROW_BTSP_SEARCH_BISECT 0
+#define ARROW_BTSP_SEARCH_GALLOP 1
+#define ARROW_BTSP_SEARCH_INTERPOLATE 2
+#define ARROW_BTSP_SEARCH_QUANTILE 3
+
+#define ARROW_BTSP_MEMO_THRESHOLD 0
+
+#define ARROW_BTSP_CHECKPOINT_VALUES 8
+
 /**
  *  @brief  BTSP result
  */
@@ -35,6 +45,8 @@ typedef struct arrow_btsp_result
     int bin_search_steps;   /**< number of steps in binary search */
     int solver_attempts[ARROW_TSP_SOLVER_COUNT]; /**< calls to solver */
     double solver_time[ARROW_TSP_SOLVER_COUNT];  /**< total time for solver */
+    int search_probes[ARROW_BTSP_SEARCH_COUNT];  /**< binary search steps
+                                                      chosen by strategy */
     double total_time;      /**< total time */
 } arrow_btsp_result;
 
@@ -45,6 +57,19 @@ typedef struct arrow_btsp_fun
 {
     void *data;             /**< data required by function */
     int shallow;            /**< indicates use of shallow copy of data */
+    int threshold_graph;    /**< ARROW_TRUE if every feasible tour only uses
+                                 edges with min_cost <= C[i,j] <= max_cost
+                                 (or negative cost fixed edges), so a probe
+                                 is infeasible unless that graph is
+                                 Hamiltonian */
+    int incremental;        /**< ARROW_TRUE if get_cost only depends on an
+                                 edge's cost and whether it is in
+                                 [min_cost, max_cost], and initialize doesn't
+                                 change it, so a deep copy can be updated by
+                                 rewriting the edges entering or leaving the
+                                 window */
+    struct arrow_btsp_fun_cache *cache; /**< deep copy kept between applies
+                                 (NULL to build a new one every time) */
 
     /**
      *  @brief  Retrieves cost between nodes i and j from the function.
@@ -59,7 +84,26 @@ typedef struct arrow_btsp_fun
     int 
     (*get_cost)(struct arrow_btsp_fun *fun, arrow_problem *base_problem,
                 int min_cost, int max_cost, int i, int j);
-                
+
+    /**
+     *  @brief  Writes rows [first, last) of the lower triangle of a deep
+     *          copy, giving the same costs as get_cost a row at a time.
+     *          Can be NULL, in which case get_cost is called for every
+     *          edge.  Must be safe to call from several threads at once.
+     *  @param  fun [in] function structure
+     *  @param  base_problem [in] problem structure
+     *  @param  min_cost [in] min_cost to consider for active edges
+     *  @param  max_cost [in] max_cost to consider for active edges
+     *  @param  first [in] first row to write
+     *  @param  last [in] one past the last row to write
+     *  @param  row [out] scratch space for base_problem->size costs
+     *  @param  adj [out] matrix rows; adj[i][j] is written for j < i
+     */
+    void
+    (*transform_rows)(struct arrow_btsp_fun *fun, arrow_problem *base_problem,
+                      int min_cost, int max_cost, int first, int last,
+                      int *row, int **adj);
+
     /**
      *  @brief  Initializes the function structure for a new problem
      *  @param  fun [out] function structure
@@ -89,6 +133,40 @@ typedef struct arrow_btsp_fun
                 int min_cost, int max_cost, double tour_length, int *tour);
 } arrow_btsp_fun;
 
+/**
+ *  @brief  Edges of a symmetric problem grouped by cost, so the edges with
+ *          costs in a range can be visited without looking at the others.
+ */
+typedef struct arrow_btsp_edge_index
+{
+    arrow_problem *base;        /**< problem the edges are from */
+    arrow_problem_info *info;   /**< base problem info */
+    int *start;                 /**< edges costing info->cost_list[k] are
+                                     edges[start[k]..start[k+1]-1] */
+    int *edges;                 /**< edges as i * size + j, with j < i */
+} arrow_btsp_edge_index;
+
+/**
+ *  @brief  Deep copy of a transformed cost matrix kept between calls to
+ *          arrow_btsp_fun_apply on the same base problem.  Only one problem
+ *          built from a cache may be alive at a time.
+ */
+typedef struct arrow_btsp_fun_cache
+{
+    CCdatagroup dat;            /**< the transformed matrix (must come first,
+                                     since problems built from the cache
+                                     point at it) */
+    arrow_btsp_edge_index *index;   /**< edges of the base problem */
+    int built;                  /**< ARROW_TRUE once dat holds a matrix */
+    int in_use;                 /**< ARROW_TRUE while a problem built from
+                                     the cache is alive */
+    int min_cost;               /**< min_cost dat was last built for */
+    int max_cost;               /**< max_cost dat was last built for */
+    int rebuilds;               /**< number of times every edge was written */
+    int updates;                /**< number of incremental updates */
+    long long written;          /**< number of edges written in all */
+} arrow_btsp_fun_cache;
+
 /**
  *  @brief  BTSP feasibility solve step plan
  */
@@ -100,6 +178,106 @@ typedef struct arrow_btsp_solve_plan
     int attempts;                   /**< number of attempts to perform */
 } arrow_btsp_solve_plan;
 
+/**
+ *  @brief  A feasibility verdict remembered by a memo.  Verdicts are about
+ *          windows: a problem of a given kind has a feasible tour using
+ *          only costs in [min_cost, max_cost] or it doesn't.  A tour in a
+ *          window is also in every window containing it, and a window with
+ *          no tour has none in any window inside it.
+ */
+typedef struct arrow_btsp_memo_entry
+{
+    arrow_problem *problem;     /**< problem the verdict is about */
+    int kind;                   /**< feasibility question asked, one of
+                                     ARROW_BTSP_MEMO_* */
+    int min_cost;               /**< smallest cost in the tour, or in the
+                                     window proven infeasible */
+    int max_cost;               /**< largest cost in the tour, or in the
+                                     window proven infeasible */
+    int *tour;                  /**< tour in node-node format, or NULL if the
+                                     window is proven infeasible */
+    double tour_length;         /**< length of the tour */
+} arrow_btsp_memo_entry;
+
+/**
+ *  @brief  Feasibility verdicts shared between solves.  All operations
+ *          lock the memo, so one memo may be shared by every driver and
+ *          search thread in a process.
+ */
+typedef struct arrow_btsp_memo
+{
+    pthread_mutex_t lock;           /**< guards everything below */
+    arrow_btsp_memo_entry *entries; /**< verdicts recorded so far */
+    int num_entries;                /**< number of entries */
+    int max_entries;                /**< allocated size of entries */
+    int lookups;                    /**< number of lookups */
+    int hits;                       /**< lookups answered from the memo */
+} arrow_btsp_memo;
+
+/**
+ *  @brief  Where a feasibility problem files its verdicts in a memo.  The
+ *          problem solved may be a restriction of a base problem to edges
+ *          costing at least min_cost (as built by the BalTSP IB function),
+ *          so verdicts about it are really about a window of the base.
+ */
+typedef struct arrow_btsp_memo_view
+{
+    arrow_btsp_memo *memo;      /**< memo to use (NULL for none) */
+    arrow_problem *base;        /**< problem verdicts are filed under (NULL
+                                     for the problem being solved) */
+    int min_cost;               /**< edges costing less than this are absent
+                                     from the problem being solved (INT_MIN
+                                     if it is the base itself) */
+} arrow_btsp_memo_view;
+
+/**
+ *  @brief  Saved state of a long running search.  The search fills in the
+ *          state and saves it every so often; a later run that resumes from
+ *          the file picks up where the saved one left off.
+ */
+typedef struct arrow_btsp_checkpoint
+{
+    char *file_name;        /**< file to save to and resume from */
+    const char *kind;       /**< name of the search saving its state; a file
+                                 saved by another kind of search is not
+                                 resumed */
+    double interval;        /**< wall-clock seconds between saves */
+    double last_save;       /**< wall-clock time of the last save */
+    int resumed;            /**< ARROW_TRUE if the state below was read from
+                                 the file */
+    int low;                /**< lowest cost index still to search */
+    int high;               /**< highest cost index still to search */
+    int values[ARROW_BTSP_CHECKPOINT_VALUES]; /**< any other state the search
+                                                   needs to carry on */
+    double elapsed;         /**< solve time spent before the save */
+} arrow_btsp_checkpoint;
+
+/**
+ *  @brief  Adaptive scheduler for the attempts of a solve plan.  Instead of
+ *          running each step's attempts in plan order, a feasibility problem
+ *          asks the scheduler which step to try next, picking the one with
+ *          the best optimistic estimate of feasible tours found per second
+ *          on this instance so far.  No step gets more attempts than the
+ *          plan gives it.  The statistics are locked, so one scheduler may
+ *          be shared by every thread of a parallel search.
+ */
+typedef struct arrow_btsp_scheduler
+{
+    pthread_mutex_t lock;   /**< guards everything below */
+    int num_steps;          /**< number of solve plan steps tracked */
+    int *attempts;          /**< attempts[i] is the number of attempts made
+                                 with step i */
+    int *successes;         /**< successes[i] is the number of those that
+                                 found a feasible tour */
+    double *time;           /**< time[i] is the solver time they took */
+    double min_effort;      /**< share of the plan's heuristic attempts
+                                 allowed for a probe at the top of the search
+                                 interval; probes nearer the bottom get
+                                 proportionally more, up to all of them */
+    int decisions;          /**< number of attempts the scheduler picked */
+    int skipped;            /**< heuristic attempts left out by effort */
+} arrow_btsp_scheduler;
+
 /**
  *  @brief  BTSP algorithm parameters
  */
@@ -115,14 +293,132 @@ typedef struct arrow_btsp_params
     arrow_btsp_solve_plan confirm_plan;   /**< confirm plan */
     int infinity;                   /**< value to use for "infinity" */
     int deep_copy;
+    arrow_context *context;         /**< solve context (can be NULL) */
+    int threads;                    /**< number of thresholds to probe at
+                                         once in the binary search */
+    arrow_btsp_memo_view memo;      /**< feasibility memo (memo.memo is NULL
+                                         to not use one) */
+    int search;                     /**< threshold search strategy, one of
+                                         ARROW_BTSP_SEARCH_*; must be
+                                         ARROW_BTSP_SEARCH_BISECT when
+                                         threads > 1 */
+    arrow_btsp_solve_plan **thread_steps; /**< thread_steps[i] is thread i's
+                                         own copy of the num_steps solve plan
+                                         steps; if NULL, all threads share
+                                         steps, which is only safe when no
+                                         cost matrix function keeps state
+                                         (shake functions do) */
+    arrow_btsp_checkpoint *checkpoint; /**< saves the binary search as it
+                                         goes (NULL for none); if it was
+                                         resumed, the search carries on from
+                                         it */
+    arrow_btsp_scheduler *scheduler; /**< picks the binary search's attempts
+                                         by observed success (NULL to run
+                                         the plan as given) */
 } arrow_btsp_params;
 
+/**
+ *  @brief  State of a threshold search strategy
+ */
+typedef struct arrow_btsp_search
+{
+    int strategy;           /**< requested strategy */
+    int current;            /**< strategy choosing the next probe (galloping
+                                 hands over to bisection once bracketed) */
+    int step;               /**< galloping distance past the lower bound */
+    arrow_problem_info *info;   /**< problem info */
+    long long *edge_counts; /**< edge_counts[i] is the number of edges costing
+                                 at most cost_list[i] (quantile only) */
+} arrow_btsp_search;
+
+/**
+ *  @brief  Settings shared by every instance in a batch solve.  Each
+ *          instance is solved the same way the btsp program solves one.
+ */
+typedef struct arrow_btsp_batch_params
+{
+    int threads;            /**< number of instances solved at once */
+    int deep_copy;          /**< if ARROW_TRUE, store full cost matrices */
+    int supress_hash;       /**< if ARROW_TRUE, don't hash the cost lists */
+    int posa_attempts;      /**< Posa attempts in each feasibility problem */
+    int basic_attempts;     /**< basic LK attempts in each feasibility
+                                 problem */
+    int basic_restarts;     /**< random restarts in each basic LK attempt */
+    int shake_1_attempts;   /**< shake LK attempts in each feasibility
+                                 problem */
+    int shake_1_restarts;   /**< random restarts in each shake LK attempt */
+    int search;             /**< threshold search strategy */
+    double timebound;       /**< wall-clock seconds allowed for each instance
+                                 (0.0 for none) */
+    double lb_timebound;    /**< wall-clock seconds allowed for each lower
+                                 bound portfolio (0.0 for none) */
+    arrow_context *context; /**< stops the whole batch (may be NULL) */
+    
+    /**
+     *  @brief  Called as each instance finishes, one call at a time, in the
+     *          order the instances finish.
+     *  @param  params [in] the batch parameters
+     *  @param  job [in] position of the instance in the batch
+     *  @param  file_name [in] file the instance was read from
+     *  @param  problem [in] the instance (NULL if it could not be read)
+     *  @param  ret [in] ARROW_SUCCESS if the instance was solved
+     *  @param  lower_bound [in] lower bound the search started from
+     *  @param  total_time [in] wall-clock seconds spent on the instance
+     *  @param  result [in] result of the solve (tour is for problem)
+     */
+    void
+    (*report)(struct arrow_btsp_batch_params *params, int job, 
+              const char *file_name, arrow_problem *problem, int ret,
+              int lower_bound, double total_time, arrow_btsp_result *result);
+    void *report_data;      /**< user data for the report callback */
+} arrow_btsp_batch_params;
+
+
+/****************************************************************************
+ *  batch.c
+ ****************************************************************************/
+/**
+ *  @brief  Inititalizes batch parameters to the btsp program's defaults.
+ *  @param  params [out] batch parameters structure
+ */
+void
+arrow_btsp_batch_params_init(arrow_btsp_batch_params *params);
+
+/**
+ *  @brief  Solves the BTSP on many instances in one process.  A pool of
+ *          params->threads workers takes instances off the list in order,
+ *          reads each one, finds its lower bound, solves it and hands the
+ *          result to params->report.  An instance that fails is reported
+ *          and the batch carries on.
+ *  @param  num_files [in] number of instances
+ *  @param  file_names [in] TSPLIB file for each instance
+ *  @param  params [in] batch parameters
+ *  @return ARROW_FAILURE if the workers could not be run, ARROW_SUCCESS
+ *          otherwise (whether or not every instance was solved)
+ */
+int
+arrow_btsp_solve_batch(int num_files, char **file_names,
+                       arrow_btsp_batch_params *params);
+
 
 /****************************************************************************
  *  btsp.c
  ****************************************************************************/
 /**
- *  @brief  Solves TSP with Concorde's exact solver.
+ *  @brief  Solves TSP with Concorde's exact solver.  If the solve context
+ *          in the parameters asks to stop, the best tour found so far is
+ *          returned and is not marked optimal unless it meets the lower
+ *          bound.  With params->threads > 1 the binary search probes that
+ *          many thresholds at once: the search interval shrinks as soon as
+ *          any probe finishes, and probes left outside it are cancelled.
+ *          With a checkpoint in the parameters, the binary search is saved
+ *          as it goes and whenever it stops; if the checkpoint was resumed,
+ *          the search carries on from the saved bracket and tour instead of
+ *          starting over.  The checkpoint's values hold the threshold search
+ *          state and the lower bound.  With a scheduler in the parameters,
+ *          each probe's heuristic attempts are picked by observed success
+ *          and cut back the further the probe is above the bottom of the
+ *          search interval; the confirmation solve always runs in full.
  *  @param  problem [in] problem to solve
  *  @param  info [in] extra problem info
  *  @param  params [in] parameters for solver (can be NULL)
@@ -144,13 +440,132 @@ arrow_btsp_solve(arrow_problem *problem, arrow_problem_info *info,
  *  @param  steps [in] solve plan step details
  *  @param  min_cost [in] min_cost to consider for active edges
  *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  context [in] solve context (can be NULL); remaining attempts are
+ *              skipped once it asks to stop
  *  @param  feasible [out] true if a feasible tour exists, false otherwise
  *  @param  result [out] resulting BTSP tour found
  */
 int
 arrow_btsp_feasible(arrow_problem *problem, int num_steps, 
                     arrow_btsp_solve_plan *steps, int min_cost, int max_cost, 
-                    int *feasible, arrow_btsp_result *result);
+                    arrow_context *context, int *feasible, 
+                    arrow_btsp_result *result);
+
+/**
+ *  @brief  Same as arrow_btsp_feasible, but first asks the memo for a
+ *          verdict and records any tour found or infeasibility proven
+ *          (by the pre-filter or by a completed exact solve).  The memo is
+ *          only used when every step's cost matrix function has
+ *          threshold_graph set, and not for restricted views of problems
+ *          with fixed edges.
+ *  @param  view [in] where to look up and record verdicts (can be NULL)
+ *  @param  problem [in] problem to solve
+ *  @param  num_steps [in] total number of steps in solve plan
+ *  @param  steps [in] solve plan step details
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  context [in] solve context (can be NULL)
+ *  @param  feasible [out] true if a feasible tour exists, false otherwise
+ *  @param  result [out] resulting BTSP tour found
+ */
+int
+arrow_btsp_feasible_memo(arrow_btsp_memo_view *view, arrow_problem *problem,
+                         int num_steps, arrow_btsp_solve_plan *steps,
+                         int min_cost, int max_cost, arrow_context *context,
+                         int *feasible, arrow_btsp_result *result);
+
+/**
+ *  @brief  Same as arrow_btsp_feasible_memo, but lets a scheduler pick the
+ *          order of the heuristic attempts.  Only effort times the plan's
+ *          heuristic attempts (at least one) are made; steps using the
+ *          exact solver are always run, after the heuristics.  With no
+ *          scheduler the plan is followed exactly and effort is ignored.
+ *  @param  view [in] where to look up and record verdicts (can be NULL)
+ *  @param  scheduler [in/out] attempt scheduler (can be NULL)
+ *  @param  effort [in] share of the heuristic attempts to make, in (0, 1]
+ *  @param  problem [in] problem to solve
+ *  @param  num_steps [in] total number of steps in solve plan
+ *  @param  steps [in] solve plan step details
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  context [in] solve context (can be NULL)
+ *  @param  feasible [out] true if a feasible tour exists, false otherwise
+ *  @param  result [out] resulting BTSP tour found
+ */
+int
+arrow_btsp_feasible_scheduled(arrow_btsp_memo_view *view, 
+                              arrow_btsp_scheduler *scheduler, double effort,
+                              arrow_problem *problem, int num_steps,
+                              arrow_btsp_solve_plan *steps, int min_cost,
+                              int max_cost, arrow_context *context,
+                              int *feasible, arrow_btsp_result *result);
+
+/**
+ *  @brief  Cheap tests that can prove the graph of edges with
+ *          min_cost <= C[i,j] <= max_cost (plus negative cost fixed edges)
+ *          has no Hamiltonian cycle.  For symmetric problems every node must
+ *          have degree two or more and the graph must be biconnected; for
+ *          asymmetric problems every node needs an in- and out-arc and the
+ *          graph must be strongly connected.  In both cases the graph must
+ *          have a cycle cover (a perfect matching in its bipartite double
+ *          cover).  arrow_btsp_feasible runs these before any TSP solver when
+ *          every step's cost matrix function has threshold_graph set.
+ *  @param  problem [in] problem to check
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  possible [out] ARROW_FALSE if the graph is certainly not
+ *              Hamiltonian, ARROW_TRUE if it may be
+ */
+int
+arrow_btsp_feasible_prefilter(arrow_problem *problem, int min_cost, 
+                              int max_cost, int *possible);
+
+
+/****************************************************************************
+ *  checkpoint.c
+ ****************************************************************************/
+/**
+ *  @brief  Initializes a checkpoint structure.  Nothing is read or written.
+ *  @param  file_name [in] file to save to and resume from
+ *  @param  kind [in] name of the search saving its state
+ *  @param  interval [in] wall-clock seconds between saves
+ *  @param  checkpoint [out] checkpoint structure
+ */
+void
+arrow_btsp_checkpoint_init(char *file_name, const char *kind, double interval,
+                           arrow_btsp_checkpoint *checkpoint);
+
+/**
+ *  @brief  Reads the saved state, if the file exists, into the checkpoint
+ *          and the result (best tour and solver statistics), and restores
+ *          the random number generator to where it was at the save.  A
+ *          missing file just leaves resumed as ARROW_FALSE.
+ *  @param  checkpoint [out] checkpoint structure
+ *  @param  problem [in] problem being solved
+ *  @param  info [in] problem info
+ *  @param  result [out] result to restore
+ */
+int
+arrow_btsp_checkpoint_resume(arrow_btsp_checkpoint *checkpoint,
+                             arrow_problem *problem, arrow_problem_info *info,
+                             arrow_btsp_result *result);
+
+/**
+ *  @brief  Saves the checkpoint's state and the result if the interval has
+ *          passed since the last save.  The file is replaced atomically, so
+ *          a run killed mid-save leaves the previous one intact.  The random
+ *          number generator is reseeded so a resumed run draws the same
+ *          numbers this one will.
+ *  @param  checkpoint [in/out] checkpoint structure
+ *  @param  problem [in] problem being solved
+ *  @param  info [in] problem info
+ *  @param  force [in] if ARROW_TRUE, saves regardless of the interval
+ *  @param  result [in] best tour and solver statistics so far
+ */
+int
+arrow_btsp_checkpoint_save(arrow_btsp_checkpoint *checkpoint,
+                           arrow_problem *problem, arrow_problem_info *info,
+                           int force, arrow_btsp_result *result);
 
 
 /****************************************************************************
@@ -176,6 +591,75 @@ arrow_btsp_fun_apply(arrow_btsp_fun *fun, arrow_problem *old_problem,
 void
 arrow_btsp_fun_destruct(arrow_btsp_fun *fun);
 
+/**
+ *  @brief  Groups the edges of a symmetric problem by cost.
+ *  @param  problem [in] problem to index
+ *  @param  info [in] problem info
+ *  @param  index [out] edge index structure
+ */
+int
+arrow_btsp_edge_index_init(arrow_problem *problem, arrow_problem_info *info,
+                           arrow_btsp_edge_index *index);
+
+/**
+ *  @brief  Destructs an edge index.
+ *  @param  index [out] edge index structure
+ */
+void
+arrow_btsp_edge_index_destruct(arrow_btsp_edge_index *index);
+
+/**
+ *  @brief  Initializes an empty deep copy cache.  Once a function's cache
+ *          is set, deep applies to index->base reuse the cached matrix:
+ *          incremental functions only rewrite the edges whose costs lie
+ *          between the old and new window ends, and the others rewrite
+ *          every edge in place instead of building a new matrix.
+ *  @param  index [in] edges of the base problem
+ *  @param  cache [out] cache structure
+ */
+void
+arrow_btsp_fun_cache_init(arrow_btsp_edge_index *index, 
+                          arrow_btsp_fun_cache *cache);
+
+/**
+ *  @brief  Destructs a deep copy cache.
+ *  @param  cache [out] cache structure
+ */
+void
+arrow_btsp_fun_cache_destruct(arrow_btsp_fun_cache *cache);
+
+/**
+ *  @brief  Gives the costs C[i,0..i-1] of a symmetric problem as one array,
+ *          for transform_rows functions.
+ *  @param  problem [in] problem structure
+ *  @param  i [in] row to get
+ *  @param  row [out] space for i costs, used unless the problem's matrix
+ *              can be read directly
+ *  @return the row's costs (either row or the problem's own matrix row)
+ */
+int *
+arrow_btsp_fun_base_row(arrow_problem *problem, int i, int *row);
+
+/**
+ *  @brief  Writes one row of a deep copy for transform_rows functions.
+ *          Costs in [low, high] become in_scale * cost + in_shift, and the
+ *          rest out_scale * cost + out_shift.  Uses AVX2 when the CPU has
+ *          it.
+ *  @param  costs [in] base costs of the row
+ *  @param  count [in] number of costs
+ *  @param  low [in] lowest cost in range
+ *  @param  high [in] highest cost in range
+ *  @param  in_scale [in] multiplier for costs in range
+ *  @param  in_shift [in] added to costs in range
+ *  @param  out_scale [in] multiplier for costs out of range
+ *  @param  out_shift [in] added to costs out of range
+ *  @param  out [out] transformed costs
+ */
+void
+arrow_btsp_fun_select_row(const int *costs, int count, int low, int high,
+                          int in_scale, int in_shift, int out_scale,
+                          int out_shift, int *out);
+
 
 /****************************************************************************
  *  fun_btsp.c
@@ -242,6 +726,71 @@ arrow_btsp_fun_cbtsp_shake(int shallow, double feasible_length, int infinity,
                            arrow_problem_info *info, arrow_btsp_fun *fun);
                                  
 
+/****************************************************************************
+ *  memo.c
+ ****************************************************************************/
+/**
+ *  @brief  Initializes an empty memo.
+ *  @param  memo [out] memo structure
+ */
+int
+arrow_btsp_memo_init(arrow_btsp_memo *memo);
+
+/**
+ *  @brief  Destructs a memo.
+ *  @param  memo [out] memo structure
+ */
+void
+arrow_btsp_memo_destruct(arrow_btsp_memo *memo);
+
+/**
+ *  @brief  Looks for a verdict on the window [min_cost, max_cost].  If a
+ *          remembered tour fits in the window, the one with the smallest
+ *          max cost is copied into result.
+ *  @param  memo [in] memo structure
+ *  @param  problem [in] problem the verdict is about
+ *  @param  kind [in] feasibility question, one of ARROW_BTSP_MEMO_*
+ *  @param  min_cost [in] smallest cost allowed
+ *  @param  max_cost [in] largest cost allowed
+ *  @param  known [out] ARROW_TRUE if the memo has a verdict
+ *  @param  feasible [out] the verdict, if known
+ *  @param  result [out] the remembered tour, if feasible
+ */
+void
+arrow_btsp_memo_lookup(arrow_btsp_memo *memo, arrow_problem *problem,
+                       int kind, int min_cost, int max_cost, int *known,
+                       int *feasible, arrow_btsp_result *result);
+
+/**
+ *  @brief  Remembers a feasible tour.
+ *  @param  memo [out] memo structure
+ *  @param  problem [in] problem the tour is for
+ *  @param  kind [in] feasibility question, one of ARROW_BTSP_MEMO_*
+ *  @param  min_cost [in] smallest cost in the tour
+ *  @param  max_cost [in] largest cost in the tour
+ *  @param  tour_length [in] length of the tour
+ *  @param  tour [in] tour in node-node format (copied)
+ */
+int
+arrow_btsp_memo_add_tour(arrow_btsp_memo *memo, arrow_problem *problem,
+                         int kind, int min_cost, int max_cost,
+                         double tour_length, int *tour);
+
+/**
+ *  @brief  Remembers that no feasible tour uses only costs in
+ *          [min_cost, max_cost].  Only record proofs, such as a lower bound
+ *          or an exact solve, never a heuristic coming up empty.
+ *  @param  memo [out] memo structure
+ *  @param  problem [in] problem the proof is for
+ *  @param  kind [in] feasibility question, one of ARROW_BTSP_MEMO_*
+ *  @param  min_cost [in] smallest cost allowed
+ *  @param  max_cost [in] largest cost allowed
+ */
+int
+arrow_btsp_memo_add_infeasible(arrow_btsp_memo *memo, arrow_problem *problem,
+                               int kind, int min_cost, int max_cost);
+
+
 /****************************************************************************
  *  params.c
  ****************************************************************************/               
@@ -288,6 +837,127 @@ void
 arrow_btsp_result_print_pretty(arrow_btsp_result *result, FILE *out);
 
 
+/****************************************************************************
+ *  scheduler.c
+ ****************************************************************************/
+/**
+ *  @brief  Initializes a scheduler with no statistics.
+ *  @param  num_steps [in] number of solve plan steps it will schedule
+ *  @param  scheduler [out] scheduler structure
+ */
+int
+arrow_btsp_scheduler_init(int num_steps, arrow_btsp_scheduler *scheduler);
+
+/**
+ *  @brief  Destructs a scheduler.
+ *  @param  scheduler [out] scheduler structure
+ */
+void
+arrow_btsp_scheduler_destruct(arrow_btsp_scheduler *scheduler);
+
+/**
+ *  @brief  Picks the heuristic step to make the next attempt with.  Steps
+ *          never tried on this instance go first, in plan order; after that
+ *          each step is scored by its success rate plus a (damped) UCB1
+ *          exploration bonus, divided by its mean solver time per attempt.
+ *  @param  scheduler [in/out] scheduler structure
+ *  @param  num_steps [in] total number of steps in solve plan
+ *  @param  steps [in] solve plan step details
+ *  @param  used [in] used[i] is the number of attempts already made with
+ *              step i in this feasibility problem
+ *  @return the step to use, or -1 if every heuristic step is used up
+ */
+int
+arrow_btsp_scheduler_pick(arrow_btsp_scheduler *scheduler, int num_steps,
+                          arrow_btsp_solve_plan *steps, int *used);
+
+/**
+ *  @brief  Records how an attempt turned out.
+ *  @param  scheduler [in/out] scheduler structure
+ *  @param  step [in] step the attempt was made with
+ *  @param  success [in] ARROW_TRUE if it found a feasible tour
+ *  @param  time [in] solver time the attempt took
+ */
+void
+arrow_btsp_scheduler_update(arrow_btsp_scheduler *scheduler, int step,
+                            int success, double time);
+
+/**
+ *  @brief  Records heuristic attempts left out because of the effort.
+ *  @param  scheduler [in/out] scheduler structure
+ *  @param  skipped [in] number of attempts left out
+ */
+void
+arrow_btsp_scheduler_skip(arrow_btsp_scheduler *scheduler, int skipped);
+
+/**
+ *  @brief  Prints the scheduler's statistics out in XML format.
+ *  @param  scheduler [in] scheduler structure
+ *  @param  out [out] file to write to
+ */
+void
+arrow_btsp_scheduler_print_xml(arrow_btsp_scheduler *scheduler, FILE *out);
+
+
+/****************************************************************************
+ *  search.c
+ ****************************************************************************/
+/**
+ *  @brief  Initializes a threshold search.  The edge-count quantile
+ *          strategy counts the problem's edges at each cost up front.
+ *  @param  strategy [in] one of ARROW_BTSP_SEARCH_*
+ *  @param  problem [in] problem being solved
+ *  @param  info [in] extra problem info
+ *  @param  search [out] search structure
+ */
+int
+arrow_btsp_search_init(int strategy, arrow_problem *problem,
+                       arrow_problem_info *info, arrow_btsp_search *search);
+
+/**
+ *  @brief  Destructs a threshold search.
+ *  @param  search [out] search structure
+ */
+void
+arrow_btsp_search_destruct(arrow_btsp_search *search);
+
+/**
+ *  @brief  Picks the next cost index to probe.  The strategy that chose it
+ *          is left in search->current.
+ *  @param  search [in] search structure
+ *  @param  low [in] lowest cost index still possible
+ *  @param  high [in] cost index of the best known tour (low < high)
+ *  @return a cost index in [low, high)
+ */
+int
+arrow_btsp_search_next(arrow_btsp_search *search, int low, int high);
+
+/**
+ *  @brief  Tells the search how the last probe turned out.  Probes cut
+ *          short by the solve context should not be reported.
+ *  @param  search [out] search structure
+ *  @param  feasible [in] ARROW_TRUE if the probe found a tour
+ */
+void
+arrow_btsp_search_update(arrow_btsp_search *search, int feasible);
+
+/**
+ *  @brief  Prints out the short name for the given search strategy.
+ *  @param  strategy [in] the search strategy in question
+ *  @param  out [out] the file handle to print out to.
+ */
+void
+arrow_btsp_search_short_name(int strategy, FILE *out);
+
+/**
+ *  @brief  Prints out the long name for the given search strategy.
+ *  @param  strategy [in] the search strategy in question
+ *  @param  out [out] the file handle to print out to.
+ */
+void
+arrow_btsp_search_long_name(int strategy, FILE *out);
+
+
 /****************************************************************************
  *  solve_plan.c
  ****************************************************************************/
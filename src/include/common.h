@@ -27,17 +27,44 @@
 #include <float.h>
 #include <regex.h>
 #include <getopt.h>
+#include <pthread.h>
 #include "concorde.h"
 #include <cmph.h>
 
 /****************************************************************************
- *  Debugging info macro.  Rename ARROW_DEBUG to disable debug info
+ *  Tracing levels.  Build with -DARROW_TRACE_LEVEL=n to choose what gets
+ *  compiled in: ARROW_TRACE_OFF drops everything, ARROW_TRACE_EVENTS keeps
+ *  the structured events (see trace.c) but drops the debug text, and
+ *  ARROW_TRACE_DEBUG keeps both.
  ****************************************************************************/
-#define ARROW_DEBUG
-#ifdef  ARROW_DEBUG
+#define ARROW_TRACE_OFF 0
+#define ARROW_TRACE_EVENTS 1
+#define ARROW_TRACE_DEBUG 2
+
+#ifndef ARROW_TRACE_LEVEL
+    #define ARROW_TRACE_LEVEL ARROW_TRACE_DEBUG
+#endif
+
+/****************************************************************************
+ *  Debugging info macro
+ ****************************************************************************/
+#if ARROW_TRACE_LEVEL >= ARROW_TRACE_DEBUG
+    #define ARROW_DEBUG
     #define arrow_debug printf
 #else
-    #define arrow_debug
+    #define arrow_debug(args...)
+#endif
+
+/****************************************************************************
+ *  Trace event macros.  arrow_trace_clock(t) stores the wall-clock time in
+ *  t and arrow_trace(...) takes the arguments of arrow_trace_record().
+ ****************************************************************************/
+#if ARROW_TRACE_LEVEL >= ARROW_TRACE_EVENTS
+    #define arrow_trace_clock(t) ((t) = arrow_util_real_zeit())
+    #define arrow_trace(args...) arrow_trace_record(args)
+#else
+    #define arrow_trace_clock(t)
+    #define arrow_trace(args...)
 #endif
 
 
@@ -144,6 +171,150 @@ void
 arrow_bintree_print(arrow_bintree *tree);
 
 
+/****************************************************************************
+ *  closure.c
+ ****************************************************************************/
+/**
+ *  @brief  Replaces each entry c_ij of a square matrix with the cost of the
+ *          bottleneck path from i to j: the smallest possible largest entry
+ *          along any path.  Entries of INT_MAX mean there is no edge.
+ *  @param  n [in] number of rows (and columns)
+ *  @param  matrix [out] n x n matrix, stored row after row
+ *  @param  threads [in] most threads to use (0 for one per processor)
+ */
+int
+arrow_closure_minimax(int n, int *matrix, int threads);
+
+
+/****************************************************************************
+ *  context.c
+ ****************************************************************************/
+/**
+ *  @brief  Solve context shared by a caller and a running solver.  Carries a
+ *          wall-clock deadline, a cancellation flag, a progress callback and
+ *          a lower bound proven elsewhere.  Solvers accept a NULL context to
+ *          mean "run to completion".
+ */
+typedef struct arrow_context
+{
+    double deadline;        /**< wall-clock time to stop at (0.0 for none) */
+    volatile int cancel;    /**< set to ARROW_TRUE to request a stop */
+    volatile int lower_bound; /**< objective value known to be a lower bound
+                                   (INT_MIN for none) */
+    
+    /**
+     *  @brief  Called by solvers to report on their progress.
+     *  @param  context [in] the solve context
+     *  @param  stage [in] short name of the stage reporting progress
+     *  @param  lower [in] current lower bound on the objective value
+     *  @param  upper [in] current upper bound on the objective value
+     */
+    void
+    (*progress)(struct arrow_context *context, const char *stage,
+                int lower, int upper);
+    void *progress_data;    /**< user data for the progress callback */
+    struct arrow_context *parent; /**< also stop when this context says so
+                                       (may be NULL) */
+} arrow_context;
+
+/**
+ *  @brief  Initializes a solve context with no deadline and no callback.
+ *  @param  context [out] solve context
+ */
+void
+arrow_context_init(arrow_context *context);
+
+/**
+ *  @brief  Initializes a solve context that stops whenever its parent does,
+ *          and can also be cancelled on its own.  Used to stop one piece of
+ *          a larger solve without stopping the rest.
+ *  @param  context [out] solve context
+ *  @param  parent [in] parent solve context (may be NULL)
+ */
+void
+arrow_context_init_child(arrow_context *context, arrow_context *parent);
+
+/**
+ *  @brief  Sets the deadline to the given number of seconds from now.
+ *  @param  context [out] solve context
+ *  @param  timebound [in] seconds of wall-clock time allowed (0.0 or less
+ *              for no deadline)
+ */
+void
+arrow_context_set_timebound(arrow_context *context, double timebound);
+
+/**
+ *  @brief  Requests that any solver using the context stop as soon as it
+ *          can.  Safe to call from a signal handler or another thread.
+ *  @param  context [out] solve context
+ */
+void
+arrow_context_cancel(arrow_context *context);
+
+/**
+ *  @brief  Determines if a solver should stop what it is doing.
+ *  @param  context [in] solve context (may be NULL)
+ *  @return ARROW_TRUE if it or any parent is cancelled or past its deadline,
+ *          ARROW_FALSE otherwise
+ */
+int
+arrow_context_should_stop(arrow_context *context);
+
+/**
+ *  @brief  Returns the wall-clock time left before the deadline.
+ *  @param  context [in] solve context (may be NULL)
+ *  @return seconds remaining before the earliest deadline of the context and
+ *          its parents (never negative), or DBL_MAX if there is none
+ */
+double
+arrow_context_remaining(arrow_context *context);
+
+/**
+ *  @brief  Raises the lower bound carried by the context.  Only one thread
+ *          should raise the bound on a given context at a time.
+ *  @param  context [out] solve context
+ *  @param  value [in] newly proven lower bound (ignored if not larger)
+ */
+void
+arrow_context_raise_lower_bound(arrow_context *context, int value);
+
+/**
+ *  @brief  Returns the best lower bound carried by the context.
+ *  @param  context [in] solve context (may be NULL)
+ *  @return largest lower bound of the context and its parents, or INT_MIN
+ *          if there is none
+ */
+int
+arrow_context_lower_bound(arrow_context *context);
+
+/**
+ *  @brief  Moves the low end of a binary search over a sorted cost list up
+ *          past costs below the context's lower bound.  A bound solver that
+ *          does so converges to the larger of its own bound and the
+ *          context's, which is still a valid lower bound.
+ *  @param  context [in] solve context (may be NULL)
+ *  @param  cost_list [in] sorted list of costs
+ *  @param  low [in] lowest cost index still possible
+ *  @param  high [in] highest cost index still possible
+ *  @return the first index in [low, high] whose cost is at least the lower
+ *          bound, or high if there is none
+ */
+int
+arrow_context_floor_index(arrow_context *context, int *cost_list, int low,
+                          int high);
+
+/**
+ *  @brief  Reports progress through the context's callback, if any.
+ *  @param  context [in] solve context (may be NULL)
+ *  @param  stage [in] short name of the stage reporting progress
+ *  @param  lower [in] current lower bound on the objective value
+ *  @param  upper [in] current upper bound on the objective value
+ */
+void
+arrow_context_progress(arrow_context *context, const char *stage,
+                       int lower, int upper);
+
+
 /****************************************************************************
  *  hash.c
  ****************************************************************************/
@@ -439,6 +610,9 @@ typedef struct arrow_problem
     int fixed_edges;    /**< number of fixed edges */
     char name[ARROW_PROBLEM_NAME_LENGTH]; /**< problem name */
     void *data;         /**< Pointer to structure for problem data. */
+    struct arrow_problem_analysis *analysis; /**< results of one sweep over
+                                                  the costs (NULL until
+                                                  arrow_problem_analyze) */
         
     /**
      *  @brief  Returns the cost between node i and node j.
@@ -470,6 +644,27 @@ typedef struct arrow_problem_info
     arrow_hash hash;       /**< hash table structure */
 } arrow_problem_info;
 
+/**
+ *  @brief  Everything learned about a problem's costs from one sweep over
+ *          them.  On symmetric problems each edge is counted once, and a
+ *          node's costs "in" are the same as its costs "out".
+ */
+typedef struct arrow_problem_analysis
+{
+    int *cost_list;         /**< sorted list of unique costs */
+    int *cost_count;        /**< number of edges with each cost */
+    int cost_list_length;   /**< length of cost list */
+    int min_cost;           /**< smallest cost in problem */
+    int max_cost;           /**< largest cost in problem */
+    int *min_out;           /**< smallest cost out of each node */
+    int *next_out;          /**< second smallest cost out of each node */
+    int *min_in;            /**< smallest cost into each node */
+    int *max_out;           /**< largest cost out of each node */
+    int *next_max_out;      /**< second largest cost out of each node */
+    int *max_in;            /**< largest cost into each node */
+    int two_max;            /**< the 2-max bound (see arrow_2mb_solve) */
+} arrow_problem_analysis;
+
 /**
  *  @brief  Reads a problem from a TSPLIB file.
  *  @param  file_name [in] path to TSPLIB file
@@ -485,6 +680,20 @@ arrow_problem_read(char *file_name, arrow_problem *problem);
 void
 arrow_problem_destruct(arrow_problem *problem);
 
+/**
+ *  @brief  Sweeps over the costs of a problem once, in parallel, keeping
+ *          the results with the problem so later calls (and the functions
+ *          below) don't sweep again.  The problem's costs must not change
+ *          afterwards, and the first call shouldn't race with another.
+ *          Problems built by a cost matrix function are swept on every
+ *          call instead, and their analysis is only good until the next.
+ *  @param  problem [in] problem data structure
+ *  @param  analysis [out] the problem's analysis (owned by the problem)
+ */
+int
+arrow_problem_analyze(arrow_problem *problem,
+                      arrow_problem_analysis **analysis);
+
 /**
  *  @brief  Builds ordered cost list and finds min/max cost in a problem.
  *  @param  problem [in] problem data structure
@@ -512,8 +721,8 @@ int
 arrow_problem_info_cost_index(arrow_problem_info *info, int cost, int *pos);
 
 /**
- *  @brief  Finds the largest cost in a problem (cheaper than calling
-            arrow_problem_info_get)
+ *  @brief  Finds the largest cost in a problem (analyzing the problem, so
+ *          a later arrow_problem_info_get is free)
  *  @param  problem [in] problem data structure
  *  @return The largest cost in the problem.
  */
@@ -561,6 +770,153 @@ arrow_problem_mstsp_to_btsp(int shallow, arrow_problem *old_problem,
                             int max_cost, arrow_problem *new_problem);
 
 
+/****************************************************************************
+ *  threshold.c
+ ****************************************************************************/
+/**
+ *  @brief  Search over a sorted cost list for the first cost at which a
+ *          monotone predicate holds (once it holds at a cost, it holds at
+ *          every larger cost).  Bound solvers fill in the predicate and,
+ *          optionally, hooks that let one probe start from the state the
+ *          last one left behind.
+ */
+typedef struct arrow_threshold
+{
+    int *cost_list;         /**< sorted list of costs to search */
+    int low;                /**< lowest cost index still possible */
+    int high;               /**< highest cost index still possible */
+    int high_feasible;      /**< ARROW_TRUE if the predicate is known to
+                                 hold at high, so it's never probed */
+    int slots;              /**< number of probes evaluated at once, each
+                                 on its own thread with its own state */
+    const char *stage;      /**< short name for progress reports */
+    arrow_context *context; /**< solve context (may be NULL) */
+    void *data;             /**< solver data passed to the functions below */
+
+    /**
+     *  @brief  Evaluates the predicate at a cost.
+     *  @param  data [in] solver data
+     *  @param  slot [in] which state to use (0 <= slot < slots)
+     *  @param  index [in] index of the cost in the cost list
+     *  @param  feasible [out] ARROW_TRUE if the predicate holds
+     */
+    int
+    (*probe)(void *data, int slot, int index, int *feasible);
+
+    /**
+     *  @brief  Called when the search moves up past a probe that failed;
+     *          every later probe is at a larger cost (may be NULL).
+     *  @param  data [in] solver data
+     *  @param  slot [in] state the probe was evaluated with
+     *  @param  index [in] index of the cost probed
+     */
+    void
+    (*advance)(void *data, int slot, int index);
+
+    /**
+     *  @brief  Called when the search moves down to a probe that held;
+     *          every later probe is at a smaller cost (may be NULL).
+     *  @param  data [in] solver data
+     *  @param  slot [in] state the probe was evaluated with
+     *  @param  index [in] index of the cost probed
+     */
+    void
+    (*retreat)(void *data, int slot, int index);
+
+    int found;              /**< ARROW_TRUE if the predicate held at high */
+    int probes;             /**< number of probes evaluated */
+    double probe_time;      /**< total (thread) time spent in probes */
+} arrow_threshold;
+
+/**
+ *  @brief  Sets up a search over the whole cost list, one probe at a time,
+ *          with no hooks.  The caller fills in probe and anything else.
+ *  @param  search [out] search
+ *  @param  cost_list [in] sorted list of costs
+ *  @param  length [in] length of the cost list
+ */
+void
+arrow_threshold_init(arrow_threshold *search, int *cost_list, int length);
+
+/**
+ *  @brief  Narrows [low, high] until the two meet, probing slots evenly
+ *          spaced costs per round and skipping costs below the context's
+ *          lower bound.  If the predicate held nowhere it's tried at the
+ *          top before giving up.  If the context stops the search early,
+ *          cost_list[low] is still a valid lower bound.
+ *  @param  search [out] search
+ */
+int
+arrow_threshold_run(arrow_threshold *search);
+
+
+/****************************************************************************
+ *  trace.c
+ ****************************************************************************/
+#define ARROW_TRACE_JSONL 0
+#define ARROW_TRACE_CHROME 1
+
+#define ARROW_TRACE_PROBE 0
+#define ARROW_TRACE_MEMO 1
+#define ARROW_TRACE_PREFILTER 2
+#define ARROW_TRACE_ATTEMPT 3
+#define ARROW_TRACE_KIND_COUNT 4
+
+#define ARROW_TRACE_INFEASIBLE 0
+#define ARROW_TRACE_FEASIBLE 1
+#define ARROW_TRACE_STOPPED 2
+
+/**
+ *  @brief  One traced event.
+ */
+typedef struct arrow_trace_event
+{
+    int kind;           /**< what happened (ARROW_TRACE_PROBE, ...) */
+    int min_cost;       /**< smallest cost allowed in the probe */
+    int max_cost;       /**< largest cost allowed in the probe */
+    int step;           /**< solve plan step (-1 if none) */
+    int attempt;        /**< attempt within the step (-1 if none) */
+    int solver;         /**< TSP solver used (-1 if none) */
+    int outcome;        /**< ARROW_TRACE_FEASIBLE, ... */
+    double start;       /**< wall-clock time the event started */
+    double duration;    /**< wall-clock seconds the event took */
+} arrow_trace_event;
+
+/**
+ *  @brief  Starts writing trace events to the given file.  Events are
+ *          buffered per thread and written out as each buffer fills.
+ *  @param  file_name [in] file to write to
+ *  @param  format [in] ARROW_TRACE_JSONL for one JSON object per line, or
+ *          ARROW_TRACE_CHROME for the Chrome trace event format
+ */
+int
+arrow_trace_open(const char *file_name, int format);
+
+/**
+ *  @brief  Writes out every buffered event and closes the trace file.
+ *          Events recorded by other threads after this are dropped.
+ */
+int
+arrow_trace_close();
+
+/**
+ *  @brief  Records an event in the calling thread's buffer.  Does nothing if
+ *          no trace file is open.  Use the arrow_trace() macro instead so
+ *          the call can be compiled out.
+ *  @param  kind [in] what happened (ARROW_TRACE_PROBE, ...)
+ *  @param  min_cost [in] smallest cost allowed in the probe
+ *  @param  max_cost [in] largest cost allowed in the probe
+ *  @param  step [in] solve plan step (-1 if none)
+ *  @param  attempt [in] attempt within the step (-1 if none)
+ *  @param  solver [in] TSP solver used (-1 if none)
+ *  @param  outcome [in] ARROW_TRACE_FEASIBLE, ...
+ *  @param  start [in] wall-clock time the event started
+ */
+void
+arrow_trace_record(int kind, int min_cost, int max_cost, int step,
+                   int attempt, int solver, int outcome, double start);
+
+
 /****************************************************************************
  *  util.c
  ****************************************************************************/
@@ -599,6 +955,13 @@ arrow_util_print_error(const char *file_name, int line_num,
 inline double
 arrow_util_zeit();
 
+/**
+ *  @brief  Used to measure deadlines.
+ *  @return a value representing the wall-clock time in seconds
+ */
+inline double
+arrow_util_real_zeit();
+
 /**
  *  @brief  Redirects STDOUT stream to a file (can be used
  *      to completely surpress output by directing to /dev/null).
@@ -697,6 +1060,27 @@ arrow_util_random_between(int min, int max);
 void
 arrow_util_permute_array(int size, int *array);
 
+/**
+ *  @brief  Returns a random number between min and max using the caller's
+ *          own generator state, so it is safe to call from several threads.
+ *  @param  seed [out] generator state
+ *  @param  min [in] the minimum random number to return
+ *  @param  max [in] the maximum random number to return
+ *  @return a random integer in the range [min, max]
+ */
+int
+arrow_util_random_between_r(unsigned int *seed, int min, int max);
+
+/**
+ *  @brief  Randomly permutes the elements of the given array using the
+ *          caller's own generator state.
+ *  @param  seed [out] generator state
+ *  @param  size [in] the size of the array.
+ *  @param  array [out] the array to permute.
+ */
+void
+arrow_util_permute_array_r(unsigned int *seed, int size, int *array);
+
 /**
  *  @brief  Writes a tour in TSPLIB format.
  *  @param  problem [in] problem associated with tour.
@@ -16,7 +16,10 @@
 #endif
 
 /**
- *  @brief  A lower bound result
+ *  @brief  A lower bound result.  Solvers that binary search over the cost
+ *          list and are stopped early by their solve context report the
+ *          smallest cost not yet ruled out, which is still a valid (if
+ *          weaker) lower bound.
  */
 typedef struct arrow_bound_result
 {
@@ -44,11 +47,12 @@ arrow_2mb_solve(arrow_problem *problem, arrow_bound_result *result);
  *  @brief  Solves the bottleneck assignment problem (BAP).
  *  @param  problem [in] problem data
  *  @param  info [in] problem info
+ *  @param  context [in] solve context (can be NULL)
  *  @param  result [out] BBSSP solution
  */
 int
 arrow_bap_solve(arrow_problem *problem, arrow_problem_info *info, 
-                arrow_bound_result *result);
+                arrow_context *context, arrow_bound_result *result);
 
 /**
  *  @brief  Determines if the problem has an assignment using only costs
@@ -70,11 +74,12 @@ arrow_bap_has_assignment(arrow_problem *problem, int min_cost, int max_cost,
  *          (BBSSP) on the given problem.
  *  @param  problem [in] problem data
  *  @param  info [in] problem info
+ *  @param  context [in] solve context (can be NULL)
  *  @param  result [out] BBSSP solution
  */
 int
 arrow_bbssp_solve(arrow_problem *problem, arrow_problem_info *info, 
-                  arrow_bound_result *result);
+                  arrow_context *context, arrow_bound_result *result);
 
 /**
  *  @brief  Determines if the graph is biconnected using only edges with costs
@@ -97,11 +102,12 @@ arrow_bbssp_biconnected(arrow_problem *problem, int min_cost, int max_cost,
  *          (BSCSSP) on the given graph.
  *  @param  problem [in] problem data
  *  @param  info [in] problem info
+ *  @param  context [in] solve context (can be NULL)
  *  @param  result [out] BSCSSP solution
  */
 int
 arrow_bscssp_solve(arrow_problem *problem, arrow_problem_info *info, 
-                   arrow_bound_result *result);
+                   arrow_context *context, arrow_bound_result *result);
 
 /**
  *  @brief  Determines if the problem is strongly connected using only costs
@@ -124,11 +130,13 @@ arrow_bscssp_connected(arrow_problem *problem, int min_cost, int max_cost,
  *  @param  problem [in] problem data
  *  @param  info [in] problem info
  *  @param  max_length [in] the maximum length of the assignment
+ *  @param  context [in] solve context (can be NULL)
  *  @param  result [out] CBAP solution
  */
 int
 arrow_cbap_solve(arrow_problem *problem, arrow_problem_info *info, 
-                 double max_length, arrow_bound_result *result);
+                 double max_length, arrow_context *context,
+                 arrow_bound_result *result);
 
 /**
  *  @brief  Solves the linear assignment problem (LAP).
@@ -171,11 +179,39 @@ arrow_cbst_mst_solve(arrow_problem *problem, arrow_problem_info *info,
  ****************************************************************************/ 
 /**
  *  @brief  Solves the degree constrained bottleneck paths bound (DCBPB).
+ *          If the context stops it early, the bound covers only the nodes
+ *          examined so far.
  *  @param  problem [in] problem data
+ *  @param  context [in] solve context (can be NULL)
  *  @param  result [out] BPB solution
  */
 int
-arrow_dcbpb_solve(arrow_problem *problem, arrow_bound_result *result);
+arrow_dcbpb_solve(arrow_problem *problem, arrow_context *context,
+                  arrow_bound_result *result);
+
+
+/****************************************************************************
+ *  portfolio.c
+ ****************************************************************************/
+/**
+ *  @brief  Runs the BTSP lower bounds side by side and returns the best.
+ *          The 2MB is computed first; BAP, BBSSP, DCBPB and (for asymmetric
+ *          problems) BSCSSP then run in their own threads.  Whenever one
+ *          finishes, its bound is shared with the others still running so
+ *          their binary searches start above it.  When the time bound is
+ *          hit the remaining solvers stop with whatever bound they have.
+ *  @param  problem [in] problem data
+ *  @param  info [in] problem info
+ *  @param  timebound [in] seconds of wall-clock time allowed (0.0 or less
+ *              for none)
+ *  @param  context [in] solve context (can be NULL); each solver's bound
+ *              is reported through its progress callback
+ *  @param  result [out] best lower bound found
+ */
+int
+arrow_lb_portfolio_solve(arrow_problem *problem, arrow_problem_info *info,
+                         double timebound, arrow_context *context,
+                         arrow_bound_result *result);
 
 
 /* End C++ wrapper */
@@ -15,11 +15,12 @@
     extern "C" {
 #endif
 
-#define ARROW_TSP_SOLVER_COUNT 4
+#define ARROW_TSP_SOLVER_COUNT 5
 #define ARROW_TSP_CC_EXACT 0
 #define ARROW_TSP_CC_LK 1
 #define ARROW_TSP_RAI 2
 #define ARROW_TSP_PATCHING 3
+#define ARROW_TSP_POSA 4
 
 /**
  *  @brief  LK algorithm parameters
@@ -41,14 +42,29 @@ typedef struct arrow_tsp_cc_lk_params
 } arrow_tsp_cc_lk_params;
 
 /**
- *  @brief  LK algorithm parameters
+ *  @brief  RAI algorithm parameters
  */
 typedef struct arrow_tsp_rai_params
 {
     int iterations;     /**< the number of RAI iterations to perform */
     int solve_btsp;     /**< if ARROW_TRUE, solves BTSP instead of TSP */
+    int threads;        /**< number of worker threads; the iterations are
+                             shared out between them */
+    int restart_interval; /**< workers restart from the shared best tour
+                               after this many iterations (0 for never) */
 } arrow_tsp_rai_params;
 
+/**
+ *  @brief  Posa rotation-extension parameters
+ */
+typedef struct arrow_tsp_posa_params
+{
+    int restarts;       /**< the number of random restarts to perform */
+    int max_steps;      /**< rotations and extensions allowed per attempt */
+    int threshold;      /**< edges costing at most this much form the graph
+                             searched for a Hamiltonian cycle */
+} arrow_tsp_posa_params;
+
 /**
  *  @brief  TSP result (including result from LK heuristic)
  */
@@ -88,32 +104,94 @@ void
 arrow_tsp_cc_lk_params_destruct(arrow_tsp_cc_lk_params *params);
 
 /**
- *  @brief  Solves TSP with Concorde's exact solver.
+ *  @brief  Solves TSP with Concorde's exact solver.  The time left on the
+ *          context is passed to Concorde as its time bound; if it is hit the
+ *          best tour found so far is returned.
  *  @param  problem [in] problem to solve
  *  @param  initial_tour [in] an initial tour (can be NULL)
+ *  @param  context [in] solve context (can be NULL)
  *  @param  result [out] TSP solution
  */
 int 
 arrow_tsp_cc_exact_solve(arrow_problem *problem, int *initial_tour, 
-                         arrow_tsp_result *result);
+                         arrow_context *context, arrow_tsp_result *result);
 
 /**
- *  @brief  Solves TSP with Concorde's Lin-Kernighan heuristic.
+ *  @brief  Solves TSP with Concorde's Lin-Kernighan heuristic.  Random
+ *          restarts stop early if the context says so.
  *  @param  problem [in] problem to solve
  *  @param  params [in] Lin-Kernighan params (can be NULL)
+ *  @param  context [in] solve context (can be NULL)
  *  @param  result [out] TSP solution
  */                  
 int
 arrow_tsp_cc_lk_solve(arrow_problem *problem, arrow_tsp_cc_lk_params *params,
-                      arrow_tsp_result *result);
+                      arrow_context *context, arrow_tsp_result *result);
+
+
+/****************************************************************************
+ *  posa.c
+ ****************************************************************************/
+/**
+ *  @brief  Sets default parameters for the Posa heuristic:
+ *              - restarts = 10
+ *              - max_steps = 20 * problem->size
+ *              - threshold = 0
+ *  @param  problem [in] problem to solve
+ *  @param  params [out] Posa parameters structure
+ */
+void
+arrow_tsp_posa_params_init(arrow_problem *problem,
+                           arrow_tsp_posa_params *params);
+
+/**
+ *  @brief  Looks for a Hamiltonian cycle in the graph of edges costing at
+ *          most params->threshold using Posa's rotation-extension method.
+ *          Negative cost (fixed) edges are taken whenever possible and never
+ *          rotated out of the path.  If no cycle is found, found_tour is
+ *          ARROW_FALSE; with the default threshold of 0 this suits the
+ *          feasibility problems built by the BTSP cost matrix functions.
+ *          Restarts stop early if the context says so.
+ *  @param  problem [in] problem to solve (assumed symmetric)
+ *  @param  params [in] Posa params
+ *  @param  context [in] solve context (can be NULL)
+ *  @param  result [out] TSP solution
+ */
+int
+arrow_tsp_posa_solve(arrow_problem *problem, arrow_tsp_posa_params *params,
+                     arrow_context *context, arrow_tsp_result *result);
 
 
 /****************************************************************************
  *  rai.c
  ****************************************************************************/
+/**
+ *  @brief  Sets default parameters for the RAI heuristic:
+ *              - iterations = problem->size * problem->size
+ *              - solve_btsp = ARROW_FALSE
+ *              - threads = 1
+ *              - restart_interval = 0
+ *  @param  problem [in] problem to solve
+ *  @param  params [out] RAI parameters structure
+ */
+void
+arrow_tsp_rai_params_init(arrow_problem *problem, 
+                          arrow_tsp_rai_params *params);
+
+/**
+ *  @brief  Solves TSP with the random arbitrary insertion heuristic.  With
+ *          more than one thread, each worker builds its own tour from a
+ *          different random permutation and improves it, publishing
+ *          improvements to a shared best tour.  Improvement iterations stop
+ *          early if the context says so.
+ *  @param  problem [in] problem to solve
+ *  @param  params [in] RAI params
+ *  @param  context [in] solve context (can be NULL)
+ *  @param  result [out] TSP solution
+ */
 int
 arrow_tsp_rai_solve(arrow_problem *problem, arrow_tsp_rai_params *params, 
-                    arrow_tsp_result *result);
+                    arrow_context *context, arrow_tsp_result *result);
 
 
 /****************************************************************************
@@ -143,11 +221,12 @@ arrow_tsp_result_destruct(arrow_tsp_result *result);
  *  @param  tsp_solver [in] the TSP solver to use
  *  @param  problem [in] problem to solve
  *  @param  params [in] Lin-Kernighan params (can be NULL)
+ *  @param  context [in] solve context (can be NULL)
  *  @param  result [out] TSP solution
  */                  
 int
 arrow_tsp_solve(int tsp_solver, arrow_problem *problem, void *params,
-                arrow_tsp_result *result);
+                arrow_context *context, arrow_tsp_result *result);
 
 /**
  *  @brief  Prints out the short name for the given solver.
@@ -16,14 +16,6 @@
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
-/**
- *  @brief  Calculates the best BTSP lower bound
- *  @param  problem [in] problem structure
- *  @param  lower_bound [out] the best lower bound value
- */
-int 
-btsp_lower_bound(arrow_problem *problem, arrow_problem_info *info, int *lower_bound);
-
 /**
  *  @brief  Calculates BTSP lower bounds for each unique cost
  *  @param  problem [in] problem structure
@@ -121,6 +113,9 @@ arrow_balanced_tsp_db(arrow_problem *btsp_problem,
     arrow_problem *solve_problem2;
     arrow_problem ib_problem;
     arrow_btsp_result cur_tour_result;
+    arrow_btsp_checkpoint *checkpoint = params->checkpoint;
+    int resumed = ((checkpoint != NULL) && checkpoint->resumed);
+    arrow_btsp_memo_view memo_view = btsp_params->memo;
     
     /* Print out debug information */
     arrow_debug("With Improvements? %s\n", (params->with_improvements ? "Yes" : "No"));
@@ -139,14 +134,17 @@ arrow_balanced_tsp_db(arrow_problem *btsp_problem,
     *lb_time = 0.0;
     arrow_btsp_result_init(solve_problem, &cur_tour_result);
     tour_result->optimal = ARROW_FALSE;
-    tour_result->found_tour = ARROW_FALSE;
-    tour_result->total_time = 0.0;
-    tour_result->bin_search_steps = 0;
-    for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
+    if(!resumed)
     {
-        tour_result->solver_attempts[i] = 0;
-        tour_result->solver_time[i] = 0.0;
-    }    
+        tour_result->found_tour = ARROW_FALSE;
+        tour_result->total_time = 0.0;
+        tour_result->bin_search_steps = 0;
+        for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
+        {
+            tour_result->solver_attempts[i] = 0;
+            tour_result->solver_time[i] = 0.0;
+        }
+    }
     
     /* Find low/high/max values */
     low = 0; best_tour_low = 0;
@@ -181,7 +179,18 @@ arrow_balanced_tsp_db(arrow_problem *btsp_problem,
     }
     
     low++;
-    printf("low = %d; high = %d; max = %d\n", low, high, max);
+    arrow_debug("low = %d; high = %d; max = %d\n", low, high, max);
+    
+    /* Carry on from a saved search */
+    if(resumed)
+    {
+        low = checkpoint->low;
+        high = checkpoint->high;
+        best_tour_low = checkpoint->values[0];
+        best_tour_high = checkpoint->values[1];
+        tour_result->total_time = checkpoint->elapsed;
+        arrow_debug("Resuming at low = %d; high = %d\n", low, high);
+    }
     
     
     /* Create function for ignoring C[i,j] < low_val */
@@ -198,9 +207,22 @@ arrow_balanced_tsp_db(arrow_problem *btsp_problem,
     arrow_debug("Starting balanced search [%d,...]\n", info->cost_list[low]);
     while((low <= max) && (high < info->cost_list_length))
     {
-        printf("------------------------------------\n");
+        if(!arrow_baltsp_checkpoint_save(checkpoint, btsp_problem, info, low, high,
+                                         best_tour_low, best_tour_high, 0,
+                                         ARROW_FALSE, tour_result))
+        {
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        if(arrow_context_should_stop(params->context))
+        {
+            arrow_debug("Stopping balanced search early.\n");
+            break;
+        }
+        
+        arrow_debug("------------------------------------\n");
         low_val = info->cost_list[low];
-        printf("C[i,j] >= %d: \n", low_val);
+        arrow_debug("C[i,j] >= %d: \n", low_val);
         
         tour_result->bin_search_steps++;
     
@@ -215,13 +237,25 @@ arrow_balanced_tsp_db(arrow_problem *btsp_problem,
         }
         
         /* See if the BTSP lower bound is less than the current gap */
-        if(!btsp_lower_bound(&ib_problem, info, &btsp_lb))
+        if(!arrow_baltsp_btsp_lower_bound(&ib_problem, info, &btsp_lb))
         {
             arrow_print_error("Could not solve BTSP lower bounds on IB cost matrix\n");
             ret = ARROW_FAILURE;
             goto CLEANUP;
         }
         
+        /* The bound proves no tour uses only costs in [low_val, btsp_lb) */
+        if((params->memo != NULL) && (solve_problem->fixed_edges == 0) && 
+           (btsp_lb > low_val))
+        {
+            if(!arrow_btsp_memo_add_infeasible(params->memo, solve_problem,
+                    ARROW_BTSP_MEMO_THRESHOLD, low_val, btsp_lb - 1))
+            {
+                ret = ARROW_FAILURE;
+                goto CLEANUP;
+            }
+        }
+        
         arrow_debug("best_lb - low_val = %d - %d = %d vs best_gap = %d\n",
                     btsp_lb, low_val, btsp_lb - low_val, best_gap);
         if(btsp_lb - low_val > best_gap)
@@ -234,6 +268,10 @@ arrow_balanced_tsp_db(arrow_problem *btsp_problem,
             start_time = arrow_util_zeit();
             btsp_params->lower_bound = btsp_lb;
             btsp_params->upper_bound = info->max_cost;
+            btsp_params->context = params->context;
+            btsp_params->memo.memo = params->memo;
+            btsp_params->memo.base = solve_problem;
+            btsp_params->memo.min_cost = low_val;
             
             arrow_debug("Starting BTSP search to find upper index\n");
             if(!arrow_btsp_solve(&ib_problem, info, btsp_params, &cur_tour_result))
@@ -331,6 +369,10 @@ arrow_balanced_tsp_db(arrow_problem *btsp_problem,
                 start_time = arrow_util_zeit();
                 btsp_params->lower_bound = btsp_lb;
                 btsp_params->upper_bound = info->max_cost;
+                btsp_params->context = params->context;
+                btsp_params->memo.memo = params->memo;
+                btsp_params->memo.base = solve_problem2;
+                btsp_params->memo.min_cost = info->max_cost - info->cost_list[high];
                 if(!arrow_btsp_solve(&ib_problem, info, btsp_params, &cur_tour_result))
                 {
                     arrow_print_error("Error searching for MSTSP tour\n");
@@ -437,8 +479,15 @@ arrow_balanced_tsp_db(arrow_problem *btsp_problem,
         arrow_debug("\n");
     }
     arrow_debug("\n");
+    
+    /* Save where the search ended, whether it finished or was stopped */
+    if(!arrow_baltsp_checkpoint_save(checkpoint, btsp_problem, info, low, high,
+                                     best_tour_low, best_tour_high, 0,
+                                     ARROW_TRUE, tour_result))
+        ret = ARROW_FAILURE;
 
 CLEANUP:
+    btsp_params->memo = memo_view;
     arrow_btsp_fun_destruct(&fun_ib);
     arrow_btsp_result_destruct(&cur_tour_result);
     return ARROW_SUCCESS;
@@ -448,22 +497,6 @@ CLEANUP:
 /****************************************************************************
  * Private function implementations
  ****************************************************************************/
-int 
-btsp_lower_bound(arrow_problem *problem, arrow_problem_info *info, 
-                 int *lower_bound)
-{
-    arrow_bound_result result;
-    
-    if(!arrow_bbssp_solve(problem, info, &result))
-    {
-        arrow_debug("Error finding BBSSP lower bound\n");
-        return ARROW_FAILURE;
-    }
-    *lower_bound = result.obj_value;
-        
-    return ARROW_SUCCESS;
-}
-
 int
 btsp_bounds(arrow_problem *problem, arrow_problem_info *info, int *max_index, 
             int *btsp_lbs, int *best_gap, int *best_low, int *best_high, 
@@ -504,7 +537,7 @@ btsp_bounds(arrow_problem *problem, arrow_problem_info *info, int *max_index,
         
         /* Calculate lower bound */
         start_time = arrow_util_zeit();
-        if(!btsp_lower_bound(&ib_problem, info, &lb))
+        if(!arrow_baltsp_btsp_lower_bound(&ib_problem, info, &lb))
         {
             arrow_print_error("Error finding BTSP lower bound\n");
             ret = ARROW_FAILURE;
@@ -513,10 +546,11 @@ btsp_bounds(arrow_problem *problem, arrow_problem_info *info, int *max_index,
         end_time = arrow_util_zeit();
         *total_time += (end_time - start_time);
         
-        /* A negative value indicates an infeasible lower bound, so we quit here */
-        if(lb < 0)
+        /* A bound past the largest cost means there's no tour, so we quit
+           here */
+        if(lb > info->max_cost)
         {
-            arrow_debug("Negative value for the lower bound #%d, so quit\n", i);
+            arrow_debug("No tour for lower bound #%d, so quit\n", i);
             arrow_debug("Old Max Index Value: %d\n", *max_index);
             *max_index = i - 1;
             arrow_debug("New Max Index Value: %d\n", *max_index);
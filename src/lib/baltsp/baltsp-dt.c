@@ -50,6 +50,9 @@ arrow_balanced_tsp_dt(arrow_problem *problem,
     arrow_problem asym_problem;
     arrow_problem *solve_problem;
     arrow_btsp_result cur_tour_result;
+    arrow_btsp_memo_view *memo_view = NULL;
+    arrow_btsp_checkpoint *checkpoint = params->checkpoint;
+    int resumed = ((checkpoint != NULL) && checkpoint->resumed);
     
     /* Print out debug information */
     arrow_debug("LB Only? %s\n", (lb_only ? "Yes" : "No"));
@@ -74,16 +77,24 @@ arrow_balanced_tsp_dt(arrow_problem *problem,
         solve_problem = &asym_problem;
     }
     
+    /* Verdicts are filed by problem, so only remember them for the
+       caller's problem, not our temporary transformation of it */
+    if(solve_problem == problem)
+        memo_view = &(params->memo);
+    
     /* Setup result structures */
     arrow_btsp_result_init(solve_problem, &cur_tour_result);
     tour_result->optimal = ARROW_FALSE;
-    tour_result->found_tour = ARROW_FALSE;
-    tour_result->total_time = 0.0;
-    tour_result->bin_search_steps = 0;
-    for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
+    if(!resumed)
     {
-        tour_result->solver_attempts[i] = 0;
-        tour_result->solver_time[i] = 0.0;
+        tour_result->found_tour = ARROW_FALSE;
+        tour_result->total_time = 0.0;
+        tour_result->bin_search_steps = 0;
+        for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
+        {
+            tour_result->solver_attempts[i] = 0;
+            tour_result->solver_time[i] = 0.0;
+        }
     }
     lb_result->total_time = 0.0;
     
@@ -108,15 +119,43 @@ arrow_balanced_tsp_dt(arrow_problem *problem,
         max = info->cost_list_length - 1;
     }
     
-    printf("low = %d; high = %d; max = %d\n", low, high, max);
+    arrow_debug("low = %d; high = %d; max = %d\n", low, high, max);
+    
+    /* Carry on from a saved search; only the width of the best lower bound
+       window is kept */
+    if(resumed)
+    {
+        low = checkpoint->low;
+        high = checkpoint->high;
+        best_tour_low = checkpoint->values[0];
+        best_tour_high = checkpoint->values[1];
+        best_lb_low = 0;
+        best_lb_high = checkpoint->values[2];
+        tour_result->total_time = checkpoint->elapsed;
+        arrow_debug("Resuming at low = %d; high = %d\n", low, high);
+    }
     
     /* Main loop */
     arrow_debug("Starting balanced search [%d,%d]\n", params->lower_bound, params->upper_bound);
     while((low <= high) && (high < info->cost_list_length))
     {        
+        if(!arrow_baltsp_checkpoint_save(checkpoint, problem, info, low, high,
+                                         best_tour_low, best_tour_high,
+                                         best_lb_high - best_lb_low,
+                                         ARROW_FALSE, tour_result))
+        {
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        if(arrow_context_should_stop(params->context))
+        {
+            arrow_debug("Stopping balanced search early.\n");
+            break;
+        }
+        
         low_val = info->cost_list[low];
         high_val = info->cost_list[high];
-        printf("%d <= C[i,j] <= %d: ", low_val, high_val);
+        arrow_debug("%d <= C[i,j] <= %d: ", low_val, high_val);
         
         if(with_improvements)
         {
@@ -159,8 +198,10 @@ arrow_balanced_tsp_dt(arrow_problem *problem,
             {
                 arrow_debug("LB is feasible, now trying to find a tour...\n");
                 start_time = arrow_util_zeit();
-                if(!arrow_btsp_feasible(solve_problem, params->num_steps, params->steps,
-                                        low_val, high_val, &is_feasible, &cur_tour_result))
+                if(!arrow_btsp_feasible_memo(memo_view, solve_problem, 
+                                             params->num_steps, params->steps,
+                                             low_val, high_val, params->context,
+                                             &is_feasible, &cur_tour_result))
                 {
                     arrow_debug("Error checking tour feasibility\n");
                     ret = ARROW_FAILURE;
@@ -231,7 +272,7 @@ arrow_balanced_tsp_dt(arrow_problem *problem,
         }
         else
         {
-            if(!lb_only) printf("No tour can be found.\n");
+            if(!lb_only) arrow_debug("No tour can be found.\n");
             
             high++;
             
@@ -252,6 +293,13 @@ arrow_balanced_tsp_dt(arrow_problem *problem,
     
     arrow_debug("\n");
     
+    /* Save where the search ended, whether it finished or was stopped */
+    if(!arrow_baltsp_checkpoint_save(checkpoint, problem, info, low, high,
+                                     best_tour_low, best_tour_high,
+                                     best_lb_high - best_lb_low,
+                                     ARROW_TRUE, tour_result))
+        ret = ARROW_FAILURE;
+    
     lb_result->obj_value = best_lb_high - best_lb_low;
 
 CLEANUP:
@@ -268,12 +316,12 @@ int balanced_lb_feasible(arrow_problem *problem, int min_cost, int max_cost,
         
     if(!arrow_bbssp_biconnected(problem, min_cost, max_cost, is_feasible))
     {
-        printf("Could not solve BBSSP for balanced LB.\n");
+        arrow_debug("Could not solve BBSSP for balanced LB.\n");
         return ARROW_FAILURE;
     }
     if(!*is_feasible)
     {
-        printf("BBSSP is infeasible.\n");
+        arrow_debug("BBSSP is infeasible.\n");
         return ARROW_SUCCESS;
     }
 
@@ -284,7 +332,7 @@ int balanced_lb_feasible(arrow_problem *problem, int min_cost, int max_cost,
     }
     if(!*is_feasible)
     {
-        printf("BAP is infeasible.\n");
+        arrow_debug("BAP is infeasible.\n");
         return ARROW_SUCCESS;
     }
 
@@ -297,7 +345,7 @@ int balanced_lb_feasible(arrow_problem *problem, int min_cost, int max_cost,
         }
         if(!*is_feasible)
         {
-            printf("BSCSSP is infeasible.\n");
+            arrow_debug("BSCSSP is infeasible.\n");
             return ARROW_SUCCESS;
         }
     }
@@ -16,14 +16,6 @@
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
-/**
- *  @brief  Calculates the best BTSP lower bound
- *  @param  problem [in] problem structure
- *  @param  lower_bound [out] the best lower bound value
- */
-int 
-btsp_lower_bound(arrow_problem *problem, arrow_problem_info *info, int *lower_bound);
-
 /**
  *  @brief  Calculates BTSP lower bounds for each unique cost
  *  @param  problem [in] problem structure
@@ -110,7 +102,7 @@ arrow_balanced_tsp_ib(arrow_problem *problem,
     int best_tour_low, best_tour_high;
     int low_val, max;
     int best_gap, cur_gap, lb_gap;
-    int no_tour_cost;
+    int no_tour_cost, first;
     int *btsp_lbs;
     int *cost_order;
     double start_time, end_time;
@@ -118,6 +110,11 @@ arrow_balanced_tsp_ib(arrow_problem *problem,
     arrow_problem *solve_problem;
     arrow_problem ib_problem;
     arrow_btsp_result cur_tour_result;
+    arrow_btsp_checkpoint *checkpoint = params->checkpoint;
+    int resumed = ((checkpoint != NULL) && checkpoint->resumed);
+    
+    /* The checkpoint follows this loop, not the BTSP searches inside it */
+    params->checkpoint = NULL;
     
     /* Print out debug information */
     arrow_debug("LB Only? %s\n", (lb_only ? "Yes" : "No"));
@@ -136,13 +133,16 @@ arrow_balanced_tsp_ib(arrow_problem *problem,
     /* Setup result structures */
     arrow_btsp_result_init(solve_problem, &cur_tour_result);
     tour_result->optimal = ARROW_FALSE;
-    tour_result->found_tour = ARROW_FALSE;
-    tour_result->total_time = 0.0;
-    tour_result->bin_search_steps = 0;
-    for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
+    if(!resumed)
     {
-        tour_result->solver_attempts[i] = 0;
-        tour_result->solver_time[i] = 0.0;
+        tour_result->found_tour = ARROW_FALSE;
+        tour_result->total_time = 0.0;
+        tour_result->bin_search_steps = 0;
+        for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
+        {
+            tour_result->solver_attempts[i] = 0;
+            tour_result->solver_time[i] = 0.0;
+        }
     }
     lb_result->total_time = 0.0;
     
@@ -216,13 +216,37 @@ arrow_balanced_tsp_ib(arrow_problem *problem,
     
     arrow_debug("Starting iterative bottleneck search\n");
     no_tour_cost = info->max_cost + 1;
-    for(i = 0; i <= max; i++)
+    first = 0;
+    if(resumed)
     {
+        first = checkpoint->low;
+        best_tour_low = checkpoint->values[0];
+        best_tour_high = checkpoint->values[1];
+        no_tour_cost = checkpoint->values[2];
+        tour_result->total_time = checkpoint->elapsed;
+        arrow_debug("Resuming at cost order position %d\n", first);
+    }
+    for(i = first; i <= max; i++)
+    {
+        if(!arrow_baltsp_checkpoint_save(checkpoint, problem, info, i, max,
+                                         best_tour_low, best_tour_high,
+                                         no_tour_cost, ARROW_FALSE,
+                                         tour_result))
+        {
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        if(arrow_context_should_stop(params->context))
+        {
+            arrow_debug("Stopping balanced search early.\n");
+            break;
+        }
+        
         low_idx = cost_order[i];
-        printf("------------------------------------\n");
-        printf("Cost Index: %d\n", low_idx);
+        arrow_debug("------------------------------------\n");
+        arrow_debug("Cost Index: %d\n", low_idx);
         low_val = info->cost_list[low_idx];
-        printf("C[i,j] >= %d:\n", low_val);
+        arrow_debug("C[i,j] >= %d:\n", low_val);
         
         if(low_val > no_tour_cost)
         {
@@ -319,8 +343,15 @@ arrow_balanced_tsp_ib(arrow_problem *problem,
         arrow_debug("\n");
     }
     arrow_debug("\n");
+    
+    /* Save where the search ended, whether it finished or was stopped */
+    if(!arrow_baltsp_checkpoint_save(checkpoint, problem, info, i, max,
+                                     best_tour_low, best_tour_high,
+                                     no_tour_cost, ARROW_TRUE, tour_result))
+        ret = ARROW_FAILURE;
 
 CLEANUP:
+    params->checkpoint = checkpoint;
     if(cost_order != NULL) free(cost_order);
     if(btsp_lbs != NULL) free(btsp_lbs);
     arrow_btsp_fun_destruct(&fun_ib);
@@ -332,30 +363,6 @@ CLEANUP:
 /****************************************************************************
  * Private function implementations
  ****************************************************************************/
-int 
-btsp_lower_bound(arrow_problem *problem, arrow_problem_info *info, 
-                 int *lower_bound)
-{
-    arrow_bound_result result;
-    
-    if(!arrow_bbssp_solve(problem, info, &result))
-    {
-        arrow_debug("Error finding BBSSP lower bound\n");
-        return ARROW_FAILURE;
-    }
-    *lower_bound = result.obj_value;
-    
-    if(!arrow_bap_solve(problem, info, &result))
-    {
-        arrow_debug("Error finding BAP lower bound\n");
-        return ARROW_FAILURE;
-    }
-    if(result.obj_value < *lower_bound)
-        *lower_bound = result.obj_value;
-        
-    return ARROW_SUCCESS;
-}
-
 int
 btsp_bounds(arrow_problem *problem, arrow_problem_info *info, int *max_index, 
             int *btsp_lbs, int *best_gap, int *best_low, int *best_high, 
@@ -396,7 +403,7 @@ btsp_bounds(arrow_problem *problem, arrow_problem_info *info, int *max_index,
         
         /* Calculate lower bound */
         start_time = arrow_util_zeit();
-        if(!btsp_lower_bound(&ib_problem, info, &lb))
+        if(!arrow_baltsp_btsp_lower_bound(&ib_problem, info, &lb))
         {
             arrow_print_error("Error finding BTSP lower bound\n");
             ret = ARROW_FAILURE;
@@ -405,10 +412,11 @@ btsp_bounds(arrow_problem *problem, arrow_problem_info *info, int *max_index,
         end_time = arrow_util_zeit();
         *total_time += (end_time - start_time);
         
-        /* A negative value indicates an infeasible lower bound, so we quit here */
-        if(lb < 0)
+        /* A bound past the largest cost means there's no tour, so we quit
+           here */
+        if(lb > info->max_cost)
         {
-            arrow_debug("Negative value for the lower bound #%d, so quit\n", i);
+            arrow_debug("No tour for lower bound #%d, so quit\n", i);
             arrow_debug("Old Max Index Value: %d\n", *max_index);
             *max_index = i - 1;
             arrow_debug("New Max Index Value: %d\n", *max_index);
@@ -16,14 +16,6 @@
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
-/**
- *  @brief  Calculates the best BTSP lower bound
- *  @param  problem [in] problem structure
- *  @param  lower_bound [out] the best lower bound value
- */
-int 
-btsp_lower_bound(arrow_problem *problem, arrow_problem_info *info, int *lower_bound);
-
 /**
  *  @brief  Calculates BTSP lower bounds for each unique cost
  *  @param  problem [in] problem structure
@@ -143,7 +135,7 @@ arrow_balanced_tsp_lb(arrow_problem *problem,
     }
     
     low++;
-    printf("low = %d; high = %d; max = %d\n", low, high, max);
+    arrow_debug("low = %d; high = %d; max = %d\n", low, high, max);
     
     
     /* Create function for ignoring C[i,j] < low_val */
@@ -160,9 +152,9 @@ arrow_balanced_tsp_lb(arrow_problem *problem,
     arrow_debug("Starting balanced search [%d,...]\n", info->cost_list[low]);
     while((low <= max) && (high < info->cost_list_length))
     {        
-        printf("------------------------------------\n");
+        arrow_debug("------------------------------------\n");
         low_val = info->cost_list[low];
-        printf("C[i,j] >= %d: \n", low_val);
+        arrow_debug("C[i,j] >= %d: \n", low_val);
         
         /* Create problem that ignores C[i,j] < low_val */
         if(!arrow_btsp_fun_apply(&fun_ib, solve_problem, low_val, info->max_cost, &ib_problem))
@@ -173,7 +165,7 @@ arrow_balanced_tsp_lb(arrow_problem *problem,
         }
         
         /* See if the BTSP lower bound is less than the current gap */
-        if(!btsp_lower_bound(&ib_problem, info, &btsp_lb))
+        if(!arrow_baltsp_btsp_lower_bound(&ib_problem, info, &btsp_lb))
         {
             arrow_print_error("Could not solve BTSP lower bounds on IB cost matrix\n");
             ret = ARROW_FAILURE;
@@ -211,35 +203,6 @@ CLEANUP:
 /****************************************************************************
  * Private function implementations
  ****************************************************************************/
-int 
-btsp_lower_bound(arrow_problem *problem, arrow_problem_info *info, 
-                 int *lower_bound)
-{
-    arrow_bound_result result;
-    
-    if(!arrow_bbssp_solve(problem, info, &result))
-    {
-        arrow_debug("Error finding BBSSP lower bound\n");
-        return ARROW_FAILURE;
-    }
-    if(result.obj_value == -1)
-        *lower_bound = info->max_cost + 1;
-    else
-        *lower_bound = result.obj_value;
-    
-    if(!arrow_bap_solve(problem, info, &result))
-    {
-        arrow_debug("Error finding BAP lower bound\n");
-        return ARROW_FAILURE;
-    }
-    if(result.obj_value == -1)
-        *lower_bound = info->max_cost + 1;
-    else if(result.obj_value > *lower_bound)
-        *lower_bound = result.obj_value;
-        
-    return ARROW_SUCCESS;
-}
-
 int
 btsp_bounds(arrow_problem *problem, arrow_problem_info *info, int *max_index, 
             int *btsp_lbs, int *best_gap, int *best_low, int *best_high, 
@@ -280,7 +243,7 @@ btsp_bounds(arrow_problem *problem, arrow_problem_info *info, int *max_index,
         
         /* Calculate lower bound */
         start_time = arrow_util_zeit();
-        if(!btsp_lower_bound(&ib_problem, info, &lb))
+        if(!arrow_baltsp_btsp_lower_bound(&ib_problem, info, &lb))
         {
             arrow_print_error("Error finding BTSP lower bound\n");
             ret = ARROW_FAILURE;
@@ -289,10 +252,11 @@ btsp_bounds(arrow_problem *problem, arrow_problem_info *info, int *max_index,
         end_time = arrow_util_zeit();
         *total_time += (end_time - start_time);
         
-        /* A negative value indicates an infeasible lower bound, so we quit here */
-        if(lb < 0)
+        /* A bound past the largest cost means there's no tour, so we quit
+           here */
+        if(lb > info->max_cost)
         {
-            arrow_debug("Negative value for the lower bound #%d, so quit\n", i);
+            arrow_debug("No tour for lower bound #%d, so quit\n", i);
             arrow_debug("Old Max Index Value: %d\n", *max_index);
             *max_index = i - 1;
             arrow_debug("New Max Index Value: %d\n", *max_index);
@@ -0,0 +1,49 @@
+/**********************************************************doxygen*//** @file
+ * @brief   BTSP lower bounds for balanced TSP searches.
+ *
+ * The balanced TSP searches bound the largest cost of a tour that uses no
+ * cost below some value.  The BBSSP bound is found first, and the BAP
+ * search starts from it, since only the larger of the two matters.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+#include "baltsp.h"
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+int 
+arrow_baltsp_btsp_lower_bound(arrow_problem *problem, arrow_problem_info *info,
+                              int *lower_bound)
+{
+    arrow_bound_result result;
+    arrow_context context;
+    
+    if(!arrow_bbssp_solve(problem, info, NULL, &result))
+    {
+        arrow_debug("Error finding BBSSP lower bound\n");
+        return ARROW_FAILURE;
+    }
+    if(result.obj_value == -1)
+    {
+        *lower_bound = info->max_cost + 1;
+        return ARROW_SUCCESS;
+    }
+    *lower_bound = result.obj_value;
+    
+    arrow_context_init(&context);
+    arrow_context_raise_lower_bound(&context, *lower_bound);
+    if(!arrow_bap_solve(problem, info, &context, &result))
+    {
+        arrow_debug("Error finding BAP lower bound\n");
+        return ARROW_FAILURE;
+    }
+    if(result.obj_value == -1)
+        *lower_bound = info->max_cost + 1;
+    else if(result.obj_value > *lower_bound)
+        *lower_bound = result.obj_value;
+        
+    return ARROW_SUCCESS;
+}
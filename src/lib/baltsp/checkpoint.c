@@ -0,0 +1,34 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Checkpoints for balanced TSP searches.
+ *
+ * Saves the state shared by the balanced TSP searches: the pair of cost
+ * indices being tried and the gap of the best tour found.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+#include "baltsp.h"
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+int
+arrow_baltsp_checkpoint_save(arrow_btsp_checkpoint *checkpoint, 
+                             arrow_problem *problem, arrow_problem_info *info,
+                             int low, int high, int best_low, int best_high,
+                             int extra, int force, 
+                             arrow_btsp_result *tour_result)
+{
+    if(checkpoint == NULL)
+        return ARROW_SUCCESS;
+
+    checkpoint->low = low;
+    checkpoint->high = high;
+    checkpoint->values[0] = best_low;
+    checkpoint->values[1] = best_high;
+    checkpoint->values[2] = extra;
+    checkpoint->elapsed = tour_result->total_time;
+    return arrow_btsp_checkpoint_save(checkpoint, problem, info, force,
+                                      tour_result);
+}
@@ -43,6 +43,22 @@ typedef struct baltsp_shake_data
 int
 baltsp_basic_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
                       int min_cost, int max_cost, int i, int j);
+
+/**
+ *  @brief  Writes rows [first, last) of a deep copy, as get_cost would.
+ *  @param  fun [in] function structure
+ *  @param  base_problem [in] problem structure
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  first [in] first row to write
+ *  @param  last [in] one past the last row to write
+ *  @param  row [out] scratch space for base_problem->size costs
+ *  @param  adj [out] matrix rows; adj[i][j] is written for j < i
+ */
+void
+baltsp_basic_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                            int min_cost, int max_cost, int first, int last,
+                            int *row, int **adj);
                
 /**
  *  @brief  Initializes the function data.
@@ -85,6 +101,22 @@ baltsp_basic_feasible(arrow_btsp_fun *fun, arrow_problem *base_problem,
 int
 baltsp_ut_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
                    int min_cost, int max_cost, int i, int j);
+
+/**
+ *  @brief  Writes rows [first, last) of a deep copy, as get_cost would.
+ *  @param  fun [in] function structure
+ *  @param  base_problem [in] problem structure
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  first [in] first row to write
+ *  @param  last [in] one past the last row to write
+ *  @param  row [out] scratch space for base_problem->size costs
+ *  @param  adj [out] matrix rows; adj[i][j] is written for j < i
+ */
+void
+baltsp_ut_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                         int min_cost, int max_cost, int first, int last,
+                         int *row, int **adj);
                
 /**
  *  @brief  Determines if the given tour is feasible or not.
@@ -141,6 +173,22 @@ baltsp_shake_destruct(arrow_btsp_fun *fun);
 int
 baltsp_ib_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
                    int min_cost, int max_cost, int i, int j);
+
+/**
+ *  @brief  Writes rows [first, last) of a deep copy, as get_cost would.
+ *  @param  fun [in] function structure
+ *  @param  base_problem [in] problem structure
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  first [in] first row to write
+ *  @param  last [in] one past the last row to write
+ *  @param  row [out] scratch space for base_problem->size costs
+ *  @param  adj [out] matrix rows; adj[i][j] is written for j < i
+ */
+void
+baltsp_ib_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                         int min_cost, int max_cost, int first, int last,
+                         int *row, int **adj);
                
 /**
  *  @brief  Determines if the given tour is feasible or not.
@@ -207,7 +255,11 @@ arrow_baltsp_fun_basic(int shallow, arrow_btsp_fun *fun)
 {    
     fun->data = NULL;
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_TRUE;
+    fun->incremental = ARROW_FALSE;
+    fun->cache = NULL;
     fun->get_cost = baltsp_basic_get_cost;
+    fun->transform_rows = baltsp_basic_transform_rows;
     fun->initialize = baltsp_basic_initialize;
     fun->destruct = baltsp_basic_destruct;
     fun->feasible = baltsp_basic_feasible;
@@ -219,7 +271,11 @@ arrow_baltsp_fun_ut(int shallow, arrow_btsp_fun *fun)
 {    
     fun->data = NULL;
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_TRUE;
+    fun->incremental = ARROW_FALSE;
+    fun->cache = NULL;
     fun->get_cost = baltsp_ut_get_cost;
+    fun->transform_rows = baltsp_ut_transform_rows;
     fun->initialize = baltsp_basic_initialize;
     fun->destruct = baltsp_basic_destruct;
     fun->feasible = baltsp_ut_feasible;
@@ -254,7 +310,11 @@ arrow_baltsp_fun_shake(int shallow, int infinity,
     }
     
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_TRUE;
+    fun->incremental = ARROW_FALSE;
+    fun->cache = NULL;
     fun->get_cost = baltsp_shake_get_cost;
+    fun->transform_rows = NULL;
     fun->initialize = baltsp_shake_initialize;
     fun->destruct = baltsp_shake_destruct;
     fun->feasible = baltsp_basic_feasible;
@@ -267,7 +327,11 @@ arrow_baltsp_fun_ib(int shallow, arrow_btsp_fun *fun)
 {    
     fun->data = NULL;
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_FALSE;
+    fun->incremental = ARROW_FALSE;
+    fun->cache = NULL;
     fun->get_cost = baltsp_ib_get_cost;
+    fun->transform_rows = baltsp_ib_transform_rows;
     fun->initialize = baltsp_basic_initialize;
     fun->destruct = baltsp_basic_destruct;
     fun->feasible = baltsp_ib_feasible;
@@ -301,7 +365,11 @@ arrow_baltsp_fun_dt2(int shallow, int random_min, int random_max,
     }
     
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_TRUE;
+    fun->incremental = ARROW_FALSE;
+    fun->cache = NULL;
     fun->get_cost = baltsp_dt2_get_cost;
+    fun->transform_rows = NULL;
     fun->initialize = baltsp_dt2_initialize;
     fun->destruct = baltsp_shake_destruct;
     fun->feasible = baltsp_dt2_feasible;
@@ -324,6 +392,22 @@ baltsp_basic_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
         return cost + 1;
 }
 
+void
+baltsp_basic_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                            int min_cost, int max_cost, int first, int last,
+                            int *row, int **adj)
+{
+    int i;
+    int *costs;
+    
+    for(i = first; i < last; i++)
+    {
+        costs = arrow_btsp_fun_base_row(base_problem, i, row);
+        arrow_btsp_fun_select_row(costs, i, min_cost, max_cost, 0, 0, 1, 1,
+                                  adj[i]);
+    }
+}
+
 int
 baltsp_basic_initialize(arrow_btsp_fun *fun)
 { 
@@ -354,6 +438,23 @@ baltsp_ut_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
         return infinity;
 }
 
+void
+baltsp_ut_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                         int min_cost, int max_cost, int first, int last,
+                         int *row, int **adj)
+{
+    int infinity = base_problem->size * (max_cost - min_cost + 1);
+    int i;
+    int *costs;
+    
+    for(i = first; i < last; i++)
+    {
+        costs = arrow_btsp_fun_base_row(base_problem, i, row);
+        arrow_btsp_fun_select_row(costs, i, min_cost, max_cost, -1, max_cost,
+                                  0, infinity, adj[i]);
+    }
+}
+
 int
 baltsp_ut_feasible(arrow_btsp_fun *fun, arrow_problem *base_problem, 
                    int min_cost, int max_cost, double tour_length, int *tour)
@@ -429,6 +530,23 @@ baltsp_ib_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
         return infinity;
 }
 
+void
+baltsp_ib_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                         int min_cost, int max_cost, int first, int last,
+                         int *row, int **adj)
+{
+    int infinity = base_problem->size * (max_cost + 1);
+    int i;
+    int *costs;
+    
+    for(i = first; i < last; i++)
+    {
+        costs = arrow_btsp_fun_base_row(base_problem, i, row);
+        arrow_btsp_fun_select_row(costs, i, min_cost, INT_MAX, 1, 0, 0,
+                                  infinity, adj[i]);
+    }
+}
+
 int
 baltsp_ib_feasible(arrow_btsp_fun *fun, arrow_problem *base_problem, 
                    int min_cost, int max_cost, double tour_length, int *tour)
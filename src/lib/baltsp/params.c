@@ -22,4 +22,7 @@ arrow_baltsp_params_init(arrow_baltsp_params *params)
     params->mstsp_min_cost = INT_MAX;
     params->num_steps = 0;
     params->timebound = 18000.0;
+    params->context = NULL;
+    params->memo = NULL;
+    params->checkpoint = NULL;
 }
@@ -0,0 +1,337 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Batch solves of the bottleneck traveling salesman problem.
+ *
+ * Solves many BTSP instances inside one process with a pool of worker
+ * threads, handing each result back as soon as it is ready.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+#include "lb.h"
+#include "tsp.h"
+#include "btsp.h"
+
+#define BATCH_SOLVE_STEPS 3
+
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  State shared by the batch's worker threads.
+ */
+typedef struct batch
+{
+    pthread_mutex_t lock;       /**< guards next and the report callback */
+    int next;                   /**< next instance to hand out */
+    int num_files;              /**< number of instances */
+    char **file_names;          /**< TSPLIB file for each instance */
+    arrow_btsp_batch_params *params;    /**< batch parameters */
+} batch;
+
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Solves instances until there are none left.
+ *  @param  arg [in] a batch structure
+ */
+void *
+batch_worker(void *arg);
+
+/**
+ *  @brief  Reads, bounds and solves one instance and reports its result.
+ *  @param  b [in] batch structure
+ *  @param  job [in] position of the instance in the batch
+ */
+void
+batch_solve(batch *b, int job);
+
+/**
+ *  @brief  Hands a finished instance to the report callback.
+ *  @param  b [in] batch structure
+ *  @param  job [in] position of the instance in the batch
+ *  @param  problem [in] the instance (NULL if it could not be read)
+ *  @param  ret [in] ARROW_SUCCESS if the instance was solved
+ *  @param  lower_bound [in] lower bound the search started from
+ *  @param  start_time [in] wall-clock time the instance was started
+ *  @param  result [in] result of the solve (NULL if there is none)
+ */
+void
+batch_report(batch *b, int job, arrow_problem *problem, int ret,
+             int lower_bound, double start_time, arrow_btsp_result *result);
+
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+void
+arrow_btsp_batch_params_init(arrow_btsp_batch_params *params)
+{
+    params->threads = 1;
+    params->deep_copy = ARROW_FALSE;
+    params->supress_hash = ARROW_FALSE;
+    params->posa_attempts = 0;
+    params->basic_attempts = 3;
+    params->basic_restarts = 1;
+    params->shake_1_attempts = 1;
+    params->shake_1_restarts = 1;
+    params->search = ARROW_BTSP_SEARCH_BISECT;
+    params->timebound = 0.0;
+    params->lb_timebound = 0.0;
+    params->context = NULL;
+    params->report = NULL;
+    params->report_data = NULL;
+}
+
+int
+arrow_btsp_solve_batch(int num_files, char **file_names,
+                       arrow_btsp_batch_params *params)
+{
+    int i, started;
+    int threads = (params->threads < 1 ? 1 : params->threads);
+    pthread_t *thread_ids;
+    batch b;
+
+    if(threads > num_files)
+        threads = (num_files > 0 ? num_files : 1);
+    if((thread_ids = malloc(threads * sizeof(pthread_t))) == NULL)
+    {
+        arrow_print_error("Could not allocate memory for batch threads");
+        return ARROW_FAILURE;
+    }
+    if(pthread_mutex_init(&(b.lock), NULL) != 0)
+    {
+        arrow_print_error("Could not create batch lock");
+        free(thread_ids);
+        return ARROW_FAILURE;
+    }
+    b.next = 0;
+    b.num_files = num_files;
+    b.file_names = file_names;
+    b.params = params;
+
+    started = 0;
+    for(i = 0; i < threads; i++)
+    {
+        if(pthread_create(&(thread_ids[started]), NULL, batch_worker, &b) != 0)
+        {
+            arrow_debug("Could only start %d of %d batch workers.\n",
+                        started, threads);
+            break;
+        }
+        started++;
+    }
+
+    /* Without any workers, this thread does the batch on its own */
+    if(started == 0)
+        batch_worker(&b);
+    for(i = 0; i < started; i++)
+        pthread_join(thread_ids[i], NULL);
+
+    pthread_mutex_destroy(&(b.lock));
+    free(thread_ids);
+    return ARROW_SUCCESS;
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+void *
+batch_worker(void *arg)
+{
+    batch *b = (batch *)arg;
+    int job;
+
+    while(!arrow_context_should_stop(b->params->context))
+    {
+        pthread_mutex_lock(&(b->lock));
+        job = b->next;
+        if(job < b->num_files)
+            b->next++;
+        pthread_mutex_unlock(&(b->lock));
+
+        if(job >= b->num_files)
+            break;
+        batch_solve(b, job);
+    }
+    return NULL;
+}
+
+void
+batch_solve(batch *b, int job)
+{
+    int ret = ARROW_FAILURE;
+    int rand_max, infinity;
+    int lower_bound = -1;
+    int have_info = ARROW_FALSE;
+    int have_asym = ARROW_FALSE;
+    int have_lk = ARROW_FALSE;
+    int have_basic = ARROW_FALSE;
+    int have_shake = ARROW_FALSE;
+    int have_confirm = ARROW_FALSE;
+    int have_result = ARROW_FALSE;
+    int *actual_tour;
+    double start_time = arrow_util_real_zeit();
+    arrow_btsp_batch_params *params = b->params;
+    arrow_problem input_problem;
+    arrow_problem asym_problem;
+    arrow_problem *problem = &input_problem;
+    arrow_problem_info info;
+    arrow_bound_result lb_result;
+    arrow_tsp_posa_params posa_params;
+    arrow_tsp_cc_lk_params lk_basic_params;
+    arrow_tsp_cc_lk_params lk_shake_1_params;
+    arrow_btsp_fun fun_basic;
+    arrow_btsp_fun fun_shake_1;
+    arrow_btsp_fun fun_confirm;
+    arrow_btsp_solve_plan steps[BATCH_SOLVE_STEPS];
+    arrow_btsp_params btsp_params;
+    arrow_btsp_result result;
+    arrow_context context;
+
+    if(!arrow_problem_read(b->file_names[job], &input_problem))
+    {
+        batch_report(b, job, NULL, ARROW_FAILURE, -1, start_time, NULL);
+        return;
+    }
+    arrow_context_init_child(&context, params->context);
+    arrow_context_set_timebound(&context, params->timebound);
+
+    /* Gather basic info about the problem, as the btsp program does */
+    if(!arrow_problem_info_get(problem, !params->supress_hash, &info))
+        goto CLEANUP;
+    have_info = ARROW_TRUE;
+    rand_max = input_problem.size * input_problem.size;
+    if(rand_max < info.cost_list_length)
+    {
+        arrow_print_error("shake random interval not large enough");
+        goto CLEANUP;
+    }
+    infinity = (info.max_cost + rand_max) * 2;
+
+    /* The lower bounds are found on the problem as given */
+    if(!arrow_lb_portfolio_solve(problem, &info, params->lb_timebound,
+                                 &context, &lb_result))
+        goto CLEANUP;
+    lower_bound = lb_result.obj_value;
+
+    if(!problem->symmetric)
+    {
+        if(!arrow_problem_abtsp_to_sbtsp(params->deep_copy, problem, infinity,
+                                         &asym_problem))
+            goto CLEANUP;
+        have_asym = ARROW_TRUE;
+        problem = &asym_problem;
+    }
+
+    /* Solve plan */
+    arrow_tsp_posa_params_init(problem, &posa_params);
+    arrow_tsp_cc_lk_params_init(problem, &lk_basic_params);
+    arrow_tsp_cc_lk_params_init(problem, &lk_shake_1_params);
+    have_lk = ARROW_TRUE;
+    lk_basic_params.random_restarts = params->basic_restarts;
+    lk_shake_1_params.random_restarts = params->shake_1_restarts;
+    if(!input_problem.symmetric)
+    {
+        lk_basic_params.length_bound = (infinity * -1.0) * input_problem.size;
+        lk_shake_1_params.length_bound = lk_basic_params.length_bound;
+    }
+
+    if(!arrow_btsp_fun_basic(params->deep_copy, &fun_basic))
+        goto CLEANUP;
+    have_basic = ARROW_TRUE;
+    if(!arrow_btsp_fun_shake_1(params->deep_copy, infinity, 0, rand_max,
+                               &info, &fun_shake_1))
+        goto CLEANUP;
+    have_shake = ARROW_TRUE;
+    if(input_problem.symmetric)
+        have_confirm = arrow_btsp_fun_basic(params->deep_copy, &fun_confirm);
+    else
+        have_confirm = arrow_btsp_fun_asym_shift(params->deep_copy, infinity,
+                                                 &fun_confirm);
+    if(!have_confirm)
+        goto CLEANUP;
+
+    steps[0].tsp_solver = ARROW_TSP_POSA;
+    steps[0].tsp_params = (void *)&posa_params;
+    steps[0].fun = fun_basic;
+    steps[0].attempts = params->posa_attempts;
+    steps[1].tsp_solver = ARROW_TSP_CC_LK;
+    steps[1].tsp_params = (void *)&lk_basic_params;
+    steps[1].fun = fun_basic;
+    steps[1].attempts = params->basic_attempts;
+    steps[2].tsp_solver = ARROW_TSP_CC_LK;
+    steps[2].tsp_params = (void *)&lk_shake_1_params;
+    steps[2].fun = fun_shake_1;
+    steps[2].attempts = params->shake_1_attempts;
+
+    arrow_btsp_params_init(&btsp_params);
+    btsp_params.lower_bound = lower_bound;
+    btsp_params.upper_bound = INT_MAX;
+    btsp_params.num_steps = BATCH_SOLVE_STEPS;
+    btsp_params.steps = steps;
+    btsp_params.confirm_plan.tsp_solver = ARROW_TSP_CC_EXACT;
+    btsp_params.confirm_plan.tsp_params = NULL;
+    btsp_params.confirm_plan.fun = fun_confirm;
+    btsp_params.confirm_plan.attempts = 1;
+    btsp_params.infinity = infinity;
+    btsp_params.deep_copy = params->deep_copy;
+    btsp_params.context = &context;
+    btsp_params.search = params->search;
+
+    /* Solve, then turn a symmetric tour back into the asymmetric one */
+    if(!arrow_btsp_result_init(problem, &result))
+        goto CLEANUP;
+    have_result = ARROW_TRUE;
+    if(!arrow_btsp_solve(problem, &info, &btsp_params, &result))
+        goto CLEANUP;
+    if(result.found_tour && !input_problem.symmetric)
+    {
+        if(!arrow_util_create_int_array(input_problem.size, &actual_tour))
+            goto CLEANUP;
+        arrow_util_sbtsp_to_abstp_tour(problem, result.tour, actual_tour);
+        free(result.tour);
+        result.tour = actual_tour;
+        result.tour_length += input_problem.size * infinity;
+    }
+    ret = ARROW_SUCCESS;
+
+CLEANUP:
+    batch_report(b, job, &input_problem, ret, lower_bound, start_time,
+                 (have_result ? &result : NULL));
+    if(have_result)
+        arrow_btsp_result_destruct(&result);
+    if(have_confirm)
+        arrow_btsp_fun_destruct(&fun_confirm);
+    if(have_shake)
+        arrow_btsp_fun_destruct(&fun_shake_1);
+    if(have_basic)
+        arrow_btsp_fun_destruct(&fun_basic);
+    if(have_lk)
+    {
+        arrow_tsp_cc_lk_params_destruct(&lk_basic_params);
+        arrow_tsp_cc_lk_params_destruct(&lk_shake_1_params);
+    }
+    if(have_asym)
+        arrow_problem_destruct(&asym_problem);
+    if(have_info)
+        arrow_problem_info_destruct(&info);
+    arrow_problem_destruct(&input_problem);
+}
+
+void
+batch_report(batch *b, int job, arrow_problem *problem, int ret,
+             int lower_bound, double start_time, arrow_btsp_result *result)
+{
+    arrow_btsp_batch_params *params = b->params;
+
+    if(params->report == NULL)
+        return;
+    pthread_mutex_lock(&(b->lock));
+    params->report(params, job, b->file_names[job], problem, ret, lower_bound,
+                   arrow_util_real_zeit() - start_time, result);
+    pthread_mutex_unlock(&(b->lock));
+}
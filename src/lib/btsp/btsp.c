@@ -9,6 +9,146 @@
 #include "common.h"
 #include "btsp.h"
 
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  Search state shared by the threads of a parallel binary search.
+ */
+typedef struct btsp_search
+{
+    pthread_mutex_t lock;           /**< guards everything below */
+    pthread_cond_t changed;         /**< signalled when a probe finishes */
+    arrow_problem *problem;         /**< problem to solve */
+    arrow_problem_info *info;       /**< extra problem info */
+    arrow_btsp_params *params;      /**< BTSP parameters */
+    arrow_btsp_result *result;      /**< best tour found so far */
+    int low;                        /**< lowest cost index still possible */
+    int high;                       /**< cost index of best known tour */
+    int failed;                     /**< set if any probe failed outright */
+    int *probe;                     /**< probe[i] is the cost index thread i
+                                         is testing, or -1 */
+    int *marks;                     /**< scratch space for picking probes */
+    arrow_context *contexts;        /**< per-thread contexts, children of
+                                         params->context */
+    double start_time;              /**< time the solve started, for
+                                         checkpoints */
+} btsp_search;
+
+/**
+ *  @brief  A thread of a parallel binary search.
+ */
+typedef struct btsp_search_thread
+{
+    btsp_search *search;            /**< shared search state */
+    int id;                         /**< thread number */
+} btsp_search_thread;
+
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Saves the binary search to params->checkpoint, if there is one.
+ *  @param  problem [in] problem to solve
+ *  @param  info [in] extra problem info
+ *  @param  params [in] parameters for solver
+ *  @param  low [in] lowest cost index still possible
+ *  @param  high [in] cost index of best known tour
+ *  @param  search [in] threshold search (NULL for the parallel search)
+ *  @param  start_time [in] time the solve started
+ *  @param  force [in] if ARROW_TRUE, saves regardless of the interval
+ *  @param  result [in] BTSP solution so far
+ */
+int
+btsp_checkpoint(arrow_problem *problem, arrow_problem_info *info,
+                arrow_btsp_params *params, int low, int high,
+                arrow_btsp_search *search, double start_time, int force,
+                arrow_btsp_result *result);
+
+/**
+ *  @brief  Gives the plan's deep copy steps matrices that are kept for the
+ *          whole solve, so each probe only rewrites the edges that changed.
+ *          Steps using the same function share one.  Only the serial
+ *          search uses them, since a cache serves one attempt at a time.
+ *  @param  problem [in] problem to solve
+ *  @param  info [in] extra problem info
+ *  @param  params [in/out] parameters for solver; the caches are set in
+ *              params->steps
+ *  @param  index [out] edge index the caches share
+ *  @param  caches [out] array of params->num_steps caches, or NULL if none
+ *              are used
+ */
+int
+btsp_caches_init(arrow_problem *problem, arrow_problem_info *info,
+                 arrow_btsp_params *params, arrow_btsp_edge_index *index,
+                 arrow_btsp_fun_cache **caches);
+
+/**
+ *  @brief  Takes the caches back out of params->steps and frees them.
+ *  @param  params [in/out] parameters for solver
+ *  @param  index [out] edge index the caches share
+ *  @param  caches [out] caches from btsp_caches_init (can be NULL)
+ */
+void
+btsp_caches_destruct(arrow_btsp_params *params, arrow_btsp_edge_index *index,
+                     arrow_btsp_fun_cache *caches);
+
+/**
+ *  @brief  Runs the binary search over cost_list[low..high] with
+ *          params->threads probes at once.
+ *  @param  problem [in] problem to solve
+ *  @param  info [in] extra problem info
+ *  @param  params [in] parameters for solver
+ *  @param  start_time [in] time the solve started
+ *  @param  low [in/out] lowest cost index to consider; the lowest still
+ *              possible when the search ends
+ *  @param  high [in/out] cost index of the initial upper bound; that of the
+ *              best known tour when the search ends
+ *  @param  result [out] BTSP solution
+ */
+int
+btsp_search_parallel(arrow_problem *problem, arrow_problem_info *info,
+                     arrow_btsp_params *params, double start_time, int *low,
+                     int *high, arrow_btsp_result *result);
+
+/**
+ *  @brief  Probes thresholds until the search interval closes.  Matches the
+ *          pthread start routine signature.
+ *  @param  arg [out] the thread's btsp_search_thread structure
+ *  @return NULL
+ */
+void *
+btsp_search_run(void *arg);
+
+/**
+ *  @brief  Picks the untested cost index that best splits what is left of
+ *          the search interval, given the probes already running.  Must be
+ *          called with the lock held.
+ *  @param  search [in] shared search state
+ *  @param  threads [in] number of threads
+ *  @return cost index to probe, or -1 if every index is being probed
+ */
+int
+btsp_search_pick(btsp_search *search, int threads);
+
+
+/**
+ *  @brief  Share of the plan's heuristic attempts to spend on a probe.
+ *          Probes just above the lower end of the search interval decide
+ *          where the optimum is and get every attempt; probes further up
+ *          are likely to be feasible quickly, so they get less, down to the
+ *          scheduler's min_effort at the top.
+ *  @param  params [in] parameters for solver
+ *  @param  low [in] lowest cost index still possible
+ *  @param  high [in] cost index of best known tour
+ *  @param  probe [in] cost index being probed
+ *  @return the share, in (0, 1]; 1.0 without a scheduler
+ */
+double
+btsp_effort(arrow_btsp_params *params, int low, int high, int probe);
+
+
 /****************************************************************************
  * Public function implementations
  ****************************************************************************/
@@ -18,13 +158,47 @@ arrow_btsp_solve(arrow_problem *problem, arrow_problem_info *info,
 {    
     int ret = ARROW_SUCCESS;
     int is_feasible;
-    int i, low, high, median, median_val;
+    int i, low, high, probe, probe_val;
+    int resumed = ((params->checkpoint != NULL) && 
+                   params->checkpoint->resumed);
     double start_time = arrow_util_zeit();
     
     arrow_btsp_result cur_result;
+    arrow_btsp_search search;
+    arrow_btsp_edge_index edge_index;
+    arrow_btsp_fun_cache *caches = NULL;
     arrow_btsp_result_init(problem, &cur_result);
+    search.edge_counts = NULL;
+    
+    /* The parallel search picks its own probes, which is bisection */
+    if((params->threads > 1) && (params->search != ARROW_BTSP_SEARCH_BISECT))
+    {
+        arrow_print_error("The parallel binary search can only bisect.");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if(!btsp_caches_init(problem, info, params, &edge_index, &caches))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
     
     result->optimal = ARROW_FALSE;
+    if(resumed)
+    {
+        /* The tour and search bracket come from the checkpoint */
+        arrow_debug("Resuming binary search from checkpoint.\n");
+        low = params->checkpoint->low;
+        high = params->checkpoint->high;
+        if((low > high) || (high >= info->cost_list_length))
+        {
+            arrow_print_error("Checkpoint does not hold a binary search");
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        start_time -= params->checkpoint->elapsed;
+        goto SEARCH;
+    }
     result->found_tour = ARROW_FALSE;
 
     /* Print out debug information */
@@ -47,8 +221,11 @@ arrow_btsp_solve(arrow_problem *problem, arrow_problem_info *info,
     /* Start enhanced threshold heuristic */
     arrow_debug("Starting enhanced threshold heuristic\n");
     arrow_debug("Current solution: %d\n", result->max_cost);
-    ret = arrow_btsp_feasible(problem, params->num_steps, params->steps, INT_MIN, 
-                              params->lower_bound, &is_feasible, result);
+    ret = arrow_btsp_feasible_scheduled(&(params->memo), params->scheduler,
+                                        1.0, problem, params->num_steps,
+                                        params->steps, INT_MIN,
+                                        params->lower_bound, params->context,
+                                        &is_feasible, result);
     if(ret != ARROW_SUCCESS)
     {
         ret = ARROW_FAILURE;
@@ -61,6 +238,7 @@ arrow_btsp_solve(arrow_problem *problem, arrow_problem_info *info,
         result->found_tour = ARROW_TRUE;
         goto CONFIRM;
     }
+    if(arrow_context_should_stop(params->context)) goto CLEANUP;
     
     /* Start enhanced binary search threshold heuristic */
     if(params->supress_ebst) goto CONFIRM;
@@ -73,6 +251,7 @@ arrow_btsp_solve(arrow_problem *problem, arrow_problem_info *info,
         low--;
         arrow_debug("Lower bound not in cost list, so pick next lowest\n");
         arrow_debug("Next lowest cost is %d...", info->cost_list[low]);
+        if(low < 0) low = 0;
     }
     
     int upper_bound = params->upper_bound;
@@ -88,31 +267,95 @@ arrow_btsp_solve(arrow_problem *problem, arrow_problem_info *info,
                                        upper_bound, &high);
     }
     
+SEARCH:
+    if(params->threads > 1)
+    {
+        ret = btsp_search_parallel(problem, info, params, start_time, 
+                                   &low, &high, result);
+        if(ret != ARROW_SUCCESS)
+        {
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        ret = btsp_checkpoint(problem, info, params, low, high, NULL,
+                              start_time, ARROW_TRUE, result);
+        if(ret != ARROW_SUCCESS)
+        {
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        if(arrow_context_should_stop(params->context))
+        {
+            arrow_debug("Stopping binary search early.\n");
+            goto CLEANUP;
+        }
+        goto CONFIRM;
+    }
+    
+    if(!arrow_btsp_search_init(params->search, problem, info, &search))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if(resumed)
+    {
+        search.current = params->checkpoint->values[0];
+        search.step = params->checkpoint->values[1];
+    }
+    
     arrow_debug("Starting binary search.\n");
     while(low != high)
     {
-        median = ((high - low) / 2) + low;
-        median_val = info->cost_list[median];
-        arrow_debug("low = %d; high = %d; median = %d\n", 
-                    info->cost_list[low], info->cost_list[high], median_val);
+        if(arrow_context_should_stop(params->context))
+        {
+            arrow_debug("Stopping binary search early.\n");
+            if(!btsp_checkpoint(problem, info, params, low, high, &search,
+                                start_time, ARROW_TRUE, result))
+                ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
         
-        ret = arrow_btsp_feasible(problem, params->num_steps, params->steps, 
-                                  INT_MIN, median_val, &is_feasible, &cur_result);
+        probe = arrow_btsp_search_next(&search, low, high);
+        probe_val = info->cost_list[probe];
+        result->search_probes[search.current]++;
+        arrow_debug("low = %d; high = %d; probe = %d\n", 
+                    info->cost_list[low], info->cost_list[high], probe_val);
+        
+        ret = arrow_btsp_feasible_scheduled(&(params->memo), 
+                                            params->scheduler,
+                                            btsp_effort(params, low, high,
+                                                        probe),
+                                            problem, params->num_steps,
+                                            params->steps, INT_MIN, probe_val,
+                                            params->context, &is_feasible,
+                                            &cur_result);
         if(ret != ARROW_SUCCESS)
         {
             ret = ARROW_FAILURE;
             goto CLEANUP;
         }
         
+        /* An attempt cut short says nothing about the probe, so leave the
+           search interval alone */
+        if(!is_feasible && arrow_context_should_stop(params->context))
+        {
+            arrow_debug("Stopping binary search early.\n");
+            if(!btsp_checkpoint(problem, info, params, low, high, &search,
+                                start_time, ARROW_TRUE, result))
+                ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        arrow_btsp_search_update(&search, is_feasible);
+        
         if(is_feasible)
         {
             arrow_debug("A tour was found!\n");
             result->found_tour = ARROW_TRUE;
             
-            /* Check to see if we found a smaller solution than our median */
-            if(cur_result.max_cost < median_val)
+            /* Check to see if we found a smaller solution than our probe */
+            if(cur_result.max_cost < probe_val)
             {
-                arrow_debug(" - Found a smaller solution than our median: %d\n",
+                arrow_debug(" - Found a smaller solution than our probe: %d\n",
                             cur_result.max_cost);
                 arrow_util_binary_search(info->cost_list, 
                                          info->cost_list_length,
@@ -120,13 +363,13 @@ arrow_btsp_solve(arrow_problem *problem, arrow_problem_info *info,
                                          
                 if(low > high)
                 {
-                    arrow_debug(" - Median smaller than low value, so set low = high\n");
+                    arrow_debug(" - Probe smaller than low value, so set low = high\n");
                     low = high;
                 }
             }
             else
             {
-                high = median;
+                high = probe;
             }
             
             /* Copy over new best objective value and tour */
@@ -143,10 +386,10 @@ arrow_btsp_solve(arrow_problem *problem, arrow_problem_info *info,
         else
         {
             arrow_debug("A tour could not be found.\n");
-            low = median + 1;
+            low = probe + 1;
             
-            /* Check to see if we found a smaller solution than our median */
-            if(cur_result.max_cost < median_val)
+            /* Check to see if we found a smaller solution than our probe */
+            if(cur_result.max_cost < probe_val)
             {
                 arrow_debug(" - Found a smaller solution than our best: %d\n",
                             cur_result.max_cost);
@@ -176,13 +419,29 @@ arrow_btsp_solve(arrow_problem *problem, arrow_problem_info *info,
             result->solver_attempts[i] += cur_result.solver_attempts[i];
             result->solver_time[i] += cur_result.solver_time[i];
         }
+        arrow_context_progress(params->context, "btsp", info->cost_list[low],
+                               info->cost_list[high]);
+        if(!btsp_checkpoint(problem, info, params, low, high, &search,
+                            start_time, ARROW_FALSE, result))
+        {
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+    }
+    
+    /* A finished search is saved too, so resuming it skips to the end */
+    if(!btsp_checkpoint(problem, info, params, low, high, &search, 
+                        start_time, ARROW_TRUE, result))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
     }
 
     /* Confirm the solution if required.  If we can find a Hamiltonian cycle
        using costs strictly less than our objective value, then our tour
        is not optimal. */
 CONFIRM:
-    if(params->confirm_sol)
+    if(params->confirm_sol && !arrow_context_should_stop(params->context))
     {
         arrow_debug("Confirming solution...\n");
         arrow_btsp_solve_plan confirm_plan_steps[1] = 
@@ -190,9 +449,11 @@ CONFIRM:
            params->confirm_plan
         };
         
-        printf("checking feasibility...\n");
-        ret = arrow_btsp_feasible(problem, 1, confirm_plan_steps, INT_MIN, 
-                                  result->max_cost - 1, &is_feasible, &cur_result);
+        arrow_debug("checking feasibility...\n");
+        ret = arrow_btsp_feasible_memo(&(params->memo), problem, 1, 
+                                       confirm_plan_steps, INT_MIN, 
+                                       result->max_cost - 1, params->context,
+                                       &is_feasible, &cur_result);
         if(ret != ARROW_SUCCESS)
         {
             ret = ARROW_FAILURE;
@@ -215,7 +476,7 @@ CONFIRM:
                     result->tour[i] = cur_result.tour[i];
             }
         }
-        else
+        else if(!arrow_context_should_stop(params->context))
         {
             arrow_debug("Tour could not be found -- solution optimal!\n");
             result->optimal = ARROW_TRUE;
@@ -234,6 +495,394 @@ CLEANUP:
         result->optimal = ARROW_TRUE;
     result->total_time = arrow_util_zeit() - start_time;
 
+    btsp_caches_destruct(params, &edge_index, caches);
+    arrow_btsp_search_destruct(&search);
     arrow_btsp_result_destruct(&cur_result);
     return ret;
 }
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+int
+btsp_checkpoint(arrow_problem *problem, arrow_problem_info *info,
+                arrow_btsp_params *params, int low, int high,
+                arrow_btsp_search *search, double start_time, int force,
+                arrow_btsp_result *result)
+{
+    arrow_btsp_checkpoint *checkpoint = params->checkpoint;
+
+    if(checkpoint == NULL)
+        return ARROW_SUCCESS;
+
+    checkpoint->low = low;
+    checkpoint->high = high;
+    checkpoint->values[0] = 
+        (search != NULL ? search->current : ARROW_BTSP_SEARCH_BISECT);
+    checkpoint->values[1] = (search != NULL ? search->step : 1);
+    checkpoint->values[2] = params->lower_bound;
+    checkpoint->elapsed = arrow_util_zeit() - start_time;
+    return arrow_btsp_checkpoint_save(checkpoint, problem, info, force, 
+                                      result);
+}
+
+int
+btsp_caches_init(arrow_problem *problem, arrow_problem_info *info,
+                 arrow_btsp_params *params, arrow_btsp_edge_index *index,
+                 arrow_btsp_fun_cache **caches)
+{
+    int i, j;
+    int deep = ARROW_FALSE;
+    arrow_btsp_solve_plan *steps = params->steps;
+
+    *caches = NULL;
+    if(params->threads > 1)
+        return ARROW_SUCCESS;
+    for(i = 0; i < params->num_steps; i++)
+    {
+        if(!steps[i].fun.shallow && (steps[i].attempts > 0) &&
+           (steps[i].fun.cache == NULL))
+            deep = ARROW_TRUE;
+    }
+    if(!deep)
+        return ARROW_SUCCESS;
+
+    if(!arrow_btsp_edge_index_init(problem, info, index))
+    {
+        arrow_debug("Deep copies will be rebuilt for every attempt.\n");
+        return ARROW_SUCCESS;
+    }
+    if((*caches = malloc(params->num_steps * sizeof(arrow_btsp_fun_cache)))
+       == NULL)
+    {
+        arrow_print_error("Could not allocate memory for deep copy caches");
+        arrow_btsp_edge_index_destruct(index);
+        return ARROW_FAILURE;
+    }
+
+    for(i = 0; i < params->num_steps; i++)
+    {
+        arrow_btsp_fun_cache_init(index, &((*caches)[i]));
+        if(steps[i].fun.shallow || (steps[i].fun.cache != NULL))
+            continue;
+        for(j = 0; j < i; j++)
+        {
+            if((steps[j].fun.get_cost == steps[i].fun.get_cost) &&
+               (steps[j].fun.data == steps[i].fun.data) &&
+               (steps[j].fun.cache >= *caches) && 
+               (steps[j].fun.cache < *caches + params->num_steps))
+            {
+                steps[i].fun.cache = steps[j].fun.cache;
+                break;
+            }
+        }
+        if(steps[i].fun.cache == NULL)
+            steps[i].fun.cache = &((*caches)[i]);
+    }
+    return ARROW_SUCCESS;
+}
+
+void
+btsp_caches_destruct(arrow_btsp_params *params, arrow_btsp_edge_index *index,
+                     arrow_btsp_fun_cache *caches)
+{
+    int i;
+    arrow_btsp_solve_plan *steps = params->steps;
+
+    if(caches == NULL)
+        return;
+    for(i = 0; i < params->num_steps; i++)
+    {
+        if((steps[i].fun.cache >= caches) &&
+           (steps[i].fun.cache < caches + params->num_steps))
+            steps[i].fun.cache = NULL;
+    }
+    for(i = 0; i < params->num_steps; i++)
+    {
+        if(caches[i].built)
+        {
+            arrow_debug("Deep copy cache %d: %d rebuilds, %d updates, "
+                        "%lld edges written.\n", i + 1, caches[i].rebuilds,
+                        caches[i].updates, caches[i].written);
+        }
+        arrow_btsp_fun_cache_destruct(&(caches[i]));
+    }
+    free(caches);
+    arrow_btsp_edge_index_destruct(index);
+}
+
+double
+btsp_effort(arrow_btsp_params *params, int low, int high, int probe)
+{
+    double distance;
+    double min_effort;
+
+    if((params->scheduler == NULL) || (high <= low))
+        return 1.0;
+    min_effort = params->scheduler->min_effort;
+    distance = (probe - low) / ((high - low) * 1.0);
+    if(distance < 0.0) distance = 0.0;
+    if(distance > 1.0) distance = 1.0;
+    return 1.0 - (1.0 - min_effort) * distance;
+}
+
+int
+btsp_search_parallel(arrow_problem *problem, arrow_problem_info *info,
+                     arrow_btsp_params *params, double start_time, int *low,
+                     int *high, arrow_btsp_result *result)
+{
+    int ret = ARROW_SUCCESS;
+    int i, started;
+    int threads = params->threads;
+    btsp_search search;
+    btsp_search_thread *args = NULL;
+    pthread_t *thread_ids = NULL;
+
+    arrow_debug("Starting parallel binary search with %d threads.\n", 
+                threads);
+    pthread_mutex_init(&(search.lock), NULL);
+    pthread_cond_init(&(search.changed), NULL);
+    search.problem = problem;
+    search.info = info;
+    search.params = params;
+    search.result = result;
+    search.low = *low;
+    search.high = *high;
+    search.failed = ARROW_FALSE;
+    search.start_time = start_time;
+    search.probe = NULL;
+    search.marks = NULL;
+    search.contexts = NULL;
+
+    if(!arrow_util_create_int_array(threads, &(search.probe)))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if(!arrow_util_create_int_array(threads + 2, &(search.marks)))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if((search.contexts = malloc(threads * sizeof(arrow_context))) == NULL)
+    {
+        arrow_print_error("Error allocating memory for contexts array.");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if((args = malloc(threads * sizeof(btsp_search_thread))) == NULL)
+    {
+        arrow_print_error("Error allocating memory for args array.");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if((thread_ids = malloc(threads * sizeof(pthread_t))) == NULL)
+    {
+        arrow_print_error("Error allocating memory for thread_ids array.");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    for(i = 0; i < threads; i++)
+    {
+        search.probe[i] = -1;
+        arrow_context_init_child(&(search.contexts[i]), params->context);
+        args[i].search = &search;
+        args[i].id = i;
+    }
+
+    /* Thread 0 is the calling thread.  If some threads can't be created the
+       search just runs with fewer probes at once. */
+    for(started = 1; started < threads; started++)
+    {
+        if(pthread_create(&(thread_ids[started]), NULL, btsp_search_run,
+                          &(args[started])) != 0)
+        {
+            arrow_debug("Could only start %d search threads.\n", started);
+            break;
+        }
+    }
+    btsp_search_run(&(args[0]));
+    for(i = 1; i < started; i++)
+        pthread_join(thread_ids[i], NULL);
+
+    if(search.failed)
+        ret = ARROW_FAILURE;
+    *low = search.low;
+    *high = search.high;
+
+CLEANUP:
+    pthread_cond_destroy(&(search.changed));
+    pthread_mutex_destroy(&(search.lock));
+    if(search.probe != NULL) free(search.probe);
+    if(search.marks != NULL) free(search.marks);
+    if(search.contexts != NULL) free(search.contexts);
+    if(args != NULL) free(args);
+    if(thread_ids != NULL) free(thread_ids);
+    return ret;
+}
+
+void *
+btsp_search_run(void *arg)
+{
+    btsp_search_thread *thread = (btsp_search_thread *)arg;
+    btsp_search *search = thread->search;
+    arrow_problem *problem = search->problem;
+    arrow_problem_info *info = search->info;
+    arrow_btsp_params *params = search->params;
+    arrow_btsp_result *result = search->result;
+    arrow_btsp_solve_plan *steps = params->steps;
+    arrow_context *context = &(search->contexts[thread->id]);
+    int i, p, ret, high;
+    int is_feasible;
+    double effort;
+    arrow_btsp_result cur_result;
+
+    if(params->thread_steps != NULL)
+        steps = params->thread_steps[thread->id];
+    if(!arrow_btsp_result_init(problem, &cur_result))
+    {
+        pthread_mutex_lock(&(search->lock));
+        search->failed = ARROW_TRUE;
+        pthread_cond_broadcast(&(search->changed));
+        pthread_mutex_unlock(&(search->lock));
+        return NULL;
+    }
+
+    pthread_mutex_lock(&(search->lock));
+    while(!search->failed && (search->low < search->high) &&
+          !arrow_context_should_stop(params->context))
+    {
+        /* If every threshold left is being probed, wait for one to finish */
+        p = btsp_search_pick(search, params->threads);
+        if(p < 0)
+        {
+            pthread_cond_wait(&(search->changed), &(search->lock));
+            continue;
+        }
+        search->probe[thread->id] = p;
+        effort = btsp_effort(params, search->low, search->high, p);
+        arrow_context_init_child(context, params->context);
+        arrow_debug("low = %d; high = %d; probe = %d\n", 
+                    info->cost_list[search->low], 
+                    info->cost_list[search->high], info->cost_list[p]);
+        pthread_mutex_unlock(&(search->lock));
+
+        ret = arrow_btsp_feasible_scheduled(&(params->memo), 
+                                            params->scheduler, effort,
+                                            problem, params->num_steps, steps,
+                                            INT_MIN, info->cost_list[p],
+                                            context, &is_feasible,
+                                            &cur_result);
+
+        pthread_mutex_lock(&(search->lock));
+        search->probe[thread->id] = -1;
+        if(ret != ARROW_SUCCESS)
+        {
+            search->failed = ARROW_TRUE;
+            break;
+        }
+
+        result->bin_search_steps++;
+        result->search_probes[params->search]++;
+        for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
+        {
+            result->solver_attempts[i] += cur_result.solver_attempts[i];
+            result->solver_time[i] += cur_result.solver_time[i];
+        }
+
+        if(is_feasible)
+        {
+            /* Any tour is worth keeping, even from a cancelled probe, and
+               its actual max cost may undercut the threshold probed */
+            arrow_debug("A tour was found with max cost %d\n",
+                        cur_result.max_cost);
+            arrow_util_binary_search(info->cost_list, info->cost_list_length,
+                                     cur_result.max_cost, &high);
+            if(!result->found_tour || (cur_result.max_cost < result->max_cost))
+            {
+                result->found_tour = ARROW_TRUE;
+                result->min_cost = cur_result.min_cost;
+                result->max_cost = cur_result.max_cost;
+                result->tour_length = cur_result.tour_length;
+                if(result->tour != NULL)
+                {
+                    for(i = 0; i < problem->size; i++)
+                        result->tour[i] = cur_result.tour[i];
+                }
+            }
+            if(high < search->high)
+                search->high = high;
+        }
+        else if(!arrow_context_should_stop(context))
+        {
+            /* Only a probe that ran to completion says anything about the
+               threshold */
+            arrow_debug("A tour could not be found at %d\n", 
+                        info->cost_list[p]);
+            if(p + 1 > search->low)
+                search->low = p + 1;
+        }
+        if(search->low > search->high)
+            search->low = search->high;
+
+        /* Stop the probes that the new interval has made pointless */
+        for(i = 0; i < params->threads; i++)
+        {
+            p = search->probe[i];
+            if((p >= 0) && ((p < search->low) || (p >= search->high)))
+                arrow_context_cancel(&(search->contexts[i]));
+        }
+
+        arrow_context_progress(params->context, "btsp", 
+                               info->cost_list[search->low],
+                               info->cost_list[search->high]);
+        if(!btsp_checkpoint(problem, info, params, search->low, search->high,
+                            NULL, search->start_time, ARROW_FALSE, result))
+            search->failed = ARROW_TRUE;
+        pthread_cond_broadcast(&(search->changed));
+    }
+    pthread_cond_broadcast(&(search->changed));
+    pthread_mutex_unlock(&(search->lock));
+
+    arrow_btsp_result_destruct(&cur_result);
+    return NULL;
+}
+
+int
+btsp_search_pick(btsp_search *search, int threads)
+{
+    int i, j, p, gap, best_gap, best;
+    int n = 0;
+    int *marks = search->marks;
+
+    /* Collect the interval ends and the running probes in sorted order;
+       low - 1 and high are already settled */
+    marks[n++] = search->low - 1;
+    for(i = 0; i < threads; i++)
+    {
+        p = search->probe[i];
+        if((p >= search->low) && (p < search->high))
+        {
+            for(j = n; (j > 1) && (marks[j - 1] > p); j--)
+                marks[j] = marks[j - 1];
+            marks[j] = p;
+            n++;
+        }
+    }
+    marks[n++] = search->high;
+
+    /* Split the widest stretch of untested thresholds down the middle */
+    best = -1;
+    best_gap = 1;
+    for(i = 0; i + 1 < n; i++)
+    {
+        gap = marks[i + 1] - marks[i];
+        if(gap > best_gap)
+        {
+            best_gap = gap;
+            best = marks[i] + gap / 2;
+        }
+    }
+    return best;
+}
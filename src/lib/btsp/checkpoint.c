@@ -0,0 +1,324 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Checkpoints for long running searches.
+ *
+ * Saves the state of a BTSP or BalTSP search to a small text file and reads
+ * it back, so a run that is stopped can be resumed without redoing work.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+#include "btsp.h"
+
+#define CHECKPOINT_VERSION 2
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Writes the checkpoint and result to the given file.
+ *  @param  checkpoint [in] checkpoint structure
+ *  @param  problem [in] problem being solved
+ *  @param  info [in] problem info
+ *  @param  seed [in] seed the random number generator restarts from
+ *  @param  result [in] best tour and solver statistics so far
+ *  @param  out [out] file to write to
+ */
+void
+checkpoint_write(arrow_btsp_checkpoint *checkpoint, arrow_problem *problem,
+                 arrow_problem_info *info, int seed, arrow_btsp_result *result,
+                 FILE *out);
+
+/**
+ *  @brief  Hashes the cost list (32-bit FNV-1a over the costs), so a
+ *          checkpoint is only resumed on the problem it was saved for.
+ *  @param  info [in] problem info
+ *  @return hash of the cost list
+ */
+unsigned int
+checkpoint_checksum(arrow_problem_info *info);
+
+/**
+ *  @brief  Reads the next word from the file and checks it is the label
+ *          expected.
+ *  @param  in [in] file to read from
+ *  @param  label [in] label expected
+ */
+int
+checkpoint_expect(FILE *in, const char *label);
+
+/**
+ *  @brief  Reads the checkpoint and result from the given file.
+ *  @param  checkpoint [out] checkpoint structure
+ *  @param  problem [in] problem being solved
+ *  @param  info [in] problem info
+ *  @param  seed [out] seed the random number generator restarts from
+ *  @param  result [out] best tour and solver statistics so far
+ *  @param  in [in] file to read from
+ */
+int
+checkpoint_read(arrow_btsp_checkpoint *checkpoint, arrow_problem *problem,
+                arrow_problem_info *info, int *seed, arrow_btsp_result *result,
+                FILE *in);
+
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+void
+arrow_btsp_checkpoint_init(char *file_name, const char *kind, double interval,
+                           arrow_btsp_checkpoint *checkpoint)
+{
+    int i;
+
+    checkpoint->file_name = file_name;
+    checkpoint->kind = kind;
+    checkpoint->interval = interval;
+    checkpoint->last_save = arrow_util_real_zeit();
+    checkpoint->resumed = ARROW_FALSE;
+    checkpoint->low = 0;
+    checkpoint->high = 0;
+    for(i = 0; i < ARROW_BTSP_CHECKPOINT_VALUES; i++)
+        checkpoint->values[i] = 0;
+    checkpoint->elapsed = 0.0;
+}
+
+int
+arrow_btsp_checkpoint_resume(arrow_btsp_checkpoint *checkpoint,
+                             arrow_problem *problem, arrow_problem_info *info,
+                             arrow_btsp_result *result)
+{
+    int seed;
+    FILE *in;
+
+    if((in = fopen(checkpoint->file_name, "r")) == NULL)
+    {
+        arrow_debug("No checkpoint in %s to resume from.\n",
+                    checkpoint->file_name);
+        return ARROW_SUCCESS;
+    }
+    if(!checkpoint_read(checkpoint, problem, info, &seed, result, in))
+    {
+        arrow_print_error("Could not resume from checkpoint file");
+        fclose(in);
+        return ARROW_FAILURE;
+    }
+    fclose(in);
+
+    arrow_util_random_seed(seed);
+    checkpoint->resumed = ARROW_TRUE;
+    checkpoint->last_save = arrow_util_real_zeit();
+    return ARROW_SUCCESS;
+}
+
+int
+arrow_btsp_checkpoint_save(arrow_btsp_checkpoint *checkpoint,
+                           arrow_problem *problem, arrow_problem_info *info,
+                           int force, arrow_btsp_result *result)
+{
+    int seed;
+    char *temp_name;
+    FILE *out;
+    double now = arrow_util_real_zeit();
+
+    if(!force && (now - checkpoint->last_save < checkpoint->interval))
+        return ARROW_SUCCESS;
+
+    /* Write to a scratch file first and rename it over the old one */
+    temp_name = malloc(strlen(checkpoint->file_name) + 5);
+    if(temp_name == NULL)
+    {
+        arrow_print_error("Could not allocate memory for file name");
+        return ARROW_FAILURE;
+    }
+    sprintf(temp_name, "%s.tmp", checkpoint->file_name);
+    if((out = fopen(temp_name, "w")) == NULL)
+    {
+        arrow_print_error("Could not open checkpoint file for writing");
+        free(temp_name);
+        return ARROW_FAILURE;
+    }
+
+    /* rand() state can't be saved, so restart it from a seed that can */
+    seed = arrow_util_random_between(1, RAND_MAX - 1);
+    arrow_util_random_seed(seed);
+
+    checkpoint_write(checkpoint, problem, info, seed, result, out);
+    if((fclose(out) != 0) || (rename(temp_name, checkpoint->file_name) != 0))
+    {
+        arrow_print_error("Could not write checkpoint file");
+        free(temp_name);
+        return ARROW_FAILURE;
+    }
+    free(temp_name);
+
+    arrow_debug("Saved checkpoint to %s.\n", checkpoint->file_name);
+    checkpoint->last_save = now;
+    return ARROW_SUCCESS;
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+void
+checkpoint_write(arrow_btsp_checkpoint *checkpoint, arrow_problem *problem,
+                 arrow_problem_info *info, int seed, arrow_btsp_result *result,
+                 FILE *out)
+{
+    int i;
+    int has_tour = (result->found_tour && (result->tour != NULL));
+
+    fprintf(out, "arrow_checkpoint %d %s\n", CHECKPOINT_VERSION,
+            checkpoint->kind);
+    fprintf(out, "problem %d %d %d %d %u\n", problem->size,
+            info->cost_list_length, info->min_cost, info->max_cost,
+            checkpoint_checksum(info));
+    fprintf(out, "search %d %d", checkpoint->low, checkpoint->high);
+    for(i = 0; i < ARROW_BTSP_CHECKPOINT_VALUES; i++)
+        fprintf(out, " %d", checkpoint->values[i]);
+    fprintf(out, "\n");
+    fprintf(out, "seed %d\n", seed);
+    fprintf(out, "elapsed %.17g\n", checkpoint->elapsed);
+
+    fprintf(out, "result %d %d %d %.17g %d\n", result->found_tour,
+            result->min_cost, result->max_cost, result->tour_length,
+            result->bin_search_steps);
+    fprintf(out, "solvers");
+    for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
+        fprintf(out, " %d %.17g", result->solver_attempts[i],
+                result->solver_time[i]);
+    fprintf(out, "\n");
+    fprintf(out, "probes");
+    for(i = 0; i < ARROW_BTSP_SEARCH_COUNT; i++)
+        fprintf(out, " %d", result->search_probes[i]);
+    fprintf(out, "\n");
+
+    fprintf(out, "tour %d", has_tour);
+    if(has_tour)
+    {
+        for(i = 0; i < problem->size; i++)
+            fprintf(out, " %d", result->tour[i]);
+    }
+    fprintf(out, "\n");
+}
+
+int
+checkpoint_read(arrow_btsp_checkpoint *checkpoint, arrow_problem *problem,
+                arrow_problem_info *info, int *seed, arrow_btsp_result *result,
+                FILE *in)
+{
+    int i, version, size, costs, min_cost, max_cost, has_tour, node;
+    unsigned int checksum;
+    char kind[64];
+
+    if(!checkpoint_expect(in, "arrow_checkpoint") ||
+       (fscanf(in, "%d %63s", &version, kind) != 2) ||
+       (version != CHECKPOINT_VERSION))
+    {
+        arrow_print_error("Not a checkpoint file, or an unknown version");
+        return ARROW_FAILURE;
+    }
+    if(strcmp(kind, checkpoint->kind) != 0)
+    {
+        arrow_print_error("Checkpoint was saved by another kind of search");
+        return ARROW_FAILURE;
+    }
+    if(!checkpoint_expect(in, "problem") ||
+       (fscanf(in, "%d %d %d %d %u", &size, &costs, &min_cost, &max_cost,
+               &checksum) != 5) ||
+       (size != problem->size) || (costs != info->cost_list_length) ||
+       (min_cost != info->min_cost) || (max_cost != info->max_cost) ||
+       (checksum != checkpoint_checksum(info)))
+    {
+        arrow_print_error("Checkpoint was saved for another problem");
+        return ARROW_FAILURE;
+    }
+
+    if(!checkpoint_expect(in, "search") ||
+       (fscanf(in, "%d %d", &(checkpoint->low), &(checkpoint->high)) != 2))
+        return ARROW_FAILURE;
+    for(i = 0; i < ARROW_BTSP_CHECKPOINT_VALUES; i++)
+    {
+        if(fscanf(in, " %d", &(checkpoint->values[i])) != 1)
+            return ARROW_FAILURE;
+    }
+    if((checkpoint->low < 0) || (checkpoint->low >= costs) ||
+       (checkpoint->high < 0) || (checkpoint->high >= costs))
+    {
+        arrow_print_error("Checkpoint search interval is out of range");
+        return ARROW_FAILURE;
+    }
+    if(!checkpoint_expect(in, "seed") || (fscanf(in, "%d", seed) != 1))
+        return ARROW_FAILURE;
+    if(!checkpoint_expect(in, "elapsed") ||
+       (fscanf(in, "%lf", &(checkpoint->elapsed)) != 1))
+        return ARROW_FAILURE;
+
+    if(!checkpoint_expect(in, "result") ||
+       (fscanf(in, "%d %d %d %lf %d", &(result->found_tour),
+               &(result->min_cost), &(result->max_cost),
+               &(result->tour_length), &(result->bin_search_steps)) != 5))
+        return ARROW_FAILURE;
+    if(!checkpoint_expect(in, "solvers"))
+        return ARROW_FAILURE;
+    for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
+    {
+        if(fscanf(in, " %d %lf", &(result->solver_attempts[i]),
+                  &(result->solver_time[i])) != 2)
+            return ARROW_FAILURE;
+    }
+    if(!checkpoint_expect(in, "probes"))
+        return ARROW_FAILURE;
+    for(i = 0; i < ARROW_BTSP_SEARCH_COUNT; i++)
+    {
+        if(fscanf(in, " %d", &(result->search_probes[i])) != 1)
+            return ARROW_FAILURE;
+    }
+
+    if(!checkpoint_expect(in, "tour") || (fscanf(in, "%d", &has_tour) != 1))
+        return ARROW_FAILURE;
+    if(has_tour)
+    {
+        for(i = 0; i < size; i++)
+        {
+            if((fscanf(in, " %d", &node) != 1) || (node < 0) || (node >= size))
+                return ARROW_FAILURE;
+            if(result->tour != NULL)
+                result->tour[i] = node;
+        }
+    }
+    return ARROW_SUCCESS;
+}
+
+unsigned int
+checkpoint_checksum(arrow_problem_info *info)
+{
+    int i, k;
+    unsigned int cost;
+    unsigned int hash = 2166136261u;
+
+    for(i = 0; i < info->cost_list_length; i++)
+    {
+        cost = (unsigned int)info->cost_list[i];
+        for(k = 0; k < 4; k++)
+        {
+            hash ^= (cost >> (8 * k)) & 0xFF;
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+int
+checkpoint_expect(FILE *in, const char *label)
+{
+    char word[64];
+
+    if((fscanf(in, "%63s", word) != 1) || (strcmp(word, label) != 0))
+    {
+        arrow_debug("Expected '%s' in checkpoint file.\n", label);
+        return ARROW_FAILURE;
+    }
+    return ARROW_SUCCESS;
+}
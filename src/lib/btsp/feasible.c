@@ -6,26 +6,184 @@
  * @author  John LaRusic
  * @ingroup lib
  ****************************************************************************/
+#include <math.h>
 #include "common.h"
 #include "btsp.h"
 
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  Threshold graph in compressed adjacency form.
+ */
+typedef struct prefilter_graph
+{
+    int size;       /**< number of nodes */
+    int symmetric;  /**< if ARROW_TRUE, adj holds both ends of every edge */
+    int *start;     /**< arcs out of i are adj[start[i]..start[i+1]-1] */
+    int *adj;       /**< heads of arcs out of each node */
+    int *rstart;    /**< arcs into i are radj[rstart[i]..rstart[i+1]-1]
+                         (asymmetric only) */
+    int *radj;      /**< tails of arcs into each node (asymmetric only) */
+} prefilter_graph;
+
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Determines if the plan's cost matrix functions all restrict
+ *          feasible tours to the threshold graph.
+ *  @param  num_steps [in] total number of steps in solve plan
+ *  @param  steps [in] solve plan step details
+ *  @return ARROW_TRUE if the pre-filter may be used, ARROW_FALSE otherwise
+ */
+int
+prefilter_applies(int num_steps, arrow_btsp_solve_plan *steps);
+
+/**
+ *  @brief  Builds the threshold graph.
+ *  @param  problem [in] problem data
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  graph [out] graph structure
+ */
+int
+prefilter_graph_init(arrow_problem *problem, int min_cost, int max_cost,
+                     prefilter_graph *graph);
+
+/**
+ *  @brief  Destructs a graph structure.
+ *  @param  graph [out] graph structure
+ */
+void
+prefilter_graph_destruct(prefilter_graph *graph);
+
+/**
+ *  @brief  Checks that each node has degree two or more (symmetric) or an
+ *          in-arc and an out-arc (asymmetric).
+ *  @param  graph [in] graph structure
+ *  @return ARROW_TRUE if the degrees are large enough, ARROW_FALSE otherwise
+ */
+int
+prefilter_degrees(prefilter_graph *graph);
+
+/**
+ *  @brief  Checks that a symmetric graph is biconnected with an iterative
+ *          version of the articulation point search in bbssp.c.
+ *  @param  graph [in] graph structure
+ *  @param  work [out] temporary array of size 5n
+ *  @return ARROW_TRUE if biconnected, ARROW_FALSE otherwise
+ */
+int
+prefilter_biconnected(prefilter_graph *graph, int *work);
+
+/**
+ *  @brief  Checks that an asymmetric graph is strongly connected with
+ *          iterative versions of the searches in bscssp.c.
+ *  @param  graph [in] graph structure
+ *  @param  work [out] temporary array of size 5n
+ *  @return ARROW_TRUE if strongly connected, ARROW_FALSE otherwise
+ */
+int
+prefilter_strongly_connected(prefilter_graph *graph, int *work);
+
+/**
+ *  @brief  Marks every node reachable from node 0.
+ *  @param  n [in] number of nodes
+ *  @param  start [in] adjacency list offsets
+ *  @param  adj [in] adjacency lists
+ *  @param  visited [out] visited[i] is ARROW_TRUE if i was reached
+ *  @param  stack [out] temporary array of size n
+ *  @return the number of nodes reached
+ */
+int
+prefilter_reach(int n, int *start, int *adj, int *visited, int *stack);
+
+/**
+ *  @brief  Checks that the graph has a cycle cover (every node gets one
+ *          successor and one predecessor) by looking for a perfect matching
+ *          in its bipartite double cover with Hopcroft-Karp.
+ *  @param  graph [in] graph structure
+ *  @param  work [out] temporary array of size 5n
+ *  @return ARROW_TRUE if a cycle cover exists, ARROW_FALSE otherwise
+ */
+int
+prefilter_cycle_cover(prefilter_graph *graph, int *work);
+
+
+/**
+ *  @brief  Picks the step for the next attempt.  Without a scheduler this is
+ *          the plan order.  With one, heuristic steps are picked by the
+ *          scheduler until the budget is spent, then the exact steps run.
+ *  @param  scheduler [in/out] attempt scheduler (can be NULL)
+ *  @param  num_steps [in] total number of steps in solve plan
+ *  @param  steps [in] solve plan step details
+ *  @param  used [in] used[i] is the number of attempts made with step i
+ *  @param  budget [in] heuristic attempts allowed
+ *  @param  made [in] heuristic attempts made so far
+ *  @return the step to use, or -1 if there are no attempts left
+ */
+int
+feasible_next_step(arrow_btsp_scheduler *scheduler, int num_steps,
+                   arrow_btsp_solve_plan *steps, int *used, int budget,
+                   int made);
+
+
 /****************************************************************************
  * Public function implementations
  ****************************************************************************/
 int
 arrow_btsp_feasible(arrow_problem *problem, int num_steps, 
                     arrow_btsp_solve_plan *steps, int min_cost, int max_cost, 
-                    int *feasible, arrow_btsp_result *result)
+                    arrow_context *context, int *feasible, 
+                    arrow_btsp_result *result)
+{
+    return arrow_btsp_feasible_memo(NULL, problem, num_steps, steps, min_cost,
+                                    max_cost, context, feasible, result);
+}
+
+int
+arrow_btsp_feasible_memo(arrow_btsp_memo_view *view, arrow_problem *problem,
+                         int num_steps, arrow_btsp_solve_plan *steps,
+                         int min_cost, int max_cost, arrow_context *context,
+                         int *feasible, arrow_btsp_result *result)
+{
+    return arrow_btsp_feasible_scheduled(view, NULL, 1.0, problem, num_steps,
+                                         steps, min_cost, max_cost, context,
+                                         feasible, result);
+}
+
+int
+arrow_btsp_feasible_scheduled(arrow_btsp_memo_view *view, 
+                              arrow_btsp_scheduler *scheduler, double effort,
+                              arrow_problem *problem, int num_steps,
+                              arrow_btsp_solve_plan *steps, int min_cost,
+                              int max_cost, arrow_context *context,
+                              int *feasible, arrow_btsp_result *result)
 {
     //printf("Feasible?: %d <= C[i,j] <= %d\n", min_cost, max_cost);
     //printf("is_symmetric = %d; size = %d;\n", problem->symmetric, problem->size);
     
     int ret = ARROW_SUCCESS;
-    int i, j, k;
+    int i, k;
     int u, v;
     int cost;
+    int possible;
+    int proven;
+    int known;
+    int budget, planned, made;
+    int *used = NULL;
     double len;
+    double start_time;
+#if ARROW_TRACE_LEVEL >= ARROW_TRACE_EVENTS
+    double trace_start, attempt_start;
+#endif
+    arrow_btsp_memo *memo = NULL;
+    arrow_problem *memo_problem = problem;
+    int memo_min = min_cost;
        
+    arrow_trace_clock(trace_start);
     *feasible = ARROW_FALSE;
     result->found_tour = ARROW_FALSE;
     result->max_cost = INT_MIN;
@@ -38,122 +196,668 @@ arrow_btsp_feasible(arrow_problem *problem, int num_steps,
     }
     result->total_time = 0.0;
     
+    /* Verdicts only carry over between windows when the plan decides
+       feasibility by the threshold graph alone.  A restricted view drops
+       its fixed edges along with the cheap ones, so it doesn't match any
+       window of its base. */
+    if((view != NULL) && (view->memo != NULL) && 
+       prefilter_applies(num_steps, steps) &&
+       ((view->base == NULL) || (problem->fixed_edges == 0)))
+    {
+        memo = view->memo;
+        if(view->base != NULL)
+        {
+            memo_problem = view->base;
+            if(view->min_cost > memo_min) memo_min = view->min_cost;
+        }
+        arrow_btsp_memo_lookup(memo, memo_problem, ARROW_BTSP_MEMO_THRESHOLD,
+                               memo_min, max_cost, &known, feasible, result);
+        if(known)
+        {
+            arrow_debug("Memo knows %d <= C[i,j] <= %d is %s.\n", 
+                        memo_min, max_cost, 
+                        (*feasible ? "feasible" : "infeasible"));
+            arrow_trace(ARROW_TRACE_MEMO, min_cost, max_cost, -1, -1, -1,
+                        (*feasible ? ARROW_TRACE_FEASIBLE
+                                   : ARROW_TRACE_INFEASIBLE), trace_start);
+            return ARROW_SUCCESS;
+        }
+    }
+    
+    /* Most probes below the optimal value can be refuted without running
+       a single TSP solver */
+    if(prefilter_applies(num_steps, steps))
+    {
+        start_time = arrow_util_zeit();
+        if(!arrow_btsp_feasible_prefilter(problem, min_cost, max_cost, 
+                                          &possible))
+            return ARROW_FAILURE;
+        result->total_time = arrow_util_zeit() - start_time;
+        if(!possible)
+        {
+            arrow_debug("Threshold graph for %d <= C[i,j] <= %d is not "
+                        "Hamiltonian.\n", min_cost, max_cost);
+            arrow_trace(ARROW_TRACE_PREFILTER, min_cost, max_cost, -1, -1, -1,
+                        ARROW_TRACE_INFEASIBLE, trace_start);
+            if(memo != NULL)
+                return arrow_btsp_memo_add_infeasible(memo, memo_problem,
+                    ARROW_BTSP_MEMO_THRESHOLD, memo_min, max_cost);
+            return ARROW_SUCCESS;
+        }
+    }
+    
     /* This holds the current tour that was found and its length */
     arrow_tsp_result tsp_result;
     arrow_tsp_result_init(problem, &tsp_result);
+    proven = ARROW_FALSE;
     
     arrow_debug("Feasibility problem for %d <= C[i,j] <= %d\n", min_cost, max_cost);
+    
+    /* With a scheduler, only a share of the heuristic attempts are made */
+    if(!arrow_util_create_int_array(num_steps + 1, &used))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    budget = 0;
     for(i = 0; i < num_steps; i++)
+    {
+        used[i] = 0;
+        if((steps[i].tsp_solver != ARROW_TSP_CC_EXACT) && 
+           (steps[i].attempts > 0))
+            budget += steps[i].attempts;
+    }
+    if(scheduler != NULL)
+    {
+        planned = budget;
+        budget = (int)ceil(effort * planned);
+        if(budget < 1) budget = 1;
+        if(budget > planned) budget = planned;
+        arrow_btsp_scheduler_skip(scheduler, planned - budget);
+        arrow_debug("Scheduler allows %d of %d heuristic attempts.\n",
+                    budget, planned);
+    }
+    
+    made = 0;
+    while((i = feasible_next_step(scheduler, num_steps, steps, used, budget,
+                                  made)) >= 0)
     {
         arrow_btsp_solve_plan *plan = &(steps[i]);
         arrow_btsp_fun *fun = &(plan->fun);
-                
-        arrow_debug("Step %d of %d:\n", i + 1, num_steps);
         
-        for(j = 1; j <= plan->attempts; j++)
+        used[i]++;
+        if(plan->tsp_solver != ARROW_TSP_CC_EXACT)
+            made++;
+        arrow_debug("Step %d of %d, attempt %d of %d:\n", i + 1, num_steps,
+                    used[i], plan->attempts);
+        
+        if(arrow_context_should_stop(context))
+        {
+            arrow_debug("Stopping feasibility problem early.\n");
+            goto CLEANUP;
+        }
+        
+        /* Create a new problem based upon the solve plan */
+        arrow_problem new_problem;
+        if(!arrow_btsp_fun_apply(fun, problem, min_cost, max_cost, &new_problem))
+        {
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+                                                
+        /* Call a TSP solver on new problem */      
+        arrow_trace_clock(attempt_start);
+        ret = arrow_tsp_solve(plan->tsp_solver, &new_problem, 
+                              plan->tsp_params, context, &tsp_result);
+        if(!ret)
+        {
+            ret = ARROW_FAILURE;
+            arrow_tsp_result_destruct(&tsp_result);
+            arrow_problem_destruct(&new_problem);
+            goto CLEANUP;   
+        }
+        
+        result->solver_attempts[plan->tsp_solver] += 1;
+        arrow_debug("TSP Solver Time: %.2f\n", tsp_result.total_time);
+        result->solver_time[plan->tsp_solver] += tsp_result.total_time;            
+        
+        /* Determine if we have found a tour of feasible length or not;
+           a solver cut short by the context may not have one at all */
+        if(tsp_result.found_tour)
         {
-            arrow_debug("Attempt %d of %d:\n", j, plan->attempts);
+            arrow_debug("Found a tour of length %.0f\n", 
+                        tsp_result.obj_value);
+            *feasible = fun->feasible(fun, problem, min_cost, max_cost, 
+                                      tsp_result.obj_value, 
+                                      tsp_result.tour);
             
-            /* Create a new problem based upon the solve plan */
-            arrow_problem new_problem;
-            if(!arrow_btsp_fun_apply(fun, problem, min_cost, max_cost, &new_problem))
+            /* An exact solve that ran to completion without a
+               feasible tour proves there isn't one */
+            if((plan->tsp_solver == ARROW_TSP_CC_EXACT) && !*feasible &&
+               !arrow_context_should_stop(context))
+                proven = ARROW_TRUE;
+        }
+        arrow_trace(ARROW_TRACE_ATTEMPT, min_cost, max_cost, i + 1, used[i],
+                    plan->tsp_solver,
+                    (*feasible ? ARROW_TRACE_FEASIBLE :
+                     (tsp_result.found_tour ? ARROW_TRACE_INFEASIBLE
+                                            : ARROW_TRACE_STOPPED)),
+                    attempt_start);
+        
+        /* An attempt cut short says nothing about how good the step is */
+        if((scheduler != NULL) && (plan->tsp_solver != ARROW_TSP_CC_EXACT) &&
+           (*feasible || !arrow_context_should_stop(context)))
+        {
+            arrow_btsp_scheduler_update(scheduler, i, *feasible,
+                                        tsp_result.total_time);
+        }
+        if(*feasible)
+        {
+            /* Set this tour to the output variables then exit */
+            arrow_debug(" - tour found is feasible.\n");
+            result->found_tour = ARROW_TRUE;
+            result->min_cost = INT_MAX;
+            result->max_cost = INT_MIN;
+
+            len = 0.0;
+            for(k = 0; k < problem->size; k++)
             {
-                ret = ARROW_FAILURE;
-                goto CLEANUP;
+                u = tsp_result.tour[k];
+                v = tsp_result.tour[(k + 1) % problem->size];
+                cost = problem->get_cost(problem, u, v);
+                
+                /* See if we've got a better min/max cost */
+                if(cost < result->min_cost) result->min_cost = cost;
+                if(cost > result->max_cost) result->max_cost = cost;
+                
+                /* Calculate the actual length of the tour */
+                len += cost;
+                if(result->tour != NULL)
+                    result->tour[k] = tsp_result.tour[k];
             }
-                                                    
-            /* Call a TSP solver on new problem */      
-            ret = arrow_tsp_solve(plan->tsp_solver, &new_problem, 
-                                  plan->tsp_params, &tsp_result);
-            if(!ret)
+            arrow_debug(" - actual tour is of length %.0f\n", len);
+            result->tour_length = len;
+            
+            if((memo != NULL) && (result->tour != NULL))
             {
-                ret = ARROW_FAILURE;
-                arrow_tsp_result_destruct(&tsp_result);
-                arrow_problem_destruct(&new_problem);
-                goto CLEANUP;   
+                ret = arrow_btsp_memo_add_tour(memo, memo_problem,
+                    ARROW_BTSP_MEMO_THRESHOLD, result->min_cost,
+                    result->max_cost, result->tour_length, result->tour);
             }
-            
-            result->solver_attempts[plan->tsp_solver] += 1;
-            printf("TSP Solver Time: %.2f\n", tsp_result.total_time);
-            result->solver_time[plan->tsp_solver] += tsp_result.total_time;            
-            
-            /* Determine if we have found a tour of feasible length or not */
-            arrow_debug("Found a tour of length %.0f\n", 
-                        tsp_result.obj_value);
-            *feasible = fun->feasible(fun, problem, min_cost, max_cost, 
-                                      tsp_result.obj_value, tsp_result.tour);
-            if(*feasible)
+                
+            arrow_debug("Finished feasibility question.\n");
+            arrow_problem_destruct(&new_problem);
+            goto CLEANUP;
+        }
+        
+        /* Clean up */
+        arrow_problem_destruct(&new_problem);
+    }
+    arrow_debug("Finished feasibility problem finding no feasible tours.\n");
+    if((memo != NULL) && proven)
+    {
+        ret = arrow_btsp_memo_add_infeasible(memo, memo_problem,
+            ARROW_BTSP_MEMO_THRESHOLD, memo_min, max_cost);
+    }
+    
+CLEANUP:
+    arrow_trace(ARROW_TRACE_PROBE, min_cost, max_cost, -1, -1, -1,
+                (*feasible ? ARROW_TRACE_FEASIBLE :
+                 (arrow_context_should_stop(context) ? ARROW_TRACE_STOPPED
+                                                     : ARROW_TRACE_INFEASIBLE)),
+                trace_start);
+    arrow_tsp_result_destruct(&tsp_result);
+    if(used != NULL) free(used);
+    return ret;
+}
+
+int
+arrow_btsp_feasible_prefilter(arrow_problem *problem, int min_cost, 
+                              int max_cost, int *possible)
+{
+    int ret = ARROW_SUCCESS;
+    int *work = NULL;
+    prefilter_graph graph;
+
+    *possible = ARROW_TRUE;
+    if(problem->size < 3)
+        return ARROW_SUCCESS;
+
+    if(!prefilter_graph_init(problem, min_cost, max_cost, &graph))
+        return ARROW_FAILURE;
+    if(!arrow_util_create_int_array(5 * problem->size, &work))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+
+    /* Cheapest tests first */
+    if(!prefilter_degrees(&graph))
+    {
+        arrow_debug(" - prefilter: node degree too small\n");
+        *possible = ARROW_FALSE;
+    }
+    else if(graph.symmetric && !prefilter_biconnected(&graph, work))
+    {
+        arrow_debug(" - prefilter: graph not biconnected\n");
+        *possible = ARROW_FALSE;
+    }
+    else if(!graph.symmetric && !prefilter_strongly_connected(&graph, work))
+    {
+        arrow_debug(" - prefilter: graph not strongly connected\n");
+        *possible = ARROW_FALSE;
+    }
+    else if(!prefilter_cycle_cover(&graph, work))
+    {
+        arrow_debug(" - prefilter: graph has no cycle cover\n");
+        *possible = ARROW_FALSE;
+    }
+
+CLEANUP:
+    prefilter_graph_destruct(&graph);
+    if(work != NULL) free(work);
+    return ret;
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+int
+feasible_next_step(arrow_btsp_scheduler *scheduler, int num_steps,
+                   arrow_btsp_solve_plan *steps, int *used, int budget,
+                   int made)
+{
+    int i;
+
+    if(scheduler == NULL)
+    {
+        for(i = 0; i < num_steps; i++)
+        {
+            if(used[i] < steps[i].attempts)
+                return i;
+        }
+        return -1;
+    }
+
+    if(made < budget)
+    {
+        i = arrow_btsp_scheduler_pick(scheduler, num_steps, steps, used);
+        if(i >= 0)
+            return i;
+    }
+    for(i = 0; i < num_steps; i++)
+    {
+        if((steps[i].tsp_solver == ARROW_TSP_CC_EXACT) &&
+           (used[i] < steps[i].attempts))
+            return i;
+    }
+    return -1;
+}
+
+int
+prefilter_applies(int num_steps, arrow_btsp_solve_plan *steps)
+{
+    int i;
+    int applies = ARROW_FALSE;
+
+    for(i = 0; i < num_steps; i++)
+    {
+        if(steps[i].attempts <= 0)
+            continue;
+        if(!steps[i].fun.threshold_graph)
+            return ARROW_FALSE;
+        applies = ARROW_TRUE;
+    }
+    return applies;
+}
+
+int
+prefilter_graph_init(arrow_problem *problem, int min_cost, int max_cost,
+                     prefilter_graph *graph)
+{
+    int i, j, cost;
+    int n = problem->size;
+    int *out_deg = NULL;
+    int *in_deg = NULL;
+
+    graph->size = n;
+    graph->symmetric = problem->symmetric;
+    graph->start = NULL;
+    graph->adj = NULL;
+    graph->rstart = NULL;
+    graph->radj = NULL;
+
+    if(!arrow_util_create_int_array(n + 1, &(graph->start)))
+        goto FAILURE;
+    if(!arrow_util_create_int_array(n, &out_deg))
+        goto FAILURE;
+    if(!arrow_util_create_int_array(n, &in_deg))
+        goto FAILURE;
+    for(i = 0; i < n; i++)
+    {
+        out_deg[i] = 0;
+        in_deg[i] = 0;
+    }
+
+    /* First pass counts degrees so the adjacency lists can be packed */
+    for(i = 0; i < n; i++)
+    {
+        for(j = (graph->symmetric ? i + 1 : 0); j < n; j++)
+        {
+            if(i == j)
+                continue;
+            cost = problem->get_cost(problem, i, j);
+            if((cost < 0) || ((cost >= min_cost) && (cost <= max_cost)))
             {
-                /* Set this tour to the output variables then exit */
-                arrow_debug(" - tour found is feasible.\n");
-                result->found_tour = ARROW_TRUE;
-                result->min_cost = INT_MAX;
-                result->max_cost = INT_MIN;
-
-                len = 0.0;
-                for(k = 0; k < problem->size; k++)
+                out_deg[i]++;
+                if(graph->symmetric)
+                    out_deg[j]++;
+                else
+                    in_deg[j]++;
+            }
+        }
+    }
+    graph->start[0] = 0;
+    for(i = 0; i < n; i++)
+        graph->start[i + 1] = graph->start[i] + out_deg[i];
+    if(!arrow_util_create_int_array(graph->start[n] + 1, &(graph->adj)))
+        goto FAILURE;
+    if(!graph->symmetric)
+    {
+        if(!arrow_util_create_int_array(n + 1, &(graph->rstart)))
+            goto FAILURE;
+        graph->rstart[0] = 0;
+        for(i = 0; i < n; i++)
+            graph->rstart[i + 1] = graph->rstart[i] + in_deg[i];
+        if(!arrow_util_create_int_array(graph->rstart[n] + 1, 
+                                        &(graph->radj)))
+            goto FAILURE;
+    }
+
+    /* Second pass fills the lists, reusing the degree arrays as cursors */
+    for(i = 0; i < n; i++)
+    {
+        out_deg[i] = graph->start[i];
+        if(!graph->symmetric)
+            in_deg[i] = graph->rstart[i];
+    }
+    for(i = 0; i < n; i++)
+    {
+        for(j = (graph->symmetric ? i + 1 : 0); j < n; j++)
+        {
+            if(i == j)
+                continue;
+            cost = problem->get_cost(problem, i, j);
+            if((cost < 0) || ((cost >= min_cost) && (cost <= max_cost)))
+            {
+                graph->adj[out_deg[i]++] = j;
+                if(graph->symmetric)
+                    graph->adj[out_deg[j]++] = i;
+                else
+                    graph->radj[in_deg[j]++] = i;
+            }
+        }
+    }
+
+    free(out_deg);
+    free(in_deg);
+    return ARROW_SUCCESS;
+
+FAILURE:
+    if(out_deg != NULL) free(out_deg);
+    if(in_deg != NULL) free(in_deg);
+    prefilter_graph_destruct(graph);
+    return ARROW_FAILURE;
+}
+
+void
+prefilter_graph_destruct(prefilter_graph *graph)
+{
+    if(graph->start != NULL) free(graph->start);
+    if(graph->adj != NULL) free(graph->adj);
+    if(graph->rstart != NULL) free(graph->rstart);
+    if(graph->radj != NULL) free(graph->radj);
+    graph->start = NULL;
+    graph->adj = NULL;
+    graph->rstart = NULL;
+    graph->radj = NULL;
+}
+
+int
+prefilter_degrees(prefilter_graph *graph)
+{
+    int i;
+
+    for(i = 0; i < graph->size; i++)
+    {
+        if(graph->symmetric)
+        {
+            if(graph->start[i + 1] - graph->start[i] < 2)
+                return ARROW_FALSE;
+        }
+        else
+        {
+            if((graph->start[i + 1] == graph->start[i]) ||
+               (graph->rstart[i + 1] == graph->rstart[i]))
+                return ARROW_FALSE;
+        }
+    }
+    return ARROW_TRUE;
+}
+
+int
+prefilter_biconnected(prefilter_graph *graph, int *work)
+{
+    int u, v, p, top;
+    int n = graph->size;
+    int depth_num = 0;
+    int root_children = 0;
+    int *depth = work;
+    int *low = work + n;
+    int *parent = work + 2 * n;
+    int *next = work + 3 * n;
+    int *stack = work + 4 * n;
+
+    for(u = 0; u < n; u++)
+    {
+        depth[u] = -1;
+        next[u] = graph->start[u];
+    }
+
+    /* Depth-first search from node 0, keeping the search path on an explicit
+       stack.  depth and low have the same meaning as in find_art_points. */
+    depth[0] = low[0] = depth_num++;
+    parent[0] = -1;
+    stack[0] = 0;
+    top = 0;
+    while(top >= 0)
+    {
+        u = stack[top];
+        if(next[u] < graph->start[u + 1])
+        {
+            v = graph->adj[next[u]];
+            next[u]++;
+            if(depth[v] < 0)
+            {
+                if(u == 0)
+                    root_children++;
+                parent[v] = u;
+                depth[v] = low[v] = depth_num++;
+                stack[++top] = v;
+            }
+            else if((v != parent[u]) && (depth[v] < low[u]))
+            {
+                low[u] = depth[v];
+            }
+        }
+        else
+        {
+            /* Done with u; check if its parent is an articulation point */
+            top--;
+            p = parent[u];
+            if(p >= 0)
+            {
+                if(low[u] < low[p])
+                    low[p] = low[u];
+                if((p != 0) && (low[u] >= depth[p]))
+                    return ARROW_FALSE;
+            }
+        }
+    }
+
+    /* The root is an articulation point if it has more than one child, and
+       the graph is disconnected if the search missed anyone */
+    return ((root_children == 1) && (depth_num == n) 
+            ? ARROW_TRUE : ARROW_FALSE);
+}
+
+int
+prefilter_strongly_connected(prefilter_graph *graph, int *work)
+{
+    int n = graph->size;
+    int *visited = work;
+    int *stack = work + n;
+
+    if(prefilter_reach(n, graph->start, graph->adj, visited, stack) < n)
+        return ARROW_FALSE;
+    if(prefilter_reach(n, graph->rstart, graph->radj, visited, stack) < n)
+        return ARROW_FALSE;
+    return ARROW_TRUE;
+}
+
+int
+prefilter_reach(int n, int *start, int *adj, int *visited, int *stack)
+{
+    int i, k, u, v;
+    int top = 0;
+    int reached = 1;
+
+    for(i = 0; i < n; i++)
+        visited[i] = ARROW_FALSE;
+    visited[0] = ARROW_TRUE;
+    stack[0] = 0;
+    while(top >= 0)
+    {
+        u = stack[top--];
+        for(k = start[u]; k < start[u + 1]; k++)
+        {
+            v = adj[k];
+            if(!visited[v])
+            {
+                visited[v] = ARROW_TRUE;
+                reached++;
+                stack[++top] = v;
+            }
+        }
+    }
+    return reached;
+}
+
+int
+prefilter_cycle_cover(prefilter_graph *graph, int *work)
+{
+    int i, k, u, v, w, head, tail, top, found;
+    int n = graph->size;
+    int matched = 0;
+    int *match_l = work;            /* successor picked for each node */
+    int *match_r = work + n;        /* predecessor picked for each node */
+    int *dist = work + 2 * n;
+    int *next = work + 3 * n;
+    int *queue = work + 4 * n;      /* doubles as the DFS stack */
+
+    /* Greedy start: most nodes get matched without any searching */
+    for(i = 0; i < n; i++)
+        match_r[i] = -1;
+    for(u = 0; u < n; u++)
+    {
+        match_l[u] = -1;
+        for(k = graph->start[u]; k < graph->start[u + 1]; k++)
+        {
+            v = graph->adj[k];
+            if(match_r[v] < 0)
+            {
+                match_l[u] = v;
+                match_r[v] = u;
+                matched++;
+                break;
+            }
+        }
+    }
+
+    while(matched < n)
+    {
+        /* Layer the unmatched left nodes and what they can reach along
+           alternating paths */
+        head = tail = 0;
+        for(u = 0; u < n; u++)
+        {
+            next[u] = graph->start[u];
+            if(match_l[u] < 0)
+            {
+                dist[u] = 0;
+                queue[tail++] = u;
+            }
+            else
+                dist[u] = INT_MAX;
+        }
+        found = ARROW_FALSE;
+        while(head < tail)
+        {
+            u = queue[head++];
+            for(k = graph->start[u]; k < graph->start[u + 1]; k++)
+            {
+                w = match_r[graph->adj[k]];
+                if(w < 0)
+                    found = ARROW_TRUE;
+                else if(dist[w] == INT_MAX)
                 {
-                    u = tsp_result.tour[k];
-                    v = tsp_result.tour[(k + 1) % problem->size];
-                    cost = problem->get_cost(problem, u, v);
-                    
-                    /* See if we've got a better min/max cost */
-                    if(cost < result->min_cost) result->min_cost = cost;
-                    if(cost > result->max_cost) result->max_cost = cost;
-                    
-                    /* Calculate the actual length of the tour */
-                    len += cost;
-                    if(result->tour != NULL)
-                        result->tour[k] = tsp_result.tour[k];
+                    dist[w] = dist[u] + 1;
+                    queue[tail++] = w;
                 }
-                arrow_debug(" - actual tour is of length %.0f\n", len);
-                result->tour_length = len;
-                    
-                arrow_debug("Finished feasibility question.\n");
-                arrow_problem_destruct(&new_problem);
-                goto CLEANUP;
             }
-            
-            /** TODO: Find a better way of doing this upper bound update */
-            /*
-            else if(plan->upper_bound_update)
+        }
+        if(!found)
+            return ARROW_FALSE;
+
+        /* Augment along shortest alternating paths.  next[x] stays on the
+           edge the search went down so the path can be flipped at the end. */
+        for(i = 0; i < n; i++)
+        {
+            if(match_l[i] >= 0)
+                continue;
+            top = 0;
+            queue[0] = i;
+            while(top >= 0)
             {
-                printf("Check to see if we found a better upper bound...\n");
-                max_cost = INT_MIN;
-                len = 0.0;
-                for(k = 0; k < problem->size; k++)
+                u = queue[top];
+                if(next[u] == graph->start[u + 1])
                 {
-                    u = tsp_result.tour[k];
-                    v = tsp_result.tour[(k + 1) % problem->size];
-                    cost = problem->get_cost(problem, u, v);
-                    len += cost;
-                    if(cost > max_cost) max_cost = cost;
+                    dist[u] = INT_MAX;
+                    top--;
+                    if(top >= 0)
+                        next[queue[top]]++;
+                    continue;
                 }
-                
-                if(max_cost < result->obj_value)
+                v = graph->adj[next[u]];
+                w = match_r[v];
+                if(w < 0)
                 {
-                    arrow_debug(" - tour is the best one found so far.\n");
-                    arrow_debug(" - max. cost is %d\n", max_cost);
-                    result->found_tour = ARROW_TRUE;
-                    result->obj_value = max_cost;
-                    arrow_debug(" - actual tour is of length %.0f\n", len);
-                    result->tour_length = len;
-                    if(result->tour != NULL)
+                    for(; top >= 0; top--)
                     {
-                        for(k = 0; k < problem->size; k++)
-                            result->tour[k] = tsp_result.tour[k];
+                        u = queue[top];
+                        v = graph->adj[next[u]];
+                        match_l[u] = v;
+                        match_r[v] = u;
                     }
+                    matched++;
                 }
+                else if((dist[w] != INT_MAX) && (dist[w] == dist[u] + 1))
+                    queue[++top] = w;
+                else
+                    next[u]++;
             }
-            */
-            
-            /* Clean up */
-            arrow_problem_destruct(&new_problem);
         }
     }
-    arrow_debug("Finished feasibility problem finding no feasible tours.\n");
-    
-CLEANUP:
-    arrow_tsp_result_destruct(&tsp_result);
-    return ret;
+    return ARROW_TRUE;
 }
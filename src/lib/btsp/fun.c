@@ -7,9 +7,22 @@
  * @author  John LaRusic
  * @ingroup lib
  ****************************************************************************/
+#include <math.h>
 #include "common.h"
 #include "btsp.h"
 
+/* Deep copy rows have an AVX2 kernel on x86 GCC builds; which kernel runs
+   is decided at run time so the library still works on older CPUs. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define FUN_HAVE_AVX2
+    #include <immintrin.h>
+#endif
+
+/* Deep copies are only split between threads when each gets at least this
+   many edges */
+#define FILL_EDGES_PER_THREAD 262144
+#define FILL_MAX_THREADS 64
+
 /****************************************************************************
  * Private structures
  ****************************************************************************/
@@ -21,6 +34,34 @@ typedef struct fun_data
     int max_cost;               /**< max cost to consider for active edges */
 } fun_data;
 
+/**
+ *  @brief  Rows of a deep copy written by one thread.
+ */
+typedef struct fill_job
+{
+    arrow_btsp_fun *fun;            /**< cost matrix function */
+    arrow_problem *base_problem;    /**< base problem for function */
+    int min_cost;               /**< min cost to consider for active edges */
+    int max_cost;               /**< max cost to consider for active edges */
+    int first;                  /**< first row to write */
+    int last;                   /**< one past the last row to write */
+    int **adj;                  /**< matrix rows to write */
+    int ret;                    /**< ARROW_SUCCESS once the rows are written */
+} fill_job;
+
+/* Deep copies being filled across the process, so parallel probes and
+   batch workers share the processors instead of each taking them all */
+static pthread_mutex_t fill_lock = PTHREAD_MUTEX_INITIALIZER;
+static int fill_active = 0;
+
+/**
+ *  @brief  Kernel that writes one row of a deep copy.
+ */
+typedef void
+(*fun_row_kernel)(const int *costs, int count, int low, int high,
+                  int in_scale, int in_shift, int out_scale, int out_shift,
+                  int *out);
+
 
 /****************************************************************************
  * Private function prototypes
@@ -51,6 +92,88 @@ int
 apply_deep(arrow_btsp_fun *fun, arrow_problem *old_problem, 
            int min_cost, int max_cost, arrow_problem *new_problem);
 
+/**
+ *  @brief  Builds the problem from the function's deep copy cache, writing
+ *          only the edges that need it.
+ *  @param  fun [in] the cost matrix function (fun->cache is not NULL)
+ *  @param  old_problem [in] the base problem (fun->cache->index->base)
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  new_problem [out] the problem, pointing at the cached matrix
+ */
+int
+apply_cached(arrow_btsp_fun *fun, arrow_problem *old_problem, 
+             int min_cost, int max_cost, arrow_problem *new_problem);
+
+/**
+ *  @brief  Writes the transformed cost of every edge with a cost in
+ *          [low, high] into the cached matrix.
+ *  @param  fun [in] the cost matrix function
+ *  @param  cache [in/out] the deep copy cache
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  low [in] smallest edge cost to rewrite
+ *  @param  high [in] largest edge cost to rewrite
+ */
+void
+cache_write(arrow_btsp_fun *fun, arrow_btsp_fun_cache *cache, int min_cost,
+            int max_cost, int low, int high);
+
+/**
+ *  @brief  Writes the transformed cost of every edge into a lower triangle
+ *          matrix, splitting the rows between threads for large problems
+ *          when the function has a transform_rows.
+ *  @param  fun [in] the cost matrix function
+ *  @param  old_problem [in] the base problem
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  adj [out] matrix rows
+ */
+int
+fill_matrix(arrow_btsp_fun *fun, arrow_problem *old_problem,
+            int min_cost, int max_cost, int **adj);
+
+/**
+ *  @brief  Writes the rows of one fill_job.
+ *  @param  arg [in/out] a fill_job structure
+ */
+void *
+fill_rows(void *arg);
+
+/**
+ *  @brief  Writes one row of a deep copy an edge at a time (any CPU).
+ */
+void
+select_row_scalar(const int *costs, int count, int low, int high,
+                  int in_scale, int in_shift, int out_scale, int out_shift,
+                  int *out);
+
+#ifdef FUN_HAVE_AVX2
+/**
+ *  @brief  Writes one row of a deep copy eight edges at a time with AVX2.
+ */
+void
+select_row_avx2(const int *costs, int count, int low, int high,
+                int in_scale, int in_shift, int out_scale, int out_shift,
+                int *out)
+    __attribute__((target("avx2")));
+#endif
+
+/**
+ *  @brief  Picks the fastest row kernel the CPU supports.
+ *  @return row kernel
+ */
+fun_row_kernel
+select_row_fun();
+
+/**
+ *  @brief  Releases a problem built from a deep copy cache; the matrix
+ *          stays with the cache.
+ *  @param  problem [in] problem structure
+ */
+void
+cache_destruct(arrow_problem *problem);
+
 /**
  *  @brief  Cost function for problems based upon cost matrix functions.
  *  @param  this [in] problem structure
@@ -97,6 +220,7 @@ arrow_btsp_fun_apply(arrow_btsp_fun *fun, arrow_problem *old_problem,
     new_problem->symmetric = old_problem->symmetric;
     new_problem->fixed_edges = old_problem->fixed_edges;
     new_problem->shallow = fun->shallow;
+    new_problem->analysis = NULL;
     strcpy(new_problem->name, old_problem->name);
     
     if(!fun->initialize(fun))
@@ -107,6 +231,9 @@ arrow_btsp_fun_apply(arrow_btsp_fun *fun, arrow_problem *old_problem,
     
     if(fun->shallow)
         return apply_shallow(fun, old_problem, min_cost, max_cost, new_problem);
+    else if((fun->cache != NULL) && !fun->cache->in_use &&
+            (fun->cache->index->base == old_problem))
+        return apply_cached(fun, old_problem, min_cost, max_cost, new_problem);
     else
         return apply_deep(fun, old_problem, min_cost, max_cost, new_problem);
 }
@@ -117,6 +244,125 @@ arrow_btsp_fun_destruct(arrow_btsp_fun *fun)
     fun->destruct(fun);
 }
 
+int
+arrow_btsp_edge_index_init(arrow_problem *problem, arrow_problem_info *info,
+                           arrow_btsp_edge_index *index)
+{
+    int i, j, k, pos;
+    int n = problem->size;
+    int length = info->cost_list_length;
+
+    index->base = problem;
+    index->info = info;
+    index->start = NULL;
+    index->edges = NULL;
+
+    /* Edges are packed into an int, and only the lower triangle is kept */
+    if(!problem->symmetric || (n > 46340))
+    {
+        arrow_debug("Edge index needs a symmetric problem of at most "
+                    "46340 nodes.\n");
+        return ARROW_FAILURE;
+    }
+    if(!arrow_util_create_int_array(length + 1, &(index->start)))
+        goto FAILURE;
+    if(!arrow_util_create_int_array(n * (n - 1) / 2 + 1, &(index->edges)))
+        goto FAILURE;
+
+    /* Counting sort by cost index, as the quantile search counts edges */
+    for(k = 0; k <= length; k++)
+        index->start[k] = 0;
+    for(i = 0; i < n; i++)
+    {
+        for(j = 0; j < i; j++)
+        {
+            if(!arrow_problem_info_cost_index(info,
+                    problem->get_cost(problem, i, j), &pos))
+                goto FAILURE;
+            index->start[pos + 1]++;
+        }
+    }
+    for(k = 0; k < length; k++)
+        index->start[k + 1] += index->start[k];
+    for(i = 0; i < n; i++)
+    {
+        for(j = 0; j < i; j++)
+        {
+            arrow_problem_info_cost_index(info,
+                problem->get_cost(problem, i, j), &pos);
+            index->edges[index->start[pos]++] = i * n + j;
+        }
+    }
+
+    /* Filling moved each start to the next one's; shift them back */
+    for(k = length; k > 0; k--)
+        index->start[k] = index->start[k - 1];
+    index->start[0] = 0;
+    return ARROW_SUCCESS;
+
+FAILURE:
+    arrow_btsp_edge_index_destruct(index);
+    return ARROW_FAILURE;
+}
+
+void
+arrow_btsp_edge_index_destruct(arrow_btsp_edge_index *index)
+{
+    if(index->start != NULL) free(index->start);
+    if(index->edges != NULL) free(index->edges);
+    index->start = NULL;
+    index->edges = NULL;
+}
+
+void
+arrow_btsp_fun_cache_init(arrow_btsp_edge_index *index, 
+                          arrow_btsp_fun_cache *cache)
+{
+    cache->index = index;
+    cache->built = ARROW_FALSE;
+    cache->in_use = ARROW_FALSE;
+    cache->min_cost = INT_MIN;
+    cache->max_cost = INT_MIN;
+    cache->rebuilds = 0;
+    cache->updates = 0;
+    cache->written = 0;
+}
+
+void
+arrow_btsp_fun_cache_destruct(arrow_btsp_fun_cache *cache)
+{
+    if(cache->built)
+        CCutil_freedatagroup(&(cache->dat));
+    cache->built = ARROW_FALSE;
+}
+
+int *
+arrow_btsp_fun_base_row(arrow_problem *problem, int i, int *row)
+{
+    int j;
+    CCdatagroup *dat;
+
+    /* Concorde keeps explicit matrices as a lower triangle of rows */
+    if(problem->type == ARROW_PROBLEM_DATA_CONCORDE)
+    {
+        dat = (CCdatagroup *)problem->data;
+        if((dat->norm == CC_MATRIXNORM) && (dat->adj != NULL))
+            return dat->adj[i];
+    }
+    for(j = 0; j < i; j++)
+        row[j] = problem->get_cost(problem, i, j);
+    return row;
+}
+
+void
+arrow_btsp_fun_select_row(const int *costs, int count, int low, int high,
+                          int in_scale, int in_shift, int out_scale,
+                          int out_shift, int *out)
+{
+    fun_row_kernel kernel = select_row_fun();
+    kernel(costs, count, low, high, in_scale, in_shift, out_scale,
+           out_shift, out);
+}
 
 /****************************************************************************
  * Private function implementations
@@ -149,7 +395,6 @@ int
 apply_deep(arrow_btsp_fun *fun, arrow_problem *old_problem, 
            int min_cost, int max_cost, arrow_problem *new_problem)
 {
-    int i, j;
     int size = old_problem->size;
     
     CCdatagroup *dat = NULL;
@@ -166,11 +411,11 @@ apply_deep(arrow_btsp_fun *fun, arrow_problem *old_problem,
         return ARROW_FAILURE;
     }
     
-    for(i = 0; i < size; i++)
+    if(!fill_matrix(fun, old_problem, min_cost, max_cost, dat->adj))
     {
-        for(j = 0; j < i; j++)
-            dat->adj[i][j] = 
-                fun->get_cost(fun, old_problem, min_cost, max_cost, i, j);
+        CCutil_freedatagroup(dat);
+        free(dat);
+        return ARROW_FAILURE;
     }
     
     new_problem->type = ARROW_PROBLEM_DATA_CONCORDE;
@@ -181,6 +426,288 @@ apply_deep(arrow_btsp_fun *fun, arrow_problem *old_problem,
     return ARROW_SUCCESS;
 }
 
+int
+apply_cached(arrow_btsp_fun *fun, arrow_problem *old_problem, 
+             int min_cost, int max_cost, arrow_problem *new_problem)
+{
+    arrow_btsp_fun_cache *cache = fun->cache;
+#if ARROW_TRACE_LEVEL >= ARROW_TRACE_DEBUG
+    long long written = cache->written;
+#endif
+    int fresh = !cache->built;
+
+    if(fresh)
+    {
+        if(!arrow_util_CCdatagroup_init_matrix(old_problem->size, 
+                                               &(cache->dat)))
+        {
+            arrow_print_error("Could not allocate memory for CC matrix");
+            return ARROW_FAILURE;
+        }
+        cache->built = ARROW_TRUE;
+    }
+    if(fresh || !fun->incremental)
+    {
+        /* Shake functions draw new random numbers for every attempt, but
+           the matrix itself can still be reused.  Every edge is written, so
+           go row by row rather than through the index. */
+        if(!fill_matrix(fun, old_problem, min_cost, max_cost, cache->dat.adj))
+        {
+            CCutil_freedatagroup(&(cache->dat));
+            cache->built = ARROW_FALSE;
+            return ARROW_FAILURE;
+        }
+        cache->written += old_problem->size * (old_problem->size - 1LL) / 2;
+        cache->rebuilds++;
+    }
+    else
+    {
+        /* Only edges between the old and new ends of the window can have
+           moved in or out of it */
+        if(min_cost != cache->min_cost)
+        {
+            cache_write(fun, cache, min_cost, max_cost,
+                        (min_cost < cache->min_cost ? min_cost
+                                                    : cache->min_cost),
+                        (min_cost < cache->min_cost ? cache->min_cost
+                                                    : min_cost));
+        }
+        if(max_cost != cache->max_cost)
+        {
+            cache_write(fun, cache, min_cost, max_cost,
+                        (max_cost < cache->max_cost ? max_cost
+                                                    : cache->max_cost),
+                        (max_cost < cache->max_cost ? cache->max_cost
+                                                    : max_cost));
+        }
+        cache->updates++;
+    }
+    arrow_debug("Deep copy for %d <= C[i,j] <= %d rewrote %lld edges.\n",
+                min_cost, max_cost, cache->written - written);
+
+    cache->min_cost = min_cost;
+    cache->max_cost = max_cost;
+    cache->in_use = ARROW_TRUE;
+    new_problem->type = ARROW_PROBLEM_DATA_CONCORDE;
+    new_problem->data = (void *)&(cache->dat);
+    new_problem->get_cost = cc_get_cost;
+    new_problem->destruct = cache_destruct;
+    return ARROW_SUCCESS;
+}
+
+void
+cache_write(arrow_btsp_fun *fun, arrow_btsp_fun_cache *cache, int min_cost,
+            int max_cost, int low, int high)
+{
+    int i, j, k, first, last, mid, edge;
+    arrow_btsp_edge_index *index = cache->index;
+    arrow_problem *base = index->base;
+    int *cost_list = index->info->cost_list;
+    int length = index->info->cost_list_length;
+    int n = base->size;
+
+    /* First cost index at or above low */
+    first = 0;
+    last = length;
+    while(first < last)
+    {
+        mid = first + (last - first) / 2;
+        if(cost_list[mid] < low)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+
+    for(k = first; (k < length) && (cost_list[k] <= high); k++)
+    {
+        for(edge = index->start[k]; edge < index->start[k + 1]; edge++)
+        {
+            i = index->edges[edge] / n;
+            j = index->edges[edge] % n;
+            cache->dat.adj[i][j] =
+                fun->get_cost(fun, base, min_cost, max_cost, i, j);
+        }
+        cache->written += index->start[k + 1] - index->start[k];
+    }
+}
+
+int
+fill_matrix(arrow_btsp_fun *fun, arrow_problem *old_problem,
+            int min_cost, int max_cost, int **adj)
+{
+    int t, started;
+    int ret = ARROW_SUCCESS;
+    int threads = 1;
+    int n = old_problem->size;
+    double edges = n * (n - 1.0) / 2.0;
+    long processors;
+    fill_job jobs[FILL_MAX_THREADS];
+    pthread_t thread_ids[FILL_MAX_THREADS];
+
+    /* get_cost may draw random numbers, so only transform_rows is known to
+       be safe to run from several threads */
+    if(fun->transform_rows != NULL)
+    {
+        pthread_mutex_lock(&fill_lock);
+        fill_active++;
+        processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (processors > 0 ? (int)(processors / fill_active) : 1);
+        pthread_mutex_unlock(&fill_lock);
+
+        if(threads > edges / FILL_EDGES_PER_THREAD)
+            threads = (int)(edges / FILL_EDGES_PER_THREAD);
+        if(threads > FILL_MAX_THREADS)
+            threads = FILL_MAX_THREADS;
+        if(threads < 1)
+            threads = 1;
+    }
+
+    /* Row i has i edges, so an equal share of the triangle ends at row
+       n * sqrt(t / threads) */
+    for(t = 0; t < threads; t++)
+    {
+        jobs[t].fun = fun;
+        jobs[t].base_problem = old_problem;
+        jobs[t].min_cost = min_cost;
+        jobs[t].max_cost = max_cost;
+        jobs[t].first = (t == 0 ? 0 : jobs[t - 1].last);
+        jobs[t].last = (t == threads - 1 ? n
+                        : (int)(n * sqrt((t + 1.0) / threads)));
+        jobs[t].adj = adj;
+        jobs[t].ret = ARROW_FAILURE;
+    }
+
+    /* The calling thread takes the first share, and any share a thread
+       could not be started for */
+    started = 1;
+    while(started < threads)
+    {
+        if(pthread_create(&(thread_ids[started]), NULL, fill_rows,
+                          &(jobs[started])) != 0)
+            break;
+        started++;
+    }
+    fill_rows(&(jobs[0]));
+    for(t = started; t < threads; t++)
+        fill_rows(&(jobs[t]));
+    for(t = 1; t < started; t++)
+        pthread_join(thread_ids[t], NULL);
+
+    for(t = 0; t < threads; t++)
+    {
+        if(!jobs[t].ret)
+            ret = ARROW_FAILURE;
+    }
+    if(fun->transform_rows != NULL)
+    {
+        pthread_mutex_lock(&fill_lock);
+        fill_active--;
+        pthread_mutex_unlock(&fill_lock);
+    }
+    return ret;
+}
+
+void *
+fill_rows(void *arg)
+{
+    int i, j;
+    int *row = NULL;
+    fill_job *job = (fill_job *)arg;
+    arrow_btsp_fun *fun = job->fun;
+
+    if(fun->transform_rows != NULL)
+    {
+        if(!arrow_util_create_int_array(job->base_problem->size, &row))
+            return NULL;
+        fun->transform_rows(fun, job->base_problem, job->min_cost, 
+                            job->max_cost, job->first, job->last, row,
+                            job->adj);
+        free(row);
+    }
+    else
+    {
+        for(i = job->first; i < job->last; i++)
+        {
+            for(j = 0; j < i; j++)
+                job->adj[i][j] = fun->get_cost(fun, job->base_problem,
+                                               job->min_cost, job->max_cost,
+                                               i, j);
+        }
+    }
+    job->ret = ARROW_SUCCESS;
+    return NULL;
+}
+
+void
+select_row_scalar(const int *costs, int count, int low, int high,
+                  int in_scale, int in_shift, int out_scale, int out_shift,
+                  int *out)
+{
+    int j, cost;
+
+    for(j = 0; j < count; j++)
+    {
+        cost = costs[j];
+        if((cost >= low) && (cost <= high))
+            out[j] = in_scale * cost + in_shift;
+        else
+            out[j] = out_scale * cost + out_shift;
+    }
+}
+
+#ifdef FUN_HAVE_AVX2
+void
+select_row_avx2(const int *costs, int count, int low, int high,
+                int in_scale, int in_shift, int out_scale, int out_shift,
+                int *out)
+{
+    int j;
+    __m256i low8 = _mm256_set1_epi32(low);
+    __m256i high8 = _mm256_set1_epi32(high);
+    __m256i in_scale8 = _mm256_set1_epi32(in_scale);
+    __m256i in_shift8 = _mm256_set1_epi32(in_shift);
+    __m256i out_scale8 = _mm256_set1_epi32(out_scale);
+    __m256i out_shift8 = _mm256_set1_epi32(out_shift);
+    __m256i c8, outside8, in8, out8;
+
+    /* Both values are computed for every lane and the lanes outside
+       [low, high] take the second */
+    for(j = 0; j + 8 <= count; j += 8)
+    {
+        c8 = _mm256_loadu_si256((const __m256i *)(costs + j));
+        outside8 = _mm256_or_si256(_mm256_cmpgt_epi32(low8, c8),
+                                   _mm256_cmpgt_epi32(c8, high8));
+        in8 = _mm256_add_epi32(_mm256_mullo_epi32(c8, in_scale8), in_shift8);
+        out8 = _mm256_add_epi32(_mm256_mullo_epi32(c8, out_scale8),
+                                out_shift8);
+        _mm256_storeu_si256((__m256i *)(out + j),
+                            _mm256_blendv_epi8(in8, out8, outside8));
+    }
+    if(j < count)
+        select_row_scalar(costs + j, count - j, low, high, in_scale,
+                          in_shift, out_scale, out_shift, out + j);
+}
+#endif
+
+fun_row_kernel
+select_row_fun()
+{
+#ifdef FUN_HAVE_AVX2
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return select_row_avx2;
+#endif
+    return select_row_scalar;
+}
+
+void
+cache_destruct(arrow_problem *problem)
+{
+    /* The matrix is the first member of the cache */
+    arrow_btsp_fun_cache *cache = (arrow_btsp_fun_cache *)problem->data;
+    cache->in_use = ARROW_FALSE;
+}
+
 int 
 fun_get_cost(arrow_problem *this, int i, int j)
 {
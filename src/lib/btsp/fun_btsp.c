@@ -43,6 +43,22 @@ typedef struct btsp_shake_1_data
 int
 btsp_basic_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
                      int min_cost, int max_cost, int i, int j);
+
+/**
+ *  @brief  Writes rows [first, last) of a deep copy, as get_cost would.
+ *  @param  fun [in] function structure
+ *  @param  base_problem [in] problem structure
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  first [in] first row to write
+ *  @param  last [in] one past the last row to write
+ *  @param  row [out] scratch space for base_problem->size costs
+ *  @param  adj [out] matrix rows; adj[i][j] is written for j < i
+ */
+void
+btsp_basic_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                          int min_cost, int max_cost, int first, int last,
+                          int *row, int **adj);
                
 /**
  *  @brief  Initializes the function data.
@@ -144,7 +160,11 @@ arrow_btsp_fun_basic(int shallow, arrow_btsp_fun *fun)
 {    
     fun->data = NULL;
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_TRUE;
+    fun->incremental = ARROW_TRUE;
+    fun->cache = NULL;
     fun->get_cost = btsp_basic_get_cost;
+    fun->transform_rows = btsp_basic_transform_rows;
     fun->initialize = btsp_basic_initialize;
     fun->destruct = btsp_basic_destruct;
     fun->feasible = btsp_basic_feasible;
@@ -179,7 +199,11 @@ arrow_btsp_fun_shake_1(int shallow, int infinity,
     }
     
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_TRUE;
+    fun->incremental = ARROW_FALSE;
+    fun->cache = NULL;
     fun->get_cost = btsp_shake_1_get_cost;
+    fun->transform_rows = NULL;
     fun->initialize = btsp_shake_1_initialize;
     fun->destruct = btsp_shake_1_destruct;
     fun->feasible = btsp_basic_feasible;
@@ -201,7 +225,11 @@ arrow_btsp_fun_asym_shift(int shallow, int shift, arrow_btsp_fun *fun)
     *shift_data = shift;
         
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_TRUE;
+    fun->incremental = ARROW_TRUE;
+    fun->cache = NULL;
     fun->get_cost = btsp_asym_shift_get_cost;
+    fun->transform_rows = NULL;
     fun->initialize = btsp_basic_initialize;
     fun->destruct = btsp_asym_shift_destruct;
     fun->feasible = btsp_asym_shift_feasible;
@@ -227,6 +255,23 @@ btsp_basic_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
         return cost;
 }
 
+void
+btsp_basic_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                          int min_cost, int max_cost, int first, int last,
+                          int *row, int **adj)
+{
+    /* Negative costs are never in range */
+    int low = (min_cost > 0 ? min_cost : 0);
+    int i;
+    int *costs;
+    
+    for(i = first; i < last; i++)
+    {
+        costs = arrow_btsp_fun_base_row(base_problem, i, row);
+        arrow_btsp_fun_select_row(costs, i, low, max_cost, 0, 0, 1, 0, adj[i]);
+    }
+}
+
 int
 btsp_basic_initialize(arrow_btsp_fun *fun)
 { 
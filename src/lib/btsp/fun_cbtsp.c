@@ -54,6 +54,22 @@ int
 cbtsp_basic_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
                      int min_cost, int max_cost, int i, int j);
 
+/**
+ *  @brief  Writes rows [first, last) of a deep copy, as get_cost would.
+ *  @param  fun [in] function structure
+ *  @param  base_problem [in] problem structure
+ *  @param  min_cost [in] min_cost to consider for active edges
+ *  @param  max_cost [in] max_cost to consider for active edges
+ *  @param  first [in] first row to write
+ *  @param  last [in] one past the last row to write
+ *  @param  row [out] scratch space for base_problem->size costs
+ *  @param  adj [out] matrix rows; adj[i][j] is written for j < i
+ */
+void
+cbtsp_basic_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                           int min_cost, int max_cost, int first, int last,
+                           int *row, int **adj);
+
 /**
  *  @brief  Initializes the function data.
  *  @param  fun [out] the function structure to initialize
@@ -144,7 +160,11 @@ arrow_btsp_fun_cbtsp_basic(int shallow, double feasible_length, int infinity,
     cbtsp_data->feasible_length = feasible_length;
     
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_FALSE;
+    fun->incremental = ARROW_TRUE;
+    fun->cache = NULL;
     fun->get_cost = cbtsp_basic_get_cost;
+    fun->transform_rows = cbtsp_basic_transform_rows;
     fun->initialize = cbtsp_basic_initialize;
     fun->destruct = cbtsp_basic_destruct;
     fun->feasible = cbtsp_basic_feasible;
@@ -181,7 +201,11 @@ arrow_btsp_fun_cbtsp_shake(int shallow, double feasible_length, int infinity,
     }
     
     fun->shallow = shallow;
+    fun->threshold_graph = ARROW_FALSE;
+    fun->incremental = ARROW_FALSE;
+    fun->cache = NULL;
     fun->get_cost = cbtsp_shake_get_cost;
+    fun->transform_rows = NULL;
     fun->initialize = cbtsp_shake_initialize;
     fun->destruct = cbtsp_shake_destruct;
     fun->feasible = cbtsp_shake_feasible;
@@ -206,6 +230,24 @@ cbtsp_basic_get_cost(arrow_btsp_fun *fun, arrow_problem *base_problem,
         return data->infinity;
 }
 
+void
+cbtsp_basic_transform_rows(arrow_btsp_fun *fun, arrow_problem *base_problem,
+                           int min_cost, int max_cost, int first, int last,
+                           int *row, int **adj)
+{
+    cbtsp_basic_data *data = (cbtsp_basic_data *)fun->data;
+    int infinity = data->infinity;
+    int i;
+    int *costs;
+    
+    for(i = first; i < last; i++)
+    {
+        costs = arrow_btsp_fun_base_row(base_problem, i, row);
+        arrow_btsp_fun_select_row(costs, i, min_cost, max_cost, 1, 0, 0,
+                                  infinity, adj[i]);
+    }
+}
+
 int
 cbtsp_basic_initialize(arrow_btsp_fun *fun)
 { 
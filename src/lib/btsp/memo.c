@@ -0,0 +1,229 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Memo of BTSP feasibility verdicts.
+ *
+ * Remembers tours and infeasibility proofs from earlier feasibility
+ * problems so that repeated solves on related thresholds can skip the TSP
+ * solvers.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+#include "btsp.h"
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Makes room for one more entry in the memo.  Must be called with
+ *          the lock held.
+ *  @param  memo [out] memo structure
+ */
+int
+memo_grow(arrow_btsp_memo *memo);
+
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+int
+arrow_btsp_memo_init(arrow_btsp_memo *memo)
+{
+    memo->entries = NULL;
+    memo->num_entries = 0;
+    memo->max_entries = 0;
+    memo->lookups = 0;
+    memo->hits = 0;
+    if(pthread_mutex_init(&(memo->lock), NULL) != 0)
+    {
+        arrow_print_error("Could not create memo lock");
+        return ARROW_FAILURE;
+    }
+    return ARROW_SUCCESS;
+}
+
+void
+arrow_btsp_memo_destruct(arrow_btsp_memo *memo)
+{
+    int i;
+    for(i = 0; i < memo->num_entries; i++)
+    {
+        if(memo->entries[i].tour != NULL)
+            free(memo->entries[i].tour);
+    }
+    if(memo->entries != NULL)
+        free(memo->entries);
+    memo->entries = NULL;
+    memo->num_entries = 0;
+    memo->max_entries = 0;
+    pthread_mutex_destroy(&(memo->lock));
+}
+
+void
+arrow_btsp_memo_lookup(arrow_btsp_memo *memo, arrow_problem *problem,
+                       int kind, int min_cost, int max_cost, int *known,
+                       int *feasible, arrow_btsp_result *result)
+{
+    int i;
+    arrow_btsp_memo_entry *entry;
+    arrow_btsp_memo_entry *best = NULL;
+
+    *known = ARROW_FALSE;
+    *feasible = ARROW_FALSE;
+
+    pthread_mutex_lock(&(memo->lock));
+    memo->lookups++;
+    for(i = 0; i < memo->num_entries; i++)
+    {
+        entry = &(memo->entries[i]);
+        if((entry->problem != problem) || (entry->kind != kind))
+            continue;
+
+        if(entry->tour == NULL)
+        {
+            /* No tour in the refuted window, so none in a window inside it */
+            if((entry->min_cost <= min_cost) && (max_cost <= entry->max_cost))
+            {
+                *known = ARROW_TRUE;
+                best = NULL;
+                break;
+            }
+        }
+        else if((min_cost <= entry->min_cost) && (entry->max_cost <= max_cost))
+        {
+            /* A tour that fits in the window; keep the one with the
+               smallest bottleneck */
+            if((best == NULL) || (entry->max_cost < best->max_cost))
+                best = entry;
+        }
+    }
+
+    if(best != NULL)
+    {
+        *known = ARROW_TRUE;
+        *feasible = ARROW_TRUE;
+        result->found_tour = ARROW_TRUE;
+        result->min_cost = best->min_cost;
+        result->max_cost = best->max_cost;
+        result->tour_length = best->tour_length;
+        if(result->tour != NULL)
+        {
+            for(i = 0; i < problem->size; i++)
+                result->tour[i] = best->tour[i];
+        }
+    }
+    if(*known)
+        memo->hits++;
+    pthread_mutex_unlock(&(memo->lock));
+}
+
+int
+arrow_btsp_memo_add_tour(arrow_btsp_memo *memo, arrow_problem *problem,
+                         int kind, int min_cost, int max_cost,
+                         double tour_length, int *tour)
+{
+    int ret = ARROW_SUCCESS;
+    int i;
+    arrow_btsp_memo_entry *entry;
+
+    pthread_mutex_lock(&(memo->lock));
+
+    /* Skip tours whose window holds one we already know */
+    for(i = 0; i < memo->num_entries; i++)
+    {
+        entry = &(memo->entries[i]);
+        if((entry->problem == problem) && (entry->kind == kind) &&
+           (entry->tour != NULL) && (min_cost <= entry->min_cost) &&
+           (entry->max_cost <= max_cost))
+            goto CLEANUP;
+    }
+
+    if(!memo_grow(memo))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    entry = &(memo->entries[memo->num_entries]);
+    if(!arrow_util_create_int_array(problem->size, &(entry->tour)))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    for(i = 0; i < problem->size; i++)
+        entry->tour[i] = tour[i];
+    entry->problem = problem;
+    entry->kind = kind;
+    entry->min_cost = min_cost;
+    entry->max_cost = max_cost;
+    entry->tour_length = tour_length;
+    memo->num_entries++;
+
+CLEANUP:
+    pthread_mutex_unlock(&(memo->lock));
+    return ret;
+}
+
+int
+arrow_btsp_memo_add_infeasible(arrow_btsp_memo *memo, arrow_problem *problem,
+                               int kind, int min_cost, int max_cost)
+{
+    int ret = ARROW_SUCCESS;
+    int i;
+    arrow_btsp_memo_entry *entry;
+
+    pthread_mutex_lock(&(memo->lock));
+
+    /* Skip windows inside one already refuted */
+    for(i = 0; i < memo->num_entries; i++)
+    {
+        entry = &(memo->entries[i]);
+        if((entry->problem == problem) && (entry->kind == kind) &&
+           (entry->tour == NULL) && (entry->min_cost <= min_cost) &&
+           (max_cost <= entry->max_cost))
+            goto CLEANUP;
+    }
+
+    if(!memo_grow(memo))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    entry = &(memo->entries[memo->num_entries]);
+    entry->problem = problem;
+    entry->kind = kind;
+    entry->min_cost = min_cost;
+    entry->max_cost = max_cost;
+    entry->tour = NULL;
+    entry->tour_length = DBL_MAX;
+    memo->num_entries++;
+
+CLEANUP:
+    pthread_mutex_unlock(&(memo->lock));
+    return ret;
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+int
+memo_grow(arrow_btsp_memo *memo)
+{
+    int max_entries;
+    arrow_btsp_memo_entry *entries;
+
+    if(memo->num_entries < memo->max_entries)
+        return ARROW_SUCCESS;
+
+    max_entries = (memo->max_entries == 0 ? 64 : memo->max_entries * 2);
+    entries = realloc(memo->entries,
+                      max_entries * sizeof(arrow_btsp_memo_entry));
+    if(entries == NULL)
+    {
+        arrow_print_error("Could not allocate memory for memo entries");
+        return ARROW_FAILURE;
+    }
+    memo->entries = entries;
+    memo->max_entries = max_entries;
+    return ARROW_SUCCESS;
+}
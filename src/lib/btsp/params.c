@@ -21,4 +21,13 @@ arrow_btsp_params_init(arrow_btsp_params *params)
     params->lower_bound = 0;
     params->upper_bound = INT_MAX;
     params->num_steps = 0;
+    params->context = NULL;
+    params->threads = 1;
+    params->search = ARROW_BTSP_SEARCH_BISECT;
+    params->memo.memo = NULL;
+    params->memo.base = NULL;
+    params->memo.min_cost = INT_MIN;
+    params->thread_steps = NULL;
+    params->checkpoint = NULL;
+    params->scheduler = NULL;
 }
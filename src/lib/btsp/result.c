@@ -32,6 +32,8 @@ arrow_btsp_result_init(arrow_problem *problem, arrow_btsp_result *result)
         result->solver_attempts[i] = 0;
         result->solver_time[i] = 0.0;
     }
+    for(i = 0; i < ARROW_BTSP_SEARCH_COUNT; i++)
+        result->search_probes[i] = 0;
     
     result->total_time = 0.0;
     return ARROW_SUCCESS;
@@ -91,6 +93,26 @@ arrow_btsp_result_print_xml(arrow_btsp_result *result, FILE *out)
     }
     arrow_xml_element_close("solver_info", out);
     
+    arrow_xml_element_open("search_info", out);
+    for(i = 0; i < ARROW_BTSP_SEARCH_COUNT; i++)
+    {
+        if(result->search_probes[i] > 0)
+        {
+            arrow_xml_element_start("search", out);
+            
+            arrow_xml_attribute_int("search_type", i, out);
+            arrow_xml_attribute_start("search_name", out);
+            arrow_btsp_search_short_name(i, out);
+            arrow_xml_attribute_end(out);
+            arrow_xml_element_end(out);
+            
+            arrow_xml_element_int("probes", result->search_probes[i], out);
+            
+            arrow_xml_element_close("search", out);
+        }
+    }
+    arrow_xml_element_close("search_info", out);
+    
     arrow_xml_element_double("btsp_total_time", result->total_time, out);
 }
 
@@ -112,6 +134,16 @@ arrow_btsp_result_print_pretty(arrow_btsp_result *result, FILE *out)
             (result->optimal == ARROW_TRUE ? "Yes" : "???"));
     fprintf(out, "Binary Search Steps: %d\n", result->bin_search_steps);
     
+    for(i = 0; i < ARROW_BTSP_SEARCH_COUNT; i++)
+    {
+        if(result->search_probes[i] > 0)
+        {
+            fprintf(out, " - ");
+            arrow_btsp_search_long_name(i, out);
+            fprintf(out, " Probes: %d\n", result->search_probes[i]);
+        }
+    }
+    
     fprintf(out, "Solver Information:\n");
     for(i = 0; i < ARROW_TSP_SOLVER_COUNT; i++)
     {
@@ -0,0 +1,196 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Adaptive scheduling of solve plan attempts.
+ *
+ * Keeps track of how often each solve plan step finds a feasible tour and
+ * how long it takes, and picks the step to try next with a bandit rule.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include <math.h>
+#include "common.h"
+#include "btsp.h"
+
+/* Share of the plan's heuristic attempts for probes far from the lower
+   bound */
+#define SCHEDULER_MIN_EFFORT 0.5
+
+/* Weight of the UCB1 exploration bonus.  Scores are divided by time, so
+   the full bonus would keep cheap steps that never succeed in play for a
+   long time. */
+#define SCHEDULER_EXPLORE 0.25
+
+/* Mean attempt times below this are treated as this, so a step that hasn't
+   taken measurable time doesn't get an infinite score */
+#define SCHEDULER_MIN_TIME 1e-3
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+int
+arrow_btsp_scheduler_init(int num_steps, arrow_btsp_scheduler *scheduler)
+{
+    int i;
+
+    scheduler->num_steps = num_steps;
+    scheduler->min_effort = SCHEDULER_MIN_EFFORT;
+    scheduler->decisions = 0;
+    scheduler->skipped = 0;
+    scheduler->attempts = NULL;
+    scheduler->successes = NULL;
+    scheduler->time = NULL;
+
+    if(!arrow_util_create_int_array(num_steps, &(scheduler->attempts)))
+        goto FAILURE;
+    if(!arrow_util_create_int_array(num_steps, &(scheduler->successes)))
+        goto FAILURE;
+    if((scheduler->time = malloc(num_steps * sizeof(double))) == NULL)
+    {
+        arrow_print_error("Could not allocate memory for scheduler times");
+        goto FAILURE;
+    }
+    for(i = 0; i < num_steps; i++)
+    {
+        scheduler->attempts[i] = 0;
+        scheduler->successes[i] = 0;
+        scheduler->time[i] = 0.0;
+    }
+    if(pthread_mutex_init(&(scheduler->lock), NULL) != 0)
+    {
+        arrow_print_error("Could not create scheduler lock");
+        goto FAILURE;
+    }
+    return ARROW_SUCCESS;
+
+FAILURE:
+    if(scheduler->attempts != NULL) free(scheduler->attempts);
+    if(scheduler->successes != NULL) free(scheduler->successes);
+    if(scheduler->time != NULL) free(scheduler->time);
+    scheduler->attempts = NULL;
+    scheduler->successes = NULL;
+    scheduler->time = NULL;
+    return ARROW_FAILURE;
+}
+
+void
+arrow_btsp_scheduler_destruct(arrow_btsp_scheduler *scheduler)
+{
+    pthread_mutex_destroy(&(scheduler->lock));
+    if(scheduler->attempts != NULL) free(scheduler->attempts);
+    if(scheduler->successes != NULL) free(scheduler->successes);
+    if(scheduler->time != NULL) free(scheduler->time);
+    scheduler->attempts = NULL;
+    scheduler->successes = NULL;
+    scheduler->time = NULL;
+}
+
+int
+arrow_btsp_scheduler_pick(arrow_btsp_scheduler *scheduler, int num_steps,
+                          arrow_btsp_solve_plan *steps, int *used)
+{
+    int i, n;
+    int best = -1;
+    int total = 0;
+    double rate, mean_time, score;
+    double best_score = -1.0;
+
+    if(num_steps > scheduler->num_steps)
+        num_steps = scheduler->num_steps;
+
+    pthread_mutex_lock(&(scheduler->lock));
+    for(i = 0; i < num_steps; i++)
+        total += scheduler->attempts[i];
+
+    for(i = 0; i < num_steps; i++)
+    {
+        if((steps[i].tsp_solver == ARROW_TSP_CC_EXACT) ||
+           (used[i] >= steps[i].attempts))
+            continue;
+
+        /* Every step gets tried before any is judged */
+        n = scheduler->attempts[i];
+        if(n == 0)
+        {
+            best = i;
+            break;
+        }
+
+        rate = (scheduler->successes[i] * 1.0) / n
+             + SCHEDULER_EXPLORE * sqrt(2.0 * log(total * 1.0) / n);
+        if(rate > 1.0) rate = 1.0;
+        mean_time = scheduler->time[i] / n;
+        if(mean_time < SCHEDULER_MIN_TIME) mean_time = SCHEDULER_MIN_TIME;
+        score = rate / mean_time;
+
+        /* Ties go to the earlier step, as in the plan */
+        if(score > best_score)
+        {
+            best_score = score;
+            best = i;
+        }
+    }
+    if(best >= 0)
+    {
+        scheduler->decisions++;
+        arrow_debug("Scheduler picked step %d (%d of %d successes, "
+                    "%.2f s per attempt).\n", best + 1,
+                    scheduler->successes[best], scheduler->attempts[best],
+                    (scheduler->attempts[best] > 0
+                        ? scheduler->time[best] / scheduler->attempts[best]
+                        : 0.0));
+    }
+    pthread_mutex_unlock(&(scheduler->lock));
+    return best;
+}
+
+void
+arrow_btsp_scheduler_update(arrow_btsp_scheduler *scheduler, int step,
+                            int success, double time)
+{
+    if((step < 0) || (step >= scheduler->num_steps))
+        return;
+    pthread_mutex_lock(&(scheduler->lock));
+    scheduler->attempts[step]++;
+    if(success)
+        scheduler->successes[step]++;
+    scheduler->time[step] += time;
+    pthread_mutex_unlock(&(scheduler->lock));
+}
+
+void
+arrow_btsp_scheduler_skip(arrow_btsp_scheduler *scheduler, int skipped)
+{
+    if(skipped <= 0)
+        return;
+    pthread_mutex_lock(&(scheduler->lock));
+    scheduler->skipped += skipped;
+    pthread_mutex_unlock(&(scheduler->lock));
+}
+
+void
+arrow_btsp_scheduler_print_xml(arrow_btsp_scheduler *scheduler, FILE *out)
+{
+    int i;
+    double avg_time;
+
+    pthread_mutex_lock(&(scheduler->lock));
+    arrow_xml_element_open("scheduler_info", out);
+    arrow_xml_element_int("decisions", scheduler->decisions, out);
+    arrow_xml_element_int("skipped_attempts", scheduler->skipped, out);
+    for(i = 0; i < scheduler->num_steps; i++)
+    {
+        arrow_xml_element_start("step", out);
+        arrow_xml_attribute_int("number", i + 1, out);
+        arrow_xml_element_end(out);
+
+        avg_time = (scheduler->attempts[i] > 0
+                    ? scheduler->time[i] / scheduler->attempts[i] : 0.0);
+        arrow_xml_element_int("attempts", scheduler->attempts[i], out);
+        arrow_xml_element_int("successes", scheduler->successes[i], out);
+        arrow_xml_element_double("avg_time", avg_time, out);
+
+        arrow_xml_element_close("step", out);
+    }
+    arrow_xml_element_close("scheduler_info", out);
+    pthread_mutex_unlock(&(scheduler->lock));
+}
@@ -0,0 +1,261 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Threshold search strategies for the BTSP binary search.
+ *
+ * Strategies for choosing which cost to try next when searching the cost
+ * list for the smallest feasible threshold.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+#include "btsp.h"
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Counts the edges at each cost in the cost list, accumulated so
+ *          that edge_counts[i] is the number of edges costing at most
+ *          cost_list[i].  Edges costing outside [info->min_cost,
+ *          info->max_cost] are skipped, such as the infinite edges of the
+ *          symmetric transformation of an asymmetric problem.
+ *  @param  problem [in] problem to count edges in
+ *  @param  info [in] extra problem info (may be for the problem before it
+ *              was transformed)
+ *  @param  edge_counts [out] array of info->cost_list_length counts
+ */
+int
+search_count_edges(arrow_problem *problem, arrow_problem_info *info,
+                   long long *edge_counts);
+
+/**
+ *  @brief  Picks the middle of [low, high).
+ *  @param  low [in] lowest cost index still possible
+ *  @param  high [in] cost index of the best known tour
+ *  @return cost index to probe
+ */
+int
+search_bisect(int low, int high);
+
+/**
+ *  @brief  Picks the cost index whose cost is halfway between the costs at
+ *          low and high.
+ *  @param  search [in] search structure
+ *  @param  low [in] lowest cost index still possible
+ *  @param  high [in] cost index of the best known tour
+ *  @return cost index to probe
+ */
+int
+search_interpolate(arrow_btsp_search *search, int low, int high);
+
+/**
+ *  @brief  Picks the cost index that splits the edges costing between the
+ *          costs at low and high in half.
+ *  @param  search [in] search structure
+ *  @param  low [in] lowest cost index still possible
+ *  @param  high [in] cost index of the best known tour
+ *  @return cost index to probe
+ */
+int
+search_quantile(arrow_btsp_search *search, int low, int high);
+
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+int
+arrow_btsp_search_init(int strategy, arrow_problem *problem,
+                       arrow_problem_info *info, arrow_btsp_search *search)
+{
+    search->strategy = strategy;
+    search->current = strategy;
+    search->step = 1;
+    search->info = info;
+    search->edge_counts = NULL;
+
+    switch(strategy)
+    {
+        case ARROW_BTSP_SEARCH_BISECT:
+        case ARROW_BTSP_SEARCH_GALLOP:
+        case ARROW_BTSP_SEARCH_INTERPOLATE:
+            break;
+        case ARROW_BTSP_SEARCH_QUANTILE:
+            search->edge_counts =
+                malloc(info->cost_list_length * sizeof(long long));
+            if(search->edge_counts == NULL)
+            {
+                arrow_print_error("Could not allocate memory for edge counts");
+                return ARROW_FAILURE;
+            }
+            if(!search_count_edges(problem, info, search->edge_counts))
+            {
+                free(search->edge_counts);
+                search->edge_counts = NULL;
+                return ARROW_FAILURE;
+            }
+            break;
+        default:
+            arrow_print_error("Search strategy %d not supported", strategy);
+            return ARROW_FAILURE;
+    }
+    return ARROW_SUCCESS;
+}
+
+void
+arrow_btsp_search_destruct(arrow_btsp_search *search)
+{
+    if(search->edge_counts != NULL)
+    {
+        free(search->edge_counts);
+        search->edge_counts = NULL;
+    }
+}
+
+int
+arrow_btsp_search_next(arrow_btsp_search *search, int low, int high)
+{
+    int probe;
+
+    switch(search->current)
+    {
+        case ARROW_BTSP_SEARCH_GALLOP:
+            probe = low + search->step - 1;
+            break;
+        case ARROW_BTSP_SEARCH_INTERPOLATE:
+            probe = search_interpolate(search, low, high);
+            break;
+        case ARROW_BTSP_SEARCH_QUANTILE:
+            probe = search_quantile(search, low, high);
+            break;
+        default:
+            probe = search_bisect(low, high);
+    }
+
+    /* Every strategy must make progress, so never probe high itself */
+    if(probe >= high) probe = high - 1;
+    if(probe < low) probe = low;
+    return probe;
+}
+
+void
+arrow_btsp_search_update(arrow_btsp_search *search, int feasible)
+{
+    if(search->current != ARROW_BTSP_SEARCH_GALLOP)
+        return;
+
+    /* Gallop until the optimum is bracketed, then bisect what is left */
+    if(feasible)
+        search->current = ARROW_BTSP_SEARCH_BISECT;
+    else
+        search->step *= 2;
+}
+
+void
+arrow_btsp_search_short_name(int strategy, FILE *out)
+{
+    switch(strategy)
+    {
+        case ARROW_BTSP_SEARCH_BISECT:
+            fprintf(out, "bisect"); break;
+        case ARROW_BTSP_SEARCH_GALLOP:
+            fprintf(out, "gallop"); break;
+        case ARROW_BTSP_SEARCH_INTERPOLATE:
+            fprintf(out, "interpolate"); break;
+        case ARROW_BTSP_SEARCH_QUANTILE:
+            fprintf(out, "quantile"); break;
+        default:
+            arrow_print_error("Search strategy %d not supported", strategy);
+    }
+}
+
+void
+arrow_btsp_search_long_name(int strategy, FILE *out)
+{
+    switch(strategy)
+    {
+        case ARROW_BTSP_SEARCH_BISECT:
+            fprintf(out, "Bisection"); break;
+        case ARROW_BTSP_SEARCH_GALLOP:
+            fprintf(out, "Galloping"); break;
+        case ARROW_BTSP_SEARCH_INTERPOLATE:
+            fprintf(out, "Cost Interpolation"); break;
+        case ARROW_BTSP_SEARCH_QUANTILE:
+            fprintf(out, "Edge-Count Quantile"); break;
+        default:
+            arrow_print_error("Search strategy %d not supported", strategy);
+    }
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+int
+search_count_edges(arrow_problem *problem, arrow_problem_info *info,
+                   long long *edge_counts)
+{
+    int i, j, cost, pos;
+
+    for(i = 0; i < info->cost_list_length; i++)
+        edge_counts[i] = 0;
+
+    for(i = 0; i < problem->size; i++)
+    {
+        for(j = (problem->symmetric ? i + 1 : 0); j < problem->size; j++)
+        {
+            if(i == j) continue;
+
+            /* A hash lookup of a cost that isn't in the list gives back an
+               arbitrary index, so never ask about one */
+            cost = problem->get_cost(problem, i, j);
+            if((cost < info->min_cost) || (cost > info->max_cost))
+                continue;
+            if(!arrow_problem_info_cost_index(info, cost, &pos))
+                return ARROW_FAILURE;
+            edge_counts[pos]++;
+        }
+    }
+
+    for(i = 1; i < info->cost_list_length; i++)
+        edge_counts[i] += edge_counts[i - 1];
+    return ARROW_SUCCESS;
+}
+
+int
+search_bisect(int low, int high)
+{
+    return ((high - low) / 2) + low;
+}
+
+int
+search_interpolate(arrow_btsp_search *search, int low, int high)
+{
+    int pos;
+    int *cost_list = search->info->cost_list;
+    long long span = (long long)cost_list[high] - cost_list[low];
+    int target = (int)(cost_list[low] + (span + 1) / 2);
+
+    /* The first cost at or above the target; binary search leaves pos at
+       the insertion point when the target isn't a cost itself */
+    arrow_util_binary_search(cost_list + low, high - low + 1, target, &pos);
+    return low + pos;
+}
+
+int
+search_quantile(arrow_btsp_search *search, int low, int high)
+{
+    int mid;
+    long long below = (low > 0 ? search->edge_counts[low - 1] : 0);
+    long long target = below + (search->edge_counts[high] - below) / 2;
+
+    /* Smallest index in [low, high) with at least target edges below it */
+    while(low < high)
+    {
+        mid = ((high - low) / 2) + low;
+        if(search->edge_counts[mid] >= target)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    return low;
+}
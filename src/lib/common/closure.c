@@ -0,0 +1,385 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Bottleneck (minimax) path closure of a cost matrix.
+ *
+ * A Floyd-Warshall pass over the (min, max) semiring, done one square tile
+ * at a time so the three tiles being worked on stay in cache.  For each
+ * diagonal tile k, the tile itself is closed first, then the rest of its
+ * row and column of tiles, and then every remaining tile, which only reads
+ * the row and column just finished.  The tiles of the last two phases are
+ * shared out between threads.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+
+/* Tiles have an AVX2 kernel on x86 GCC builds; which kernel runs is
+   decided at run time so the library still works on older CPUs. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define CLOSURE_HAVE_AVX2
+    #include <immintrin.h>
+#endif
+
+/* Edge length of a tile; three tiles of ints fit in a typical L2 cache */
+#define CLOSURE_BLOCK 64
+
+/* Matrices smaller than this are closed on the calling thread alone */
+#define CLOSURE_THREAD_SIZE 384
+
+/* Upper limit on threads, however many processors there are */
+#define CLOSURE_MAX_THREADS 64
+
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  Kernel that updates one tile.
+ */
+typedef void
+(*closure_tile_fun)(int *matrix, int n, int ib, int jb, int kb);
+
+/**
+ *  @brief  Tiles shared between the threads closing a matrix.
+ */
+typedef struct closure_job
+{
+    pthread_mutex_t lock;       /**< guards the rest of the structure */
+    pthread_cond_t cond;        /**< signalled when a phase is finished */
+    int *matrix;                /**< matrix being closed */
+    closure_tile_fun tile;      /**< tile kernel for this CPU */
+    int n;                      /**< number of rows (and columns) */
+    int tiles;                  /**< number of tiles along each side */
+    int threads;                /**< number of threads working */
+    int next;                   /**< next tile of the phase to hand out */
+    int waiting;                /**< threads done with the phase */
+    int generation;             /**< number of phases finished */
+} closure_job;
+
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Closes one phase's worth of tiles, then the next phase, until
+ *          the whole matrix is done.
+ *  @param  arg [out] closure job (closure_job *)
+ *  @return NULL
+ */
+void *
+closure_worker(void *arg);
+
+/**
+ *  @brief  Waits until every thread is done with the current phase.  Must
+ *          be called with the job locked.
+ *  @param  job [out] closure job
+ */
+void
+closure_barrier(closure_job *job);
+
+/**
+ *  @brief  Updates one task of a phase.
+ *  @param  job [out] closure job
+ *  @param  kb [in] diagonal tile of the current round
+ *  @param  step [in] phase of the round (0: the diagonal tile, 1: its row
+ *              and column of tiles, 2: every other tile)
+ *  @param  task [in] which tile of the phase to update
+ */
+void
+closure_task(closure_job *job, int kb, int step, int task);
+
+/**
+ *  @brief  Updates tile (ib, jb) with paths through the nodes of tile kb:
+ *          c_ij = min(c_ij, max(c_ik, c_kj)).  Works on any CPU.
+ *  @param  matrix [out] matrix being closed
+ *  @param  n [in] number of rows (and columns)
+ *  @param  ib [in] row of the tile
+ *  @param  jb [in] column of the tile
+ *  @param  kb [in] tile of intermediate nodes
+ */
+void
+closure_tile_scalar(int *matrix, int n, int ib, int jb, int kb);
+
+#ifdef CLOSURE_HAVE_AVX2
+/**
+ *  @brief  Updates a tile as closure_tile_scalar does, eight entries of a
+ *          row at a time with AVX2.
+ */
+void
+closure_tile_avx2(int *matrix, int n, int ib, int jb, int kb)
+    __attribute__((target("avx2")));
+#endif
+
+/**
+ *  @brief  Picks the fastest tile kernel the CPU supports.
+ *  @return tile kernel
+ */
+closure_tile_fun
+closure_select_tile();
+
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+int
+arrow_closure_minimax(int n, int *matrix, int threads)
+{
+    int i, started;
+    long processors;
+    pthread_t *thread_ids = NULL;
+    closure_job job;
+
+    if(n <= 1)
+        return ARROW_SUCCESS;
+
+    job.matrix = matrix;
+    job.tile = closure_select_tile();
+    job.n = n;
+    job.tiles = (n + CLOSURE_BLOCK - 1) / CLOSURE_BLOCK;
+    job.next = 0;
+    job.waiting = 0;
+    job.generation = 0;
+
+    /* More threads than tiles in a row or column would sit idle */
+    if(threads <= 0)
+    {
+        processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (processors > 1 ? (int)processors : 1);
+    }
+    if(threads > CLOSURE_MAX_THREADS) threads = CLOSURE_MAX_THREADS;
+    if(threads > job.tiles - 1) threads = job.tiles - 1;
+    if((n < CLOSURE_THREAD_SIZE) || (threads < 1)) threads = 1;
+
+    if(pthread_mutex_init(&(job.lock), NULL) != 0)
+    {
+        arrow_print_error("Could not create closure lock");
+        return ARROW_FAILURE;
+    }
+    if(pthread_cond_init(&(job.cond), NULL) != 0)
+    {
+        arrow_print_error("Could not create closure condition");
+        pthread_mutex_destroy(&(job.lock));
+        return ARROW_FAILURE;
+    }
+
+    /* Threads that don't start just leave more tiles for the others; the
+       lock keeps them all waiting until the count is known */
+    started = 0;
+    if(threads > 1)
+    {
+        if((thread_ids = malloc((threads - 1) * sizeof(pthread_t))) == NULL)
+            arrow_debug("Could not allocate closure threads\n");
+    }
+    pthread_mutex_lock(&(job.lock));
+    if(thread_ids != NULL)
+    {
+        for(i = 0; i < threads - 1; i++)
+        {
+            if(pthread_create(&(thread_ids[started]), NULL, closure_worker,
+                              &job) == 0)
+                started++;
+        }
+    }
+    job.threads = started + 1;
+    pthread_mutex_unlock(&(job.lock));
+
+    closure_worker(&job);
+    for(i = 0; i < started; i++)
+        pthread_join(thread_ids[i], NULL);
+
+    if(thread_ids != NULL) free(thread_ids);
+    pthread_cond_destroy(&(job.cond));
+    pthread_mutex_destroy(&(job.lock));
+    return ARROW_SUCCESS;
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+void *
+closure_worker(void *arg)
+{
+    closure_job *job = (closure_job *)arg;
+    int phase, kb, step, count, task;
+    int others = job->tiles - 1;
+
+    pthread_mutex_lock(&(job->lock));
+    for(phase = 0; phase < 3 * job->tiles; phase++)
+    {
+        kb = phase / 3;
+        step = phase % 3;
+        if(step == 0)
+            count = 1;
+        else if(step == 1)
+            count = 2 * others;
+        else
+            count = others * others;
+
+        while(job->next < count)
+        {
+            task = job->next++;
+            pthread_mutex_unlock(&(job->lock));
+            closure_task(job, kb, step, task);
+            pthread_mutex_lock(&(job->lock));
+        }
+        closure_barrier(job);
+    }
+    pthread_mutex_unlock(&(job->lock));
+    return NULL;
+}
+
+void
+closure_barrier(closure_job *job)
+{
+    int generation = job->generation;
+
+    job->waiting++;
+    if(job->waiting == job->threads)
+    {
+        job->waiting = 0;
+        job->next = 0;
+        job->generation++;
+        pthread_cond_broadcast(&(job->cond));
+    }
+    else
+    {
+        while(generation == job->generation)
+            pthread_cond_wait(&(job->cond), &(job->lock));
+    }
+}
+
+void
+closure_task(closure_job *job, int kb, int step, int task)
+{
+    int ib, jb;
+    int others = job->tiles - 1;
+
+    if(step == 0)
+    {
+        ib = kb;
+        jb = kb;
+    }
+    else if(step == 1)
+    {
+        /* The first half of the tasks are the row, the rest the column */
+        if(task < others)
+        {
+            ib = kb;
+            jb = (task < kb ? task : task + 1);
+        }
+        else
+        {
+            task -= others;
+            ib = (task < kb ? task : task + 1);
+            jb = kb;
+        }
+    }
+    else
+    {
+        ib = task / others;
+        jb = task % others;
+        if(ib >= kb) ib++;
+        if(jb >= kb) jb++;
+    }
+    job->tile(job->matrix, job->n, ib, jb, kb);
+}
+
+void
+closure_tile_scalar(int *matrix, int n, int ib, int jb, int kb)
+{
+    int i, j, k, a, path, width;
+    int *row;
+    int via[CLOSURE_BLOCK];
+    int i_start = ib * CLOSURE_BLOCK;
+    int j_start = jb * CLOSURE_BLOCK;
+    int k_start = kb * CLOSURE_BLOCK;
+    int i_end = (i_start + CLOSURE_BLOCK < n ? i_start + CLOSURE_BLOCK : n);
+    int j_end = (j_start + CLOSURE_BLOCK < n ? j_start + CLOSURE_BLOCK : n);
+    int k_end = (k_start + CLOSURE_BLOCK < n ? k_start + CLOSURE_BLOCK : n);
+
+    width = j_end - j_start;
+    for(k = k_start; k < k_end; k++)
+    {
+        /* A private copy of row k can't overlap the row being updated, so
+           the compiler is free to turn the inner loop into vector min/max
+           instructions */
+        memcpy(via, matrix + k * n + j_start, width * sizeof(int));
+        for(i = i_start; i < i_end; i++)
+        {
+            row = matrix + i * n + j_start;
+            a = matrix[i * n + k];
+            if(width == CLOSURE_BLOCK)
+            {
+                /* A fixed trip count vectorizes even at -O2 */
+                for(j = 0; j < CLOSURE_BLOCK; j++)
+                {
+                    path = (a > via[j] ? a : via[j]);
+                    row[j] = (path < row[j] ? path : row[j]);
+                }
+            }
+            else
+            {
+                for(j = 0; j < width; j++)
+                {
+                    path = (a > via[j] ? a : via[j]);
+                    row[j] = (path < row[j] ? path : row[j]);
+                }
+            }
+        }
+    }
+}
+
+#ifdef CLOSURE_HAVE_AVX2
+void
+closure_tile_avx2(int *matrix, int n, int ib, int jb, int kb)
+{
+    int i, j, k, a, path, width;
+    int *row;
+    int via[CLOSURE_BLOCK];
+    int i_start = ib * CLOSURE_BLOCK;
+    int j_start = jb * CLOSURE_BLOCK;
+    int k_start = kb * CLOSURE_BLOCK;
+    int i_end = (i_start + CLOSURE_BLOCK < n ? i_start + CLOSURE_BLOCK : n);
+    int j_end = (j_start + CLOSURE_BLOCK < n ? j_start + CLOSURE_BLOCK : n);
+    int k_end = (k_start + CLOSURE_BLOCK < n ? k_start + CLOSURE_BLOCK : n);
+    __m256i a8, path8, row8;
+
+    width = j_end - j_start;
+    for(k = k_start; k < k_end; k++)
+    {
+        /* Row k is copied for the same reason as in the scalar kernel: it
+           may be one of the rows being updated */
+        memcpy(via, matrix + k * n + j_start, width * sizeof(int));
+        for(i = i_start; i < i_end; i++)
+        {
+            row = matrix + i * n + j_start;
+            a = matrix[i * n + k];
+            a8 = _mm256_set1_epi32(a);
+            for(j = 0; j + 8 <= width; j += 8)
+            {
+                path8 = _mm256_max_epi32(a8,
+                            _mm256_loadu_si256((__m256i *)(via + j)));
+                row8 = _mm256_loadu_si256((__m256i *)(row + j));
+                _mm256_storeu_si256((__m256i *)(row + j),
+                                    _mm256_min_epi32(path8, row8));
+            }
+            for(; j < width; j++)
+            {
+                path = (a > via[j] ? a : via[j]);
+                row[j] = (path < row[j] ? path : row[j]);
+            }
+        }
+    }
+}
+#endif
+
+closure_tile_fun
+closure_select_tile()
+{
+#ifdef CLOSURE_HAVE_AVX2
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return closure_tile_avx2;
+#endif
+    return closure_tile_scalar;
+}
@@ -0,0 +1,124 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Solve context implementation.
+ *
+ * Deadlines, cancellation, progress reporting and shared lower bounds
+ * passed between a caller and the solvers it runs.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+void
+arrow_context_init(arrow_context *context)
+{
+    context->deadline = 0.0;
+    context->cancel = ARROW_FALSE;
+    context->lower_bound = INT_MIN;
+    context->progress = NULL;
+    context->progress_data = NULL;
+    context->parent = NULL;
+}
+
+void
+arrow_context_init_child(arrow_context *context, arrow_context *parent)
+{
+    arrow_context_init(context);
+    context->parent = parent;
+}
+
+void
+arrow_context_set_timebound(arrow_context *context, double timebound)
+{
+    if(timebound > 0.0)
+        context->deadline = arrow_util_real_zeit() + timebound;
+    else
+        context->deadline = 0.0;
+}
+
+void
+arrow_context_cancel(arrow_context *context)
+{
+    context->cancel = ARROW_TRUE;
+}
+
+int
+arrow_context_should_stop(arrow_context *context)
+{
+    for(; context != NULL; context = context->parent)
+    {
+        if(context->cancel)
+            return ARROW_TRUE;
+        if((context->deadline > 0.0) &&
+           (arrow_util_real_zeit() >= context->deadline))
+            return ARROW_TRUE;
+    }
+    return ARROW_FALSE;
+}
+
+double
+arrow_context_remaining(arrow_context *context)
+{
+    double remaining = DBL_MAX;
+    double left;
+
+    for(; context != NULL; context = context->parent)
+    {
+        if(context->cancel)
+            return 0.0;
+        if(context->deadline > 0.0)
+        {
+            left = context->deadline - arrow_util_real_zeit();
+            if(left < remaining)
+                remaining = left;
+        }
+    }
+    return (remaining > 0.0 ? remaining : 0.0);
+}
+
+void
+arrow_context_raise_lower_bound(arrow_context *context, int value)
+{
+    if(value > context->lower_bound)
+        context->lower_bound = value;
+}
+
+int
+arrow_context_lower_bound(arrow_context *context)
+{
+    int bound = INT_MIN;
+
+    for(; context != NULL; context = context->parent)
+    {
+        if(context->lower_bound > bound)
+            bound = context->lower_bound;
+    }
+    return bound;
+}
+
+int
+arrow_context_floor_index(arrow_context *context, int *cost_list, int low,
+                          int high)
+{
+    int pos;
+    int bound = arrow_context_lower_bound(context);
+
+    if((low >= high) || (cost_list[low] >= bound))
+        return low;
+
+    /* Binary search leaves pos at the first cost at or above the bound, or
+       at the end of the range if every cost is below it */
+    arrow_util_binary_search(cost_list + low, high - low + 1, bound, &pos);
+    return low + pos;
+}
+
+void
+arrow_context_progress(arrow_context *context, const char *stage,
+                       int lower, int upper)
+{
+    if((context != NULL) && (context->progress != NULL))
+        context->progress(context, stage, lower, upper);
+}
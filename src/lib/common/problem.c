@@ -9,6 +9,18 @@
  ****************************************************************************/
 #include "common.h"
 
+/* Problems with fewer edges than this are analyzed on the calling thread */
+#define ANALYSIS_THREAD_EDGES 262144
+
+/* Upper limit on analysis threads, however many processors there are */
+#define ANALYSIS_MAX_THREADS 64
+
+/* Rows handed to an analysis thread at a time */
+#define ANALYSIS_ROWS 16
+
+/* Starting size of each thread's table of costs (a power of two) */
+#define ANALYSIS_MIN_TABLE 1024
+
 /****************************************************************************
  * Private structures
  ****************************************************************************/
@@ -30,6 +42,44 @@ typedef struct mstsp_data
     int max_cost;
 } mstsp_data;
 
+/**
+ *  @brief  A cost and how many edges have it.
+ */
+typedef struct analysis_cost
+{
+    int cost;       /**< the cost */
+    int count;      /**< number of edges with the cost */
+} analysis_cost;
+
+/**
+ *  @brief  Rows of the cost matrix still to be swept.
+ */
+typedef struct analysis_job
+{
+    pthread_mutex_t lock;   /**< guards next */
+    int next;               /**< first row not yet handed out */
+    arrow_problem *problem; /**< problem being analyzed */
+} analysis_job;
+
+/**
+ *  @brief  What one thread has found in the rows it swept.
+ */
+typedef struct analysis_part
+{
+    analysis_job *job;      /**< rows still to be swept */
+    analysis_cost *costs;   /**< hash table of costs seen (empty slots have
+                                 a count of 0) */
+    int length;             /**< number of distinct costs seen */
+    int bits;               /**< the table has 2^bits slots */
+    int *min_out;           /**< smallest cost out of each node seen */
+    int *next_out;          /**< second smallest cost out of each node seen */
+    int *min_in;            /**< smallest cost into each node seen */
+    int *max_out;           /**< largest cost out of each node seen */
+    int *next_max_out;      /**< second largest cost out of each node seen */
+    int *max_in;            /**< largest cost into each node seen */
+    int failed;             /**< ARROW_TRUE if memory ran out */
+} analysis_part;
+
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
@@ -133,6 +183,131 @@ mstsp_get_cost(arrow_problem *problem, int i, int j);
 void
 mstsp_destruct(arrow_problem *problem);
 
+/**
+ *  @brief  Allocates an analysis and its per-node arrays.
+ *  @param  size [in] number of nodes
+ *  @param  length [in] number of distinct costs
+ *  @param  analysis [out] the new analysis
+ */
+int
+analysis_create(int size, int length, arrow_problem_analysis **analysis);
+
+/**
+ *  @brief  Frees an analysis and its arrays.
+ *  @param  analysis [in] the analysis
+ */
+void
+analysis_destruct(arrow_problem_analysis *analysis);
+
+/**
+ *  @brief  Allocates a thread's share of the sweep.
+ *  @param  job [in] rows to be swept
+ *  @param  size [in] number of nodes
+ *  @param  part [out] the thread's share
+ */
+int
+analysis_part_init(analysis_job *job, int size, analysis_part *part);
+
+/**
+ *  @brief  Frees a thread's share of the sweep.
+ *  @param  part [out] the thread's share
+ */
+void
+analysis_part_destruct(analysis_part *part);
+
+/**
+ *  @brief  Sweeps rows of the cost matrix until there are none left.
+ *  @param  arg [out] the thread's share (analysis_part *)
+ *  @return NULL
+ */
+void *
+analysis_worker(void *arg);
+
+/**
+ *  @brief  Makes sure the table of costs stays at most half full with
+ *          another row of costs in it, doubling it if need be.
+ *  @param  part [out] the thread's share
+ *  @param  room [in] number of costs to make room for
+ */
+int
+analysis_reserve(analysis_part *part, int room);
+
+/**
+ *  @brief  Adds one to the count of edges with a cost.
+ *  @param  costs [out] hash table of costs
+ *  @param  bits [in] the table has 2^bits slots
+ *  @param  cost [in] the cost
+ *  @param  count [in] number of edges to add
+ *  @return ARROW_TRUE if the cost is new to the table
+ */
+int
+analysis_count(analysis_cost *costs, int bits, int cost, int count);
+
+/**
+ *  @brief  Sorts a list of costs and merges repeats, adding their counts.
+ *  @param  costs [out] the list of costs
+ *  @param  length [out] length of the list, before and after
+ */
+void
+analysis_compact(analysis_cost *costs, int *length);
+
+/**
+ *  @brief  Orders costs from smallest to largest.
+ */
+int
+analysis_cost_compare(const void *a, const void *b);
+
+/**
+ *  @brief  Keeps the two smallest values seen.
+ *  @param  first [out] smallest value so far
+ *  @param  second [out] second smallest value so far
+ *  @param  cost [in] new value
+ */
+void
+analysis_low(int *first, int *second, int cost);
+
+/**
+ *  @brief  Keeps the two largest values seen.
+ *  @param  first [out] largest value so far
+ *  @param  second [out] second largest value so far
+ *  @param  cost [in] new value
+ */
+void
+analysis_high(int *first, int *second, int cost);
+
+/**
+ *  @brief  Works out the 2-max bound from the per-node costs.
+ *  @param  size [in] number of nodes
+ *  @param  symmetric [in] if the problem is symmetric
+ *  @param  analysis [in] the analysis
+ *  @return the 2-max bound
+ */
+int
+analysis_two_max(int size, int symmetric, arrow_problem_analysis *analysis);
+
+/**
+ *  @brief  Builds the analysis of the MSTSP->BTSP problem with costs
+ *          max_cost - c_ij out of the analysis of the original problem.
+ *  @param  base [in] analysis of the original problem
+ *  @param  size [in] number of nodes
+ *  @param  symmetric [in] if the problem is symmetric
+ *  @param  max_cost [in] the cost the original costs are taken from
+ *  @param  analysis [out] analysis of the new problem
+ */
+int
+analysis_mirror(arrow_problem_analysis *base, int size, int symmetric,
+                int max_cost, arrow_problem_analysis **analysis);
+
+/**
+ *  @brief  Returns max_cost - cost, taking "no cost" (INT_MIN or INT_MAX)
+ *          to the other end.
+ *  @param  max_cost [in] the cost the original costs are taken from
+ *  @param  cost [in] original cost
+ *  @return the mirrored cost
+ */
+int
+analysis_flip(int max_cost, int cost);
+
 
 /****************************************************************************
  * Public function implementations
@@ -180,58 +355,214 @@ arrow_problem_destruct(arrow_problem *problem)
         problem->destruct(problem);
         problem->data = NULL;
     }
+    if(problem->analysis != NULL)
+    {
+        analysis_destruct(problem->analysis);
+        problem->analysis = NULL;
+    }
 }
 
 int
-arrow_problem_info_get(arrow_problem *problem, int create_hash,
-                       arrow_problem_info *info)
+arrow_problem_analyze(arrow_problem *problem,
+                      arrow_problem_analysis **analysis)
 {
-    arrow_bintree tree;
-    int ret;
-    int i, j;
-    int cost, min_cost, max_cost;
-    
-    ret = ARROW_SUCCESS;
-    arrow_bintree_init(&tree);
-    min_cost = INT_MAX;
-    max_cost = INT_MIN;
-        
-    for(i = 0; i < problem->size; i++)
+    int ret = ARROW_SUCCESS;
+    int i, u, threads, started, length;
+    int n = problem->size;
+    long processors;
+    analysis_job job;
+    analysis_part *parts = NULL;
+    analysis_cost *costs = NULL;
+    pthread_t *thread_ids = NULL;
+    arrow_problem_analysis *result = NULL;
+
+    /* A cost matrix function can be applied again with new random numbers
+       or a new window under a shallow problem, so its costs are swept anew
+       every time */
+    if((problem->analysis != NULL) &&
+       (problem->type != ARROW_PROBLEM_DATA_BTSP_FUN))
     {
-        j = (problem->symmetric == ARROW_TRUE ? i + 1 : 0);
-        for(; j < problem->size; j++)
+        *analysis = problem->analysis;
+        return ARROW_SUCCESS;
+    }
+    job.next = 0;
+    job.problem = problem;
+
+    /* Cost functions of BTSP transformations can keep state, so only
+       problems read from files (or built on them) are swept in parallel */
+    threads = 1;
+    if((n * (n - 1.0) >= ANALYSIS_THREAD_EDGES) &&
+       (problem->type != ARROW_PROBLEM_DATA_BTSP_FUN))
+    {
+        processors = sysconf(_SC_NPROCESSORS_ONLN);
+        if(processors > 1) threads = (int)processors;
+        if(threads > ANALYSIS_MAX_THREADS) threads = ANALYSIS_MAX_THREADS;
+        if(threads > (n + ANALYSIS_ROWS - 1) / ANALYSIS_ROWS)
+            threads = (n + ANALYSIS_ROWS - 1) / ANALYSIS_ROWS;
+    }
+
+    if((parts = calloc(threads, sizeof(analysis_part))) == NULL)
+    {
+        arrow_print_error("Could not allocate memory for analysis");
+        return ARROW_FAILURE;
+    }
+    for(i = 0; i < threads; i++)
+    {
+        if(!analysis_part_init(&job, n, &(parts[i])))
         {
-            if(i != j)
+            threads = i;
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+    }
+    if(pthread_mutex_init(&(job.lock), NULL) != 0)
+    {
+        arrow_print_error("Could not create analysis lock");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+
+    /* Threads that don't start just leave more rows for the others */
+    started = 0;
+    if(threads > 1)
+    {
+        if((thread_ids = malloc((threads - 1) * sizeof(pthread_t))) != NULL)
+        {
+            for(i = 1; i < threads; i++)
             {
-                /* Add to binary tree */
-                cost = problem->get_cost(problem, i, j);
-                ret = arrow_bintree_insert(&tree, cost);
-                if(ret != ARROW_SUCCESS) goto CLEANUP;
-            
-                /* Determine min and max costs */
-                if(cost < min_cost) min_cost = cost;
-                if(cost > max_cost) max_cost = cost;
+                if(pthread_create(&(thread_ids[started]), NULL,
+                                  analysis_worker, &(parts[i])) == 0)
+                    started++;
             }
         }
     }
+    analysis_worker(&(parts[0]));
+    for(i = 0; i < started; i++)
+        pthread_join(thread_ids[i], NULL);
+    pthread_mutex_destroy(&(job.lock));
+
+    /* Pool the costs every thread found */
+    length = 0;
+    for(i = 0; i < threads; i++)
+    {
+        if(parts[i].failed)
+        {
+            arrow_print_error("Could not allocate memory for analysis");
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        length += parts[i].length;
+    }
+    if((costs = malloc((length > 0 ? length : 1) * sizeof(analysis_cost)))
+        == NULL)
+    {
+        arrow_print_error("Could not allocate memory for analysis");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    length = 0;
+    for(i = 0; i < threads; i++)
+    {
+        for(u = 0; u < (1 << parts[i].bits); u++)
+        {
+            if(parts[i].costs[u].count > 0)
+                costs[length++] = parts[i].costs[u];
+        }
+    }
+    analysis_compact(costs, &length);
+
+    if(!analysis_create(n, length, &result))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    for(i = 0; i < length; i++)
+    {
+        result->cost_list[i] = costs[i].cost;
+        result->cost_count[i] = costs[i].count;
+    }
+    result->cost_list_length = length;
+    result->min_cost = (length > 0 ? costs[0].cost : INT_MAX);
+    result->max_cost = (length > 0 ? costs[length - 1].cost : INT_MIN);
+
+    /* And what they saw of every node */
+    for(u = 0; u < n; u++)
+    {
+        result->min_out[u] = INT_MAX;
+        result->next_out[u] = INT_MAX;
+        result->min_in[u] = INT_MAX;
+        result->max_out[u] = INT_MIN;
+        result->next_max_out[u] = INT_MIN;
+        result->max_in[u] = INT_MIN;
+        for(i = 0; i < threads; i++)
+        {
+            analysis_low(&(result->min_out[u]), &(result->next_out[u]),
+                         parts[i].min_out[u]);
+            analysis_low(&(result->min_out[u]), &(result->next_out[u]),
+                         parts[i].next_out[u]);
+            analysis_high(&(result->max_out[u]), &(result->next_max_out[u]),
+                          parts[i].max_out[u]);
+            analysis_high(&(result->max_out[u]), &(result->next_max_out[u]),
+                          parts[i].next_max_out[u]);
+            if(parts[i].min_in[u] < result->min_in[u])
+                result->min_in[u] = parts[i].min_in[u];
+            if(parts[i].max_in[u] > result->max_in[u])
+                result->max_in[u] = parts[i].max_in[u];
+        }
+        if(problem->symmetric)
+        {
+            result->min_in[u] = result->min_out[u];
+            result->max_in[u] = result->max_out[u];
+        }
+    }
+    result->two_max = analysis_two_max(n, problem->symmetric, result);
+
+    if(problem->analysis != NULL)
+        analysis_destruct(problem->analysis);
+    problem->analysis = result;
+    *analysis = result;
+    result = NULL;
+
+CLEANUP:
+    if(result != NULL) analysis_destruct(result);
+    if(costs != NULL) free(costs);
+    if(thread_ids != NULL) free(thread_ids);
+    for(i = 0; i < threads; i++)
+        analysis_part_destruct(&(parts[i]));
+    free(parts);
+    return ret;
+}
+
+int
+arrow_problem_info_get(arrow_problem *problem, int create_hash,
+                       arrow_problem_info *info)
+{
+    arrow_problem_analysis *analysis;
+    int length;
     
-    /* Convert tree to array */
-    arrow_bintree_to_new_array(&tree, &(info->cost_list));
-    info->cost_list_length = tree.size;
-    info->min_cost = min_cost;
-    info->max_cost = max_cost;
+    info->cost_list = NULL;
+    info->cost_list_length = 0;
+    info->hash.num_keys = 0;
+    if(!arrow_problem_analyze(problem, &analysis))
+        return ARROW_FAILURE;
+    
+    /* The info owns its own copy of the cost list */
+    length = analysis->cost_list_length;
+    if(!arrow_util_create_int_array((length > 0 ? length : 1),
+                                    &(info->cost_list)))
+        return ARROW_FAILURE;
+    memcpy(info->cost_list, analysis->cost_list, length * sizeof(int));
+    info->cost_list_length = length;
+    info->min_cost = analysis->min_cost;
+    info->max_cost = analysis->max_cost;
     
     /* (optionally) create hash table */
-    info->hash.num_keys = 0;
     if(create_hash)
     {
         arrow_hash_cost_list(info->cost_list, info->cost_list_length, 
                              &(info->hash));
     }
-    
-CLEANUP:
-    arrow_bintree_destruct(&tree);
-    return ret;
+    return ARROW_SUCCESS;
 }
 
 void
@@ -274,7 +605,12 @@ arrow_problem_max_cost(arrow_problem *problem)
     int i, j;
     int cost;
     int max_cost = INT_MIN;
+    arrow_problem_analysis *analysis;
     
+    if(arrow_problem_analyze(problem, &analysis))
+        return analysis->max_cost;
+    
+    /* Fall back on a plain sweep if there's no memory for the analysis */
     for(i = 0; i < problem->size; i++)
     {
         j = (problem->symmetric == ARROW_TRUE ? i + 1 : 0);
@@ -384,6 +720,7 @@ arrow_problem_abtsp_to_sbtsp(int shallow, arrow_problem *old_problem,
     new_problem->shallow = shallow;
     new_problem->symmetric = ARROW_TRUE;
     new_problem->fixed_edges = old_problem->size;
+    new_problem->analysis = NULL;
     sprintf(new_problem->name, "%s", old_problem->name);
     
     abtsp_data *data = NULL;
@@ -411,6 +748,7 @@ arrow_problem_mstsp_to_btsp(int shallow, arrow_problem *old_problem,
     new_problem->shallow = shallow;
     new_problem->symmetric = old_problem->symmetric;
     new_problem->fixed_edges = old_problem->fixed_edges;
+    new_problem->analysis = NULL;
     sprintf(new_problem->name, "%s", old_problem->name);
     
     mstsp_data *data = NULL;
@@ -426,6 +764,18 @@ arrow_problem_mstsp_to_btsp(int shallow, arrow_problem *old_problem,
     new_problem->get_cost = mstsp_get_cost;
     new_problem->destruct = mstsp_destruct;
     
+    /* Costs max_cost - c_ij come in the reverse order, so there's no need
+       to sweep the matrix again if it's been done once (and is still
+       current) */
+    if((old_problem->analysis != NULL) &&
+       (old_problem->type != ARROW_PROBLEM_DATA_BTSP_FUN))
+    {
+        if(!analysis_mirror(old_problem->analysis, old_problem->size,
+                            old_problem->symmetric, max_cost,
+                            &(new_problem->analysis)))
+            new_problem->analysis = NULL;
+    }
+    
     return ARROW_SUCCESS;
 }
 
@@ -478,6 +828,7 @@ read_stsp(char *file_name, arrow_problem *problem)
     problem->fixed_edges = 0;
     problem->data = (void *)dat;
     problem->shallow = ARROW_FALSE;
+    problem->analysis = NULL;
     problem->get_cost = concorde_get_cost;
     problem->destruct = concorde_destruct;
     
@@ -665,6 +1016,7 @@ read_atsp(char *file_name, arrow_problem *problem)
     problem->fixed_edges = 0;
     problem->data = (void *)data;
     problem->shallow = ARROW_FALSE;
+    problem->analysis = NULL;
     problem->get_cost = full_matrix_get_cost;
     problem->destruct = full_matrix_destruct;
     return ARROW_SUCCESS;
@@ -727,3 +1079,331 @@ mstsp_destruct(arrow_problem *this)
 { 
     free(this->data);
 }
+
+int
+analysis_create(int size, int length, arrow_problem_analysis **analysis)
+{
+    arrow_problem_analysis *result;
+    
+    if((result = calloc(1, sizeof(arrow_problem_analysis))) == NULL)
+    {
+        arrow_print_error("Could not allocate memory for analysis");
+        return ARROW_FAILURE;
+    }
+    if(length < 1) length = 1;
+    if(size < 1) size = 1;
+    if(!arrow_util_create_int_array(length, &(result->cost_list)) ||
+       !arrow_util_create_int_array(length, &(result->cost_count)) ||
+       !arrow_util_create_int_array(size, &(result->min_out)) ||
+       !arrow_util_create_int_array(size, &(result->next_out)) ||
+       !arrow_util_create_int_array(size, &(result->min_in)) ||
+       !arrow_util_create_int_array(size, &(result->max_out)) ||
+       !arrow_util_create_int_array(size, &(result->next_max_out)) ||
+       !arrow_util_create_int_array(size, &(result->max_in)))
+    {
+        analysis_destruct(result);
+        return ARROW_FAILURE;
+    }
+    *analysis = result;
+    return ARROW_SUCCESS;
+}
+
+void
+analysis_destruct(arrow_problem_analysis *analysis)
+{
+    if(analysis->cost_list != NULL) free(analysis->cost_list);
+    if(analysis->cost_count != NULL) free(analysis->cost_count);
+    if(analysis->min_out != NULL) free(analysis->min_out);
+    if(analysis->next_out != NULL) free(analysis->next_out);
+    if(analysis->min_in != NULL) free(analysis->min_in);
+    if(analysis->max_out != NULL) free(analysis->max_out);
+    if(analysis->next_max_out != NULL) free(analysis->next_max_out);
+    if(analysis->max_in != NULL) free(analysis->max_in);
+    free(analysis);
+}
+
+int
+analysis_part_init(analysis_job *job, int size, analysis_part *part)
+{
+    int u;
+    
+    part->job = job;
+    part->length = 0;
+    part->bits = 0;
+    while((1 << part->bits) < ANALYSIS_MIN_TABLE)
+        part->bits++;
+    part->failed = ARROW_FALSE;
+    if(size < 1) size = 1;
+    if(((part->costs = calloc(1 << part->bits, sizeof(analysis_cost)))
+            == NULL) ||
+       !arrow_util_create_int_array(size, &(part->min_out)) ||
+       !arrow_util_create_int_array(size, &(part->next_out)) ||
+       !arrow_util_create_int_array(size, &(part->min_in)) ||
+       !arrow_util_create_int_array(size, &(part->max_out)) ||
+       !arrow_util_create_int_array(size, &(part->next_max_out)) ||
+       !arrow_util_create_int_array(size, &(part->max_in)))
+    {
+        arrow_print_error("Could not allocate memory for analysis");
+        analysis_part_destruct(part);
+        return ARROW_FAILURE;
+    }
+    for(u = 0; u < size; u++)
+    {
+        part->min_out[u] = INT_MAX;
+        part->next_out[u] = INT_MAX;
+        part->min_in[u] = INT_MAX;
+        part->max_out[u] = INT_MIN;
+        part->next_max_out[u] = INT_MIN;
+        part->max_in[u] = INT_MIN;
+    }
+    return ARROW_SUCCESS;
+}
+
+void
+analysis_part_destruct(analysis_part *part)
+{
+    if(part->costs != NULL) free(part->costs);
+    if(part->min_out != NULL) free(part->min_out);
+    if(part->next_out != NULL) free(part->next_out);
+    if(part->min_in != NULL) free(part->min_in);
+    if(part->max_out != NULL) free(part->max_out);
+    if(part->next_max_out != NULL) free(part->next_max_out);
+    if(part->max_in != NULL) free(part->max_in);
+    part->costs = NULL;
+    part->min_out = NULL;
+    part->next_out = NULL;
+    part->min_in = NULL;
+    part->max_out = NULL;
+    part->next_max_out = NULL;
+    part->max_in = NULL;
+}
+
+void *
+analysis_worker(void *arg)
+{
+    analysis_part *part = (analysis_part *)arg;
+    analysis_job *job = part->job;
+    arrow_problem *problem = job->problem;
+    int i, j, first, last, cost;
+    int n = problem->size;
+    
+    while(!part->failed)
+    {
+        pthread_mutex_lock(&(job->lock));
+        first = job->next;
+        job->next += ANALYSIS_ROWS;
+        pthread_mutex_unlock(&(job->lock));
+        if(first >= n)
+            break;
+        last = (first + ANALYSIS_ROWS < n ? first + ANALYSIS_ROWS : n);
+        
+        for(i = first; (i < last) && !part->failed; i++)
+        {
+            if(!analysis_reserve(part, n))
+            {
+                part->failed = ARROW_TRUE;
+                break;
+            }
+            
+            /* Symmetric problems only need the lower triangle, which is
+               both ends' costs out */
+            for(j = 0; j < (problem->symmetric ? i : n); j++)
+            {
+                if(j == i)
+                    continue;
+                cost = problem->get_cost(problem, i, j);
+                part->length += analysis_count(part->costs, part->bits,
+                                               cost, 1);
+                
+                analysis_low(&(part->min_out[i]), &(part->next_out[i]), cost);
+                analysis_high(&(part->max_out[i]), &(part->next_max_out[i]),
+                              cost);
+                if(problem->symmetric)
+                {
+                    analysis_low(&(part->min_out[j]), &(part->next_out[j]),
+                                 cost);
+                    analysis_high(&(part->max_out[j]),
+                                  &(part->next_max_out[j]), cost);
+                }
+                else
+                {
+                    if(cost < part->min_in[j]) part->min_in[j] = cost;
+                    if(cost > part->max_in[j]) part->max_in[j] = cost;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+int
+analysis_reserve(analysis_part *part, int room)
+{
+    int i, bits;
+    analysis_cost *costs;
+    
+    /* Every cost of the row could be new */
+    bits = part->bits;
+    while((bits < 30) && (2.0 * (part->length + room) > (1 << bits)))
+        bits++;
+    if(bits == part->bits)
+        return ARROW_SUCCESS;
+    
+    if((costs = calloc(1 << bits, sizeof(analysis_cost))) == NULL)
+        return ARROW_FAILURE;
+    for(i = 0; i < (1 << part->bits); i++)
+    {
+        if(part->costs[i].count > 0)
+            analysis_count(costs, bits, part->costs[i].cost,
+                           part->costs[i].count);
+    }
+    free(part->costs);
+    part->costs = costs;
+    part->bits = bits;
+    return ARROW_SUCCESS;
+}
+
+int
+analysis_count(analysis_cost *costs, int bits, int cost, int count)
+{
+    /* Fibonacci hashing, then linear probing */
+    unsigned int slot = ((unsigned int)cost * 2654435769U) >> (32 - bits);
+    unsigned int mask = (1U << bits) - 1;
+    
+    while(costs[slot].count > 0)
+    {
+        if(costs[slot].cost == cost)
+        {
+            costs[slot].count += count;
+            return ARROW_FALSE;
+        }
+        slot = (slot + 1) & mask;
+    }
+    costs[slot].cost = cost;
+    costs[slot].count = count;
+    return ARROW_TRUE;
+}
+
+void
+analysis_compact(analysis_cost *costs, int *length)
+{
+    int i, k;
+    
+    if(*length == 0)
+        return;
+    qsort(costs, *length, sizeof(analysis_cost), analysis_cost_compare);
+    k = 0;
+    for(i = 1; i < *length; i++)
+    {
+        if(costs[i].cost == costs[k].cost)
+            costs[k].count += costs[i].count;
+        else
+            costs[++k] = costs[i];
+    }
+    *length = k + 1;
+}
+
+int
+analysis_cost_compare(const void *a, const void *b)
+{
+    const analysis_cost *x = (const analysis_cost *)a;
+    const analysis_cost *y = (const analysis_cost *)b;
+    
+    return (x->cost < y->cost ? -1 : (x->cost > y->cost ? 1 : 0));
+}
+
+void
+analysis_low(int *first, int *second, int cost)
+{
+    if(cost < *first)
+    {
+        *second = *first;
+        *first = cost;
+    }
+    else if(cost < *second)
+    {
+        *second = cost;
+    }
+}
+
+void
+analysis_high(int *first, int *second, int cost)
+{
+    if(cost > *first)
+    {
+        *second = *first;
+        *first = cost;
+    }
+    else if(cost > *second)
+    {
+        *second = cost;
+    }
+}
+
+int
+analysis_two_max(int size, int symmetric, arrow_problem_analysis *analysis)
+{
+    int u;
+    int max = INT_MIN;
+    
+    /* Every node has two tour edges: the two cheapest ones on symmetric
+       problems, or one in and one out on asymmetric ones */
+    for(u = 0; u < size; u++)
+    {
+        if(symmetric)
+        {
+            if(max < analysis->next_out[u]) max = analysis->next_out[u];
+        }
+        else
+        {
+            if(max < analysis->min_out[u]) max = analysis->min_out[u];
+            if(max < analysis->min_in[u]) max = analysis->min_in[u];
+        }
+    }
+    return max;
+}
+
+int
+analysis_mirror(arrow_problem_analysis *base, int size, int symmetric,
+                int max_cost, arrow_problem_analysis **analysis)
+{
+    int i, u;
+    int length = base->cost_list_length;
+    arrow_problem_analysis *result;
+    
+    if(!analysis_create(size, length, &result))
+        return ARROW_FAILURE;
+    
+    for(i = 0; i < length; i++)
+    {
+        result->cost_list[i] = max_cost - base->cost_list[length - 1 - i];
+        result->cost_count[i] = base->cost_count[length - 1 - i];
+    }
+    result->cost_list_length = length;
+    result->min_cost = analysis_flip(max_cost, base->max_cost);
+    result->max_cost = analysis_flip(max_cost, base->min_cost);
+    for(u = 0; u < size; u++)
+    {
+        result->min_out[u] = analysis_flip(max_cost, base->max_out[u]);
+        result->next_out[u] = analysis_flip(max_cost, base->next_max_out[u]);
+        result->min_in[u] = analysis_flip(max_cost, base->max_in[u]);
+        result->max_out[u] = analysis_flip(max_cost, base->min_out[u]);
+        result->next_max_out[u] = analysis_flip(max_cost, base->next_out[u]);
+        result->max_in[u] = analysis_flip(max_cost, base->min_in[u]);
+    }
+    result->two_max = analysis_two_max(size, symmetric, result);
+    
+    *analysis = result;
+    return ARROW_SUCCESS;
+}
+
+int
+analysis_flip(int max_cost, int cost)
+{
+    if(cost == INT_MIN)
+        return INT_MAX;
+    else if(cost == INT_MAX)
+        return INT_MIN;
+    else
+        return max_cost - cost;
+}
@@ -0,0 +1,228 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Threshold search over a sorted cost list.
+ *
+ * The bound solvers all look for the smallest cost at which some property
+ * of the graph of cheaper edges holds (an assignment exists, the graph is
+ * biconnected, ...).  This is the binary search they share.  With more than
+ * one slot, each round probes several evenly spaced costs at once on their
+ * own threads, cutting the bracket into that many more pieces.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  One probe of a round.
+ */
+typedef struct threshold_probe
+{
+    arrow_threshold *search;    /**< search the probe is part of */
+    int slot;                   /**< state to evaluate it with */
+    int index;                  /**< index of the cost probed */
+    int feasible;               /**< ARROW_TRUE if the predicate held */
+    int ret;                    /**< what the probe function returned */
+    double time;                /**< wall-clock time the probe took */
+    int threaded;               /**< ARROW_TRUE if run on its own thread */
+} threshold_probe;
+
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Evaluates a probe and times it.
+ *  @param  arg [out] the probe (threshold_probe *)
+ *  @return NULL
+ */
+void *
+threshold_probe_run(void *arg);
+
+/**
+ *  @brief  Evaluates the first count probes, all but the first on threads
+ *          of their own (or on this thread, if one can't be started).
+ *  @param  probes [out] probes to evaluate
+ *  @param  count [in] number of probes
+ *  @param  thread_ids [out] space for count - 1 threads
+ */
+void
+threshold_round(threshold_probe *probes, int count, pthread_t *thread_ids);
+
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+void
+arrow_threshold_init(arrow_threshold *search, int *cost_list, int length)
+{
+    search->cost_list = cost_list;
+    search->low = 0;
+    search->high = length - 1;
+    search->high_feasible = ARROW_FALSE;
+    search->slots = 1;
+    search->stage = "threshold";
+    search->context = NULL;
+    search->data = NULL;
+    search->probe = NULL;
+    search->advance = NULL;
+    search->retreat = NULL;
+    search->found = ARROW_FALSE;
+    search->probes = 0;
+    search->probe_time = 0.0;
+}
+
+int
+arrow_threshold_run(arrow_threshold *search)
+{
+    int ret = ARROW_SUCCESS;
+    int i, count, first, slots, width;
+    int stopped = ARROW_FALSE;
+    threshold_probe *probes = NULL;
+    pthread_t *thread_ids = NULL;
+
+    slots = (search->slots > 1 ? search->slots : 1);
+    search->found = search->high_feasible;
+    search->probes = 0;
+    search->probe_time = 0.0;
+
+    if(((probes = malloc(slots * sizeof(threshold_probe))) == NULL) ||
+       ((slots > 1) &&
+        ((thread_ids = malloc((slots - 1) * sizeof(pthread_t))) == NULL)))
+    {
+        arrow_print_error("Could not allocate threshold search");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    for(i = 0; i < slots; i++)
+    {
+        probes[i].search = search;
+        probes[i].slot = i;
+    }
+
+    while(search->low < search->high)
+    {
+        if(arrow_context_should_stop(search->context))
+        {
+            stopped = ARROW_TRUE;
+            break;
+        }
+
+        /* Skip costs ruled out by a bound proven elsewhere */
+        search->low = arrow_context_floor_index(search->context,
+                                                search->cost_list,
+                                                search->low, search->high);
+        if(search->low == search->high)
+            break;
+
+        /* Probes split [low, high] into count + 1 pieces; with one slot
+           this is the usual median */
+        width = search->high - search->low;
+        count = (slots < width ? slots : width);
+        for(i = 0; i < count; i++)
+            probes[i].index = search->low + (i + 1) * width / (count + 1);
+        threshold_round(probes, count, thread_ids);
+
+        first = -1;
+        for(i = 0; i < count; i++)
+        {
+            if(!probes[i].ret)
+            {
+                ret = ARROW_FAILURE;
+                goto CLEANUP;
+            }
+            search->probes++;
+            search->probe_time += probes[i].time;
+            arrow_debug("%s: cost %d %s (%.3fs)\n", search->stage,
+                        search->cost_list[probes[i].index],
+                        (probes[i].feasible ? "holds" : "fails"),
+                        probes[i].time);
+            if((first < 0) && probes[i].feasible)
+                first = i;
+        }
+
+        /* The probe below the first that held failed (or it's the last
+           probe, if none held) */
+        i = (first < 0 ? count : first) - 1;
+        if(i >= 0)
+        {
+            search->low = probes[i].index + 1;
+            if(search->advance != NULL)
+                search->advance(search->data, probes[i].slot, probes[i].index);
+        }
+        if(first >= 0)
+        {
+            search->high = probes[first].index;
+            search->found = ARROW_TRUE;
+            if(search->retreat != NULL)
+                search->retreat(search->data, probes[first].slot,
+                                probes[first].index);
+        }
+        arrow_context_progress(search->context, search->stage,
+                               search->cost_list[search->low],
+                               search->cost_list[search->high]);
+    }
+
+    /* Nothing has held yet, so the top still has to be tried */
+    if(!stopped && !search->found)
+    {
+        probes[0].index = search->high;
+        threshold_probe_run(&(probes[0]));
+        if(!probes[0].ret)
+        {
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        search->probes++;
+        search->probe_time += probes[0].time;
+        search->found = probes[0].feasible;
+        if(search->found && (search->retreat != NULL))
+            search->retreat(search->data, 0, search->high);
+    }
+
+CLEANUP:
+    if(probes != NULL) free(probes);
+    if(thread_ids != NULL) free(thread_ids);
+    return ret;
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+void *
+threshold_probe_run(void *arg)
+{
+    threshold_probe *probe = (threshold_probe *)arg;
+    arrow_threshold *search = probe->search;
+    double start_time = arrow_util_real_zeit();
+
+    probe->feasible = ARROW_FALSE;
+    probe->ret = search->probe(search->data, probe->slot, probe->index,
+                               &(probe->feasible));
+    probe->time = arrow_util_real_zeit() - start_time;
+    return NULL;
+}
+
+void
+threshold_round(threshold_probe *probes, int count, pthread_t *thread_ids)
+{
+    int i;
+
+    for(i = 1; i < count; i++)
+    {
+        probes[i].threaded = (pthread_create(&(thread_ids[i - 1]), NULL,
+                                             threshold_probe_run,
+                                             &(probes[i])) == 0);
+        if(!probes[i].threaded)
+            threshold_probe_run(&(probes[i]));
+    }
+    threshold_probe_run(&(probes[0]));
+    for(i = 1; i < count; i++)
+    {
+        if(probes[i].threaded)
+            pthread_join(thread_ids[i - 1], NULL);
+    }
+}
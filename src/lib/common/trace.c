@@ -0,0 +1,364 @@
+/**********************************************************doxygen*//** @file
+ * @brief   Structured trace events.
+ *
+ * Records what the solvers are doing (probes, memo hits, solver attempts)
+ * into per-thread buffers and writes them out as JSON Lines or in the
+ * Chrome trace event format.
+ *
+ * @author  John LaRusic
+ * @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+
+#define TRACE_BUFFER_SIZE 1024
+
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  Events recorded by one thread.  Only the owning thread adds to
+ *          it; its lock is only contended when the trace is closed.  The
+ *          buffer lives as long as its thread, so a thread still recording
+ *          while the trace closes never writes into freed memory.
+ */
+typedef struct trace_buffer
+{
+    arrow_trace_event events[TRACE_BUFFER_SIZE];  /**< recorded events */
+    int count;                  /**< number of events not yet written */
+    int thread;                 /**< number given to the owning thread */
+    int live;                   /**< ARROW_TRUE while part of the open trace */
+    pthread_mutex_t lock;       /**< guards the events, count and live */
+    struct trace_buffer *next;  /**< next buffer of a living thread */
+} trace_buffer;
+
+/**
+ *  @brief  The open trace.
+ */
+typedef struct trace_state
+{
+    volatile int enabled;       /**< ARROW_TRUE while a trace file is open */
+    int format;                 /**< ARROW_TRACE_JSONL or ARROW_TRACE_CHROME */
+    int written;                /**< number of events written so far */
+    int threads;                /**< number of buffers in the open trace */
+    double origin;              /**< wall-clock time the trace was opened */
+    FILE *out;                  /**< trace file */
+    trace_buffer *buffers;      /**< every living thread's buffer */
+    pthread_mutex_t lock;       /**< guards the file and the buffer list;
+                                     taken before any buffer's lock */
+} trace_state;
+
+static trace_state trace = {ARROW_FALSE, ARROW_TRACE_JSONL, 0, 0, 0.0, NULL,
+                            NULL, PTHREAD_MUTEX_INITIALIZER};
+static __thread trace_buffer *trace_local = NULL;
+
+/* Frees a thread's buffer when the thread exits */
+static pthread_key_t trace_key;
+static pthread_once_t trace_key_once = PTHREAD_ONCE_INIT;
+
+static const char *trace_kind_names[ARROW_TRACE_KIND_COUNT] =
+    {"probe", "memo", "prefilter", "attempt"};
+static const char *trace_outcome_names[3] =
+    {"infeasible", "feasible", "stopped"};
+
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Returns the calling thread's buffer, creating it if need be.
+ *  @return the buffer, or NULL if it could not be created
+ */
+trace_buffer *
+trace_thread_buffer();
+
+/**
+ *  @brief  Makes a buffer part of the open trace.
+ *  @param  buffer [out] the calling thread's buffer
+ *  @return ARROW_TRUE if a trace is open
+ */
+int
+trace_join(trace_buffer *buffer);
+
+/**
+ *  @brief  Creates the key whose destructor frees thread buffers.
+ */
+void
+trace_key_create();
+
+/**
+ *  @brief  Writes out and frees the buffer of an exiting thread.
+ *  @param  arg [out] the thread's buffer (trace_buffer *)
+ */
+void
+trace_thread_exit(void *arg);
+
+/**
+ *  @brief  Writes out a buffer's events and empties it.  Must be called with
+ *          the lock held.
+ *  @param  buffer [out] buffer to write out
+ */
+void
+trace_flush(trace_buffer *buffer);
+
+/**
+ *  @brief  Writes one event in the trace's format.  Must be called with the
+ *          lock held.
+ *  @param  thread [in] number of the thread that recorded the event
+ *  @param  event [in] event to write
+ */
+void
+trace_write_event(int thread, arrow_trace_event *event);
+
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+int
+arrow_trace_open(const char *file_name, int format)
+{
+    FILE *out;
+
+    if((format != ARROW_TRACE_JSONL) && (format != ARROW_TRACE_CHROME))
+    {
+        arrow_print_error("Trace format %d not supported", format);
+        return ARROW_FAILURE;
+    }
+    if((out = fopen(file_name, "w")) == NULL)
+    {
+        arrow_print_error("Could not open trace file for writing");
+        return ARROW_FAILURE;
+    }
+
+    pthread_mutex_lock(&(trace.lock));
+    trace.format = format;
+    trace.written = 0;
+    trace.threads = 0;
+    trace.origin = arrow_util_real_zeit();
+    trace.out = out;
+    if(format == ARROW_TRACE_CHROME)
+        fprintf(out, "[\n");
+    trace.enabled = ARROW_TRUE;
+    pthread_mutex_unlock(&(trace.lock));
+    return ARROW_SUCCESS;
+}
+
+int
+arrow_trace_close()
+{
+    int ret = ARROW_SUCCESS;
+    trace_buffer *buffer;
+
+    pthread_mutex_lock(&(trace.lock));
+    if(!trace.enabled)
+    {
+        pthread_mutex_unlock(&(trace.lock));
+        return ARROW_SUCCESS;
+    }
+    trace.enabled = ARROW_FALSE;
+
+    /* Buffers stay with their threads, which may not have finished */
+    for(buffer = trace.buffers; buffer != NULL; buffer = buffer->next)
+    {
+        pthread_mutex_lock(&(buffer->lock));
+        if(buffer->live)
+            trace_flush(buffer);
+        buffer->live = ARROW_FALSE;
+        pthread_mutex_unlock(&(buffer->lock));
+    }
+
+    if(trace.format == ARROW_TRACE_CHROME)
+        fprintf(trace.out, "\n]\n");
+    if(fclose(trace.out) != 0)
+    {
+        arrow_print_error("Could not write trace file");
+        ret = ARROW_FAILURE;
+    }
+    trace.out = NULL;
+    pthread_mutex_unlock(&(trace.lock));
+    return ret;
+}
+
+void
+arrow_trace_record(int kind, int min_cost, int max_cost, int step,
+                   int attempt, int solver, int outcome, double start)
+{
+    int full;
+    trace_buffer *buffer;
+    arrow_trace_event *event;
+
+    if(!trace.enabled)
+        return;
+    if((buffer = trace_thread_buffer()) == NULL)
+        return;
+
+    /* The trace may have been closed (or reopened) since this thread last
+       recorded anything, so enabled is only checked again under the lock */
+    pthread_mutex_lock(&(buffer->lock));
+    if(!buffer->live)
+    {
+        pthread_mutex_unlock(&(buffer->lock));
+        if(!trace_join(buffer))
+            return;
+        pthread_mutex_lock(&(buffer->lock));
+        if(!buffer->live)
+        {
+            pthread_mutex_unlock(&(buffer->lock));
+            return;
+        }
+    }
+
+    event = &(buffer->events[buffer->count]);
+    event->kind = kind;
+    event->min_cost = min_cost;
+    event->max_cost = max_cost;
+    event->step = step;
+    event->attempt = attempt;
+    event->solver = solver;
+    event->outcome = outcome;
+    event->start = start;
+    event->duration = arrow_util_real_zeit() - start;
+    buffer->count++;
+    full = (buffer->count == TRACE_BUFFER_SIZE);
+    pthread_mutex_unlock(&(buffer->lock));
+
+    /* Only a full buffer has to wait for the file */
+    if(full)
+    {
+        pthread_mutex_lock(&(trace.lock));
+        pthread_mutex_lock(&(buffer->lock));
+        if(buffer->live)
+            trace_flush(buffer);
+        pthread_mutex_unlock(&(buffer->lock));
+        pthread_mutex_unlock(&(trace.lock));
+    }
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+trace_buffer *
+trace_thread_buffer()
+{
+    trace_buffer *buffer;
+
+    if(trace_local != NULL)
+        return trace_local;
+
+    /* First event from this thread */
+    pthread_once(&trace_key_once, trace_key_create);
+    if((buffer = malloc(sizeof(trace_buffer))) == NULL)
+    {
+        arrow_print_error("Could not allocate memory for trace buffer");
+        return NULL;
+    }
+    if(pthread_mutex_init(&(buffer->lock), NULL) != 0)
+    {
+        arrow_print_error("Could not create trace buffer lock");
+        free(buffer);
+        return NULL;
+    }
+    buffer->count = 0;
+    buffer->thread = -1;
+    buffer->live = ARROW_FALSE;
+
+    pthread_mutex_lock(&(trace.lock));
+    buffer->next = trace.buffers;
+    trace.buffers = buffer;
+    pthread_mutex_unlock(&(trace.lock));
+    pthread_setspecific(trace_key, buffer);
+    trace_local = buffer;
+    return buffer;
+}
+
+int
+trace_join(trace_buffer *buffer)
+{
+    pthread_mutex_lock(&(trace.lock));
+    if(!trace.enabled)
+    {
+        pthread_mutex_unlock(&(trace.lock));
+        return ARROW_FALSE;
+    }
+    pthread_mutex_lock(&(buffer->lock));
+    buffer->count = 0;
+    buffer->thread = trace.threads++;
+    buffer->live = ARROW_TRUE;
+    pthread_mutex_unlock(&(buffer->lock));
+    pthread_mutex_unlock(&(trace.lock));
+    return ARROW_TRUE;
+}
+
+void
+trace_key_create()
+{
+    pthread_key_create(&trace_key, trace_thread_exit);
+}
+
+void
+trace_thread_exit(void *arg)
+{
+    trace_buffer *buffer = (trace_buffer *)arg;
+    trace_buffer **link;
+
+    pthread_mutex_lock(&(trace.lock));
+    pthread_mutex_lock(&(buffer->lock));
+    if(buffer->live)
+        trace_flush(buffer);
+    buffer->live = ARROW_FALSE;
+    pthread_mutex_unlock(&(buffer->lock));
+    for(link = &(trace.buffers); *link != NULL; link = &((*link)->next))
+    {
+        if(*link == buffer)
+        {
+            *link = buffer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&(trace.lock));
+
+    pthread_mutex_destroy(&(buffer->lock));
+    free(buffer);
+}
+
+void
+trace_flush(trace_buffer *buffer)
+{
+    int i;
+    for(i = 0; i < buffer->count; i++)
+        trace_write_event(buffer->thread, &(buffer->events[i]));
+    buffer->count = 0;
+}
+
+void
+trace_write_event(int thread, arrow_trace_event *event)
+{
+    FILE *out = trace.out;
+    const char *kind = trace_kind_names[event->kind];
+    const char *outcome = trace_outcome_names[event->outcome];
+    double start = event->start - trace.origin;
+
+    if(trace.format == ARROW_TRACE_CHROME)
+    {
+        /* Complete events, with times in microseconds */
+        fprintf(out, "%s{\"name\":\"%s\",\"cat\":\"arrow\",\"ph\":\"X\","
+                "\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"min_cost\":%d,\"max_cost\":%d,\"step\":%d,"
+                "\"attempt\":%d,\"solver\":%d,\"outcome\":\"%s\"}}",
+                (trace.written > 0 ? ",\n" : ""), kind, thread,
+                start * 1e6, event->duration * 1e6, event->min_cost,
+                event->max_cost, event->step, event->attempt, event->solver,
+                outcome);
+    }
+    else
+    {
+        fprintf(out, "{\"event\":\"%s\",\"thread\":%d,\"start\":%.6f,"
+                "\"duration\":%.6f,\"min_cost\":%d,\"max_cost\":%d,"
+                "\"step\":%d,\"attempt\":%d,\"solver\":%d,"
+                "\"outcome\":\"%s\"}\n",
+                kind, thread, start, event->duration, event->min_cost,
+                event->max_cost, event->step, event->attempt, event->solver,
+                outcome);
+    }
+    trace.written++;
+}
@@ -65,6 +65,12 @@ arrow_util_zeit()
     return CCutil_zeit();
 }
 
+inline double
+arrow_util_real_zeit()
+{
+    return CCutil_real_zeit();
+}
+
 void
 arrow_util_redirect_stdout_to_file(const char *filename, int *old_stream)
 {
@@ -237,6 +243,25 @@ arrow_util_permute_array(int size, int *array)
     }
 }
 
+int
+arrow_util_random_between_r(unsigned int *seed, int min, int max)
+{
+    return min + rand_r(seed) / (RAND_MAX / (max - min + 1) + 1);
+}
+
+void
+arrow_util_permute_array_r(unsigned int *seed, int size, int *array)
+{
+    int i, c, t;
+    for(i = 0; i < size; i++)
+    {
+        c = arrow_util_random_between_r(seed, 0, size - 1 - i);
+        t = array[i]; 
+        array[i] = array[i + c];
+        array[i + c] = t;
+    }
+}
+
 void
 arrow_util_write_tour(arrow_problem *problem, char *comment, int *tour, 
                       FILE *out)
@@ -24,60 +24,18 @@ arrow_2mb_solve(arrow_problem *problem, arrow_bound_result *result)
         - for asymmetric problems we keep track of the smallest in-cost
           (alpha) and smallest out-cost (beta) incident on each vertex and
           take the largest of all those values.
+        Those are found along with the cost list in the problem's analysis,
+        so the bound is free once the problem has been analyzed.
     */
-    int i, j, cost, alpha, beta;
-    int max = INT_MIN;
+    arrow_problem_analysis *analysis;
     double start_time, end_time;
     
     start_time = arrow_util_zeit();
-    
-    for(i = 0; i < problem->size; i++)
-    {
-        alpha = INT_MAX;
-        beta = INT_MAX;
-        
-        for(j = 0; j < problem->size; j++)
-        {
-            if(i != j)
-            {
-                if(problem->symmetric)
-                {
-                    cost = problem->get_cost(problem, i, j);
-                    if(cost < alpha)
-                    {
-                        beta = alpha;
-                        alpha = cost;
-                    }
-                    else if(cost < beta)
-                    {
-                        beta = cost;
-                    }
-                }
-                else
-                {
-                    cost = problem->get_cost(problem, i, j);
-                    if(cost < alpha) alpha = cost;
-                
-                    cost = problem->get_cost(problem, j, i);
-                    if(cost < beta) beta = cost;
-                    
-                }
-            }
-        }
-        
-        if(problem->symmetric)
-        {
-            if(max < beta) max = beta;
-        }
-        else
-        {
-            if(max < alpha) max = alpha;
-            if(max < beta) max = beta;
-        }
-    }
+    if(!arrow_problem_analyze(problem, &analysis))
+        return ARROW_FAILURE;
     end_time = arrow_util_zeit();
     
-    result->obj_value = max;
+    result->obj_value = analysis->two_max;
     result->total_time = end_time - start_time;
     return ARROW_SUCCESS;   
 }
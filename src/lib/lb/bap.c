@@ -1,8 +1,10 @@
 /**********************************************************doxygen*//** @file
  *  @brief   Bottleneck assignment problem (BAP) implemenation.
  *
- *  Implemenation of the bottleneck assignment problem (BAP) that's used as a 
- *  lower bound for the Bottleneck TSP objective value.
+ *  Implemenation of the bottleneck assignment problem (BAP) that's used as a
+ *  lower bound for the Bottleneck TSP objective value.  Assignments are
+ *  found as perfect matchings with Hopcroft-Karp on sparse adjacency lists,
+ *  keeping the matching found at one threshold for the next.
  *
  *  @author  John LaRusic
  *  @ingroup lib
@@ -10,407 +12,502 @@
 #include "common.h"
 #include "lb.h"
 
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  An edge out of a row, for sorting rows by cost.
+ */
+typedef struct bap_edge
+{
+    int cost;                   /**< cost of the edge */
+    int node;                   /**< column the edge goes to */
+} bap_edge;
+
+/**
+ *  @brief  Bipartite graph of rows and columns with a matching.  Only the
+ *          first deg[i] edges of row i are active.
+ */
+typedef struct bap_graph
+{
+    int n;                      /**< number of rows (and columns) */
+    int *start;                 /**< row i's edges are adj[start[i]..
+                                     start[i+1]-1] */
+    int *adj;                   /**< column at the end of each edge */
+    int *deg;                   /**< number of active edges in each row */
+    int *mate_row;              /**< column matched to each row (-1 if none) */
+    int *mate_col;              /**< row matched to each column (-1 if none) */
+    int matched;                /**< size of the matching */
+    int *dist;                  /**< BFS layer of each row */
+    int *queue;                 /**< BFS queue of rows */
+    int *iter;                  /**< next edge to try out of each row */
+    int *stack;                 /**< path of rows being searched */
+} bap_graph;
+
+/**
+ *  @brief  State carried between the probes of the threshold search.
+ */
+typedef struct bap_search
+{
+    arrow_problem *problem;     /**< problem data */
+    int *cost_list;             /**< sorted list of costs searched */
+    bap_graph *graph;           /**< graph with sorted rows */
+    int *base_row;              /**< matching of the last probe that failed */
+    int *base_col;              /**< (and the columns' side of it) */
+    int base_matched;           /**< size of that matching */
+} bap_search;
+
+
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
-/*
- *  @brief  Initialize flow data structures.
+/**
+ *  @brief  Builds the graph of edges (i,j), i != j, with
+ *          min_cost <= C[i,j] <= max_cost, with every edge active and an
+ *          empty matching.
  *  @param  problem [in] problem data
  *  @param  min_cost [in] minimum cost to consider in problem
  *  @param  max_cost [in] maximum cost to consider in problem
- *  @param  s [in] source node index
- *  @param  t [in] sink node index
- *  @param  res [out] residual graph to construct
- *  @param  m [out] number of edges
- *  @param  dist [out] distance labels
- *  @param  pred [out] predecessor labels
+ *  @param  sorted [in] ARROW_TRUE to order each row by cost, so
+ *              bap_graph_threshold can be used
+ *  @param  graph [out] graph to build
+ */
+int
+bap_graph_init(arrow_problem *problem, int min_cost, int max_cost,
+               int sorted, bap_graph *graph);
+
+/**
+ *  @brief  Frees the graph.
+ *  @param  graph [out] graph to destruct
+ */
+void
+bap_graph_destruct(bap_graph *graph);
+
+/**
+ *  @brief  Makes only the edges with C[i,j] <= max_cost active.  The graph
+ *          must have been built with sorted rows.
+ *  @param  problem [in] problem data
+ *  @param  max_cost [in] maximum cost to consider in problem
+ *  @param  graph [out] graph
  */
 void
-initialize_flow_data(arrow_problem *problem, int min_cost, int max_cost,
-                     int s, int t, int **res, int *m, int *dist, int *pred);
-
-/*
- *  @brief  Shortest augmenting path algorithm for max-flow.
- *  @param  n [in] size of the graph
- *  @param  s [in] source node index
- *  @param  t [in] sink node index
- *  @param  stop [in] stop when d[s] >= stop
- *  @param  res [out] the residual graph -- res[i][j] > 0 indicates the edge
- *              (i,j) exists in the residual graph; res[i][j] < 0 indicates
- *              flow is going through (i, j)
- *  @param  dist [out] indicates distance labels for each node
- *  @param  pred [out] indicates predecessors for each node
- *  @param  flow [out] holds the flow found from s to t
+bap_graph_threshold(arrow_problem *problem, int max_cost, bap_graph *graph);
+
+/**
+ *  @brief  Grows the matching to a maximum matching on the active edges
+ *          with Hopcroft-Karp.
+ *  @param  graph [out] graph
  */
 void
-shortest_augmenting_path(int n, int s, int t, int stop, 
-                         int **res, int *dist, int *pred, int *flow);
-
-/*
- *  @brief  Ford-Fulkerson labeling algorithm for max-flow.
- *  @param  n [in] size of the graph
- *  @param  s [in] source node index
- *  @param  t [in] sink node index
- *  @param  res [out] the residual graph -- res[i][j] > 0 indicates the edge
- *              (i,j) exists in the residual graph; res[i][j] < 0 indicates
- *              flow is going through (i, j)
- *  @param  label [out] labels for each node
- *  @param  pred [out] indicates predecessors for each node
- *  @param  flow [out] holds the flow found from s to t
- *  @param  list [out] temporary list
- */                      
+bap_hopcroft_karp(bap_graph *graph);
+
+/**
+ *  @brief  Finds the BFS layers of the rows for a Hopcroft-Karp phase.
+ *  @param  graph [out] graph
+ *  @return ARROW_TRUE if there is an augmenting path
+ */
+int
+bap_layers(bap_graph *graph);
+
+/**
+ *  @brief  Looks for a shortest augmenting path from an unmatched row and
+ *          flips it.
+ *  @param  graph [out] graph
+ *  @param  root [in] unmatched row to start from
+ *  @return ARROW_TRUE if the matching grew
+ */
+int
+bap_augment(bap_graph *graph, int root);
+
+/**
+ *  @brief  Orders edges by cost, then by column.
+ */
+int
+bap_edge_compare(const void *a, const void *b);
+
+/**
+ *  @brief  Determines if there is an assignment using only costs up to the
+ *          given one, starting from the last failed probe's matching.
+ *  @param  data [in] the search (bap_search *)
+ *  @param  slot [in] ignored; the search probes one cost at a time
+ *  @param  index [in] index of the cost in the cost list
+ *  @param  feasible [out] ARROW_TRUE if there is an assignment
+ */
+int
+bap_probe(void *data, int slot, int index, int *feasible);
+
+/**
+ *  @brief  Keeps the matching of a failed probe: every later probe is at a
+ *          larger cost, so its matching is a good place to start.
+ *  @param  data [in] the search (bap_search *)
+ *  @param  slot [in] ignored
+ *  @param  index [in] index of the cost probed
+ */
 void
-ford_fulkerson_labeling(int n, int s, int t, int **res, int *label,
-                        int *pred, int *flow,  int *list);
+bap_advance(void *data, int slot, int index);
+
 
 /****************************************************************************
  * Public function implementations
  ****************************************************************************/
 int
-arrow_bap_solve(arrow_problem *problem, arrow_problem_info *info, 
-                arrow_bound_result *result)
+arrow_bap_solve(arrow_problem *problem, arrow_problem_info *info,
+                arrow_context *context, arrow_bound_result *result)
 {
     int ret = ARROW_SUCCESS;
-    int m, stop;
-    int low, high, median, delta, flow;
-    int found_assignment;
     double start_time, end_time;
-    
-    int n = problem->size * 2 + 2;
-    int s = n - 2;
-    int t = n - 1;
-    
-    int **res;
-    int *res_space;
-    int *dist;
-    int *pred;
-    int *list;
-    
+    bap_graph graph;
+    bap_search data;
+    arrow_threshold search;
+
     start_time = arrow_util_zeit();
-    found_assignment = ARROW_FALSE;
-    
-    /* Dynamic memory allocation GO! */
-    if(!arrow_util_create_int_matrix(n, n, &res, &res_space))
-    {
-        ret = ARROW_FAILURE;
-        goto CLEANUP;
-    }
-    if(!arrow_util_create_int_array(n, &dist))
-    {
-        ret = ARROW_FAILURE;
-        goto CLEANUP;
-    }
-    if(!arrow_util_create_int_array(n, &pred))
-    {
-        ret = ARROW_FAILURE;
-        goto CLEANUP;
-    }
-    if(!arrow_util_create_int_array(n, &list))
+    data.base_row = NULL;
+    data.base_col = NULL;
+
+    if(!bap_graph_init(problem, INT_MIN, INT_MAX, ARROW_TRUE, &graph))
+        return ARROW_FAILURE;
+    if(!arrow_util_create_int_array(problem->size, &(data.base_row)) ||
+       !arrow_util_create_int_array(problem->size, &(data.base_col)))
     {
         ret = ARROW_FAILURE;
         goto CLEANUP;
     }
-    
+    memcpy(data.base_row, graph.mate_row, problem->size * sizeof(int));
+    memcpy(data.base_col, graph.mate_col, problem->size * sizeof(int));
+    data.base_matched = 0;
+    data.problem = problem;
+    data.cost_list = info->cost_list;
+    data.graph = &graph;
+
     /*arrow_debug("Number of Unique Costs: %d\n", info->cost_list_length);*/
 
-    low = 0;
-    high = info->cost_list_length - 1;
-    while(low != high)
+    arrow_threshold_init(&search, info->cost_list, info->cost_list_length);
+    search.stage = "bap";
+    search.context = context;
+    search.data = &data;
+    search.probe = bap_probe;
+    search.advance = bap_advance;
+    if(!arrow_threshold_run(&search))
     {
-        median = ((high - low) / 2) + low;
-        delta = info->cost_list[median];  
-        /*
-        arrow_debug("Low[%d] = %d, High[%d] = %d\n", low, info->cost_list[low], high, info->cost_list[high]);
-        arrow_debug("Checking if assignment possible for C[i,j] <= %d\n", delta);
-        */  
-        flow = 0;
-        
-        initialize_flow_data(problem, INT_MIN, delta, s, t, res, &m, dist, pred);
-
-        stop = (int)(2 * pow(n, 2.0 / 3.0) + 0.5);
-        m = (int)(sqrt(m * 1.0) + 0.5);
-        /*arrow_debug("n^2/3 = %d; m^1/2 = %d\n", stop, m);*/
-        if(m < stop) stop = m;
-        
-        shortest_augmenting_path(n, s, t, stop, res, dist, pred, &flow);
-        /*arrow_debug("Flow after shortest augmenting path routine: %d\n", flow);*/
-        if(flow < problem->size)
-        {
-            ford_fulkerson_labeling(n, s, t, res, dist, pred, &flow, list);
-            /*arrow_debug("Flow after Ford Fulkerson labelling: %d\n", flow);*/
-        }
-        /*
-        else
-            arrow_debug("No need to call Ford Fulkerson labelling.\n");
-        arrow_debug("\n");
-        */
-        
-        if(flow == problem->size)
-        {
-            found_assignment = ARROW_TRUE;
-            high = median;
-        }
-        else
-        {
-            low = median + 1;
-        }
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
     }
     end_time = arrow_util_zeit();
-    
+
     /* Return the cost we converged to as the answer */
-    if(!found_assignment)
+    if(!search.found && (search.low == search.high))
         result->obj_value = -1;
     else
-        result->obj_value = info->cost_list[low];
+        result->obj_value = info->cost_list[search.low];
     result->total_time = end_time - start_time;
-    
+
 CLEANUP:
-    if(dist != NULL) free(dist);
-    if(pred != NULL) free(pred);
-    if(res_space != NULL) free(res_space);
-    if(res != NULL) free(res);
-    if(list != NULL) free(list);
-    
+    if(data.base_row != NULL) free(data.base_row);
+    if(data.base_col != NULL) free(data.base_col);
+    bap_graph_destruct(&graph);
+
     return ret;
 }
 
 int
-arrow_bap_has_assignment(arrow_problem *problem, int min_cost, int max_cost, 
+arrow_bap_has_assignment(arrow_problem *problem, int min_cost, int max_cost,
                          int *result)
 {
-    int ret = ARROW_SUCCESS;
-    int m, stop;
-    
-    int n = problem->size * 2 + 2;
-    int s = n - 2;
-    int t = n - 1;
-    
-    int **res;
-    int *res_space;
-    int *dist;
-    int *pred;
-    int *list;
-    
-    int flow = 0;
+    bap_graph graph;
+
     *result = ARROW_FALSE;
-    
-    /* Dynamic memory allocation GO! */
-    if(!arrow_util_create_int_matrix(n, n, &res, &res_space))
-    {
-        ret = ARROW_FAILURE;
-        goto CLEANUP;
-    }
-    if(!arrow_util_create_int_array(n, &dist))
-    {
-        ret = ARROW_FAILURE;
-        goto CLEANUP;
-    }
-    if(!arrow_util_create_int_array(n, &pred))
-    {
-        ret = ARROW_FAILURE;
-        goto CLEANUP;
-    }
-    if(!arrow_util_create_int_array(n, &list))
-    {
-        ret = ARROW_FAILURE;
-        goto CLEANUP;
-    }
-    
-    initialize_flow_data(problem, min_cost, max_cost, s, t, res, &m, dist, pred);
-
-    stop = (int)(2 * pow(n, 2.0 / 3.0) + 0.5);
-    m = (int)(sqrt(m * 1.0) + 0.5);
-    if(m < stop) stop = m;
-
-    shortest_augmenting_path(n, s, t, stop, res, dist, pred, &flow);
-    if(flow < problem->size)
-        ford_fulkerson_labeling(n, s, t, res, dist, pred, &flow, list);
-    
-    if(flow == problem->size)
+    if(!bap_graph_init(problem, min_cost, max_cost, ARROW_FALSE, &graph))
+        return ARROW_FAILURE;
+
+    bap_hopcroft_karp(&graph);
+    if(graph.matched == problem->size)
         *result = ARROW_TRUE;
-    
-CLEANUP:
-    if(dist != NULL) free(dist);
-    if(pred != NULL) free(pred);
-    if(res_space != NULL) free(res_space);
-    if(res != NULL) free(res);
-    if(list != NULL) free(list);
-    
-    return ret;
+
+    bap_graph_destruct(&graph);
+    return ARROW_SUCCESS;
 }
 
 
 /****************************************************************************
  * Private function implementations
  ****************************************************************************/
+int
+bap_probe(void *data, int slot, int index, int *feasible)
+{
+    bap_search *search = (bap_search *)data;
+    bap_graph *graph = search->graph;
+    int n = graph->n;
+
+    bap_graph_threshold(search->problem, search->cost_list[index], graph);
+    memcpy(graph->mate_row, search->base_row, n * sizeof(int));
+    memcpy(graph->mate_col, search->base_col, n * sizeof(int));
+    graph->matched = search->base_matched;
+    bap_hopcroft_karp(graph);
+
+    *feasible = (graph->matched == n);
+    return ARROW_SUCCESS;
+}
+
 void
-initialize_flow_data(arrow_problem *problem, int min_cost, int max_cost, 
-                     int s, int t, int **res, int *m, int *dist, int *pred)
+bap_advance(void *data, int slot, int index)
+{
+    bap_search *search = (bap_search *)data;
+    bap_graph *graph = search->graph;
+    int n = graph->n;
+
+    memcpy(search->base_row, graph->mate_row, n * sizeof(int));
+    memcpy(search->base_col, graph->mate_col, n * sizeof(int));
+    search->base_matched = graph->matched;
+}
+
+int
+bap_graph_init(arrow_problem *problem, int min_cost, int max_cost,
+               int sorted, bap_graph *graph)
 {
-    int i, j, cost;
-    
-    *m = problem->size * 2;
-    for(i = 0; i < problem->size; i++)
+    int i, j, k, cost;
+    int n = problem->size;
+    bap_edge *row = NULL;
+
+    graph->n = n;
+    graph->matched = 0;
+    graph->start = NULL;
+    graph->adj = NULL;
+    graph->deg = NULL;
+    graph->mate_row = NULL;
+    graph->mate_col = NULL;
+    graph->dist = NULL;
+    graph->queue = NULL;
+    graph->iter = NULL;
+    graph->stack = NULL;
+
+    /* Edges are counted in an int */
+    if(n > 46340)
+    {
+        arrow_print_error("Problem too large for BAP adjacency lists");
+        return ARROW_FAILURE;
+    }
+    if(!arrow_util_create_int_array(n + 1, &(graph->start)) ||
+       !arrow_util_create_int_array(n, &(graph->deg)) ||
+       !arrow_util_create_int_array(n, &(graph->mate_row)) ||
+       !arrow_util_create_int_array(n, &(graph->mate_col)) ||
+       !arrow_util_create_int_array(n, &(graph->dist)) ||
+       !arrow_util_create_int_array(n, &(graph->queue)) ||
+       !arrow_util_create_int_array(n, &(graph->iter)) ||
+       !arrow_util_create_int_array(n + 1, &(graph->stack)))
+        goto FAILURE;
+
+    /* Count first, so the lists only take as much space as the edges */
+    graph->start[0] = 0;
+    for(i = 0; i < n; i++)
     {
-        for(j = 0; j < problem->size; j++)
+        graph->start[i + 1] = graph->start[i];
+        for(j = 0; j < n; j++)
         {
             cost = problem->get_cost(problem, i, j);
             if((i != j) && (cost >= min_cost) && (cost <= max_cost))
+                graph->start[i + 1]++;
+        }
+    }
+    if(!arrow_util_create_int_array(graph->start[n] + 1, &(graph->adj)))
+        goto FAILURE;
+    if(sorted && ((row = malloc(n * sizeof(bap_edge))) == NULL))
+    {
+        arrow_print_error("Could not allocate memory for BAP row");
+        goto FAILURE;
+    }
+
+    for(i = 0; i < n; i++)
+    {
+        k = 0;
+        for(j = 0; j < n; j++)
+        {
+            cost = problem->get_cost(problem, i, j);
+            if((i == j) || (cost < min_cost) || (cost > max_cost))
+                continue;
+            if(sorted)
             {
-                res[i][j + problem->size] = 1;
-                (*m)++;
+                row[k].cost = cost;
+                row[k].node = j;
             }
             else
-            {
-                res[i][j + problem->size] = 0;
-            }
-
-            res[i][j] = 0;
-            res[i + problem->size][j] = 0;
-            res[i + problem->size][j + problem->size] = 0;
+                graph->adj[graph->start[i] + k] = j;
+            k++;
         }
-        res[s][i] = 1;
-        res[s][i + problem->size] = 0; //
-        res[i][s] = 0;
-        res[i][t] = 0;
-        res[i + problem->size][s] = 0; //
-        res[i + problem->size][t] = 1;
-        res[t][i] = 0; //
-        res[t][i + problem->size] = 0;    
-        
-        dist[i] = 2;
-        dist[i + problem->size] = 1;
-        
-        pred[i] = -1;
-        pred[i + problem->size] = -1;
+        if(sorted)
+        {
+            qsort(row, k, sizeof(bap_edge), bap_edge_compare);
+            for(j = 0; j < k; j++)
+                graph->adj[graph->start[i] + j] = row[j].node;
+        }
+        graph->deg[i] = k;
+        graph->mate_row[i] = -1;
+        graph->mate_col[i] = -1;
     }
-    res[s][s] = 0;
-    res[s][t] = 0;
-    res[t][s] = 0;
-    res[t][t] = 0;
-    
-    dist[s] = 3;  dist[t] = 0;
-    pred[s] = -1; pred[t] = -1;
+
+    if(row != NULL) free(row);
+    return ARROW_SUCCESS;
+
+FAILURE:
+    if(row != NULL) free(row);
+    bap_graph_destruct(graph);
+    return ARROW_FAILURE;
+}
+
+void
+bap_graph_destruct(bap_graph *graph)
+{
+    if(graph->start != NULL) free(graph->start);
+    if(graph->adj != NULL) free(graph->adj);
+    if(graph->deg != NULL) free(graph->deg);
+    if(graph->mate_row != NULL) free(graph->mate_row);
+    if(graph->mate_col != NULL) free(graph->mate_col);
+    if(graph->dist != NULL) free(graph->dist);
+    if(graph->queue != NULL) free(graph->queue);
+    if(graph->iter != NULL) free(graph->iter);
+    if(graph->stack != NULL) free(graph->stack);
+    graph->start = NULL;
+    graph->adj = NULL;
+    graph->deg = NULL;
+    graph->mate_row = NULL;
+    graph->mate_col = NULL;
+    graph->dist = NULL;
+    graph->queue = NULL;
+    graph->iter = NULL;
+    graph->stack = NULL;
 }
 
 void
-shortest_augmenting_path(int n, int s, int t, int stop, 
-                         int **res, int *dist, int *pred, int *flow)
+bap_graph_threshold(arrow_problem *problem, int max_cost, bap_graph *graph)
 {
-    int i, j, u, v;
-    int min_d, admissable;
-    
-    i = s;
-    while(dist[s] < stop)
+    int i, first, last, mid;
+    int *adj;
+
+    for(i = 0; i < graph->n; i++)
     {
-        min_d = n + 1;        
-        admissable = ARROW_FALSE;
-        
-        //arrow_debug(" - i = %d\n", i);
-        
-        for(j = 0; j < n; j++)
-        {            
-            if(res[i][j] > 0)
-            {
-                if(dist[i] == dist[j] + 1)
-                {
-                    //arrow_debug(" - found admissable arc (%d,%d)\n", i, j);
-                    admissable = ARROW_TRUE;
-                    //arrow_debug(" - pred[%d] = %d\n", j, i);
-                    pred[j] = i;
-                    //arrow_debug(" - i = %d\n", j);
-                    i = j;
-                    
-                    if(i == t)
-                    {
-                        //arrow_debug(" - i == t, so augment!\n");
-                        (*flow)++;
-                        //arrow_debug(" - flow is now %d\n", *flow);
-                        u = i;
-                        v = pred[u];
-                        while(u != s)
-                        {
-                            res[u][v] = 1;
-                            res[v][u] = -1;
-                            //arrow_debug(" - res[%d][%d] = 1\n", u, v);
-                            //arrow_debug(" - res[%d][%d] = -1\n", v, u);
-                            u = v;
-                            v = pred[u];
-                        }
-                        i = s;
-                    }
-                    
-                    break;
-                }
-                else
-                {
-                    if(dist[j] + 1 < min_d)
-                        min_d = dist[j] + 1;
-                }
-            }
-        }
-        
-        if(!admissable)
+        /* Number of edges in the row costing at most max_cost */
+        adj = graph->adj + graph->start[i];
+        first = 0;
+        last = graph->start[i + 1] - graph->start[i];
+        while(first < last)
         {
-            //arrow_debug(" - No admissable arcs found; retreat!\n");
-            dist[i] = min_d;
-            //arrow_debug(" - dist[%d] = %d\n", i, min_d);
-            if(i != s)
-                i = pred[i];
+            mid = first + (last - first) / 2;
+            if(problem->get_cost(problem, i, adj[mid]) <= max_cost)
+                first = mid + 1;
+            else
+                last = mid;
         }
-        
-        //arrow_debug("\n");
+        graph->deg[i] = first;
     }
 }
 
 void
-ford_fulkerson_labeling(int n, int s, int t, int **res, int *label,
-                        int *pred, int *flow,  int *list)
+bap_hopcroft_karp(bap_graph *graph)
+{
+    int i;
+
+    while((graph->matched < graph->n) && bap_layers(graph))
+    {
+        for(i = 0; i < graph->n; i++)
+            graph->iter[i] = 0;
+        for(i = 0; i < graph->n; i++)
+        {
+            if((graph->mate_row[i] == -1) && bap_augment(graph, i))
+                graph->matched++;
+        }
+    }
+}
+
+int
+bap_layers(bap_graph *graph)
 {
-    int i, j, u, v;
-    int idx = 0;
-    
-    label[t] = ARROW_TRUE;
-    while(label[t])
+    int i, k, u, w;
+    int head = 0;
+    int tail = 0;
+    int found = ARROW_FALSE;
+    int *adj;
+
+    for(i = 0; i < graph->n; i++)
     {
-        for(i = 0; i < n; i++)
+        if(graph->mate_row[i] == -1)
         {
-            label[i] = ARROW_FALSE;
-            pred[i] = -1;
+            graph->dist[i] = 0;
+            graph->queue[tail++] = i;
         }
-        
-        label[s] = ARROW_TRUE;
-        list[idx] = s; idx++;
-        
-        while(idx > 0)
+        else
+            graph->dist[i] = INT_MAX;
+    }
+
+    while(head < tail)
+    {
+        u = graph->queue[head++];
+        adj = graph->adj + graph->start[u];
+        for(k = 0; k < graph->deg[u]; k++)
         {
-            i = list[idx - 1]; idx--;
-            for(j = 0; j < n; j++)
+            w = graph->mate_col[adj[k]];
+            if(w == -1)
+                found = ARROW_TRUE;
+            else if(graph->dist[w] == INT_MAX)
             {
-                if(res[i][j] > 0)
-                {
-                    if(!label[j])
-                    {
-                        label[j] = ARROW_TRUE;
-                        pred[j] = i;
-                        list[idx++] = j;
-                    }
-                }
+                graph->dist[w] = graph->dist[u] + 1;
+                graph->queue[tail++] = w;
             }
         }
-        
-        if(label[t])
+    }
+    return found;
+}
+
+int
+bap_augment(bap_graph *graph, int root)
+{
+    int u, v, w, next;
+    int top = 0;
+
+    /* Depth-first along the layers, without recursion */
+    graph->stack[top++] = root;
+    while(top > 0)
+    {
+        u = graph->stack[top - 1];
+        if(graph->iter[u] == graph->deg[u])
+        {
+            /* Dead end, so don't come back this phase */
+            graph->dist[u] = INT_MAX;
+            top--;
+            continue;
+        }
+
+        v = graph->adj[graph->start[u] + graph->iter[u]];
+        w = graph->mate_col[v];
+        if(w == -1)
         {
-            (*flow)++;
-            u = t;
-            v = pred[u];
-            while(u != s)
+            /* Flip the path: each row on the stack takes the column the
+               row above it was matched to */
+            while(top > 0)
             {
-                res[u][v] = 1;
-                res[v][u] = -1;
-                u = v;
-                v = pred[u];
+                u = graph->stack[--top];
+                next = graph->mate_row[u];
+                graph->mate_row[u] = v;
+                graph->mate_col[v] = u;
+                v = next;
             }
+            return ARROW_TRUE;
         }
+
+        if((graph->dist[u] != INT_MAX) &&
+           (graph->dist[w] == graph->dist[u] + 1))
+            graph->stack[top++] = w;
+        else
+            graph->iter[u]++;
     }
+    return ARROW_FALSE;
+}
+
+int
+bap_edge_compare(const void *a, const void *b)
+{
+    const bap_edge *x = (const bap_edge *)a;
+    const bap_edge *y = (const bap_edge *)b;
+
+    if(x->cost != y->cost)
+        return (x->cost < y->cost ? -1 : 1);
+    return x->node - y->node;
 }
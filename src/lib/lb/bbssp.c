@@ -3,7 +3,9 @@
  *
  *  Implemenation of the bottleneck biconnected spanning subgraph problem
  *  (BBSSP) that's used as a lower bound for the Bottleneck TSP objective
- *  value.
+ *  value.  Edges are sorted by cost once; thresholds are then checked with
+ *  an iterative search for articulation points over adjacency lists of only
+ *  the edges below the threshold.
  *
  *  @author  John LaRusic
  *  @ingroup lib
@@ -11,150 +13,295 @@
 #include "common.h"
 #include "lb.h"
 
+/* Problems smaller than this are searched one threshold at a time */
+#define BBSSP_THREAD_SIZE 1000
+
+/* Most thresholds probed at once; each needs a graph of its own */
+#define BBSSP_MAX_SLOTS 4
+
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  Edges of the problem (taken as symmetric) grouped by cost.
+ */
+typedef struct bbssp_edges
+{
+    int n;                      /**< number of nodes */
+    int *start;                 /**< edges first under threshold
+                                     cost_list[k] are
+                                     edges[start[k]..start[k+1]-1] */
+    int *edges;                 /**< edges as u * n + v, with v < u */
+} bbssp_edges;
+
+/**
+ *  @brief  Adjacency lists of a graph, with space for the articulation
+ *          point search.
+ */
+typedef struct bbssp_graph
+{
+    int n;                      /**< number of nodes */
+    int *start;                 /**< node u's neighbours are adj[start[u]..
+                                     start[u+1]-1] */
+    int *adj;                   /**< neighbours of every node */
+    int *depth;                 /**< discovery depth of each node */
+    int *low;                   /**< lowest depth reachable from each node
+                                     by going down the tree, then along at
+                                     most one back edge */
+    int *parent;                /**< parent of each node in the DFS tree */
+    int *iter;                  /**< next neighbour to look at for each node */
+    int *stack;                 /**< nodes on the current DFS path */
+} bbssp_graph;
+
+/**
+ *  @brief  State shared by the probes of the threshold search.
+ */
+typedef struct bbssp_search
+{
+    bbssp_edges *edges;         /**< sorted edges */
+    bbssp_graph *graphs;        /**< a graph for each probe of a round */
+} bbssp_search;
+
+
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
 /**
- *  @brief  Recursively searches for articulation points in the graph using
- *          only costs less than or equal to 'max_cost' out from the given
- *          node.
- *  @param  problem [in] problem data structure
- *  @param  min_cost [in] the smallest cost to consider as being in the graph
- *  @param  max_cost [in] the largest cost to consider as being in the graph
- *  @param  node [in] the node to search outward from
- *  @param  depth_num [in] level at which the given node was first discovered
- *  @param  root_children [in] count of the number of children of the root
- *  @param  visited [out] indicates if a node has been visited or not
- *  @param  depth [out] indicates the discovery depth of a node
- *  @param  low [out] indicates a back edge for some descendent of a node
- *              (e.g. the discovery depth of the node closest to the root and
- *              reachable from the given node by following zero or more edges
- *              downward and then at most one back edge)
- *  @param  parent [out] indicates the closest "parent" of a node
- *  @param  art_point [out] indicates if the node is an articulation point
+ *  @brief  Sorts the edges of the problem by cost, taking
+ *          min{C[u,v],C[v,u]} as the cost of an asymmetric problem's edge.
+ *          Edges costing more than info->max_cost are left out.
+ *  @param  problem [in] problem data
+ *  @param  info [in] problem info
+ *  @param  edges [out] sorted edges
+ */
+int
+bbssp_edges_init(arrow_problem *problem, arrow_problem_info *info,
+                 bbssp_edges *edges);
+
+/**
+ *  @brief  Finds the first threshold an edge is below: the position of the
+ *          smallest cost in the cost list that is at least the given cost.
+ *          Transformed problems can have costs that aren't in the list;
+ *          those above it give the list's length (the edge is never used).
+ *  @param  info [in] problem info
+ *  @param  cost [in] cost of the edge
+ *  @return position in the cost list
+ */
+int
+bbssp_cost_bucket(arrow_problem_info *info, int cost);
+
+/**
+ *  @brief  Frees the sorted edges.
+ *  @param  edges [out] sorted edges
+ */
+void
+bbssp_edges_destruct(bbssp_edges *edges);
+
+/**
+ *  @brief  Adds edges in order of cost until the graph is connected and
+ *          every node has two neighbours, which any biconnected spanning
+ *          subgraph needs.
+ *  @param  edges [in] sorted edges
+ *  @param  length [in] number of costs in the cost list
+ *  @param  index [out] position in the cost list where that first happens
+ *              (length - 1 if it never does)
+ */
+int
+bbssp_connected_index(bbssp_edges *edges, int length, int *index);
+
+/**
+ *  @brief  Allocates the graph for up to the given number of edges.
+ *  @param  n [in] number of nodes
+ *  @param  m [in] number of edges
+ *  @param  graph [out] graph
+ */
+int
+bbssp_graph_init(int n, int m, bbssp_graph *graph);
+
+/**
+ *  @brief  Frees the graph.
+ *  @param  graph [out] graph
+ */
+void
+bbssp_graph_destruct(bbssp_graph *graph);
+
+/**
+ *  @brief  Fills in the adjacency lists from edges[0..m-1].
+ *  @param  edges [in] edges as u * n + v
+ *  @param  m [in] number of edges
+ *  @param  graph [out] graph (allocated for at least m edges)
+ */
+void
+bbssp_graph_fill(int *edges, int m, bbssp_graph *graph);
+
+/**
+ *  @brief  Determines if the graph is biconnected with an iterative depth
+ *          first search for articulation points.
+ *  @param  graph [in/out] graph
+ *  @return ARROW_TRUE if the graph is connected and has no articulation
+ *          points
+ */
+int
+bbssp_graph_biconnected(bbssp_graph *graph);
+
+/**
+ *  @brief  Finds the representative of a node's set, halving the path.
+ *  @param  set [in/out] parent of each node in the union-find forest
+ *  @param  u [in] node
+ *  @return representative of u's set
  */
 int
-find_art_points(arrow_problem *problem, int min_cost, int max_cost, int node,
-                int depth_num, int root_children, int *visited, int *depth, 
-                int *low, int *parent, int *art_point);
+bbssp_find(int *set, int u);
+
+/**
+ *  @brief  Determines if the graph of edges costing no more than the given
+ *          cost is biconnected.
+ *  @param  data [in] the search (bbssp_search *)
+ *  @param  slot [in] which graph to use
+ *  @param  index [in] index of the cost in the cost list
+ *  @param  feasible [out] ARROW_TRUE if the graph is biconnected
+ */
+int
+bbssp_probe(void *data, int slot, int index, int *feasible);
 
 
 /****************************************************************************
  * Public function implementations
  ****************************************************************************/
 int
-arrow_bbssp_solve(arrow_problem *problem, arrow_problem_info *info, 
-                  arrow_bound_result *result)
+arrow_bbssp_solve(arrow_problem *problem, arrow_problem_info *info,
+                  arrow_context *context, arrow_bound_result *result)
 {
-    int ret;
-    int low, high, median;
-    int connected;
+    int ret = ARROW_SUCCESS;
+    int i, low, slots;
+    int ready = 0;
+    int length = info->cost_list_length;
+    long processors;
     double start_time, end_time;
-    
-    /* Start binary search */
+    bbssp_edges edges;
+    bbssp_graph *graphs = NULL;
+    bbssp_search data;
+    arrow_threshold search;
+
     start_time = arrow_util_zeit();
-    low = 0;
-    high = info->cost_list_length - 1;
-    while(low != high)
-    {
-        median = ((high - low) / 2) + low;
-        
-        /* Determine is graph is biconnected if we consider only costs less
-         * than or equal to the median value. */
-        ret = arrow_bbssp_biconnected(problem, INT_MIN, 
-                                      info->cost_list[median], &connected);
-        
-        if(ret == ARROW_FAILURE)
-        {
-            result->obj_value = -1;
-            return ARROW_FAILURE;
-        }  
-        else
+    result->obj_value = -1;
+    if(!bbssp_edges_init(problem, info, &edges))
+        return ARROW_FAILURE;
+
+    /* Large problems probe a few thresholds at once */
+    slots = 1;
+    if(problem->size >= BBSSP_THREAD_SIZE)
+    {
+        processors = sysconf(_SC_NPROCESSORS_ONLN);
+        slots = (processors > 1 ? (int)processors : 1);
+        if(slots > BBSSP_MAX_SLOTS) slots = BBSSP_MAX_SLOTS;
+    }
+
+    /* Nothing below where the graph becomes connected, with every node of
+       degree two, can be biconnected */
+    if(!bbssp_connected_index(&edges, length, &low) ||
+       ((graphs = malloc(slots * sizeof(bbssp_graph))) == NULL))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    for(ready = 0; ready < slots; ready++)
+    {
+        if(!bbssp_graph_init(problem->size, edges.start[length],
+                             &(graphs[ready])))
         {
-            if(connected == ARROW_TRUE)
-                high = median;
-            else
-                low = median + 1;
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
         }
     }
+    data.edges = &edges;
+    data.graphs = graphs;
+
+    arrow_threshold_init(&search, info->cost_list, length);
+    search.low = low;
+    search.slots = slots;
+    search.stage = "bbssp";
+    search.context = context;
+    search.data = &data;
+    search.probe = bbssp_probe;
+    if(!arrow_threshold_run(&search))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
     end_time = arrow_util_zeit();
-    
+
     /* Return the cost we converged to as the answer */
-    if((result->obj_value == info->max_cost) && !connected)
+    if(!search.found && (search.low == search.high))
         result->obj_value = -1;
     else
-        result->obj_value = info->cost_list[low];
-        
+        result->obj_value = info->cost_list[search.low];
+
     result->total_time = end_time - start_time;
-    return ARROW_SUCCESS;
+
+CLEANUP:
+    if(graphs != NULL)
+    {
+        for(i = 0; i < ready; i++)
+            bbssp_graph_destruct(&(graphs[i]));
+        free(graphs);
+    }
+    bbssp_edges_destruct(&edges);
+    return ret;
 }
 
 
 int
-arrow_bbssp_biconnected(arrow_problem *problem, int min_cost, int max_cost, 
+arrow_bbssp_biconnected(arrow_problem *problem, int min_cost, int max_cost,
                         int *result)
 {
-    int ret;
-    int u;
-    int *visited;
-    int *depth;
-    int *low;
-    int *parent;
-    int *art_point;
-    
-    visited = NULL;
-    depth = NULL;
-    low = NULL;
-    parent = NULL;
-    art_point = NULL;
-
-    /* Initialize all the necessary arrays */
-    ret = arrow_util_create_int_array(problem->size, &visited);
-    if(ret == ARROW_FAILURE) goto CLEANUP; 
-
-    ret = arrow_util_create_int_array(problem->size, &depth);
-    if(ret == ARROW_FAILURE) goto CLEANUP;
-
-    ret = arrow_util_create_int_array(problem->size, &low);
-    if(ret == ARROW_FAILURE) goto CLEANUP;
-
-    ret = arrow_util_create_int_array(problem->size, &parent);
-    if(ret == ARROW_FAILURE) goto CLEANUP;
-
-    ret = arrow_util_create_int_array(problem->size, &art_point);
-    if(ret == ARROW_FAILURE) goto CLEANUP;
-
-    /* Set the default values for each array */
-    for(u = 0; u < problem->size; u++)
-    {
-        visited[u] = 0;
-        depth[u] = -1;
-        low[u] = INT_MAX;
-        parent[u] = -1;
-        art_point[u] = 0;
-    }
-
-    /* We start by assuming the graph is biconnected */
-    *result = ARROW_TRUE;
-    
-    /* Find any and all articulation points from the first vertex */
-    ret = find_art_points(problem, min_cost, max_cost, 0, 0, 0, visited,
-                          depth, low, parent, art_point);
-    
-    /* Check for articulation points or unvisited nodes */
-    for(u = 0; u < problem->size; u++)
-    {
-        if(!visited[u] || art_point[u])
-            *result = ARROW_FALSE;
-    }
-    
+    int ret = ARROW_SUCCESS;
+    int u, v, cost, cost2;
+    int m = 0;
+    int n = problem->size;
+    int *edges = NULL;
+    bbssp_graph graph;
+
+    *result = ARROW_FALSE;
+    graph.start = NULL;
+    if(n > 46340)
+    {
+        arrow_print_error("Problem too large for BBSSP edge list");
+        return ARROW_FAILURE;
+    }
+    if(!arrow_util_create_int_array(n * (n - 1) / 2 + 1, &edges))
+        return ARROW_FAILURE;
+
+    for(u = 0; u < n; u++)
+    {
+        for(v = 0; v < u; v++)
+        {
+            cost = problem->get_cost(problem, u, v);
+
+            /* If our problem is asymmetric, then we consider a symmetric
+               instance, taking min{C[u,v],C[v,u]} as the edge cost. */
+            if(!problem->symmetric)
+            {
+                cost2 = problem->get_cost(problem, v, u);
+                if(cost2 < cost)
+                    cost = cost2;
+            }
+            if((cost >= min_cost) && (cost <= max_cost))
+                edges[m++] = u * n + v;
+        }
+    }
+
+    if(!bbssp_graph_init(n, m, &graph))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    bbssp_graph_fill(edges, m, &graph);
+    *result = bbssp_graph_biconnected(&graph);
+
 CLEANUP:
-    if(visited != NULL) free(visited);   
-    if(depth != NULL) free(depth);   
-    if(low != NULL) free(low); 
-    if(parent != NULL) free(parent);
-    if(art_point != NULL) free(art_point);   
-    
+    bbssp_graph_destruct(&graph);
+    free(edges);
     return ret;
 }
 
@@ -163,83 +310,333 @@ CLEANUP:
  * Private function implementations
  ****************************************************************************/
 int
-find_art_points(arrow_problem *problem, int min_cost, int max_cost, int node,
-                int depth_num, int root_children, int *visited, int *depth, 
-                int *low, int *parent, int *art_point)
+bbssp_edges_init(arrow_problem *problem, arrow_problem_info *info,
+                 bbssp_edges *edges)
 {
-    /* "u" is the current node, and "v" will represent adjecent nodes */
-    int u, v;
-    int cost, cost2;
-
-    /* 
-       Some explanation of these variables:
-       - depth_num is the level at which we first discovered node u
-       - visited[u] indicates if node u has been visited or not
-       - depth[u] indicates the discovery depth of node u
-       - low[u] = 
-            min{d[u], d[w] |(v,w) is a back edge for some descendent v of u}
-         i.e. the discovery depth of the vertex closest to the root and
-         reachable from node u by following zero or more edges downward, and
-         then at most one back edge  
-    */
-    u = node;
-    visited[u] = 1;
-    depth[u] = depth_num;
-    low[u] = depth_num;
-    depth_num++;
-    
-    /* Look at nodes adjacent to u */
-    for(v = 0; v < problem->size; v++)
-    {
-        cost = problem->get_cost(problem, u, v);
-        
-        /* If our problem is asymmetric, then we consider a symmetric
-           instance, taking min{C[u,v],C[v,u]} as the edge cost. */
-        if(!problem->symmetric)
+    int u, v, k, pos, cost, cost2;
+    int n = problem->size;
+    int length = info->cost_list_length;
+
+    edges->n = n;
+    edges->start = NULL;
+    edges->edges = NULL;
+
+    /* Edges are packed into an int */
+    if(n > 46340)
+    {
+        arrow_print_error("Problem too large for BBSSP edge list");
+        return ARROW_FAILURE;
+    }
+    if(!arrow_util_create_int_array(length + 1, &(edges->start)))
+        goto FAILURE;
+    if(!arrow_util_create_int_array(n * (n - 1) / 2 + 1, &(edges->edges)))
+        goto FAILURE;
+
+    /* Counting sort by cost index: count, then place */
+    for(k = 0; k <= length; k++)
+        edges->start[k] = 0;
+    for(u = 0; u < n; u++)
+    {
+        for(v = 0; v < u; v++)
         {
-            cost2 = problem->get_cost(problem, v, u);
-            if(cost2 < cost)
-                cost = cost2;
+            cost = problem->get_cost(problem, u, v);
+            if(!problem->symmetric)
+            {
+                cost2 = problem->get_cost(problem, v, u);
+                if(cost2 < cost)
+                    cost = cost2;
+            }
+            pos = bbssp_cost_bucket(info, cost);
+            if(pos < length)
+                edges->start[pos + 1]++;
+        }
+    }
+    for(k = 0; k < length; k++)
+        edges->start[k + 1] += edges->start[k];
+    for(u = 0; u < n; u++)
+    {
+        for(v = 0; v < u; v++)
+        {
+            cost = problem->get_cost(problem, u, v);
+            if(!problem->symmetric)
+            {
+                cost2 = problem->get_cost(problem, v, u);
+                if(cost2 < cost)
+                    cost = cost2;
+            }
+            pos = bbssp_cost_bucket(info, cost);
+            if(pos < length)
+                edges->edges[edges->start[pos]++] = u * n + v;
         }
-        
-        if((cost >= min_cost) && (cost <= max_cost))
+    }
+
+    /* Placing moved each start to the next one's; shift them back */
+    for(k = length; k > 0; k--)
+        edges->start[k] = edges->start[k - 1];
+    edges->start[0] = 0;
+    return ARROW_SUCCESS;
+
+FAILURE:
+    bbssp_edges_destruct(edges);
+    return ARROW_FAILURE;
+}
+
+int
+bbssp_cost_bucket(arrow_problem_info *info, int cost)
+{
+    int mid;
+    int low = 0;
+    int high = info->cost_list_length;
+
+    if(cost <= info->min_cost)
+        return 0;
+    if(cost > info->max_cost)
+        return high;
+    while(low < high)
+    {
+        mid = low + (high - low) / 2;
+        if(info->cost_list[mid] < cost)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+void
+bbssp_edges_destruct(bbssp_edges *edges)
+{
+    if(edges->start != NULL) free(edges->start);
+    if(edges->edges != NULL) free(edges->edges);
+    edges->start = NULL;
+    edges->edges = NULL;
+}
+
+int
+bbssp_connected_index(bbssp_edges *edges, int length, int *index)
+{
+    int i, k, u, v, ru, rv;
+    int n = edges->n;
+    int needed = (n > 2 ? 2 : n - 1);
+    int components = n;
+    int short_nodes = n;
+    int *set = NULL;
+    int *size = NULL;
+    int *degree = NULL;
+
+    *index = length - 1;
+    if(!arrow_util_create_int_array(n, &set) ||
+       !arrow_util_create_int_array(n, &size) ||
+       !arrow_util_create_int_array(n, &degree))
+    {
+        if(set != NULL) free(set);
+        if(size != NULL) free(size);
+        return ARROW_FAILURE;
+    }
+    for(u = 0; u < n; u++)
+    {
+        set[u] = u;
+        size[u] = 1;
+        degree[u] = 0;
+    }
+
+    for(k = 0; k < length; k++)
+    {
+        for(i = edges->start[k]; i < edges->start[k + 1]; i++)
         {
-            /* If the node has yet to be visited, mark its parent as u */
-            if(!visited[v])
+            u = edges->edges[i] / n;
+            v = edges->edges[i] % n;
+            if(++degree[u] == needed) short_nodes--;
+            if(++degree[v] == needed) short_nodes--;
+
+            /* Union by size */
+            ru = bbssp_find(set, u);
+            rv = bbssp_find(set, v);
+            if(ru != rv)
             {
-                parent[v] = u;
-                
-                /* If this is the parent, increase root_children count */
-                if(parent[u] == -1) root_children++;
-                
-                /* Recurse on v */
-                find_art_points(problem, min_cost, max_cost, v, depth_num, 
-                                root_children, visited, depth, low, 
-                                parent, art_point);
-                
-                /* Update low[u] */
-                if(low[v] < low[u]) low[u] = low[v];
-                
-                /* Check articulation point conditions */
-                if(parent[u] == -1)
+                if(size[ru] < size[rv])
                 {
-                    if(root_children > 1)
-                    {
-                        art_point[u] = 1;
-                    }
+                    set[ru] = rv;
+                    size[rv] += size[ru];
                 }
-                else if(low[v] >= depth[u])
+                else
                 {
-                    art_point[u] = 1;
+                    set[rv] = ru;
+                    size[ru] += size[rv];
                 }
+                components--;
+            }
+        }
+        if((components == 1) && (short_nodes <= 0))
+        {
+            *index = k;
+            break;
+        }
+    }
+
+    free(set);
+    free(size);
+    free(degree);
+    return ARROW_SUCCESS;
+}
+
+int
+bbssp_probe(void *data, int slot, int index, int *feasible)
+{
+    bbssp_search *search = (bbssp_search *)data;
+    bbssp_graph *graph = &(search->graphs[slot]);
+
+    bbssp_graph_fill(search->edges->edges, search->edges->start[index + 1],
+                     graph);
+    *feasible = bbssp_graph_biconnected(graph);
+    return ARROW_SUCCESS;
+}
+
+int
+bbssp_graph_init(int n, int m, bbssp_graph *graph)
+{
+    graph->n = n;
+    graph->start = NULL;
+    graph->adj = NULL;
+    graph->depth = NULL;
+    graph->low = NULL;
+    graph->parent = NULL;
+    graph->iter = NULL;
+    graph->stack = NULL;
+
+    if(!arrow_util_create_int_array(n + 1, &(graph->start)) ||
+       !arrow_util_create_int_array(2 * m + 1, &(graph->adj)) ||
+       !arrow_util_create_int_array(n, &(graph->depth)) ||
+       !arrow_util_create_int_array(n, &(graph->low)) ||
+       !arrow_util_create_int_array(n, &(graph->parent)) ||
+       !arrow_util_create_int_array(n, &(graph->iter)) ||
+       !arrow_util_create_int_array(n, &(graph->stack)))
+    {
+        bbssp_graph_destruct(graph);
+        return ARROW_FAILURE;
+    }
+    return ARROW_SUCCESS;
+}
+
+void
+bbssp_graph_destruct(bbssp_graph *graph)
+{
+    if(graph->start != NULL) free(graph->start);
+    if(graph->adj != NULL) free(graph->adj);
+    if(graph->depth != NULL) free(graph->depth);
+    if(graph->low != NULL) free(graph->low);
+    if(graph->parent != NULL) free(graph->parent);
+    if(graph->iter != NULL) free(graph->iter);
+    if(graph->stack != NULL) free(graph->stack);
+    graph->start = NULL;
+    graph->adj = NULL;
+    graph->depth = NULL;
+    graph->low = NULL;
+    graph->parent = NULL;
+    graph->iter = NULL;
+    graph->stack = NULL;
+}
+
+void
+bbssp_graph_fill(int *edges, int m, bbssp_graph *graph)
+{
+    int i, u, v;
+    int n = graph->n;
+
+    /* Count each node's neighbours, then place them; iter is the fill
+       position while building */
+    for(u = 0; u <= n; u++)
+        graph->start[u] = 0;
+    for(i = 0; i < m; i++)
+    {
+        graph->start[edges[i] / n + 1]++;
+        graph->start[edges[i] % n + 1]++;
+    }
+    for(u = 0; u < n; u++)
+    {
+        graph->start[u + 1] += graph->start[u];
+        graph->iter[u] = graph->start[u];
+    }
+    for(i = 0; i < m; i++)
+    {
+        u = edges[i] / n;
+        v = edges[i] % n;
+        graph->adj[graph->iter[u]++] = v;
+        graph->adj[graph->iter[v]++] = u;
+    }
+}
+
+int
+bbssp_graph_biconnected(bbssp_graph *graph)
+{
+    int u, v, p;
+    int n = graph->n;
+    int top = 0;
+    int visited = 1;
+    int root_children = 0;
+
+    if(n == 0)
+        return ARROW_TRUE;
+    for(u = 0; u < n; u++)
+    {
+        graph->depth[u] = -1;
+        graph->parent[u] = -1;
+        graph->iter[u] = graph->start[u];
+    }
+
+    /* Depth first search from node 0, with the path kept on a stack */
+    graph->depth[0] = 0;
+    graph->low[0] = 0;
+    graph->stack[top++] = 0;
+    while(top > 0)
+    {
+        u = graph->stack[top - 1];
+        if(graph->iter[u] < graph->start[u + 1])
+        {
+            v = graph->adj[graph->iter[u]++];
+            if(graph->depth[v] == -1)
+            {
+                graph->parent[v] = u;
+                graph->depth[v] = graph->depth[u] + 1;
+                graph->low[v] = graph->depth[v];
+                graph->stack[top++] = v;
+                visited++;
+
+                /* The root is an articulation point if it has more than
+                   one child */
+                if((u == 0) && (++root_children > 1))
+                    return ARROW_FALSE;
             }
             /* Check to see if edge is a back edge */
-            else if(v != parent[u])
+            else if((v != graph->parent[u]) &&
+                    (graph->depth[v] < graph->low[u]))
+                graph->low[u] = graph->depth[v];
+        }
+        else
+        {
+            /* Done with u; pass its low value up to its parent */
+            top--;
+            p = graph->parent[u];
+            if(p >= 0)
             {
-                if(depth[v] < low[u]) low[u] = depth[v];
+                if(graph->low[u] < graph->low[p])
+                    graph->low[p] = graph->low[u];
+                if((p != 0) && (graph->low[u] >= graph->depth[p]))
+                    return ARROW_FALSE;
             }
         }
     }
-    
-    return ARROW_SUCCESS;
+
+    return (visited == n ? ARROW_TRUE : ARROW_FALSE);
+}
+
+int
+bbssp_find(int *set, int u)
+{
+    while(set[u] != u)
+    {
+        set[u] = set[set[u]];
+        u = set[u];
+    }
+    return u;
 }
@@ -1,148 +1,184 @@
 /**********************************************************doxygen*//** @file
- *  @brief  Bottleneck strongly connected spanning subgraph problem 
+ *  @brief  Bottleneck strongly connected spanning subgraph problem
  *          implemenation.
  *
- *  Implemenation of the bottleneck strongly connected spanning subgraph 
+ *  Implemenation of the bottleneck strongly connected spanning subgraph
  *  problem (BSCSSP) that's used as a lower bound for the Bottleneck TSP
  *  objective value.
  *
+ *  A graph is strongly connected exactly when every node can be reached from
+ *  node 0 and can reach node 0.  So rather than searching over thresholds,
+ *  the bound is the largest cost on the bottleneck (minimax) paths out of
+ *  and into node 0, each found with one Prim-like pass over the matrix.
+ *
  *  @author  John LaRusic
  *  @ingroup lib
  ****************************************************************************/
 #include "common.h"
 #include "lb.h"
 
+#define BSCSSP_UNREACHED 0
+#define BSCSSP_REACHED 1
+#define BSCSSP_FINISHED 2
+
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
 /**
- *  @brief  Performs a recursive depth-first search to test for connectivity
+ *  @brief  Finds the bottleneck paths from node 0 to every node (or from
+ *          every node to node 0) using only costs min_cost <= c_ij <=
+ *          max_cost.
  *  @param  problem [in] the problem instance
  *  @param  min_cost [in] minimum cost to consider in problem
  *  @param  max_cost [in] maximum cost to consider in problem
- *  @param  i [in] node index to search from
- *  @param  transpose [in] if true, calculates costs with transposed cost
- *              matrix
- *  @param  visited [out] array that marks nodes that have been visited
+ *  @param  transpose [in] if true, follows edges backwards, finding paths
+ *              into node 0
+ *  @param  key [out] largest cost on the best path found to each node
+ *  @param  state [out] whether each node is unreached, reached or finished
+ *  @param  bottleneck [out] largest cost on any of the paths
+ *  @return ARROW_TRUE if every node was reached
  */
-void
-strongly_connected_dfs(arrow_problem *problem, int min_cost, int max_cost,
-                       int i, int transpose, int *visited);
+int
+bscssp_bottleneck(arrow_problem *problem, int min_cost, int max_cost,
+                  int transpose, int *key, int *state, int *bottleneck);
 
 
 /****************************************************************************
  * Public function implementations
  ****************************************************************************/
 int
-arrow_bscssp_solve(arrow_problem *problem, arrow_problem_info *info, 
-                   arrow_bound_result *result)
+arrow_bscssp_solve(arrow_problem *problem, arrow_problem_info *info,
+                   arrow_context *context, arrow_bound_result *result)
 {
-    int ret;
-    int low, high, median;
+    int ret = ARROW_SUCCESS;
     int connected;
+    int out_bottleneck, in_bottleneck;
+    int *key = NULL;
+    int *state = NULL;
     double start_time, end_time;
-    
-    /* Start binary search */
+
     start_time = arrow_util_zeit();
-    low = 0;
-    high = info->cost_list_length - 1;
-    while(low != high)
+    result->obj_value = -1;
+    if(!arrow_util_create_int_array(problem->size, &key) ||
+       !arrow_util_create_int_array(problem->size, &state))
     {
-        median = ((high - low) / 2) + low;
-        
-        /* Determine is graph is biconnected if we consider only costs less
-         * than or equal to the median value. */
-        ret = arrow_bscssp_connected(problem, INT_MIN, info->cost_list[median],
-                                     &connected);
-        
-        if(ret == ARROW_FAILURE)
-        {
-            result->obj_value = -1;
-            return ARROW_FAILURE;
-        }  
-        else
-        {
-            if(connected == ARROW_TRUE)
-                high = median;
-            else
-                low = median + 1;
-        }
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
     }
+
+    /* Paths out of node 0, then paths into it */
+    if(arrow_context_should_stop(context))
+        goto CLEANUP;
+    connected = bscssp_bottleneck(problem, INT_MIN, INT_MAX, ARROW_FALSE,
+                                  key, state, &out_bottleneck);
+    if(arrow_context_should_stop(context))
+        goto CLEANUP;
+    if(connected)
+        connected = bscssp_bottleneck(problem, INT_MIN, INT_MAX, ARROW_TRUE,
+                                      key, state, &in_bottleneck);
     end_time = arrow_util_zeit();
-    
-    /* Return the cost we converged to as the answer */
-    result->obj_value = info->cost_list[low];
+
+    /* A single node is connected with any cost */
+    if(!connected)
+        result->obj_value = -1;
+    else if(problem->size < 2)
+        result->obj_value = info->cost_list[0];
+    else
+        result->obj_value = (out_bottleneck > in_bottleneck ? out_bottleneck
+                                                            : in_bottleneck);
     result->total_time = end_time - start_time;
-    return ARROW_SUCCESS;
+    if(connected)
+        arrow_context_progress(context, "bscssp", result->obj_value,
+                               result->obj_value);
+
+CLEANUP:
+    if(key != NULL) free(key);
+    if(state != NULL) free(state);
+    return ret;
 }
 
 int
-arrow_bscssp_connected(arrow_problem *problem, int min_cost, int max_cost, 
+arrow_bscssp_connected(arrow_problem *problem, int min_cost, int max_cost,
                        int *result)
 {
-    int i;
     int ret = ARROW_SUCCESS;
-    int *visited = NULL;
-    
-    /* Initialize arrays */
-    ret = arrow_util_create_int_array(problem->size, &visited);
-    if(ret == ARROW_FAILURE) goto CLEANUP; 
-    
-    /* We start by assuming the graph is strongly connected */
-    *result = ARROW_TRUE;
-    
-    /* Perform DFS from node 0 to see if we can reach every node */
-    for(i = 0; i < problem->size; i++)
-        visited[i] = 0;
-
-    strongly_connected_dfs(problem, min_cost, max_cost, 0, ARROW_FALSE, visited);
-    
-    for(i = 0; i < problem->size; i++)
-    {
-        if(!visited[i])
-        {
-            *result = ARROW_FALSE;
-            goto CLEANUP;
-        }
-        visited[i] = 0; /* Clear values for next DFS */
-    }
-    
-    /* Now perform the same search with the transposed cost matrix */
-    strongly_connected_dfs(problem, min_cost, max_cost, 0, ARROW_TRUE, visited);
-    
-    for(i = 0; i < problem->size; i++)
+    int bottleneck;
+    int *key = NULL;
+    int *state = NULL;
+
+    *result = ARROW_FALSE;
+    if(!arrow_util_create_int_array(problem->size, &key) ||
+       !arrow_util_create_int_array(problem->size, &state))
     {
-        if(!visited[i])
-        {
-            *result = ARROW_FALSE;
-            goto CLEANUP;
-        }
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
     }
-    
+
+    /* Every node must be reachable from node 0, and reach it */
+    if(bscssp_bottleneck(problem, min_cost, max_cost, ARROW_FALSE, key,
+                         state, &bottleneck) &&
+       bscssp_bottleneck(problem, min_cost, max_cost, ARROW_TRUE, key,
+                         state, &bottleneck))
+        *result = ARROW_TRUE;
+
 CLEANUP:
-    if(visited != NULL) free(visited);   
+    if(key != NULL) free(key);
+    if(state != NULL) free(state);
     return ret;
 }
 
-void
-strongly_connected_dfs(arrow_problem *problem, int min_cost, int max_cost,
-                       int i, int transpose, int *visited)
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+int
+bscssp_bottleneck(arrow_problem *problem, int min_cost, int max_cost,
+                  int transpose, int *key, int *state, int *bottleneck)
 {
-    int j, cost;
-    visited[i] = ARROW_TRUE;
-    
-    for(j = 0; j < problem->size; j++)
+    int i, u, v, cost, path;
+    int n = problem->size;
+
+    for(v = 0; v < n; v++)
+        state[v] = BSCSSP_UNREACHED;
+    key[0] = INT_MIN;
+    state[0] = BSCSSP_REACHED;
+    *bottleneck = INT_MIN;
+
+    for(i = 0; i < n; i++)
     {
-        if((i != j) && (!visited[j]))
+        /* Finish the reached node with the cheapest path */
+        u = -1;
+        for(v = 0; v < n; v++)
+        {
+            if((state[v] == BSCSSP_REACHED) && ((u < 0) || (key[v] < key[u])))
+                u = v;
+        }
+        if(u < 0)
+            return ARROW_FALSE;
+        state[u] = BSCSSP_FINISHED;
+        if(key[u] > *bottleneck)
+            *bottleneck = key[u];
+
+        /* Paths through u */
+        for(v = 0; v < n; v++)
         {
+            if((v == u) || (state[v] == BSCSSP_FINISHED))
+                continue;
+
             if(transpose)
-                cost = problem->get_cost(problem, j, i);
+                cost = problem->get_cost(problem, v, u);
             else
-                cost = problem->get_cost(problem, i, j);
-            
-            if((cost >= min_cost) && (cost <= max_cost))
-                strongly_connected_dfs(problem, min_cost, max_cost, 
-                                       j, transpose, visited);
+                cost = problem->get_cost(problem, u, v);
+            if((cost < min_cost) || (cost > max_cost))
+                continue;
+
+            path = (cost > key[u] ? cost : key[u]);
+            if((state[v] == BSCSSP_UNREACHED) || (path < key[v]))
+            {
+                key[v] = path;
+                state[v] = BSCSSP_REACHED;
+            }
         }
     }
+    return ARROW_TRUE;
 }
@@ -15,12 +15,59 @@
  *  Assignment Problems," Computing 38, 325-340, 1987 by
  *  R. Jonker and A. Volgenant, University of Amsterdam.
  *
+ *  Rows scan only their edges costing at most delta, kept sorted by cost in
+ *  adjacency lists.  Taking edges away never makes a reduced cost negative,
+ *  so each probe of the bisection starts from the assignment and duals of
+ *  the last feasible (larger) delta, and only re-augments the rows whose
+ *  assigned edge went over the new delta.
+ *
  *  @author  John LaRusic
  *  @ingroup lib
  ****************************************************************************/
 #include "common.h"
 #include "lb.h"
 
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  An edge out of a row, for sorting rows by cost.
+ */
+typedef struct cbap_edge
+{
+    int cost;                   /**< cost of the edge */
+    int node;                   /**< column the edge goes to */
+} cbap_edge;
+
+/**
+ *  @brief  Edges (i,j), i != j, out of each row.  Only the first limit[i]
+ *          edges of row i are used.
+ */
+typedef struct cbap_graph
+{
+    int n;                      /**< number of rows (and columns) */
+    cbap_edge *edges;           /**< row i's edges are edges[i * (n - 1)..
+                                     (i + 1) * (n - 1) - 1] */
+    int *limit;                 /**< number of edges used in each row */
+} cbap_graph;
+
+/**
+ *  @brief  State carried between the probes of the threshold search.
+ */
+typedef struct cbap_search
+{
+    arrow_problem *problem;     /**< problem data */
+    int *cost_list;             /**< sorted list of costs searched */
+    double max_length;          /**< longest assignment allowed */
+    cbap_graph *graph;          /**< graph with sorted rows */
+    int *x, *y, *pi;            /**< assignment and duals being worked on */
+    int *d, *pred, *label;      /**< space for the shortest path search */
+    arrow_heap *heap;           /**< heap for the shortest path search */
+    int *base_x, *base_y;       /**< assignment of the last feasible probe */
+    int *base_pi;               /**< duals of the last feasible probe */
+} cbap_search;
+
+
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
@@ -32,44 +79,134 @@ void
 destruct_data(int **x, int **y, int **pi, int **d, int **pred, int **label,
               arrow_heap *heap);
 
+/**
+ *  @brief  Builds the adjacency lists of a problem, with every edge used.
+ *  @param  problem [in] problem data
+ *  @param  sorted [in] ARROW_TRUE to order each row by cost, so
+ *              cbap_graph_threshold can be used
+ *  @param  graph [out] graph to build
+ */
+int
+cbap_graph_init(arrow_problem *problem, int sorted, cbap_graph *graph);
+
+/**
+ *  @brief  Frees the adjacency lists.
+ *  @param  graph [out] graph to destruct
+ */
+void
+cbap_graph_destruct(cbap_graph *graph);
+
+/**
+ *  @brief  Uses only the edges with C[i,j] <= delta.  The graph must have
+ *          been built with sorted rows.
+ *  @param  delta [in] largest cost to use
+ *  @param  graph [out] graph
+ */
+void
+cbap_graph_threshold(int delta, cbap_graph *graph);
+
+/**
+ *  @brief  Empties the assignment and zeroes the duals.
+ *  @param  n [in] number of rows (and columns)
+ *  @param  x [out] column (plus n) assigned to each row
+ *  @param  y [out] row assigned to each column (plus n)
+ *  @param  pi [out] duals
+ */
+void
+lap_reset(int n, int *x, int *y, int *pi);
+
+/**
+ *  @brief  Takes rows off edges costing more than delta.
+ *  @param  problem [in] problem data
+ *  @param  delta [in] largest cost to use
+ *  @param  x [out] column (plus n) assigned to each row
+ *  @param  y [out] row assigned to each column (plus n)
+ */
+void
+lap_drop(arrow_problem *problem, int delta, int *x, int *y);
+
+/**
+ *  @brief  Assigns every row that isn't yet, using the graph's edges.
+ *  @return the length of the assignment, or DBL_MAX if there is none
+ */
 double
-lap(arrow_problem *problem, int delta, int *x, int *y, 
+lap(arrow_problem *problem, cbap_graph *graph, int *x, int *y, 
     int *pi, int *d, int *pred, int *label, arrow_heap *heap);
 
 void
-dijkstra(arrow_problem *problem, int delta, int *x, int *y, int *pi, int s, 
-         int *t, int *d, int *pred, int *label, arrow_heap *heap);
+dijkstra(arrow_problem *problem, cbap_graph *graph, int *x, int *y, int *pi,
+         int s, int *t, int *d, int *pred, int *label, arrow_heap *heap);
 
 void
 augment(arrow_problem *problem, int s, int t, int *pred, int *x, int *y);
 
+/**
+ *  @brief  Orders edges by cost, then by column.
+ */
+int
+cbap_edge_compare(const void *a, const void *b);
+
+/**
+ *  @brief  Determines if there is an assignment short enough using only
+ *          costs up to the given one, starting from the last feasible
+ *          probe's assignment and duals.
+ *  @param  data [in] the search (cbap_search *)
+ *  @param  slot [in] ignored; the search probes one cost at a time
+ *  @param  index [in] index of the cost in the cost list
+ *  @param  feasible [out] ARROW_TRUE if there is such an assignment
+ */
+int
+cbap_probe(void *data, int slot, int index, int *feasible);
+
+/**
+ *  @brief  Keeps the assignment and duals of a feasible probe: every later
+ *          probe is at a smaller cost, so they are a good place to start.
+ *  @param  data [in] the search (cbap_search *)
+ *  @param  slot [in] ignored
+ *  @param  index [in] index of the cost probed
+ */
+void
+cbap_retreat(void *data, int slot, int index);
+
 
 /****************************************************************************
- * Private function implementations
+ * Public function implementations
  ****************************************************************************/
 int
 arrow_cbap_solve(arrow_problem *problem, arrow_problem_info *info, 
-                 double max_length, arrow_bound_result *result)
+                 double max_length, arrow_context *context,
+                 arrow_bound_result *result)
 {
     int ret = ARROW_SUCCESS;
     int n = problem->size * 2;
-    int i, cost, max_cost;
-    int low, high, median, delta;
-    int *x, *y, *pi, *d, *pred, *label;
+    int i, cost, max_cost, high;
+    int *x = NULL, *y = NULL, *pi = NULL, *d = NULL, *pred = NULL;
+    int *label = NULL;
+    int *base_x = NULL, *base_y = NULL, *base_pi = NULL;
     double length;
     double start_time, end_time;
     arrow_heap heap;
+    cbap_graph graph;
+    cbap_search data;
+    arrow_threshold search;
     
     start_time = arrow_util_zeit();
     
-    if(!init_data(n, &x, &y, &pi, &d, &pred, &label, &heap))
+    memset(&heap, 0, sizeof(arrow_heap));
+    if(!cbap_graph_init(problem, ARROW_TRUE, &graph))
+        return ARROW_FAILURE;
+    if(!init_data(n, &x, &y, &pi, &d, &pred, &label, &heap) ||
+       !arrow_util_create_int_array(n, &base_x) ||
+       !arrow_util_create_int_array(n, &base_y) ||
+       !arrow_util_create_int_array(n, &base_pi))
     {
         ret = ARROW_FAILURE;
         goto CLEANUP;
     }
     
     /* Initial LAP call */
-    length = lap(problem, INT_MAX, x, y, pi, d, pred, label, &heap);
+    lap_reset(problem->size, x, y, pi);
+    length = lap(problem, &graph, x, y, pi, d, pred, label, &heap);
     if(length > max_length)
     {
         arrow_print_error("Given max_length is infeasible.\n");
@@ -83,7 +220,7 @@ arrow_cbap_solve(arrow_problem *problem, arrow_problem_info *info,
     max_cost = INT_MIN;
     for(i = 0; i < problem->size; i++)
     {
-        cost = problem->get_cost(problem, i, x[i]);
+        cost = problem->get_cost(problem, i, x[i] - problem->size);
         if(cost > max_cost)
             max_cost = cost;
     }
@@ -95,28 +232,51 @@ arrow_cbap_solve(arrow_problem *problem, arrow_problem_info *info,
         ret = ARROW_FAILURE;
         goto CLEANUP;
     }
-    low = 0;
     
-    while(low != high)
+    /* Every probe is below the last feasible one, so it starts from that
+       one's assignment and duals */
+    memcpy(base_x, x, n * sizeof(int));
+    memcpy(base_y, y, n * sizeof(int));
+    memcpy(base_pi, pi, n * sizeof(int));
+    data.problem = problem;
+    data.cost_list = info->cost_list;
+    data.max_length = max_length;
+    data.graph = &graph;
+    data.x = x;
+    data.y = y;
+    data.pi = pi;
+    data.d = d;
+    data.pred = pred;
+    data.label = label;
+    data.heap = &heap;
+    data.base_x = base_x;
+    data.base_y = base_y;
+    data.base_pi = base_pi;
+    
+    arrow_threshold_init(&search, info->cost_list, high + 1);
+    search.high_feasible = ARROW_TRUE;
+    search.stage = "cbap";
+    search.context = context;
+    search.data = &data;
+    search.probe = cbap_probe;
+    search.retreat = cbap_retreat;
+    if(!arrow_threshold_run(&search))
     {
-        median = ((high - low) / 2) + low;
-        delta = info->cost_list[median];
-        
-        length = lap(problem, delta, x, y, pi, d, pred, label, &heap);
-        
-        if(length <= max_length)
-            high = median;
-        else
-            low = median + 1;
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
     }
     end_time = arrow_util_zeit();
     
     /* Return the cost we converged to as the answer */
-    result->obj_value = info->cost_list[low];
+    result->obj_value = info->cost_list[search.low];
     result->total_time = end_time - start_time;
 
 CLEANUP:
     destruct_data(&x, &y, &pi, &d, &pred, &label, &heap);
+    if(base_x != NULL) free(base_x);
+    if(base_y != NULL) free(base_y);
+    if(base_pi != NULL) free(base_pi);
+    cbap_graph_destruct(&graph);
     return ret;
 }
 
@@ -125,19 +285,26 @@ arrow_cbap_lap(arrow_problem *problem, double *result)
 {
     int ret = ARROW_SUCCESS;
     int n = problem->size * 2;
-    int *x, *y, *pi, *d, *pred, *label;
+    int *x = NULL, *y = NULL, *pi = NULL, *d = NULL, *pred = NULL;
+    int *label = NULL;
     arrow_heap heap;
+    cbap_graph graph;
     
+    memset(&heap, 0, sizeof(arrow_heap));
+    if(!cbap_graph_init(problem, ARROW_FALSE, &graph))
+        return ARROW_FAILURE;
     if(!init_data(n, &x, &y, &pi, &d, &pred, &label, &heap))
     {
         ret = ARROW_FAILURE;
         goto CLEANUP;
     }
     
-    *result = lap(problem, INT_MAX, x, y, pi, d, pred, label, &heap);
+    lap_reset(problem->size, x, y, pi);
+    *result = lap(problem, &graph, x, y, pi, d, pred, label, &heap);
 
 CLEANUP:
     destruct_data(&x, &y, &pi, &d, &pred, &label, &heap);
+    cbap_graph_destruct(&graph);
     return ret;
 }
 
@@ -145,6 +312,38 @@ CLEANUP:
 /****************************************************************************
  * Private function implementations
  ****************************************************************************/
+int
+cbap_probe(void *data, int slot, int index, int *feasible)
+{
+    cbap_search *search = (cbap_search *)data;
+    int delta = search->cost_list[index];
+    int n = search->problem->size * 2;
+    double length;
+    
+    memcpy(search->x, search->base_x, n * sizeof(int));
+    memcpy(search->y, search->base_y, n * sizeof(int));
+    memcpy(search->pi, search->base_pi, n * sizeof(int));
+    cbap_graph_threshold(delta, search->graph);
+    lap_drop(search->problem, delta, search->x, search->y);
+    length = lap(search->problem, search->graph, search->x, search->y,
+                 search->pi, search->d, search->pred, search->label,
+                 search->heap);
+    
+    *feasible = (length <= search->max_length);
+    return ARROW_SUCCESS;
+}
+
+void
+cbap_retreat(void *data, int slot, int index)
+{
+    cbap_search *search = (cbap_search *)data;
+    int n = search->problem->size * 2;
+    
+    memcpy(search->base_x, search->x, n * sizeof(int));
+    memcpy(search->base_y, search->y, n * sizeof(int));
+    memcpy(search->base_pi, search->pi, n * sizeof(int));
+}
+
 int
 init_data(int n, int **x, int **y, int **pi, int **d, int **pred, int **label,
           arrow_heap *heap)
@@ -181,28 +380,139 @@ destruct_data(int **x, int **y, int **pi, int **d, int **pred, int **label,
     if(*d != NULL) free(*d);
     if(*pred != NULL) free(*pred);
     if(*label != NULL) free(*label);
+    *x = NULL;
+    *y = NULL;
+    *pi = NULL;
+    *d = NULL;
+    *pred = NULL;
+    *label = NULL;
     arrow_heap_destruct(heap);
+    memset(heap, 0, sizeof(arrow_heap));
 }
 
-double
-lap(arrow_problem *problem, int delta, int *x, int *y, 
-    int *pi, int *d, int *pred, int *label, arrow_heap *heap)
+int
+cbap_graph_init(arrow_problem *problem, int sorted, cbap_graph *graph)
 {
-    int i, j, t;
+    int i, j, k;
     int n = problem->size;
+    cbap_edge *row;
+
+    graph->n = n;
+    graph->edges = NULL;
+    graph->limit = NULL;
+
+    /* Edges are counted in an int */
+    if(n > 46340)
+    {
+        arrow_print_error("Problem too large for CBAP adjacency lists");
+        return ARROW_FAILURE;
+    }
+    if(!arrow_util_create_int_array(n, &(graph->limit)))
+        return ARROW_FAILURE;
+    if((graph->edges = malloc((n > 1 ? n * (n - 1) : 1) * sizeof(cbap_edge)))
+        == NULL)
+    {
+        arrow_print_error("Could not allocate memory for CBAP edges");
+        cbap_graph_destruct(graph);
+        return ARROW_FAILURE;
+    }
+
+    for(i = 0; i < n; i++)
+    {
+        row = graph->edges + i * (n - 1);
+        k = 0;
+        for(j = 0; j < n; j++)
+        {
+            if(j == i)
+                continue;
+            row[k].cost = problem->get_cost(problem, i, j);
+            row[k].node = j;
+            k++;
+        }
+        if(sorted)
+            qsort(row, k, sizeof(cbap_edge), cbap_edge_compare);
+        graph->limit[i] = k;
+    }
+    return ARROW_SUCCESS;
+}
+
+void
+cbap_graph_destruct(cbap_graph *graph)
+{
+    if(graph->edges != NULL) free(graph->edges);
+    if(graph->limit != NULL) free(graph->limit);
+    graph->edges = NULL;
+    graph->limit = NULL;
+}
+
+void
+cbap_graph_threshold(int delta, cbap_graph *graph)
+{
+    int i, first, last, mid;
+    int n = graph->n;
+    cbap_edge *row;
+
+    for(i = 0; i < n; i++)
+    {
+        /* Number of edges in the row costing at most delta */
+        row = graph->edges + i * (n - 1);
+        first = 0;
+        last = n - 1;
+        while(first < last)
+        {
+            mid = first + (last - first) / 2;
+            if(row[mid].cost <= delta)
+                first = mid + 1;
+            else
+                last = mid;
+        }
+        graph->limit[i] = first;
+    }
+}
+
+void
+lap_reset(int n, int *x, int *y, int *pi)
+{
+    int i;
     
-    /* Initialization */
     for(i = 0; i < 2 * n; i++)
     {
         x[i] = -1;
         y[i] = -1;
         pi[i] = 0;
     }
-        
+}
+
+void
+lap_drop(arrow_problem *problem, int delta, int *x, int *y)
+{
+    int i;
+    int n = problem->size;
+    
+    for(i = 0; i < n; i++)
+    {
+        if((x[i] >= 0) && (problem->get_cost(problem, i, x[i] - n) > delta))
+        {
+            y[x[i]] = -1;
+            x[i] = -1;
+        }
+    }
+}
+
+double
+lap(arrow_problem *problem, cbap_graph *graph, int *x, int *y, 
+    int *pi, int *d, int *pred, int *label, arrow_heap *heap)
+{
+    int i, j, t;
+    int n = problem->size;
+    
     for(i = 0; i < n; i++)
     {
+        if(x[i] >= 0)
+            continue;
+        
         /* Find the shortest path from i to any demand node t */
-        dijkstra(problem, delta, x, y, pi, i, &t, d, pred, label, heap);
+        dijkstra(problem, graph, x, y, pi, i, &t, d, pred, label, heap);
         
         /* If we cannot reach a demand node then problem's infeasible */
         if(t == -1) return DBL_MAX;
@@ -218,24 +528,22 @@ lap(arrow_problem *problem, int delta, int *x, int *y,
         augment(problem, i, t, pred, x, y);
     }
     
-    /* Calculate total cost of assignment, as well as fix final solution. */
+    /* Calculate total cost of assignment.  Columns stay numbered from n,
+       so the assignment can be picked up again. */
     double cost = 0.0;
     for(i = 0; i < n; i++)
-    {
-        x[i] = x[i] - n;
-        cost += problem->get_cost(problem, i, x[i]);
-    }
+        cost += problem->get_cost(problem, i, x[i] - n);
     return cost;
 }
 
 void
-dijkstra(arrow_problem *problem, int delta, int *x, int *y, int *pi, int s, 
-         int *t, int *d, int *pred, int *label, arrow_heap *heap)
+dijkstra(arrow_problem *problem, cbap_graph *graph, int *x, int *y, int *pi,
+         int s, int *t, int *d, int *pred, int *label, arrow_heap *heap)
 {
-    int i, j, u, v;
-    int start, stop, admissable;
+    int i, j, k, count;
     int cost, red_cost;
     int n = problem->size;
+    cbap_edge *row;
     
     /* Initialization */
     arrow_heap_empty(heap);
@@ -253,18 +561,6 @@ dijkstra(arrow_problem *problem, int delta, int *x, int *y, int *pi, int s,
     {
         i = arrow_heap_get_min(heap);
         arrow_heap_delete_min(heap);
-        
-        if(i < n)
-        {
-            start = n;
-            stop = 2 * n - 1;
-        }
-        else
-        {
-            start = 0;
-            stop = n - 1;
-        } 
-
         label[i] = 1;
         
         /* If we've reached an unassigned demand node, we can stop */
@@ -273,48 +569,50 @@ dijkstra(arrow_problem *problem, int delta, int *x, int *y, int *pi, int s,
             *t = i;
             return;
         }
-            
-        /* Iterate through neighbouring nodes */
-        u = (i < n ? i : i - n);
-        for(j = start; j <= stop; j++)
+        
+        /* A supply node leads to every demand node it isn't assigned to,
+           and an assigned demand node leads back to its supply node only */
+        row = NULL;
+        count = 1;
+        if(i < n)
+        {
+            row = graph->edges + i * (n - 1);
+            count = graph->limit[i];
+        }
+        for(k = 0; k < count; k++)
         {
-            v = (j < n ? j : j - n);
-            
             if(i < n)
-                admissable = (x[i] != j);
+            {
+                j = row[k].node + n;
+                if(x[i] == j)
+                    continue;
+                cost = row[k].cost;
+            }
             else
-                admissable = (x[j] == i);
+            {
+                j = y[i];
+                cost = -1 * problem->get_cost(problem, j, i - n);
+            }
+            if(label[j])
+                continue;
+            
+            red_cost = cost - pi[i] + pi[j];
+            if(red_cost < 0)
+            {
+                arrow_print_error("Negative reduced cost!");
+                *t = -1;
+                return;
+            }
             
-            if((u != v) && (admissable) && (!label[j]))
+            if(red_cost + d[i] < d[j])
             {
-                if(i >= n)
-                    cost = problem->get_cost(problem, v, u);
+                d[j] = red_cost + d[i];
+                pred[j] = i;
+                
+                if(arrow_heap_in(heap, j))
+                    arrow_heap_change_key(heap, d[j], j);
                 else
-                    cost = problem->get_cost(problem, u, v);
-                                
-                if(cost <= delta)
-                {
-                    if(i >= n) cost = cost * -1;
-                    red_cost = cost - pi[i] + pi[j];
-                    
-                    if(red_cost < 0)
-                    {
-                        arrow_print_error("Negative reduced cost!");
-                        *t = -1;
-                        return;
-                    }
-                    
-                    if(red_cost + d[i] < d[j])
-                    {
-                        d[j] = red_cost + d[i];
-                        pred[j] = i;
-                        
-                        if(arrow_heap_in(heap, j))
-                            arrow_heap_change_key(heap, d[j], j);
-                        else
-                            arrow_heap_insert(heap, d[j], j);
-                    }
-                }
+                    arrow_heap_insert(heap, d[j], j);
             }
         }
     }
@@ -337,4 +635,13 @@ augment(arrow_problem *problem, int s, int t, int *pred, int *x, int *y)
     }
 }
 
+int
+cbap_edge_compare(const void *a, const void *b)
+{
+    const cbap_edge *x = (const cbap_edge *)a;
+    const cbap_edge *y = (const cbap_edge *)b;
 
+    if(x->cost != y->cost)
+        return (x->cost < y->cost ? -1 : 1);
+    return (x->node < y->node ? -1 : (x->node > y->node ? 1 : 0));
+}
@@ -2,41 +2,134 @@
  *  @brief   Constrained bottleneck spanning tree bound implemenation.
  *
  *  Implemenation of the Constrained bottleneck spanning tree (CBST) bound
- *  used as a lower bound for the symmetric constrained bottleneck TSP 
+ *  used as a lower bound for the symmetric constrained bottleneck TSP
  *  objective value.
  *
+ *  The spanning tree comes from Kruskal's algorithm, fed edges in rounds:
+ *  each round sweeps the matrix (in parallel) for the edges in the next
+ *  band of costs, sorts just those, and merges them into the union-find
+ *  forest left by the rounds before.  The bands are picked from the cost
+ *  histogram so the first one is usually all that's needed.
+ *
  *  @author  John LaRusic
  *  @ingroup lib
  ****************************************************************************/
 #include "common.h"
 #include "lb.h"
 
+/* Number of edges the first round of Kruskal's algorithm aims for, as a
+   multiple of the number of nodes; each later round aims for four times
+   as many as the one before */
+#define CBST_FIRST_ROUND 4
+
+/* Rows of the matrix a thread sweeps before adding its edges to the pile */
+#define CBST_ROWS 32
+
+/* Problems smaller than this are swept on the calling thread alone */
+#define CBST_THREAD_SIZE 1000
+
+/* Upper limit on threads, however many processors there are */
+#define CBST_MAX_THREADS 64
+
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  An edge (u, v), v < u, packed as u * n + v, with its cost.
+ */
+typedef struct cbst_edge
+{
+    int cost;                   /**< cost of the edge */
+    int edge;                   /**< the edge as u * n + v */
+} cbst_edge;
+
+/**
+ *  @brief  Sweep for the edges with costs in (low, high], shared between
+ *          the threads doing it.
+ */
+typedef struct cbst_sweep
+{
+    pthread_mutex_t lock;       /**< guards next, edges and failed */
+    arrow_problem *problem;     /**< problem being swept */
+    int low;                    /**< costs must be larger than this */
+    int high;                   /**< costs must be no larger than this */
+    int next;                   /**< next row to hand out */
+    cbst_edge *edges;           /**< edges found so far */
+    int count;                  /**< number of edges found so far */
+    int capacity;               /**< space in edges */
+    int failed;                 /**< ARROW_TRUE if memory ran out */
+} cbst_sweep;
+
+
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
+/**
+ *  @brief  Finds a minimum spanning tree with Kruskal's algorithm.
+ *  @param  problem [in] problem structure
+ *  @param  tree [out] the tree (tree[i] gives the predecessor of node i on
+ *              the path to node 0, and tree[0] = -1)
+ *  @param  max_cost [out] the largest cost in the tree
+ *  @param  length [out] the total length of the tree
+ */
 int
-init_data(int n, arrow_heap *heap, int **cur_tree, int **in_heap, int **d);
+cbst_kruskal(arrow_problem *problem, int *tree, int *max_cost,
+             double *length);
 
-void
-destroy_data(arrow_heap *heap, int **cur_tree, int **in_heap, int **d);
+/**
+ *  @brief  Collects the edges with costs in (low, high], using a thread
+ *          for each processor on large problems.
+ *  @param  sweep [out] sweep with problem, low and high filled in; edges
+ *              and count are replaced with the edges found
+ */
+int
+cbst_sweep_run(cbst_sweep *sweep);
 
 /**
- *  @brief  Solves a (slightly modified!) minimum spanning tree problem.
- *  @param  problem [in] problem structure
- *  @param  C [in] largest cost in problem
- *  @param  exclude_cost [in] excludes costs less than this value except...
- *  @param  cur_tree [in] includes any edge costs found in this tree
- *  @param  tree [out] the resulting minimum spanning tree
- *  @param  max_cost [out] the largest cost in the resulting tree
- *  @param  length [out] the total length of the resulting tree
- *  @param  heap [out] a temporary heap structure
- *  @param  in_heap [out] a temporary integer array
- *  @param  d [out] a temporary integer array
+ *  @brief  Sweeps rows until there are none left.
+ *  @param  arg [out] the sweep (cbst_sweep *)
+ *  @return NULL
+ */
+void *
+cbst_sweep_worker(void *arg);
+
+/**
+ *  @brief  Adds edges to the sweep's pile.  Must be called with the sweep
+ *          locked.
+ *  @param  sweep [out] the sweep
+ *  @param  edges [in] edges to add
+ *  @param  count [in] number of edges to add
  */
-void
-min_span_tree(arrow_problem *problem, int C, int exclude_cost,
-              int *cur_tree, int *tree, int *max_cost, double *length,
-              arrow_heap *heap, int *in_heap, int *d);
+int
+cbst_sweep_add(cbst_sweep *sweep, cbst_edge *edges, int count);
+
+/**
+ *  @brief  Orders edges by cost, then by index so ties always come out the
+ *          same way.
+ *  @param  a [in] first edge (cbst_edge *)
+ *  @param  b [in] second edge (cbst_edge *)
+ *  @return negative, zero or positive as a comes before, with or after b
+ */
+int
+cbst_edge_compare(const void *a, const void *b);
+
+/**
+ *  @brief  Finds the representative of a node's set, halving the path.
+ *  @param  set [in/out] parent of each node in the union-find forest
+ *  @param  u [in] node
+ *  @return representative of u's set
+ */
+int
+cbst_find(int *set, int u);
+
+/**
+ *  @brief  Hangs the tree from node 0, giving each node its predecessor.
+ *  @param  n [in] number of nodes
+ *  @param  chosen [in] the n - 1 edges of the tree, as u * n + v
+ *  @param  tree [out] predecessor of each node (-1 for node 0)
+ */
+int
+cbst_tree_orient(int n, int *chosen, int *tree);
 
 
 /****************************************************************************
@@ -47,14 +140,13 @@ arrow_cbst_solve(arrow_problem *problem, arrow_problem_info *info,
                  double max_length, arrow_bound_result *result)
 {
     int ret = ARROW_SUCCESS;
-    int *tree, *cur_tree, *in_heap, *d;
+    int *tree = NULL;
     int max_cost;
     double length;
-    arrow_heap heap;
-    
+
     double start_time, end_time;
     start_time = arrow_util_zeit();
-    
+
     /* Allocate data */
     if(!arrow_util_create_int_array(problem->size, &tree))
     {
@@ -62,16 +154,14 @@ arrow_cbst_solve(arrow_problem *problem, arrow_problem_info *info,
         ret = ARROW_FAILURE;
         goto CLEANUP;
     }
-    if(!init_data(problem->size, &heap, &cur_tree, &in_heap, &d))
+
+    /* MST call to determine feasibility and bottleneck value */
+    if(!cbst_kruskal(problem, tree, &max_cost, &length))
     {
-        arrow_print_error("Could not initialize MST data structures.");
+        arrow_print_error("Could not solve MST.");
         ret = ARROW_FAILURE;
         goto CLEANUP;
     }
-    
-    /* Initial MST call to determine feasibility and bottleneck value */
-    min_span_tree(problem, info->max_cost, INT_MIN, cur_tree, tree,
-                  &max_cost, &length, &heap, in_heap, d);
     /* See if given max_length is feasible */
     if(length > max_length)
     {
@@ -83,152 +173,367 @@ arrow_cbst_solve(arrow_problem *problem, arrow_problem_info *info,
     arrow_debug("\nSpanning tree length: %.0f\n", length);
 
     end_time = arrow_util_zeit();
-    
+
     result->obj_value = max_cost;
-    result->total_time = end_time - start_time;    
-    
+    result->total_time = end_time - start_time;
+
 CLEANUP:
     if(tree != NULL) free(tree);
     return ret;
 }
- 
+
 int
 arrow_cbst_mst_solve(arrow_problem *problem, arrow_problem_info *info,
                      int *tree, int *max_cost, double *length)
 {
-    arrow_heap heap;
-    int  *cur_tree, *in_heap, *d;
-    int ret = ARROW_SUCCESS;
-    
-    if(!init_data(problem->size, &heap, &cur_tree, &in_heap, &d))
+    if(!cbst_kruskal(problem, tree, max_cost, length))
     {
-        arrow_print_error("Could not initialize MST data structures.");
-        ret = ARROW_FAILURE;
-        goto CLEANUP;
+        arrow_print_error("Could not solve MST.");
+        return ARROW_FAILURE;
     }
-    
-    min_span_tree(problem, info->max_cost, INT_MIN, cur_tree, tree,
-                  max_cost, length, &heap, in_heap, d);
-    
-CLEANUP:
-    destroy_data(&heap, &cur_tree, &in_heap, &d);
-    return ret;
+    return ARROW_SUCCESS;
 }
 
 
 /****************************************************************************
  * Private function implementations
  ****************************************************************************/
-void
-min_span_tree(arrow_problem *problem, int C, int exclude_cost,
-              int *cur_tree, int *tree, int *max_cost, double *length,
-              arrow_heap *heap, int *in_heap, int *d)
+int
+cbst_kruskal(arrow_problem *problem, int *tree, int *max_cost,
+             double *length)
 {
-    int i, j, cost, p, tree_size;
-    
-    /* Node 0 gets inserted into an empty heap with cost 0.  All other nodes
-       get inserted in with a cost of C + 1 */
-    arrow_heap_empty(heap);
-    arrow_heap_insert(heap, 0, 0);
-    for(i = 1; i < problem->size; i++)
-        arrow_heap_insert(heap, C + 1, i);
-    
-    /* Iniitalize arrays */
-    for(i = 0; i < problem->size; i++)
-    {
-        tree[i] = -1;
-        in_heap[i] = 1;
-        d[i] = C + 1;
-    }
-    
+    int ret = ARROW_SUCCESS;
+    int i, k, u, v, ru, rv, joined;
+    int n = problem->size;
+    double target, found;
+    int *set = NULL;
+    int *chosen = NULL;
+    arrow_problem_analysis *analysis;
+    cbst_sweep sweep;
+
+    sweep.edges = NULL;
     *max_cost = INT_MIN;
     *length = 0.0;
-    tree_size = 0;
-    
-    /* Main loop */
-    while(tree_size < problem->size - 1)
-    {
-        /*
-        arrow_debug("HEAP:\n");
-        arrow_heap_print(heap);
-        arrow_debug("\n");
-        */
-        i = arrow_heap_get_min(heap);
-        arrow_heap_delete_min(heap);
-        in_heap[i] = 0;
-        
-        p = tree[i];
-        if(p >= 0)
+    if(n > 0) tree[0] = -1;
+    if(n <= 1)
+        return ARROW_SUCCESS;
+
+    /* Edges are packed into an int */
+    if(n > 46340)
+    {
+        arrow_print_error("Problem too large for CBST edge list");
+        return ARROW_FAILURE;
+    }
+    if(!arrow_problem_analyze(problem, &analysis))
+        return ARROW_FAILURE;
+    if(!arrow_util_create_int_array(n, &set) ||
+       !arrow_util_create_int_array(n - 1, &chosen))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    for(u = 0; u < n; u++)
+        set[u] = u;
+
+    sweep.problem = problem;
+    sweep.high = analysis->cost_list[0] - 1;
+    k = 0;
+    found = 0.0;
+    target = (double)CBST_FIRST_ROUND * n;
+    joined = 0;
+    while(joined < n - 1)
+    {
+        /* Nothing left to sweep; a complete graph can't get here */
+        if(k >= analysis->cost_list_length)
+        {
+            arrow_print_error("Graph is not connected");
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+
+        /* Widen the band of costs until it holds enough edges.  The counts
+           are of edges either way round on asymmetric problems, and only
+           one way round is swept */
+        sweep.low = sweep.high;
+        while(k < analysis->cost_list_length)
         {
-            /* Insert (p,i) into tree, update length and max_cost */
-            tree_size++;
-            cost = problem->get_cost(problem, p, i);
-            *length += cost;
-            if(cost > *max_cost) *max_cost = cost;
-            //arrow_debug(" - Add (%d,%d) to tree with cost %d\n", p, i, cost);
+            found += (problem->symmetric ? analysis->cost_count[k]
+                                         : analysis->cost_count[k] / 2.0);
+            k++;
+            if(found >= target)
+                break;
         }
-        
-        /* Iterate through adjacent nodes that are still in the heap */
-        //arrow_debug(" - Examine neighbours of %d:\n", i);
-        for(j = 0; j < problem->size; j++)
+        sweep.high = analysis->cost_list[k - 1];
+        target *= 4;
+
+        if(!cbst_sweep_run(&sweep))
         {
-            if((i != j) && (in_heap[j]))
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        qsort(sweep.edges, sweep.count, sizeof(cbst_edge),
+              cbst_edge_compare);
+        arrow_debug("CBST round: %d edges with costs in (%d, %d]\n",
+                    sweep.count, sweep.low, sweep.high);
+
+        /* Merge into the forest the earlier rounds left behind */
+        for(i = 0; (i < sweep.count) && (joined < n - 1); i++)
+        {
+            u = sweep.edges[i].edge / n;
+            v = sweep.edges[i].edge % n;
+            ru = cbst_find(set, u);
+            rv = cbst_find(set, v);
+            if(ru == rv)
+                continue;
+            set[ru] = rv;
+            chosen[joined++] = sweep.edges[i].edge;
+            *length += sweep.edges[i].cost;
+            if(sweep.edges[i].cost > *max_cost)
+                *max_cost = sweep.edges[i].cost;
+        }
+        free(sweep.edges);
+        sweep.edges = NULL;
+    }
+
+    if(!cbst_tree_orient(n, chosen, tree))
+        ret = ARROW_FAILURE;
+
+CLEANUP:
+    if(sweep.edges != NULL) free(sweep.edges);
+    if(set != NULL) free(set);
+    if(chosen != NULL) free(chosen);
+    return ret;
+}
+
+int
+cbst_sweep_run(cbst_sweep *sweep)
+{
+    int i, threads, started;
+    int n = sweep->problem->size;
+    long processors;
+    pthread_t *thread_ids = NULL;
+
+    sweep->next = 1;
+    sweep->edges = NULL;
+    sweep->count = 0;
+    sweep->capacity = 0;
+    sweep->failed = ARROW_FALSE;
+
+    /* The cost function of a BTSP function problem isn't safe to share */
+    threads = 1;
+    if((n >= CBST_THREAD_SIZE) &&
+       (sweep->problem->type != ARROW_PROBLEM_DATA_BTSP_FUN))
+    {
+        processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (processors > 1 ? (int)processors : 1);
+        if(threads > CBST_MAX_THREADS) threads = CBST_MAX_THREADS;
+    }
+
+    if(pthread_mutex_init(&(sweep->lock), NULL) != 0)
+    {
+        arrow_print_error("Could not create CBST lock");
+        return ARROW_FAILURE;
+    }
+
+    /* Threads that don't start just leave more rows for the others */
+    started = 0;
+    if(threads > 1)
+    {
+        if((thread_ids = malloc((threads - 1) * sizeof(pthread_t))) == NULL)
+            arrow_debug("Could not allocate CBST threads\n");
+    }
+    if(thread_ids != NULL)
+    {
+        for(i = 0; i < threads - 1; i++)
+        {
+            if(pthread_create(&(thread_ids[started]), NULL,
+                              cbst_sweep_worker, sweep) == 0)
+                started++;
+        }
+    }
+    cbst_sweep_worker(sweep);
+    for(i = 0; i < started; i++)
+        pthread_join(thread_ids[i], NULL);
+
+    if(thread_ids != NULL) free(thread_ids);
+    pthread_mutex_destroy(&(sweep->lock));
+
+    if(sweep->failed)
+    {
+        arrow_print_error("Could not allocate CBST edge list");
+        if(sweep->edges != NULL) free(sweep->edges);
+        sweep->edges = NULL;
+        return ARROW_FAILURE;
+    }
+    return ARROW_SUCCESS;
+}
+
+void *
+cbst_sweep_worker(void *arg)
+{
+    cbst_sweep *sweep = (cbst_sweep *)arg;
+    arrow_problem *problem = sweep->problem;
+    int u, v, first, last, cost, count, capacity;
+    int n = problem->size;
+    cbst_edge *edges = NULL;
+    cbst_edge *grown;
+
+    capacity = 0;
+    pthread_mutex_lock(&(sweep->lock));
+    while((sweep->next < n) && (!sweep->failed))
+    {
+        first = sweep->next;
+        last = (n - first > CBST_ROWS ? first + CBST_ROWS : n);
+        sweep->next = last;
+        pthread_mutex_unlock(&(sweep->lock));
+
+        count = 0;
+        for(u = first; u < last; u++)
+        {
+            for(v = 0; v < u; v++)
             {
-                cost = problem->get_cost(problem, i, j);
-                /* We want to consider only adjacent nodes we can visit more
-                   cheaply, and are not excluded by being less than the exclude
-                   cost and not in the current solution */
-                //arrow_debug("   - (%d,%d): cost: %d, d[%d] = %d, cur_tree[%d] = %d\n",
-                //            i, j, cost, j, d[j], j, cur_tree[j]);
-                /*if((d[j] > cost) && 
-                   ((cost > exclude_cost) || (cur_tree[j] != i)))
-                */
-                if((d[j] > cost) && (cost > exclude_cost))
+                cost = problem->get_cost(problem, u, v);
+                if((cost <= sweep->low) || (cost > sweep->high))
+                    continue;
+
+                if(count == capacity)
                 {
-                    d[j] = cost;
-                    tree[j] = i;
-                    //arrow_debug("     - update d[%d] = %d\n", j, cost);
-                    arrow_heap_change_key(heap, cost, j);
+                    capacity = (capacity > 0 ? 2 * capacity : 1024);
+                    grown = realloc(edges, capacity * sizeof(cbst_edge));
+                    if(grown == NULL)
+                    {
+                        pthread_mutex_lock(&(sweep->lock));
+                        sweep->failed = ARROW_TRUE;
+                        goto CLEANUP;
+                    }
+                    edges = grown;
                 }
+                edges[count].cost = cost;
+                edges[count].edge = u * n + v;
+                count++;
             }
         }
+
+        pthread_mutex_lock(&(sweep->lock));
+        if(!cbst_sweep_add(sweep, edges, count))
+            sweep->failed = ARROW_TRUE;
     }
+
+CLEANUP:
+    pthread_mutex_unlock(&(sweep->lock));
+    if(edges != NULL) free(edges);
+    return NULL;
 }
 
 int
-init_data(int n, arrow_heap *heap, int **cur_tree, int **in_heap, int **d)
+cbst_sweep_add(cbst_sweep *sweep, cbst_edge *edges, int count)
 {
-    int i;
-    
-    if(!arrow_heap_init(heap, n))
-        goto CLEANUP;
-    if(!arrow_util_create_int_array(n, cur_tree))
-        goto CLEANUP;
-    if(!arrow_util_create_int_array(n, in_heap))
-        goto CLEANUP;
-    if(!arrow_util_create_int_array(n, d))
-        goto CLEANUP;
-        
-    
-    for(i = 0; i < n; i++)
+    int capacity;
+    cbst_edge *grown;
+
+    if(sweep->count + count > sweep->capacity)
     {
-        (*cur_tree)[i] = 0;
-        (*in_heap)[i] = 0;
-        (*d)[i] = 0;
+        capacity = (sweep->capacity > 0 ? 2 * sweep->capacity : 1024);
+        if(capacity < sweep->count + count)
+            capacity = sweep->count + count;
+        grown = realloc(sweep->edges, capacity * sizeof(cbst_edge));
+        if(grown == NULL)
+            return ARROW_FAILURE;
+        sweep->edges = grown;
+        sweep->capacity = capacity;
     }
-    
+    if(count > 0)
+        memcpy(sweep->edges + sweep->count, edges, count * sizeof(cbst_edge));
+    sweep->count += count;
     return ARROW_SUCCESS;
+}
 
-CLEANUP:
-    destroy_data(heap, cur_tree, in_heap, d);
-    return ARROW_FAILURE;
+int
+cbst_edge_compare(const void *a, const void *b)
+{
+    const cbst_edge *x = (const cbst_edge *)a;
+    const cbst_edge *y = (const cbst_edge *)b;
+
+    if(x->cost != y->cost)
+        return (x->cost < y->cost ? -1 : 1);
+    if(x->edge != y->edge)
+        return (x->edge < y->edge ? -1 : 1);
+    return 0;
 }
 
-void
-destroy_data(arrow_heap *heap, int **cur_tree, int **in_heap, int **d)
+int
+cbst_find(int *set, int u)
 {
-    arrow_heap_destruct(heap);
-    if(*in_heap != NULL) free(*in_heap); *in_heap = NULL;
-    if(*d != NULL) free(*d); *d = NULL;
-    if(*cur_tree != NULL) free(*d); *cur_tree = NULL;
+    while(set[u] != u)
+    {
+        set[u] = set[set[u]];
+        u = set[u];
+    }
+    return u;
+}
+
+int
+cbst_tree_orient(int n, int *chosen, int *tree)
+{
+    int ret = ARROW_SUCCESS;
+    int i, u, v, head, tail;
+    int *start = NULL;
+    int *adj = NULL;
+    int *queue = NULL;
+
+    if(!arrow_util_create_int_array(n + 1, &start) ||
+       !arrow_util_create_int_array(2 * (n - 1), &adj) ||
+       !arrow_util_create_int_array(n, &queue))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+
+    /* Adjacency lists, by counting each node's edges first */
+    for(u = 0; u <= n; u++)
+        start[u] = 0;
+    for(i = 0; i < n - 1; i++)
+    {
+        start[chosen[i] / n + 1]++;
+        start[chosen[i] % n + 1]++;
+    }
+    for(u = 0; u < n; u++)
+        start[u + 1] += start[u];
+    for(i = 0; i < n - 1; i++)
+    {
+        u = chosen[i] / n;
+        v = chosen[i] % n;
+        adj[start[u]++] = v;
+        adj[start[v]++] = u;
+    }
+    for(u = n; u > 0; u--)
+        start[u] = start[u - 1];
+    start[0] = 0;
+
+    /* Breadth first from node 0 */
+    for(u = 0; u < n; u++)
+        tree[u] = -2;
+    tree[0] = -1;
+    queue[0] = 0;
+    head = 0;
+    tail = 1;
+    while(head < tail)
+    {
+        u = queue[head++];
+        for(i = start[u]; i < start[u + 1]; i++)
+        {
+            v = adj[i];
+            if(tree[v] == -2)
+            {
+                tree[v] = u;
+                queue[tail++] = v;
+            }
+        }
+    }
+
+CLEANUP:
+    if(start != NULL) free(start);
+    if(adj != NULL) free(adj);
+    if(queue != NULL) free(queue);
+    return ret;
 }
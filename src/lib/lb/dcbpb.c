@@ -4,23 +4,98 @@
  *  Implemenation of the degree constrained bottleneck paths bound (DCBPB) 
  *  used as a lower bound for the Bottleneck TSP objective value.
  *
+ *  On symmetric problems a bottleneck path costs the largest edge on the
+ *  path through a minimum spanning tree, so the largest bottleneck path out
+ *  of any node of G-i is just the largest edge of the MST of G-i.  Those
+ *  MSTs are found by patching the MST of G back together after taking i
+ *  out, with one node i per thread.
+ *
  *  @author  John LaRusic
  *  @ingroup lib
  ****************************************************************************/
 #include "common.h"
 #include "lb.h"
 
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  An edge of a symmetric problem, for sorting by cost.
+ */
+typedef struct dcbpb_edge
+{
+    int cost;                   /**< cost of the edge */
+    int edge;                   /**< edge as u * n + v, with v < u */
+} dcbpb_edge;
+
+/**
+ *  @brief  State shared by the threads working out the symmetric bound.
+ */
+typedef struct dcbpb_mst
+{
+    pthread_mutex_t lock;       /**< guards next, bottleneck and failed */
+    int next;                   /**< next node to take out */
+    int bottleneck;             /**< best bound found so far */
+    int failed;                 /**< ARROW_TRUE if a thread failed */
+    arrow_problem *problem;     /**< problem data */
+    arrow_context *context;     /**< solve context (can be NULL) */
+    int m;                      /**< number of edges */
+    dcbpb_edge *edges;          /**< every edge, sorted by cost */
+    int *tree;                  /**< positions in edges of the MST's n - 1
+                                     edges, in order of cost */
+} dcbpb_mst;
+
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Solves the DCBPB on a symmetric problem with minimum spanning
+ *          trees.
+ *  @param  problem [in] problem data (symmetric, at least 3 nodes)
+ *  @param  context [in] solve context (can be NULL)
+ *  @param  bottleneck [out] the bound
+ */
+int
+dcbpb_mst_solve(arrow_problem *problem, arrow_context *context,
+                int *bottleneck);
+
 /**
- *  @brief  Solves the all-pairs bottleneck paths problem (a simple
- *          modification of the Floyd-Warshall alg for all-pairs shortest
- *          paths).
- *  @param  problem [in] problem data
+ *  @brief  Takes nodes out of the graph until there are none left, working
+ *          out the bound each gives.
+ *  @param  arg [in] a dcbpb_mst structure
+ */
+void *
+dcbpb_mst_worker(void *arg);
+
+/**
+ *  @brief  Finds the representative of a node's set, halving the path.
+ *  @param  set [in/out] parent of each node in the union-find forest
+ *  @param  u [in] node
+ *  @return representative of u's set
+ */
+int
+dcbpb_find(int *set, int u);
+
+/**
+ *  @brief  Orders edges by cost.
+ */
+int
+dcbpb_edge_compare(const void *a, const void *b);
+
+/**
+ *  @brief  Solves the all-pairs bottleneck paths problem on G - ignore (a
+ *          simple modification of the Floyd-Warshall alg for all-pairs
+ *          shortest paths).
+ *  @param  n [in] number of nodes
+ *  @param  cost [in] cost matrix of the problem
  *  @param  ignore [in] vertex number to ignore
- *  @param  b [out] array will hold bottleneck path value for each
- *              pair of source/sink nodes
+ *  @param  b [out] (n - 1) x (n - 1) matrix, stored row after row, will hold
+ *              the bottleneck path value for each pair of source/sink nodes
+ *              other than ignore (nodes after ignore move up by one)
  */
-void
-bottleneck_paths(arrow_problem *problem, int ignore, int **b);
+int
+bottleneck_paths(int n, int **cost, int ignore, int *b);
 
 /*
  *  @brief  Returns the max of the four values
@@ -37,10 +112,11 @@ max(int i, int j, int k, int l);
  * Public function implementations
  ****************************************************************************/
 int
-arrow_dcbpb_solve(arrow_problem *problem, arrow_bound_result *result)
+arrow_dcbpb_solve(arrow_problem *problem, arrow_context *context,
+                  arrow_bound_result *result)
 {
     int ret = ARROW_SUCCESS;
-    int i, j, k;
+    int i, j, k, bj, bk;
     int bottleneck, max_tree, min_node;
     int in_cost, out_cost;
     int n = problem->size;
@@ -48,8 +124,23 @@ arrow_dcbpb_solve(arrow_problem *problem, arrow_bound_result *result)
     
     start_time = arrow_util_zeit();
     
-    int *alpha;
-    int *gamma;
+    int *alpha = NULL;
+    int *gamma = NULL;
+    int **cost = NULL;
+    int *cost_space = NULL;
+    int *b = NULL;
+    
+    /* Symmetric problems don't need the all-pairs bottleneck paths */
+    if(problem->symmetric && (n >= 3) && (n <= 46340))
+    {
+        if(!dcbpb_mst_solve(problem, context, &bottleneck))
+            return ARROW_FAILURE;
+        end_time = arrow_util_zeit();
+        result->obj_value = bottleneck;
+        result->total_time = end_time - start_time;
+        return ARROW_SUCCESS;
+    }
+    
     if(!arrow_util_create_int_array(n, &alpha))
     {
         ret = ARROW_FAILURE;
@@ -61,89 +152,81 @@ arrow_dcbpb_solve(arrow_problem *problem, arrow_bound_result *result)
         goto CLEANUP;
     }
     
-    int **b;
-    int *b_space;
-    if(!arrow_util_create_int_matrix(n, n, &b, &b_space))
+    /* Costs are read once, rather than once for every node taken out */
+    if(!arrow_util_create_int_matrix(n, n, &cost, &cost_space))
     {
         ret = ARROW_FAILURE;
         goto CLEANUP;
     }
+    for(i = 0; i < n; i++)
+    {
+        for(j = 0; j < n; j++)
+            cost[i][j] = problem->get_cost(problem, i, j);
+    }
     
+    if(n > 1)
+    {
+        if((b = malloc((n - 1) * (n - 1) * sizeof(int))) == NULL)
+        {
+            arrow_print_error("Could not allocate memory for bottleneck paths");
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+    }
     
     bottleneck = INT_MIN;
 
     for(i = 0; i < n; i++)
     {
-        bottleneck_paths(problem, i, b);
-        min_node = INT_MAX;
-        
-        /*
-        printf("P^%d\t", i);
-        for(j = 0; j < n; j++)
-            if(j != i)
-                printf("[%d]\t", j);
-        printf("\n");
+        /* Each node gives a bound of its own, so stopping early still
+           leaves the best of those seen so far */
+        if(arrow_context_should_stop(context))
+            break;
         
-        for(j = 0; j < n; j++)
+        if(!bottleneck_paths(n, cost, i, b))
         {
-            if(j != i)
-            {
-                printf("[%d]\t", j);
-                for(k = 0; k < n; k++)
-                {
-                    if((k != j) && (k != i))
-                    {
-                        printf("%d\t", b[j][k]);
-                    }
-                    else if(j == k)
-                        printf("-\t");
-                }
-                printf("\n");
-            }
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
         }
-        */
+        min_node = INT_MAX;
         
         /* Find the largest bottleneck path values leaving (alpha[j]) and 
-           entering (gamma[j]) of nodes j and k */
+           entering (gamma[j]) of nodes j and k; in b, nodes after i are
+           one row and column up */
         for(j = 0; j < n; j++)
         {
             if(j != i)
             {
                 alpha[j] = INT_MIN;
                 gamma[j] = INT_MIN;
+                bj = (j < i ? j : j - 1);
              
                 for(k = 0; k < n; k++)
                 {
                     if((k != j) && (k != i))
                     {
-                        if(alpha[j] < b[j][k]) alpha[j] = b[j][k];
-                        if(gamma[j] < b[k][j]) gamma[j] = b[k][j];
+                        bk = (k < i ? k : k - 1);
+                        if(alpha[j] < b[bj * (n - 1) + bk])
+                            alpha[j] = b[bj * (n - 1) + bk];
+                        if(gamma[j] < b[bk * (n - 1) + bj])
+                            gamma[j] = b[bk * (n - 1) + bj];
                     }
                 }
             }
         }
         
-        /*
-        for(j = 0; j < n; j++)
-        {
-            if(j != i)
-                printf("alpha[%d] = %d; gamma[%d] = %d\n", j, alpha[j], j, gamma[j]);
-        }  
-        printf("\n");
-        */
-        
         for(j = 0; j < n; j++)
         {
             if(j != i)
             {
-                out_cost = problem->get_cost(problem, i, j);
+                out_cost = cost[i][j];
                 if(out_cost < min_node)
                 {
                     for(k = 0; k < n; k++)
                     {
                         if((k != i))
                         {
-                            in_cost = problem->get_cost(problem, k, i);
+                            in_cost = cost[k][i];
                             if(in_cost < min_node)
                             {
                                 max_tree = 
@@ -167,7 +250,8 @@ arrow_dcbpb_solve(arrow_problem *problem, arrow_bound_result *result)
 CLEANUP:
     if(alpha != NULL) free(alpha);
     if(gamma != NULL) free(gamma);
-    if(b_space != NULL) free(b_space);
+    if(cost_space != NULL) free(cost_space);
+    if(cost != NULL) free(cost);
     if(b != NULL) free(b);
     return ret;
 }
@@ -175,41 +259,235 @@ CLEANUP:
 /****************************************************************************
  * Private function implementations
  ****************************************************************************/
-void
-bottleneck_paths(arrow_problem *problem, int ignore, int **b)
+int
+dcbpb_mst_solve(arrow_problem *problem, arrow_context *context,
+                int *bottleneck)
 {
-    int i, j, k, max;
-    
-    /* Initialize! */
-    for(i = 0; i < problem->size; i++)
+    int ret = ARROW_SUCCESS;
+    int i, u, v, ru, rv, count, started;
+    int n = problem->size;
+    int threads = 1;
+    long processors;
+    int *set = NULL;
+    pthread_t *thread_ids = NULL;
+    dcbpb_mst mst;
+
+    mst.next = 0;
+    mst.bottleneck = INT_MIN;
+    mst.failed = ARROW_FALSE;
+    mst.problem = problem;
+    mst.context = context;
+    mst.m = n * (n - 1) / 2;
+    mst.edges = NULL;
+    mst.tree = NULL;
+
+    if((mst.edges = malloc(mst.m * sizeof(dcbpb_edge))) == NULL)
     {
-        for(j = 0; j < problem->size; j++)
-            b[i][j] = problem->get_cost(problem, i, j);
-        b[i][i] = INT_MAX;
+        arrow_print_error("Could not allocate memory for DCBPB edges");
+        return ARROW_FAILURE;
     }
-    
-    /* Dynamic programming technique GO! */
-    for(k = 0; k < problem->size; k++)
+    if(!arrow_util_create_int_array(n - 1, &(mst.tree)) ||
+       !arrow_util_create_int_array(n, &set))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+
+    /* Kruskal's algorithm for the MST of the whole graph */
+    i = 0;
+    for(u = 0; u < n; u++)
+    {
+        for(v = 0; v < u; v++)
+        {
+            mst.edges[i].cost = problem->get_cost(problem, u, v);
+            mst.edges[i].edge = u * n + v;
+            i++;
+        }
+    }
+    qsort(mst.edges, mst.m, sizeof(dcbpb_edge), dcbpb_edge_compare);
+
+    for(u = 0; u < n; u++)
+        set[u] = u;
+    count = 0;
+    for(i = 0; (i < mst.m) && (count < n - 1); i++)
+    {
+        ru = dcbpb_find(set, mst.edges[i].edge / n);
+        rv = dcbpb_find(set, mst.edges[i].edge % n);
+        if(ru != rv)
+        {
+            set[ru] = rv;
+            mst.tree[count++] = i;
+        }
+    }
+
+    /* Each node's bound is independent of the others */
+    processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if(processors > 1)
+        threads = (processors < n ? (int)processors : n);
+    if(pthread_mutex_init(&(mst.lock), NULL) != 0)
+    {
+        arrow_print_error("Could not create DCBPB lock");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if((thread_ids = malloc(threads * sizeof(pthread_t))) == NULL)
+        threads = 1;
+
+    started = 0;
+    for(i = 1; i < threads; i++)
+    {
+        if(pthread_create(&(thread_ids[started]), NULL, dcbpb_mst_worker,
+                          &mst) != 0)
+            break;
+        started++;
+    }
+    dcbpb_mst_worker(&mst);
+    for(i = 0; i < started; i++)
+        pthread_join(thread_ids[i], NULL);
+    pthread_mutex_destroy(&(mst.lock));
+
+    if(mst.failed)
+        ret = ARROW_FAILURE;
+    *bottleneck = mst.bottleneck;
+
+CLEANUP:
+    if(thread_ids != NULL) free(thread_ids);
+    if(set != NULL) free(set);
+    if(mst.tree != NULL) free(mst.tree);
+    if(mst.edges != NULL) free(mst.edges);
+    return ret;
+}
+
+void *
+dcbpb_mst_worker(void *arg)
+{
+    dcbpb_mst *mst = (dcbpb_mst *)arg;
+    arrow_problem *problem = mst->problem;
+    int n = problem->size;
+    int i, j, k, u, v, ru, rv, cost, components;
+    int tree_max, min_cost, node_bound;
+    int *set = NULL;
+
+    if(!arrow_util_create_int_array(n, &set))
+    {
+        pthread_mutex_lock(&(mst->lock));
+        mst->failed = ARROW_TRUE;
+        pthread_mutex_unlock(&(mst->lock));
+        return NULL;
+    }
+
+    /* Each node gives a bound of its own, so stopping early still leaves
+       the best of those seen so far */
+    while(!arrow_context_should_stop(mst->context))
     {
-        if(k != ignore)
+        pthread_mutex_lock(&(mst->lock));
+        i = mst->next;
+        if(i < n)
+            mst->next++;
+        pthread_mutex_unlock(&(mst->lock));
+        if(i >= n)
+            break;
+
+        /* The MST without the edges at i falls apart into a forest... */
+        for(u = 0; u < n; u++)
+            set[u] = u;
+        components = n - 1;
+        tree_max = INT_MIN;
+        for(k = 0; k < n - 1; k++)
+        {
+            u = mst->edges[mst->tree[k]].edge / n;
+            v = mst->edges[mst->tree[k]].edge % n;
+            if((u == i) || (v == i))
+                continue;
+            set[dcbpb_find(set, u)] = dcbpb_find(set, v);
+            tree_max = mst->edges[mst->tree[k]].cost;
+            components--;
+        }
+
+        /* ...that the cheapest edges avoiding i join back into the MST of
+           G-i */
+        for(k = 0; (k < mst->m) && (components > 1); k++)
         {
-            for(i = 0; i < problem->size; i++)
+            u = mst->edges[k].edge / n;
+            v = mst->edges[k].edge % n;
+            if((u == i) || (v == i))
+                continue;
+            ru = dcbpb_find(set, u);
+            rv = dcbpb_find(set, v);
+            if(ru != rv)
             {
-                if((i != ignore) && (k != i))
-                {
-                    for(j = 0; j < problem->size; j++)
-                    {
-                        if((j != ignore) && (k != j) && (i != j))
-                        {
-                            max = (b[i][k] > b[k][j] ? b[i][k] : b[k][j]);
-                            if(max < b[i][j])
-                                b[i][j] = max;
-                        }
-                    }
-                }
+                set[ru] = rv;
+                if(mst->edges[k].cost > tree_max)
+                    tree_max = mst->edges[k].cost;
+                components--;
+            }
+        }
+
+        /* The tour enters and leaves i along its cheapest edges */
+        min_cost = INT_MAX;
+        for(j = 0; j < n; j++)
+        {
+            if(j != i)
+            {
+                cost = problem->get_cost(problem, i, j);
+                if(cost < min_cost) min_cost = cost;
             }
         }
+        node_bound = (tree_max > min_cost ? tree_max : min_cost);
+
+        pthread_mutex_lock(&(mst->lock));
+        if(mst->bottleneck < node_bound)
+            mst->bottleneck = node_bound;
+        pthread_mutex_unlock(&(mst->lock));
     }
+
+    free(set);
+    return NULL;
+}
+
+int
+dcbpb_find(int *set, int u)
+{
+    while(set[u] != u)
+    {
+        set[u] = set[set[u]];
+        u = set[u];
+    }
+    return u;
+}
+
+int
+dcbpb_edge_compare(const void *a, const void *b)
+{
+    const dcbpb_edge *x = (const dcbpb_edge *)a;
+    const dcbpb_edge *y = (const dcbpb_edge *)b;
+
+    if(x->cost != y->cost)
+        return (x->cost < y->cost ? -1 : 1);
+    return (x->edge < y->edge ? -1 : (x->edge > y->edge ? 1 : 0));
+}
+
+int
+bottleneck_paths(int n, int **cost, int ignore, int *b)
+{
+    int i, j, bi;
+    int m = n - 1;
+    
+    /* Initialize with G - ignore; a node is never on a path to itself */
+    for(i = 0; i < n; i++)
+    {
+        if(i == ignore)
+            continue;
+        bi = (i < ignore ? i : i - 1) * m;
+        for(j = 0; j < ignore; j++)
+            b[bi + j] = cost[i][j];
+        for(j = ignore + 1; j < n; j++)
+            b[bi + j - 1] = cost[i][j];
+    }
+    for(i = 0; i < m; i++)
+        b[i * m + i] = INT_MAX;
+    
+    return arrow_closure_minimax(m, b, 0);
 }
 
 int
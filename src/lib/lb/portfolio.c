@@ -0,0 +1,176 @@
+/**********************************************************doxygen*//** @file
+ *  @brief   Lower bound portfolio.
+ *
+ *  Runs the Bottleneck TSP lower bounds side by side, sharing the best
+ *  bound found so far between them, and returns the largest.
+ *
+ *  @author  John LaRusic
+ *  @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+#include "lb.h"
+
+#define PORTFOLIO_COUNT 4
+#define PORTFOLIO_BAP 0
+#define PORTFOLIO_BBSSP 1
+#define PORTFOLIO_BSCSSP 2
+#define PORTFOLIO_DCBPB 3
+
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  State shared by the portfolio's solver threads.
+ */
+typedef struct portfolio
+{
+    pthread_mutex_t lock;       /**< guards everything below */
+    arrow_problem *problem;     /**< problem data */
+    arrow_problem_info *info;   /**< problem info */
+    arrow_context shared;       /**< deadline and best bound for the solvers */
+    arrow_context *caller;      /**< caller's context (may be NULL) */
+    int best;                   /**< best lower bound found so far */
+    int failed;                 /**< ARROW_TRUE if any solver failed */
+} portfolio;
+
+/**
+ *  @brief  Arguments for one solver thread.
+ */
+typedef struct portfolio_thread
+{
+    portfolio *portfolio;       /**< shared portfolio state */
+    int solver;                 /**< which bound to solve */
+} portfolio_thread;
+
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Solves one lower bound and shares its value with the rest of the
+ *          portfolio.
+ *  @param  arg [in] a portfolio_thread structure
+ */
+void *
+portfolio_run(void *arg);
+
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+int
+arrow_lb_portfolio_solve(arrow_problem *problem, arrow_problem_info *info,
+                         double timebound, arrow_context *context,
+                         arrow_bound_result *result)
+{
+    int ret = ARROW_SUCCESS;
+    int i, started;
+    double start_time = arrow_util_zeit();
+    arrow_bound_result bound;
+    portfolio pf;
+    portfolio_thread args[PORTFOLIO_COUNT];
+    pthread_t thread_ids[PORTFOLIO_COUNT];
+
+    /* The 2MB takes no time at all, so it seeds the others */
+    if(!arrow_2mb_solve(problem, &bound))
+        return ARROW_FAILURE;
+
+    if(pthread_mutex_init(&(pf.lock), NULL) != 0)
+    {
+        arrow_print_error("Could not create portfolio lock");
+        return ARROW_FAILURE;
+    }
+    pf.problem = problem;
+    pf.info = info;
+    pf.caller = context;
+    pf.best = bound.obj_value;
+    pf.failed = ARROW_FALSE;
+    arrow_context_init_child(&(pf.shared), context);
+    arrow_context_set_timebound(&(pf.shared), timebound);
+    arrow_context_raise_lower_bound(&(pf.shared), pf.best);
+    arrow_context_progress(context, "2mb", pf.best, info->max_cost);
+
+    /* If a thread can't be created, its bound runs in this one instead */
+    started = 0;
+    for(i = 0; i < PORTFOLIO_COUNT; i++)
+    {
+        /* Strong connectivity says nothing more than biconnectivity on a
+           symmetric problem */
+        if((i == PORTFOLIO_BSCSSP) && problem->symmetric)
+            continue;
+
+        args[started].portfolio = &pf;
+        args[started].solver = i;
+        if(pthread_create(&(thread_ids[started]), NULL, portfolio_run,
+                          &(args[started])) != 0)
+        {
+            arrow_debug("Running bound %d without a thread.\n", i);
+            portfolio_run(&(args[started]));
+        }
+        else
+            started++;
+    }
+    for(i = 0; i < started; i++)
+        pthread_join(thread_ids[i], NULL);
+
+    if(pf.failed)
+        ret = ARROW_FAILURE;
+
+    result->obj_value = pf.best;
+    result->total_time = arrow_util_zeit() - start_time;
+
+    pthread_mutex_destroy(&(pf.lock));
+    return ret;
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+void *
+portfolio_run(void *arg)
+{
+    portfolio_thread *thread = (portfolio_thread *)arg;
+    portfolio *pf = thread->portfolio;
+    arrow_problem *problem = pf->problem;
+    arrow_problem_info *info = pf->info;
+    arrow_context *context = &(pf->shared);
+    arrow_bound_result bound;
+    const char *name;
+    int ret;
+
+    bound.obj_value = -1;
+    switch(thread->solver)
+    {
+        case PORTFOLIO_BAP:
+            name = "bap";
+            ret = arrow_bap_solve(problem, info, context, &bound);
+            break;
+        case PORTFOLIO_BBSSP:
+            name = "bbssp";
+            ret = arrow_bbssp_solve(problem, info, context, &bound);
+            break;
+        case PORTFOLIO_BSCSSP:
+            name = "bscssp";
+            ret = arrow_bscssp_solve(problem, info, context, &bound);
+            break;
+        default:
+            name = "dcbpb";
+            ret = arrow_dcbpb_solve(problem, context, &bound);
+    }
+
+    /* A bound of -1 means the solver found no structure at all, which tells
+       the others nothing */
+    pthread_mutex_lock(&(pf->lock));
+    if(!ret)
+        pf->failed = ARROW_TRUE;
+    else if(bound.obj_value > pf->best)
+    {
+        pf->best = bound.obj_value;
+        arrow_context_raise_lower_bound(context, pf->best);
+    }
+    arrow_context_progress(pf->caller, name, pf->best, info->max_cost);
+    pthread_mutex_unlock(&(pf->lock));
+
+    return NULL;
+}
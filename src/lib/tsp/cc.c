@@ -34,6 +34,16 @@ arrow_edgelen(int i, int j, struct CCdatagroup *dat);
 static int
 arrow_copy(int ncount, struct CCdatagroup *in, struct CCdatagroup *out);
 
+/**
+ *  @brief  Time bound for a single LK call, which may not outlast the
+ *          deadline of the solve context.
+ *  @param  params [in] LK parameters
+ *  @param  context [in] solve context (can be NULL)
+ *  @return the time bound to pass to Concorde (0.0 for none)
+ */
+static double
+lk_time_bound(arrow_tsp_cc_lk_params *params, arrow_context *context);
+
 
 /****************************************************************************
  * Public function implementations
@@ -60,10 +70,13 @@ arrow_tsp_cc_lk_params_destruct(arrow_tsp_cc_lk_params *params)
 
 int 
 arrow_tsp_cc_exact_solve(arrow_problem *problem, int *initial_tour, 
-                      arrow_tsp_result *result)
+                         arrow_context *context, arrow_tsp_result *result)
 {
     int ret;
     int success;
+    int hit_timebound = ARROW_FALSE;
+    double timebound;
+    double *timebound_ptr = NULL;
     double start_time, end_time;
     CCdatagroup *dat;
     CCdatagroup arrow_data;
@@ -88,6 +101,19 @@ arrow_tsp_cc_exact_solve(arrow_problem *problem, int *initial_tour,
     
     arrow_debug("TSP Problem Name: '%s'\n", problem->name);
     
+    /* Nothing to do if the context has already run out */
+    if(arrow_context_should_stop(context))
+    {
+        result->found_tour = ARROW_FALSE;
+        result->total_time = arrow_util_zeit() - start_time;
+        return ARROW_SUCCESS;
+    }
+    
+    /* Hand whatever time the context has left over to Concorde */
+    timebound = arrow_context_remaining(context);
+    if(timebound < DBL_MAX)
+        timebound_ptr = &timebound;
+    
     CCutil_sprand((int)CCutil_real_zeit(), &rstate);
     ret = CCtsp_solve_dat(
             problem->size,          // int ncount
@@ -99,14 +125,22 @@ arrow_tsp_cc_exact_solve(arrow_problem *problem, int *initial_tour,
             &success,               // int *success
             &(result->found_tour),  // int *foundtour
             problem->name,          // char *name
-            NULL,                   // double *timebound
-            NULL,                   // int *hit_timebound
+            timebound_ptr,          // double *timebound
+            &hit_timebound,         // int *hit_timebound
             1,                      // int silent
             &rstate                 // CCrandstate *rstate
         );
     
     end_time = arrow_util_zeit();
     result->total_time = end_time - start_time;
+    
+    /* Running out of time is not an error: the caller gets the best tour
+       Concorde had, if any, and is expected to check the context. */
+    if(hit_timebound)
+    {
+        arrow_debug("Concorde hit its time bound\n");
+        return ARROW_SUCCESS;
+    }
         
     if(result->found_tour && success)
         return ARROW_SUCCESS;
@@ -116,7 +150,7 @@ arrow_tsp_cc_exact_solve(arrow_problem *problem, int *initial_tour,
 
 int
 arrow_tsp_cc_lk_solve(arrow_problem *problem, arrow_tsp_cc_lk_params *params,
-                      arrow_tsp_result *result)
+                      arrow_context *context, arrow_tsp_result *result)
 {
     int ret = ARROW_SUCCESS;
     int cc_ret;
@@ -176,6 +210,7 @@ arrow_tsp_cc_lk_solve(arrow_problem *problem, arrow_tsp_cc_lk_params *params,
     arrow_debug("     - time_bound = %1.2f\n", lk_params.time_bound);
     arrow_debug("     - length_bound = %.0f\n", lk_params.length_bound);
     */
+    
     CCutil_sprand((int)CCutil_real_zeit(), &rstate);
     
     /* cyc temporarily holds a tour found by the LK algorithm */
@@ -223,10 +258,11 @@ arrow_tsp_cc_lk_solve(arrow_problem *problem, arrow_tsp_cc_lk_params *params,
     /* Initial LK call */
     arrow_debug(" - Initial call to the LK algorithm...\n");
     cc_ret = CClinkern_tour(problem->size, dat, ecount, elist, 
-                            params->stall_count, params->kicks,
+                            lk_params.stall_count, lk_params.kicks,
                             cyc, bestcyc, &bestval, 1, 
-                            params->time_bound, params->length_bound,
-                            (char *) NULL, params->kick_type, &rstate);
+                            lk_time_bound(&lk_params, context), 
+                            lk_params.length_bound,
+                            (char *) NULL, lk_params.kick_type, &rstate);
     arrow_debug("     - Found tour of length '%.0f'.\n", bestval);
     if(cc_ret == CONCORDE_FAILURE)
     {
@@ -239,13 +275,19 @@ arrow_tsp_cc_lk_solve(arrow_problem *problem, arrow_tsp_cc_lk_params *params,
     for(i = 0; (i < lk_params.random_restarts) 
         && (bestval > lk_params.length_bound); i++)
     {
+        if(arrow_context_should_stop(context))
+        {
+            arrow_debug(" - Stopping random restarts early.\n");
+            break;
+        }
         arrow_debug(" - Trial %d of %d to LK algorithm...\n", i + 1, 
                     lk_params.random_restarts);
         cc_ret = CClinkern_tour(problem->size, dat, ecount, 
-                                elist, params->stall_count, params->kicks,
+                                elist, lk_params.stall_count, lk_params.kicks,
                                 (int *) NULL, cyc, &val, 1, 
-                                params->time_bound, params->length_bound,
-                                (char *) NULL, params->kick_type, &rstate);
+                                lk_time_bound(&lk_params, context), 
+                                lk_params.length_bound,
+                                (char *) NULL, lk_params.kick_type, &rstate);
         arrow_debug("     - Found tour of length '%.0f'.\n", val);
         if(cc_ret == CONCORDE_FAILURE)
         {
@@ -261,14 +303,17 @@ arrow_tsp_cc_lk_solve(arrow_problem *problem, arrow_tsp_cc_lk_params *params,
         }
     }
     
-    if((lk_params.random_restarts > 0) && (bestval > lk_params.length_bound))
+    if((lk_params.random_restarts > 0) && (bestval > lk_params.length_bound)
+       && !arrow_context_should_stop(context))
     {
         arrow_debug(" - Final attempt to find tour...\n");
         cc_ret = CClinkern_tour(problem->size, dat, ecount, 
-                                elist, params->stall_count, 2 * params->kicks,
+                                elist, lk_params.stall_count, 
+                                2 * lk_params.kicks,
                                 bestcyc, result->tour, &(result->obj_value),
-                                1, params->time_bound, params->length_bound,
-                                (char *) NULL, params->kick_type, &rstate);
+                                1, lk_time_bound(&lk_params, context), 
+                                lk_params.length_bound,
+                                (char *) NULL, lk_params.kick_type, &rstate);
         arrow_debug("     - Found tour of length '%.0f'.\n", result->obj_value);
         if(cc_ret == CONCORDE_FAILURE)
         {
@@ -371,3 +416,17 @@ arrow_copy(int ncount, struct CCdatagroup *in, struct CCdatagroup *out)
     CCutil_dat_setnorm(out, CC_USER);
     return 0;
 }
+
+static double
+lk_time_bound(arrow_tsp_cc_lk_params *params, arrow_context *context)
+{
+    double remaining = arrow_context_remaining(context);
+    
+    if(remaining == DBL_MAX)
+        return params->time_bound;
+    if((params->time_bound > 0.0) && (params->time_bound < remaining))
+        return params->time_bound;
+    
+    /* Concorde treats a zero bound as no bound at all */
+    return (remaining > 0.0 ? remaining : DBL_MIN);
+}
@@ -0,0 +1,490 @@
+/**********************************************************doxygen*//** @file
+ *  @brief   Posa rotation-extension Hamiltonian cycle heuristic.
+ *
+ *  Looks for a Hamiltonian cycle in the graph of cheap edges using Posa's
+ *  rotation-extension method with random restarts.  Used on a feasibility
+ *  problem, this finds a "zero-length" tour directly rather than running a
+ *  full TSP heuristic over the transformed cost matrix.
+ *
+ *  @author  John LaRusic
+ *  @ingroup lib
+ ****************************************************************************/
+#include "common.h"
+#include "tsp.h"
+
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  Sparse threshold graph in compressed adjacency form.
+ */
+typedef struct posa_graph
+{
+    int size;       /**< number of nodes */
+    int *start;     /**< neighbours of i are adj[start[i]..start[i+1]-1] */
+    int *adj;       /**< adjacency lists, fixed (negative cost) edges first */
+    int *fixed;     /**< fixed[i] is the number of fixed edges at node i */
+} posa_graph;
+
+/**
+ *  @brief  Path being grown by rotations and extensions.
+ */
+typedef struct posa_path
+{
+    int length;     /**< number of nodes in the path */
+    int *nodes;     /**< nodes in path order */
+    int *pos;       /**< pos[i] is the index of node i in nodes, or -1 */
+} posa_path;
+
+
+/****************************************************************************
+ * Private function prototypes
+ ****************************************************************************/
+/**
+ *  @brief  Builds the graph of edges whose cost is at most the threshold.
+ *  @param  problem [in] problem data
+ *  @param  threshold [in] largest edge cost included in the graph
+ *  @param  graph [out] graph structure
+ */
+int
+posa_graph_init(arrow_problem *problem, int threshold, posa_graph *graph);
+
+/**
+ *  @brief  Destructs a graph structure.
+ *  @param  graph [out] graph structure
+ */
+void
+posa_graph_destruct(posa_graph *graph);
+
+/**
+ *  @brief  Determines if edge (u, v) is a fixed edge.
+ *  @param  graph [in] graph structure
+ *  @param  u [in] first node
+ *  @param  v [in] second node
+ *  @return ARROW_TRUE if (u, v) is fixed, ARROW_FALSE otherwise
+ */
+int
+posa_is_fixed(posa_graph *graph, int u, int v);
+
+/**
+ *  @brief  Determines if edge (u, v) is in the graph.
+ *  @param  graph [in] graph structure
+ *  @param  u [in] first node
+ *  @param  v [in] second node
+ *  @return ARROW_TRUE if (u, v) is an edge, ARROW_FALSE otherwise
+ */
+int
+posa_is_edge(posa_graph *graph, int u, int v);
+
+/**
+ *  @brief  Determines if a Hamiltonian path, closed into a cycle, uses every
+ *          fixed edge.  Extensions can pass over a fixed edge whose other
+ *          end is already on the path, so this is checked before a cycle is
+ *          accepted.
+ *  @param  graph [in] graph structure
+ *  @param  path [in] path through every node
+ *  @return ARROW_TRUE if every fixed edge is in the cycle
+ */
+int
+posa_has_fixed(posa_graph *graph, posa_path *path);
+
+/**
+ *  @brief  Tries to grow a Hamiltonian cycle from a random start node.
+ *  @param  graph [in] graph structure
+ *  @param  max_steps [in] rotations and extensions allowed before giving up
+ *  @param  context [in] solve context (can be NULL)
+ *  @param  seed [out] random number state
+ *  @param  path [out] on success, the Hamiltonian cycle in node-node order
+ *  @return ARROW_TRUE if a cycle was found, ARROW_FALSE otherwise
+ */
+int
+posa_attempt(posa_graph *graph, int max_steps, arrow_context *context,
+             unsigned int *seed, posa_path *path);
+
+/**
+ *  @brief  Extends the path from its end to a random unvisited neighbour
+ *          (preferring a fixed edge).
+ *  @param  graph [in] graph structure
+ *  @param  seed [out] random number state
+ *  @param  path [out] path structure
+ *  @return ARROW_TRUE if the path was extended, ARROW_FALSE otherwise
+ */
+int
+posa_extend(posa_graph *graph, unsigned int *seed, posa_path *path);
+
+/**
+ *  @brief  Performs a Posa rotation: picks a random neighbour u of the end
+ *          node, adds the edge from the end to u and removes the edge from u
+ *          to its successor, which becomes the new end.  Fixed edges are
+ *          never removed.
+ *  @param  graph [in] graph structure
+ *  @param  seed [out] random number state
+ *  @param  path [out] path structure
+ *  @return ARROW_TRUE if the path was rotated, ARROW_FALSE otherwise
+ */
+int
+posa_rotate(posa_graph *graph, unsigned int *seed, posa_path *path);
+
+
+/****************************************************************************
+ * Public function implementations
+ ****************************************************************************/
+void
+arrow_tsp_posa_params_init(arrow_problem *problem,
+                           arrow_tsp_posa_params *params)
+{
+    params->restarts = 10;
+    params->max_steps = 20 * problem->size;
+    params->threshold = 0;
+}
+
+int
+arrow_tsp_posa_solve(arrow_problem *problem, arrow_tsp_posa_params *params,
+                     arrow_context *context, arrow_tsp_result *result)
+{
+    int ret = ARROW_SUCCESS;
+    int i, k, u, v;
+    int n = problem->size;
+    unsigned int seed;
+    double start_time, end_time;
+    posa_graph graph;
+    posa_path path;
+
+    arrow_debug("Posa Parameters:\n");
+    arrow_debug(" - Restarts: %d\n", params->restarts);
+    arrow_debug(" - Max Steps: %d\n", params->max_steps);
+    arrow_debug(" - Threshold: %d\n", params->threshold);
+
+    start_time = arrow_util_zeit();
+    result->found_tour = ARROW_FALSE;
+    result->obj_value = DBL_MAX;
+
+    graph.start = NULL; graph.adj = NULL; graph.fixed = NULL;
+    path.nodes = NULL; path.pos = NULL;
+    if(!posa_graph_init(problem, params->threshold, &graph))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if(!arrow_util_create_int_array(n, &(path.nodes)))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if(!arrow_util_create_int_array(n, &(path.pos)))
+    {
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+
+    /* A node with fewer than two edges can't be on any cycle, and one with
+       more than two fixed edges can't be on a cycle that uses them all */
+    for(i = 0; i < n; i++)
+    {
+        if(graph.start[i + 1] - graph.start[i] < 2)
+        {
+            arrow_debug("Node %d has degree < 2; no cycle exists.\n", i);
+            goto DONE;
+        }
+        if(graph.fixed[i] > 2)
+        {
+            arrow_debug("Node %d has > 2 fixed edges; no cycle exists.\n", i);
+            goto DONE;
+        }
+    }
+
+    seed = (unsigned int)arrow_util_random();
+    for(i = 0; i <= params->restarts; i++)
+    {
+        if(arrow_context_should_stop(context))
+            break;
+        if(posa_attempt(&graph, params->max_steps, context, &seed, &path))
+        {
+            arrow_debug("Found Hamiltonian cycle on attempt %d\n", i + 1);
+            result->found_tour = ARROW_TRUE;
+            result->obj_value = 0.0;
+            for(k = 0; k < n; k++)
+            {
+                u = path.nodes[k];
+                v = path.nodes[(k + 1) % n];
+                result->tour[k] = u;
+                result->obj_value += problem->get_cost(problem, u, v);
+            }
+            break;
+        }
+    }
+
+DONE:
+    end_time = arrow_util_zeit();
+    result->total_time = end_time - start_time;
+
+CLEANUP:
+    posa_graph_destruct(&graph);
+    if(path.nodes != NULL) free(path.nodes);
+    if(path.pos != NULL) free(path.pos);
+    return ret;
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+int
+posa_graph_init(arrow_problem *problem, int threshold, posa_graph *graph)
+{
+    int i, j, cost;
+    int n = problem->size;
+    int *deg = NULL;
+    int *next_fixed = NULL;
+    int *next_free = NULL;
+
+    graph->size = n;
+    graph->start = NULL;
+    graph->adj = NULL;
+    graph->fixed = NULL;
+
+    /* First pass counts degrees so the adjacency lists can be packed */
+    if(!arrow_util_create_int_array(n + 1, &(graph->start)))
+        goto FAILURE;
+    if(!arrow_util_create_int_array(n, &(graph->fixed)))
+        goto FAILURE;
+    if(!arrow_util_create_int_array(n, &deg))
+        goto FAILURE;
+    for(i = 0; i < n; i++)
+    {
+        deg[i] = 0;
+        graph->fixed[i] = 0;
+    }
+    for(i = 0; i < n; i++)
+    {
+        for(j = i + 1; j < n; j++)
+        {
+            cost = problem->get_cost(problem, i, j);
+            if(cost <= threshold)
+            {
+                deg[i]++;
+                deg[j]++;
+                if(cost < 0)
+                {
+                    graph->fixed[i]++;
+                    graph->fixed[j]++;
+                }
+            }
+        }
+    }
+    graph->start[0] = 0;
+    for(i = 0; i < n; i++)
+        graph->start[i + 1] = graph->start[i] + deg[i];
+
+    /* Second pass fills the lists, fixed edges at the front of each */
+    if(!arrow_util_create_int_array(graph->start[n] + 1, &(graph->adj)))
+        goto FAILURE;
+    next_fixed = deg;
+    if(!arrow_util_create_int_array(n, &next_free))
+        goto FAILURE;
+    for(i = 0; i < n; i++)
+    {
+        next_fixed[i] = graph->start[i];
+        next_free[i] = graph->start[i] + graph->fixed[i];
+    }
+    for(i = 0; i < n; i++)
+    {
+        for(j = i + 1; j < n; j++)
+        {
+            cost = problem->get_cost(problem, i, j);
+            if(cost < 0)
+            {
+                graph->adj[next_fixed[i]++] = j;
+                graph->adj[next_fixed[j]++] = i;
+            }
+            else if(cost <= threshold)
+            {
+                graph->adj[next_free[i]++] = j;
+                graph->adj[next_free[j]++] = i;
+            }
+        }
+    }
+
+    free(deg);
+    free(next_free);
+    return ARROW_SUCCESS;
+
+FAILURE:
+    if(deg != NULL) free(deg);
+    if(next_free != NULL) free(next_free);
+    posa_graph_destruct(graph);
+    return ARROW_FAILURE;
+}
+
+void
+posa_graph_destruct(posa_graph *graph)
+{
+    if(graph->start != NULL)
+    {
+        free(graph->start);
+        graph->start = NULL;
+    }
+    if(graph->adj != NULL)
+    {
+        free(graph->adj);
+        graph->adj = NULL;
+    }
+    if(graph->fixed != NULL)
+    {
+        free(graph->fixed);
+        graph->fixed = NULL;
+    }
+}
+
+int
+posa_is_fixed(posa_graph *graph, int u, int v)
+{
+    int k;
+    for(k = graph->start[u]; k < graph->start[u] + graph->fixed[u]; k++)
+    {
+        if(graph->adj[k] == v)
+            return ARROW_TRUE;
+    }
+    return ARROW_FALSE;
+}
+
+int
+posa_is_edge(posa_graph *graph, int u, int v)
+{
+    int k;
+    for(k = graph->start[u]; k < graph->start[u + 1]; k++)
+    {
+        if(graph->adj[k] == v)
+            return ARROW_TRUE;
+    }
+    return ARROW_FALSE;
+}
+
+int
+posa_has_fixed(posa_graph *graph, posa_path *path)
+{
+    int k, u, used;
+    int n = graph->size;
+
+    for(k = 0; k < n; k++)
+    {
+        u = path->nodes[k];
+        if(graph->fixed[u] == 0)
+            continue;
+        used = posa_is_fixed(graph, u, path->nodes[(k + n - 1) % n]) +
+               posa_is_fixed(graph, u, path->nodes[(k + 1) % n]);
+        if(used < graph->fixed[u])
+            return ARROW_FALSE;
+    }
+    return ARROW_TRUE;
+}
+
+int
+posa_attempt(posa_graph *graph, int max_steps, arrow_context *context,
+             unsigned int *seed, posa_path *path)
+{
+    int i, step, first, last;
+    int n = graph->size;
+
+    for(i = 0; i < n; i++)
+        path->pos[i] = -1;
+    first = arrow_util_random_between_r(seed, 0, n - 1);
+    path->nodes[0] = first;
+    path->pos[first] = 0;
+    path->length = 1;
+
+    for(step = 0; step < max_steps; step++)
+    {
+        /* Checking the clock every step would cost more than the step */
+        if((step % 1024 == 1023) && arrow_context_should_stop(context))
+            return ARROW_FALSE;
+
+        if(path->length == n)
+        {
+            /* Close the cycle if we can.  Otherwise rotate to get a new end
+               node and try again. */
+            last = path->nodes[n - 1];
+            if(posa_is_edge(graph, last, first) &&
+               posa_has_fixed(graph, path))
+                return ARROW_TRUE;
+        }
+        else if(posa_extend(graph, seed, path))
+        {
+            continue;
+        }
+
+        if(!posa_rotate(graph, seed, path))
+            return ARROW_FALSE;
+    }
+    return ARROW_FALSE;
+}
+
+int
+posa_extend(posa_graph *graph, unsigned int *seed, posa_path *path)
+{
+    int i, k, v, deg;
+    int end = path->nodes[path->length - 1];
+    int *adj = graph->adj + graph->start[end];
+
+    /* An unvisited fixed neighbour must come next, or the edge is lost */
+    for(k = 0; k < graph->fixed[end]; k++)
+    {
+        v = adj[k];
+        if(path->pos[v] < 0)
+            goto EXTEND;
+    }
+
+    /* Otherwise scan from a random place for any unvisited neighbour */
+    deg = graph->start[end + 1] - graph->start[end];
+    i = arrow_util_random_between_r(seed, 0, deg - 1);
+    for(k = 0; k < deg; k++)
+    {
+        v = adj[(i + k) % deg];
+        if(path->pos[v] < 0)
+            goto EXTEND;
+    }
+    return ARROW_FALSE;
+
+EXTEND:
+    path->pos[v] = path->length;
+    path->nodes[path->length] = v;
+    path->length++;
+    return ARROW_TRUE;
+}
+
+int
+posa_rotate(posa_graph *graph, unsigned int *seed, posa_path *path)
+{
+    int i, j, k, u, tmp, deg;
+    int last = path->length - 1;
+    int end = path->nodes[last];
+    int *adj = graph->adj + graph->start[end];
+
+    /* Try the end node's neighbours starting from a random place */
+    deg = graph->start[end + 1] - graph->start[end];
+    i = arrow_util_random_between_r(seed, 0, deg - 1);
+    for(k = 0; k < deg; k++)
+    {
+        u = adj[(i + k) % deg];
+        j = path->pos[u];
+
+        /* The pivot must be on the path, not the end's predecessor, and the
+           edge leaving it must not be fixed */
+        if((j < 0) || (j >= last - 1))
+            continue;
+        if(posa_is_fixed(graph, u, path->nodes[j + 1]))
+            continue;
+
+        /* Reverse the path after the pivot */
+        for(j = j + 1; j < last; j++, last--)
+        {
+            tmp = path->nodes[j];
+            path->nodes[j] = path->nodes[last];
+            path->nodes[last] = tmp;
+            path->pos[path->nodes[j]] = j;
+            path->pos[path->nodes[last]] = last;
+        }
+        return ARROW_TRUE;
+    }
+    return ARROW_FALSE;
+}
@@ -9,6 +9,94 @@
 #include "common.h"
 #include "tsp.h"
 
+/* Insertion scoring has an AVX2 kernel on x86 GCC builds; which kernel runs
+   is decided at run time so the library still works on older CPUs. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define RAI_HAVE_AVX2
+    #include <immintrin.h>
+#endif
+
+/* Largest problem for which we keep a dense copy of the cost matrix
+   (4096^2 ints is 64MB); bigger problems go through get_cost instead. */
+#define RAI_DENSE_MAX_SIZE 4096
+
+/****************************************************************************
+ * Private structures
+ ****************************************************************************/
+/**
+ *  @brief  A (partial) tour kept in contiguous arrays.  The cost of every
+ *          tour edge is cached so insertion positions can be scored without
+ *          asking the problem for the cost of the edge being replaced.
+ */
+typedef struct rai_tour
+{
+    int size;       /**< number of nodes currently in the tour */
+    int *nodes;     /**< nodes in tour order, followed by a copy of nodes[0]
+                         so that nodes[k + 1] is always the successor */
+    int *costs;     /**< costs[k] is the cost of edge (nodes[k], nodes[k+1]) */
+} rai_tour;
+
+/**
+ *  @brief  Scores every insertion position for a node against a dense cost
+ *          matrix and collects the positions tied for the best score.
+ *  @param  matrix [in] dense n x n cost matrix, row-major
+ *  @param  n [in] number of nodes in the problem
+ *  @param  tour [in] the partial tour
+ *  @param  v [in] the node to insert
+ *  @param  solve_btsp [in] if ARROW_TRUE, scores are bottlenecks, otherwise
+ *              they are changes in tour length
+ *  @param  alpha [in] largest edge cost in tour (BTSP only)
+ *  @param  beta [in] second largest edge cost in tour (BTSP only)
+ *  @param  int_scores [out] temporary array of size n (BTSP only)
+ *  @param  dbl_scores [out] temporary array of size n (TSP only)
+ *  @param  ins_list [out] positions tied for the best score
+ *  @return the number of positions in ins_list
+ */
+typedef int
+(*rai_score_fun)(const int *matrix, int n, rai_tour *tour, int v,
+                 int solve_btsp, int alpha, int beta, int *int_scores,
+                 double *dbl_scores, int *ins_list);
+
+/**
+ *  @brief  Temporary storage and state private to one RAI worker.
+ */
+typedef struct rai_workspace
+{
+    int *ins_list;          /**< positions tied for the cheapest insertion */
+    arrow_heap edge_heap;   /**< heap of tour edge costs (BTSP only) */
+    unsigned int seed;      /**< random number state */
+    const int *matrix;      /**< dense cost matrix (NULL to use get_cost) */
+    rai_score_fun score;    /**< scoring kernel for the dense matrix */
+    int *int_scores;        /**< per-position scores (BTSP, dense only) */
+    double *dbl_scores;     /**< per-position scores (TSP, dense only) */
+} rai_workspace;
+
+/**
+ *  @brief  Best tour shared between RAI workers.
+ */
+typedef struct rai_shared
+{
+    pthread_mutex_t lock;   /**< guards length and tour */
+    double length;          /**< length (or bottleneck) of the best tour */
+    int *tour;              /**< best tour found by any worker */
+    volatile int done;      /**< set once a worker finds a tour of length 0 */
+} rai_shared;
+
+/**
+ *  @brief  Everything a single RAI worker needs.
+ */
+typedef struct rai_worker
+{
+    arrow_problem *problem;         /**< problem to solve */
+    arrow_tsp_rai_params *params;   /**< RAI parameters */
+    arrow_context *context;         /**< solve context (may be NULL) */
+    rai_shared *shared;             /**< shared best tour */
+    rai_workspace work;             /**< worker's own temporary storage */
+    int iterations;                 /**< improvement iterations to perform */
+    int ret;                        /**< ARROW_SUCCESS unless worker failed */
+} rai_worker;
+
+
 /****************************************************************************
  * Private function prototypes
  ****************************************************************************/
@@ -25,12 +113,12 @@
  *              full tour of n nodes
  *  @param  length [out] the length of the tour (or largest cost in tour
  *              if solve_btsp = ARROW_TRUE)
- *  @param  ins_list [out] a temporary array of pointers to linked list items
+ *  @param  work [out] worker's temporary storage
  */
 void
-construct_tour(arrow_problem *problem, int solve_btsp, int *node_list, 
-               int list_size, arrow_llist *tour, double *length,
-               arrow_llist_item **ins_list);
+construct_tour(arrow_problem *problem, int solve_btsp, int *node_list,
+               int list_size, rai_tour *tour, double *length,
+               rai_workspace *work);
 
 /**
  *  @brief  Attempts to improve upon the given tour by removing a random path
@@ -41,19 +129,107 @@ construct_tour(arrow_problem *problem, int solve_btsp, int *node_list,
  *              minimizing the maximum cost, otherwise constructs tour by
  *              minimizing the largest cost
  *  @param  best_tour [out] the best tour found so far; if a better tour is
- *              found this pointer will be changed to point to the new best
- *              tour
+ *              found it is swapped with tour
  *  @param  length [out] the length of the tour (or largest cost in tour
  *              if solve_btsp = ARROW_TRUE)
  *  @param  tour [out] initially a partial tour, at termination is a
  *              full tour of n nodes
- *  @param  ins_list [out] a temporary array of pointers to linked list items
  *  @param  node_list [out] temporary array of integers of size n
- */           
+ *  @param  work [out] worker's temporary storage
+ */
+void
+improve_tour(arrow_problem *problem, int solve_btsp, rai_tour *best_tour,
+            double *length, rai_tour *tour, int *node_list,
+            rai_workspace *work);
+
+/**
+ *  @brief  Scores insertion positions one at a time (any CPU).
+ */
+int
+score_positions_scalar(const int *matrix, int n, rai_tour *tour, int v,
+                       int solve_btsp, int alpha, int beta, int *int_scores,
+                       double *dbl_scores, int *ins_list);
+
+#ifdef RAI_HAVE_AVX2
+/**
+ *  @brief  Scores insertion positions eight at a time with AVX2 gathers.
+ */
+int
+score_positions_avx2(const int *matrix, int n, rai_tour *tour, int v,
+                     int solve_btsp, int alpha, int beta, int *int_scores,
+                     double *dbl_scores, int *ins_list)
+    __attribute__((target("avx2")));
+#endif
+
+/**
+ *  @brief  Picks the fastest scoring kernel the CPU supports.
+ *  @return scoring kernel
+ */
+rai_score_fun
+select_score_fun();
+
+/**
+ *  @brief  Copies the problem's costs into a dense row-major matrix.
+ *  @param  problem [in] problem data
+ *  @param  matrix [out] n x n cost matrix to create
+ */
+int
+build_dense_matrix(arrow_problem *problem, int **matrix);
+
+/**
+ *  @brief  Runs one RAI worker: builds a tour from a random permutation and
+ *          then tries to improve it.  Matches the pthread start routine
+ *          signature.
+ *  @param  arg [out] the worker's rai_worker structure
+ *  @return NULL
+ */
+void *
+rai_worker_run(void *arg);
+
+/**
+ *  @brief  Replaces the shared best tour if the given tour is better.
+ *  @param  shared [out] shared best tour
+ *  @param  tour [in] a full tour
+ *  @param  length [in] the tour's length (or bottleneck)
+ */
+void
+rai_shared_publish(rai_shared *shared, rai_tour *tour, double length);
+
+/**
+ *  @brief  Replaces the given tour with the shared best tour if the shared
+ *          one is better.
+ *  @param  shared [in] shared best tour
+ *  @param  tour [out] a full tour
+ *  @param  length [out] the tour's length (or bottleneck)
+ */
 void
-improve_tour(arrow_problem *problem, int solve_btsp, arrow_llist *best_tour, 
-            double *length, arrow_llist *tour, arrow_llist_item **ins_list, 
-            int *node_list);
+rai_shared_adopt(rai_shared *shared, rai_tour *tour, double *length);
+
+/**
+ *  @brief  Initializes a tour with room for n nodes.
+ *  @param  n [in] number of nodes in the problem
+ *  @param  tour [out] tour structure
+ */
+int
+rai_tour_init(int n, rai_tour *tour);
+
+/**
+ *  @brief  Destructs a tour structure.
+ *  @param  tour [out] tour structure
+ */
+void
+rai_tour_destruct(rai_tour *tour);
+
+/**
+ *  @brief  Finds the largest and second largest edge costs in the tour.
+ *          The heap is keyed on negated costs, so the largest cost sits at
+ *          the root and the second largest is one of its children.
+ *  @param  edge_heap [in] heap of tour edge costs
+ *  @param  alpha [out] largest edge cost
+ *  @param  beta [out] second largest edge cost
+ */
+void
+edge_heap_top_two(arrow_heap *edge_heap, int *alpha, int *beta);
 
 /**
  *  @brief  Returns the min of the two values
@@ -87,306 +263,745 @@ max3(int i, int j, int k);
 /****************************************************************************
  * Public function implementations
  ****************************************************************************/
-int 
-arrow_tsp_rai_solve(arrow_problem *problem, arrow_tsp_rai_params *params, 
-                    arrow_tsp_result *result)
+void
+arrow_tsp_rai_params_init(arrow_problem *problem,
+                          arrow_tsp_rai_params *params)
+{
+    params->iterations = problem->size * problem->size;
+    params->solve_btsp = ARROW_FALSE;
+    params->threads = 1;
+    params->restart_interval = 0;
+}
+
+int
+arrow_tsp_rai_solve(arrow_problem *problem, arrow_tsp_rai_params *params,
+                    arrow_context *context, arrow_tsp_result *result)
 {
     int ret = ARROW_SUCCESS;
-    int i, u, v;
-    double length;
-    int *order = NULL;
-    int n = problem->size;
+    int i, started;
+    int threads = (params->threads > 1 ? params->threads : 1);
+    int *matrix = NULL;
     double start_time, end_time;
-    arrow_llist best_tour;
-    arrow_llist tour;
-    arrow_llist_item **ins_list = NULL;
-    
+    rai_score_fun score;
+    rai_shared shared;
+    rai_worker *workers = NULL;
+    pthread_t *thread_ids = NULL;
+
     /* Print out RAI parameters */
     arrow_debug("RAI Parameters:\n");
     arrow_debug(" - Iterations: %d\n", params->iterations);
-    arrow_debug(" - Solve BTSP?: %s\n", 
+    arrow_debug(" - Solve BTSP?: %s\n",
                 (params->solve_btsp ? "Yes" : "No"));
-    
+    arrow_debug(" - Threads: %d\n", threads);
+
     start_time = arrow_util_zeit();
-    
+
+    /* Workers publish straight into the result's tour */
+    pthread_mutex_init(&(shared.lock), NULL);
+    shared.length = DBL_MAX;
+    shared.tour = result->tour;
+    shared.done = ARROW_FALSE;
+
+    /* Insertion asks for two costs per tour position, so when the problem
+       fits we pay for every cost once up front and let the workers share a
+       dense copy of the matrix */
+    if(problem->size <= RAI_DENSE_MAX_SIZE)
+    {
+        if(!build_dense_matrix(problem, &matrix))
+        {
+            ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+    }
+    score = select_score_fun();
+
+    if((workers = malloc(threads * sizeof(rai_worker))) == NULL)
+    {
+        arrow_print_error("Error allocating memory for workers array.");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if((thread_ids = malloc(threads * sizeof(pthread_t))) == NULL)
+    {
+        arrow_print_error("Error allocating memory for thread_ids array.");
+        ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+
+    /* Each worker gets its own random stream (seeded from the global one so
+       arrow_util_random_seed still gives repeatable runs) and an even share
+       of the iterations */
+    for(i = 0; i < threads; i++)
+    {
+        workers[i].problem = problem;
+        workers[i].params = params;
+        workers[i].context = context;
+        workers[i].shared = &shared;
+        workers[i].work.seed = (unsigned int)arrow_util_random();
+        workers[i].work.matrix = matrix;
+        workers[i].work.score = score;
+        workers[i].iterations = params->iterations / threads
+            + (i < params->iterations % threads ? 1 : 0);
+        workers[i].ret = ARROW_SUCCESS;
+    }
+
+    if(threads == 1)
+    {
+        rai_worker_run(&(workers[0]));
+    }
+    else
+    {
+        for(started = 0; started < threads; started++)
+        {
+            if(pthread_create(&(thread_ids[started]), NULL, rai_worker_run,
+                              &(workers[started])) != 0)
+            {
+                arrow_print_error("Could not create RAI worker thread.");
+                workers[started].ret = ARROW_FAILURE;
+                shared.done = ARROW_TRUE;
+                break;
+            }
+        }
+        for(i = 0; i < started; i++)
+            pthread_join(thread_ids[i], NULL);
+    }
+    arrow_debug("Finished RAI iterations\n");
+
+    for(i = 0; i < threads; i++)
+    {
+        if(!workers[i].ret)
+            ret = ARROW_FAILURE;
+    }
+
+    end_time = arrow_util_zeit();
+
+    /* Set results */
+    result->total_time = end_time - start_time;
+    result->obj_value = shared.length;
+    result->found_tour = (shared.length < DBL_MAX ? ARROW_TRUE : ARROW_FALSE);
+
+CLEANUP:
+    pthread_mutex_destroy(&(shared.lock));
+    if(thread_ids != NULL) free(thread_ids);
+    if(workers != NULL) free(workers);
+    if(matrix != NULL) free(matrix);
+    return ret;
+}
+
+
+/****************************************************************************
+ * Private function implementations
+ ****************************************************************************/
+void *
+rai_worker_run(void *arg)
+{
+    rai_worker *worker = (rai_worker *)arg;
+    rai_workspace *work = &(worker->work);
+    arrow_problem *problem = worker->problem;
+    int solve_btsp = worker->params->solve_btsp;
+    int restart_interval = worker->params->restart_interval;
+    int i;
+    int n = problem->size;
+    double length, old_length;
+    int *order = NULL;
+    rai_tour best_tour;
+    rai_tour tour;
+
     /* Initialize the arrays */
+    best_tour.nodes = NULL; best_tour.costs = NULL;
+    tour.nodes = NULL; tour.costs = NULL;
+    work->ins_list = NULL;
+    work->int_scores = NULL;
+    work->dbl_scores = NULL;
+    work->edge_heap.keys = NULL;
+    work->edge_heap.values = NULL;
+    work->edge_heap.pos = NULL;
     if(!arrow_util_create_int_array(n, &order))
-        return ARROW_FAILURE;
-    if((ins_list = malloc(n * sizeof(arrow_llist_item *))) == NULL)
     {
-        arrow_print_error("Error allocating memory for ins_list array.");
-        ins_list = NULL;
-        ret = ARROW_FAILURE;
+        worker->ret = ARROW_FAILURE;
         goto CLEANUP;
     }
-        
+    if(!arrow_util_create_int_array(n, &(work->ins_list)))
+    {
+        worker->ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if(!rai_tour_init(n, &best_tour) || !rai_tour_init(n, &tour))
+    {
+        worker->ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if(!arrow_heap_init(&(work->edge_heap), n))
+    {
+        worker->ret = ARROW_FAILURE;
+        goto CLEANUP;
+    }
+    if(work->matrix != NULL)
+    {
+        if(!arrow_util_create_int_array(n, &(work->int_scores)))
+        {
+            worker->ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+        if((work->dbl_scores = malloc(n * sizeof(double))) == NULL)
+        {
+            arrow_print_error("Error allocating memory for dbl_scores array.");
+            worker->ret = ARROW_FAILURE;
+            goto CLEANUP;
+        }
+    }
+
     /* Start by creating a random permutation of numbers from 0 to n-1.  This
        order will be the order we process nodes for the initial tour */
     for(i = 0; i < n; i++) order[i] = i;
-    arrow_util_permute_array(n, order);
-    
-    /* We store our constructed tour in a linked list.  Initially, we insert
-       the last two nodes from our random permutation, and find the largest
-       cost in the two node cycle. */
-    u = order[n - 2];
-    v = order[n - 1];
-    arrow_llist_init(&best_tour);
-    arrow_llist_init(&tour);
-    arrow_llist_insert_tail(&best_tour, u);
-    arrow_llist_insert_tail(&best_tour, v);
+    arrow_util_permute_array_r(&(work->seed), n, order);
 
     /* Using a node-insertion heuristic, build a starting tour in the
-       cheapest way possible. */
-    construct_tour(problem, params->solve_btsp, order, n - 2, &best_tour, 
-                   &length, ins_list);
+       cheapest way possible.  The last two nodes from our random permutation
+       form the initial two node cycle. */
+    construct_tour(problem, solve_btsp, order, n, &best_tour, &length, work);
     arrow_debug("Constructed initial tour (length: %.0f)\n", length);
-    
+    rai_shared_publish(worker->shared, &best_tour, length);
+
     /* Now we randomly remove chunks from the best tour, replace them into
        a new tour, and see if we can get a better solution */
-    for(i = 1; i <= params->iterations; i++)
+    for(i = 1; i <= worker->iterations; i++)
     {
-        /* See if we found a tour of length 0 (we stop then!) */
-        if(length == 0.0)
+        /* See if any worker found a tour of length 0 (we stop then!) */
+        if((length == 0.0) || worker->shared->done)
+            break;
+
+        /* Hand back the best tour so far if we've been asked to stop */
+        if(arrow_context_should_stop(worker->context))
+        {
+            arrow_debug("Stopping after %d RAI iterations\n", i - 1);
             break;
-        improve_tour(problem, params->solve_btsp, &best_tour, &length, &tour,
-                     ins_list, order);
+        }
+
+        /* Every so often, pick up from the best tour any worker has found */
+        if((restart_interval > 0) && (i % restart_interval == 0))
+            rai_shared_adopt(worker->shared, &best_tour, &length);
+
+        old_length = length;
+        improve_tour(problem, solve_btsp, &best_tour, &length, &tour,
+                     order, work);
+        if(length < old_length)
+            rai_shared_publish(worker->shared, &best_tour, length);
     }
-    arrow_debug("Finished RAI iterations\n");
-    
-    end_time = arrow_util_zeit();
-    
-    /* Set results */
-    result->total_time = end_time - start_time;
-    result->obj_value = length;
-    result->found_tour = ARROW_TRUE;
-    arrow_llist_to_array(&best_tour, result->tour);    
-    
+
 CLEANUP:
-    arrow_llist_destruct(&best_tour);
-    arrow_llist_destruct(&tour);
-    if(ins_list != NULL) free(ins_list);
+    rai_tour_destruct(&best_tour);
+    rai_tour_destruct(&tour);
+    arrow_heap_destruct(&(work->edge_heap));
+    if(work->ins_list != NULL) free(work->ins_list);
+    if(work->int_scores != NULL) free(work->int_scores);
+    if(work->dbl_scores != NULL) free(work->dbl_scores);
     if(order != NULL) free(order);
-    return ret;
+    return NULL;
 }
 
+void
+rai_shared_publish(rai_shared *shared, rai_tour *tour, double length)
+{
+    pthread_mutex_lock(&(shared->lock));
+    if(length < shared->length)
+    {
+        shared->length = length;
+        memcpy(shared->tour, tour->nodes, tour->size * sizeof(int));
+        if(length == 0.0)
+            shared->done = ARROW_TRUE;
+    }
+    pthread_mutex_unlock(&(shared->lock));
+}
+
+void
+rai_shared_adopt(rai_shared *shared, rai_tour *tour, double *length)
+{
+    pthread_mutex_lock(&(shared->lock));
+    if(shared->length < *length)
+    {
+        *length = shared->length;
+        memcpy(tour->nodes, shared->tour, tour->size * sizeof(int));
+    }
+    pthread_mutex_unlock(&(shared->lock));
+}
 
-/****************************************************************************
- * Private function implementations
- ****************************************************************************/
 void
-improve_tour(arrow_problem *problem, int solve_btsp, arrow_llist *best_tour, 
-            double *length, arrow_llist *tour, arrow_llist_item **ins_list, 
-            int *node_list)
+improve_tour(arrow_problem *problem, int solve_btsp, rai_tour *best_tour,
+            double *length, rai_tour *tour, int *node_list,
+            rai_workspace *work)
 {
-    int j, u, v;
+    int j, k, u, v;
+    int n = best_tour->size;
     double new_length;
-    arrow_llist_item *node;
-    
+    rai_tour swap;
+
     /* Pick two nodes at random (can be the same node!) */
-    u = arrow_util_random_between(0, problem->size - 1);
-    v = arrow_util_random_between(0, problem->size - 1);
-    
-    /* Find u in the linked list */
-    node = best_tour->head;
-    while(node != NULL)
+    u = arrow_util_random_between_r(&(work->seed), 0, problem->size - 1);
+    v = arrow_util_random_between_r(&(work->seed), 0, problem->size - 1);
+
+    /* Find u in the tour */
+    for(k = 0; k < n; k++)
     {
-        if(node->data == u)
+        if(best_tour->nodes[k] == u)
             break;
-        node = node->next;
     }
-    
+
     /* Start inserting nodes from u to v into an array */
     j = 0;
     while(1)
     {
-        node_list[j] = node->data;
+        node_list[j] = best_tour->nodes[k];
         j++;
-        
-        if(node->data == v)
-            break;    
 
-        if(node->next == NULL)
-            node = best_tour->head;
-        else
-            node = node->next;
+        if(best_tour->nodes[k] == v)
+            break;
+
+        k = (k + 1 == n ? 0 : k + 1);
     }
-    
-    /* Ensure linked list is empty */
-    arrow_llist_destruct(tour);
-    
-    /* Insert the rest of the tour into a new linked list */
-    if(node->next == NULL)
-        node = best_tour->head;
-    else
-        node = node->next;
 
-    while(1)
+    /* Copy the rest of the tour over as the new partial tour */
+    tour->size = 0;
+    k = (k + 1 == n ? 0 : k + 1);
+    while(best_tour->nodes[k] != u)
     {
-        if(node->data == u)
-            break;
-        
-        arrow_llist_insert_tail(tour, node->data);
-        
-        if(node->next == NULL)
-            node = best_tour->head;
-        else
-            node = node->next;
+        tour->nodes[tour->size] = best_tour->nodes[k];
+        tour->size++;
+        k = (k + 1 == n ? 0 : k + 1);
     }
-    
+
     /* Determine new insertion order */
-    arrow_util_permute_array(j, node_list);
-    
+    arrow_util_permute_array_r(&(work->seed), j, node_list);
+
     /* Finally, reinsert all those removed nodes back into the tour */
-    construct_tour(problem, solve_btsp, node_list, j, tour, 
-                   &new_length, ins_list);
-    
+    construct_tour(problem, solve_btsp, node_list, j, tour, &new_length, work);
+
     /* See if we found a better tour */
     if(new_length < *length)
     {
         arrow_debug("Better tour found! (length: %.0f)\n", new_length);
         *length = new_length;
-        arrow_llist_swap(best_tour, tour);
+        swap = *best_tour;
+        *best_tour = *tour;
+        *tour = swap;
     }
 }
 
 void
-construct_tour(arrow_problem *problem, int solve_btsp, int *node_list, 
-               int list_size, arrow_llist *tour, double *length,
-               arrow_llist_item **ins_list)
+construct_tour(arrow_problem *problem, int solve_btsp, int *node_list,
+               int list_size, rai_tour *tour, double *length,
+               rai_workspace *work)
 {
-    int i, j, u, v, w;
+    int i, j, k, u, v, w;
     int cost, in_cost, out_cost;
     double best_cost, ins_cost;
     int alpha, beta;
-    arrow_llist_item *node;
-    
+    int n = problem->size;
+    int *nodes = tour->nodes;
+    int *costs = tour->costs;
+    int *ins_list = work->ins_list;
+    const int *matrix = work->matrix;
+    arrow_heap *edge_heap = &(work->edge_heap);
+
     /* If our partial tour has less than two nodes, then we'll pick off the
        last two nodes from the randomized node_list until we have at least two
        nodes to work with. */
-    while(tour->size  < 2)
+    while(tour->size < 2)
     {
-        arrow_llist_insert_tail(tour, node_list[list_size - 1]);
+        nodes[tour->size] = node_list[list_size - 1];
+        tour->size++;
         list_size--;
     }
-    
-    /* If we're solving for the BTSP, then we need to find the largest
-       and second largest costs.  Otherwise, we want the total length. */
-    node = tour->head;
+    nodes[tour->size] = nodes[0];
+
+    /* Cache the cost of each edge in the partial tour.  If we're solving
+       for the BTSP, we also keep the costs in a heap (keyed by the edge's
+       tail node) so the largest and second largest costs are always at hand.
+       Otherwise, we want the total length. */
+    if(solve_btsp)
+        arrow_heap_empty(edge_heap);
+    *length = 0.0;
+    for(k = 0; k < tour->size; k++)
+    {
+        u = nodes[k];
+        w = nodes[k + 1];
+        costs[k] = (matrix != NULL ? matrix[u * n + w]
+                                   : problem->get_cost(problem, u, w));
+        *length += costs[k];
+        if(solve_btsp)
+            arrow_heap_insert(edge_heap, -costs[k], u);
+    }
     alpha = INT_MIN;
     beta = INT_MIN;
-    *length = 0.0;
-    while(node != NULL)
+    if(solve_btsp)
+        edge_heap_top_two(edge_heap, &alpha, &beta);
+
+    /* Find the best place to insert the left over nodes */
+    for(i = 0; i < list_size; i++)
     {
-        u = node->data;
-        if(node->next == NULL)
-            v = tour->head->data;
+        /* The current node is v, we want to insert between nodes u and w. */
+        v = node_list[i];
+
+        if(matrix != NULL)
+        {
+            j = work->score(matrix, n, tour, v, solve_btsp, alpha, beta,
+                            work->int_scores, work->dbl_scores, ins_list);
+        }
         else
-            v = node->next->data;
-        cost = problem->get_cost(problem, u, v);
+        {
+            best_cost = DBL_MAX;
+            j = 0;
+            for(k = 0; k < tour->size; k++)
+            {
+                u = nodes[k];
+                w = nodes[k + 1];
+
+                cost = costs[k];
+                in_cost = problem->get_cost(problem, u, v);
+                out_cost = problem->get_cost(problem, v, w);
+
+                if(solve_btsp)
+                {
+                    if(cost == alpha)
+                        ins_cost = max3(beta, in_cost, out_cost);
+                    else
+                        ins_cost = max3(alpha, in_cost, out_cost);
+                }
+                else
+                {
+                    ins_cost = *length + in_cost + out_cost - cost;
+                }
+
+                /* When looking for the best spot to insert v, we keep a list
+                   of all the best spots (in ins_list).  Later on, we'll pick
+                   one at random */
+                if(ins_cost < best_cost)
+                {
+                    best_cost = ins_cost;
+                    ins_list[0] = k;
+                    j = 1;
+                }
+                else if(ins_cost == best_cost)
+                {
+                    ins_list[j] = k;
+                    j++;
+                }
+            }
+        }
 
-        *length += cost;
-        if(cost > alpha)
+        /* Of the available spots to place the node, we pick one randomly */
+        j = arrow_util_random_between_r(&(work->seed), 0, j - 1);
+        k = ins_list[j];
+        u = nodes[k];
+        w = nodes[k + 1];
+        cost = costs[k];
+        if(matrix != NULL)
         {
-            beta = alpha;
-            alpha = cost;
+            in_cost = matrix[u * n + v];
+            out_cost = matrix[v * n + w];
         }
-        else if(cost > beta)
+        else
         {
-            beta = cost;
+            in_cost = problem->get_cost(problem, u, v);
+            out_cost = problem->get_cost(problem, v, w);
         }
 
-        node = node->next;
+        /* Open up a slot after position k (moving the trailing copy of
+           nodes[0] along with everything else) and place v in it */
+        memmove(nodes + k + 2, nodes + k + 1,
+                (tour->size - k) * sizeof(int));
+        memmove(costs + k + 2, costs + k + 1,
+                (tour->size - k - 1) * sizeof(int));
+        nodes[k + 1] = v;
+        costs[k] = in_cost;
+        costs[k + 1] = out_cost;
+        tour->size++;
+
+        /* Update alpha and beta, or the length */
+        if(solve_btsp)
+        {
+            arrow_heap_change_key(edge_heap, -in_cost, u);
+            arrow_heap_insert(edge_heap, -out_cost, v);
+            edge_heap_top_two(edge_heap, &alpha, &beta);
+        }
+        else
+        {
+            *length += in_cost + out_cost - cost;
+        }
     }
-    
-    /* Find the best place to insert the left over nodes */    
-    for(i = 0; i < list_size; i++)
+
+    /* If we're solving BTSP, return the length as the largest cost */
+    if(solve_btsp)
     {
-        /* Te current node  is v, we want to insert between nodes u and w. */
-        v = node_list[i];    
-        
-        best_cost = DBL_MAX;
-        node = tour->head;
-        while(node != NULL)
+        *length = alpha;
+    }
+}
+
+int
+score_positions_scalar(const int *matrix, int n, rai_tour *tour, int v,
+                       int solve_btsp, int alpha, int beta, int *int_scores,
+                       double *dbl_scores, int *ins_list)
+{
+    int j, k;
+    int score, best_score;
+    double delta, best_delta;
+    int *nodes = tour->nodes;
+    int *costs = tour->costs;
+    const int *col_v = matrix + v;
+    const int *row_v = matrix + v * n;
+
+    j = 0;
+    if(solve_btsp)
+    {
+        best_score = INT_MAX;
+        for(k = 0; k < tour->size; k++)
         {
-            u = node->data;
-            if(node->next == NULL)
-                w = tour->head->data;
-            else
-                w = node->next->data;
-            
-            cost = problem->get_cost(problem, u, w);
-            in_cost = problem->get_cost(problem, u, v);
-            out_cost = problem->get_cost(problem, v, w);
-            
-            if(solve_btsp)
+            score = max3((costs[k] == alpha ? beta : alpha),
+                         col_v[nodes[k] * n], row_v[nodes[k + 1]]);
+            if(score < best_score)
             {
-                if(cost == alpha)
-                    ins_cost = max3(beta, in_cost, out_cost);
-                else
-                    ins_cost = max3(alpha, in_cost, out_cost);
+                best_score = score;
+                ins_list[0] = k;
+                j = 1;
             }
-            else
+            else if(score == best_score)
             {
-                ins_cost = *length + in_cost + out_cost - cost;
+                ins_list[j] = k;
+                j++;
             }
-            
-            /* When looking for the best spot to insert v, we keep a list of
-               all the best spots (in ins_list).  Later on, we'll pick one at 
-               random */
-            if(ins_cost < best_cost)
+        }
+    }
+    else
+    {
+        best_delta = DBL_MAX;
+        for(k = 0; k < tour->size; k++)
+        {
+            delta = (double)col_v[nodes[k] * n]
+                  + (double)row_v[nodes[k + 1]] - (double)costs[k];
+            if(delta < best_delta)
             {
-                best_cost = ins_cost;
-                ins_list[0] = node;
+                best_delta = delta;
+                ins_list[0] = k;
                 j = 1;
             }
-            else if(ins_cost == best_cost)
+            else if(delta == best_delta)
             {
-                ins_list[j] = node;
+                ins_list[j] = k;
                 j++;
             }
-            
-            node = node->next;
         }
-        
-        /* Of the available spots to place the node, we pick one randomly */
-        j = arrow_util_random_between(0, j - 1);
-        node = ins_list[j];
-        arrow_llist_insert_after(tour, node, v);
-        
-        /* Update alpha and beta, and the length */
-        node = tour->head;
-        alpha = INT_MIN;
-        beta = INT_MIN;
-        *length = 0.0;
-        while(node != NULL)
+    }
+    return j;
+}
+
+#ifdef RAI_HAVE_AVX2
+int
+score_positions_avx2(const int *matrix, int n, rai_tour *tour, int v,
+                     int solve_btsp, int alpha, int beta, int *int_scores,
+                     double *dbl_scores, int *ins_list)
+{
+    int j, k, mask;
+    int size = tour->size;
+    int *nodes = tour->nodes;
+    int *costs = tour->costs;
+    const int *col_v = matrix + v;
+    const int *row_v = matrix + v * n;
+    int best_score, lanes[8];
+    double best_delta, dlanes[4];
+    __m256i vn = _mm256_set1_epi32(n);
+    __m256i u8, w8, in8, out8, c8, base8, s8, best8, alpha8, beta8;
+    __m256d delta_lo, delta_hi, bestd;
+
+    /* First pass scores every position, eight at a time.  The cost into v
+       comes from column v (gathered at offsets u * n) and the cost out of v
+       from row v (gathered at offsets w).  The second pass collects every
+       position tied for the best score. */
+    j = 0;
+    if(solve_btsp)
+    {
+        alpha8 = _mm256_set1_epi32(alpha);
+        beta8 = _mm256_set1_epi32(beta);
+        best8 = _mm256_set1_epi32(INT_MAX);
+        for(k = 0; k + 8 <= size; k += 8)
+        {
+            u8 = _mm256_loadu_si256((__m256i *)(nodes + k));
+            w8 = _mm256_loadu_si256((__m256i *)(nodes + k + 1));
+            c8 = _mm256_loadu_si256((__m256i *)(costs + k));
+            in8 = _mm256_i32gather_epi32(col_v,
+                                         _mm256_mullo_epi32(u8, vn), 4);
+            out8 = _mm256_i32gather_epi32(row_v, w8, 4);
+            base8 = _mm256_blendv_epi8(alpha8, beta8,
+                                       _mm256_cmpeq_epi32(c8, alpha8));
+            s8 = _mm256_max_epi32(base8, _mm256_max_epi32(in8, out8));
+            _mm256_storeu_si256((__m256i *)(int_scores + k), s8);
+            best8 = _mm256_min_epi32(best8, s8);
+        }
+        _mm256_storeu_si256((__m256i *)lanes, best8);
+        best_score = INT_MAX;
+        for(j = 0; j < 8; j++)
+            if(lanes[j] < best_score) best_score = lanes[j];
+        for(; k < size; k++)
         {
-            u = node->data;
-            if(node->next == NULL)
-                w = tour->head->data;
-            else
-                w = node->next->data;
-            cost = problem->get_cost(problem, u, w);
-            
-            *length += cost;
-            if(cost > alpha)
+            int_scores[k] = max3((costs[k] == alpha ? beta : alpha),
+                                 col_v[nodes[k] * n], row_v[nodes[k + 1]]);
+            if(int_scores[k] < best_score) best_score = int_scores[k];
+        }
+
+        j = 0;
+        best8 = _mm256_set1_epi32(best_score);
+        for(k = 0; k + 8 <= size; k += 8)
+        {
+            s8 = _mm256_loadu_si256((__m256i *)(int_scores + k));
+            mask = _mm256_movemask_ps(
+                       _mm256_castsi256_ps(_mm256_cmpeq_epi32(s8, best8)));
+            while(mask)
             {
-                beta = alpha;
-                alpha = cost;
+                ins_list[j] = k + __builtin_ctz(mask);
+                j++;
+                mask &= mask - 1;
             }
-            else if(cost > beta)
+        }
+        for(; k < size; k++)
+        {
+            if(int_scores[k] == best_score)
             {
-                beta = cost;
+                ins_list[j] = k;
+                j++;
             }
-            
-            node = node->next;
         }
     }
-    
-    /* If we're solving BTSP, return the length as the largest cost */
-    if(solve_btsp)
+    else
     {
-        *length = alpha;
+        /* Changes in length are summed in double precision, like the
+           scalar code, so large costs can't overflow */
+        bestd = _mm256_set1_pd(DBL_MAX);
+        for(k = 0; k + 8 <= size; k += 8)
+        {
+            u8 = _mm256_loadu_si256((__m256i *)(nodes + k));
+            w8 = _mm256_loadu_si256((__m256i *)(nodes + k + 1));
+            c8 = _mm256_loadu_si256((__m256i *)(costs + k));
+            in8 = _mm256_i32gather_epi32(col_v,
+                                         _mm256_mullo_epi32(u8, vn), 4);
+            out8 = _mm256_i32gather_epi32(row_v, w8, 4);
+            delta_lo = _mm256_sub_pd(
+                _mm256_add_pd(
+                    _mm256_cvtepi32_pd(_mm256_castsi256_si128(in8)),
+                    _mm256_cvtepi32_pd(_mm256_castsi256_si128(out8))),
+                _mm256_cvtepi32_pd(_mm256_castsi256_si128(c8)));
+            delta_hi = _mm256_sub_pd(
+                _mm256_add_pd(
+                    _mm256_cvtepi32_pd(_mm256_extracti128_si256(in8, 1)),
+                    _mm256_cvtepi32_pd(_mm256_extracti128_si256(out8, 1))),
+                _mm256_cvtepi32_pd(_mm256_extracti128_si256(c8, 1)));
+            _mm256_storeu_pd(dbl_scores + k, delta_lo);
+            _mm256_storeu_pd(dbl_scores + k + 4, delta_hi);
+            bestd = _mm256_min_pd(bestd, _mm256_min_pd(delta_lo, delta_hi));
+        }
+        _mm256_storeu_pd(dlanes, bestd);
+        best_delta = DBL_MAX;
+        for(j = 0; j < 4; j++)
+            if(dlanes[j] < best_delta) best_delta = dlanes[j];
+        for(; k < size; k++)
+        {
+            dbl_scores[k] = (double)col_v[nodes[k] * n]
+                          + (double)row_v[nodes[k + 1]] - (double)costs[k];
+            if(dbl_scores[k] < best_delta) best_delta = dbl_scores[k];
+        }
+
+        j = 0;
+        bestd = _mm256_set1_pd(best_delta);
+        for(k = 0; k + 4 <= size; k += 4)
+        {
+            mask = _mm256_movemask_pd(
+                       _mm256_cmp_pd(_mm256_loadu_pd(dbl_scores + k), bestd,
+                                     _CMP_EQ_OQ));
+            while(mask)
+            {
+                ins_list[j] = k + __builtin_ctz(mask);
+                j++;
+                mask &= mask - 1;
+            }
+        }
+        for(; k < size; k++)
+        {
+            if(dbl_scores[k] == best_delta)
+            {
+                ins_list[j] = k;
+                j++;
+            }
+        }
+    }
+    return j;
+}
+#endif
+
+rai_score_fun
+select_score_fun()
+{
+#ifdef RAI_HAVE_AVX2
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return score_positions_avx2;
+#endif
+    return score_positions_scalar;
+}
+
+int
+build_dense_matrix(arrow_problem *problem, int **matrix)
+{
+    int i, j;
+    int n = problem->size;
+    int *row;
+
+    if((*matrix = malloc(n * n * sizeof(int))) == NULL)
+    {
+        arrow_print_error("Error allocating memory for dense cost matrix.");
+        return ARROW_FAILURE;
+    }
+    for(i = 0; i < n; i++)
+    {
+        row = *matrix + i * n;
+        for(j = 0; j < n; j++)
+            row[j] = (i == j ? 0 : problem->get_cost(problem, i, j));
     }
+    return ARROW_SUCCESS;
+}
+
+int
+rai_tour_init(int n, rai_tour *tour)
+{
+    tour->size = 0;
+    if(!arrow_util_create_int_array(n + 1, &(tour->nodes)))
+        return ARROW_FAILURE;
+    if(!arrow_util_create_int_array(n, &(tour->costs)))
+        return ARROW_FAILURE;
+    return ARROW_SUCCESS;
+}
+
+void
+rai_tour_destruct(rai_tour *tour)
+{
+    if(tour->nodes != NULL)
+    {
+        free(tour->nodes);
+        tour->nodes = NULL;
+    }
+    if(tour->costs != NULL)
+    {
+        free(tour->costs);
+        tour->costs = NULL;
+    }
+}
+
+void
+edge_heap_top_two(arrow_heap *edge_heap, int *alpha, int *beta)
+{
+    *alpha = -(edge_heap->keys[0]);
+    *beta = INT_MIN;
+    if(edge_heap->size > 1)
+        *beta = -(edge_heap->keys[1]);
+    if((edge_heap->size > 2) && (-(edge_heap->keys[2]) > *beta))
+        *beta = -(edge_heap->keys[2]);
 }
 
 int
@@ -413,4 +1028,3 @@ max3(int i, int j, int k)
     if(max < k) max = k;
     return max;
 }
-
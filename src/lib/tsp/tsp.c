@@ -14,26 +14,33 @@
  *  @param  tsp_solver [in] the TSP solver to use
  *  @param  problem [in] problem to solve
  *  @param  params [in] Lin-Kernighan params (can be NULL)
+ *  @param  context [in] solve context (can be NULL)
  *  @param  result [out] TSP solution
  */                  
 int
 arrow_tsp_solve(int tsp_solver, arrow_problem *problem, void *params,
-                      arrow_tsp_result *result)
+                arrow_context *context, arrow_tsp_result *result)
 {
     switch(tsp_solver)
     {
         case ARROW_TSP_CC_EXACT:
-            return arrow_tsp_cc_exact_solve(problem, (int *)params, result);
+            return arrow_tsp_cc_exact_solve(problem, (int *)params, context,
+                                            result);
             break;
         case ARROW_TSP_CC_LK:
             return arrow_tsp_cc_lk_solve(problem, 
                                          (arrow_tsp_cc_lk_params *)params, 
-                                         result);
+                                         context, result);
             break;
         case ARROW_TSP_RAI:
             return arrow_tsp_rai_solve(problem,
                                        (arrow_tsp_rai_params *)params,
-                                       result);
+                                       context, result);
+            break;
+        case ARROW_TSP_POSA:
+            return arrow_tsp_posa_solve(problem,
+                                        (arrow_tsp_posa_params *)params,
+                                        context, result);
             break;
         default:
             arrow_print_error("TSP solver type %d not supported", tsp_solver);
@@ -52,6 +59,8 @@ arrow_tsp_short_name(int tsp_solver, FILE *out)
             fprintf(out, "cc_lk"); break;
         case ARROW_TSP_RAI:
             fprintf(out, "rai"); break;            
+        case ARROW_TSP_POSA:
+            fprintf(out, "posa"); break;
         default:
             arrow_print_error("TSP solver type %d not supported", tsp_solver);
     }
@@ -68,6 +77,8 @@ arrow_tsp_long_name(int tsp_solver, FILE *out)
             fprintf(out, "CC Lin-Kernighan"); break;
         case ARROW_TSP_RAI:
             fprintf(out, "RAI Solver"); break;
+        case ARROW_TSP_POSA:
+            fprintf(out, "Posa Rotation-Extension"); break;
         default:
             arrow_print_error("TSP solver type %d not supported", tsp_solver);
     }